@@ -1,5 +1,12 @@
 CHECK_REQUIRED_LIB(FFTW3F fftw3f fftw3.h libfftw3f-3 "")
 CHECK_REQUIRED_LIB(FFTW3D fftw3 fftw3.h libfftw3-3  "")
+# multithreaded fftw is optional, builds without the threads library fall back to single threaded transforms
+if(ENABLE_FFTW_THREADS)
+	FIND_LIBRARY(FFTW3F_THREADS_LIBRARY NAMES fftw3f_threads libfftw3f_threads-3 PATHS $ENV{FFTW3F_THREADSDIR}/lib ${EMAN_PREFIX_LIB})
+	if(NOT FFTW3F_THREADS_LIBRARY)
+		message(STATUS "fftw3f_threads not found, building without multithreaded fftw")
+	endif()
+endif()
 
 include(FindPackageHandleStandardArgs)
 find_package_handle_standard_args(FFTW3
@@ -26,4 +33,8 @@ if(FFTW3_FOUND AND NOT TARGET FFTW3 AND NOT TARGET FFTW3F AND NOT TARGET FFTW3D)
 						  INTERFACE_COMPILE_DEFINITIONS USE_FFTW3
 						  )
 	target_link_libraries(FFTW3 INTERFACE FFTW3F::FFTW3F FFTW3D::FFTW3D)
+	if(ENABLE_FFTW_THREADS AND FFTW3F_THREADS_LIBRARY)
+		target_link_libraries(FFTW3 INTERFACE ${FFTW3F_THREADS_LIBRARY})
+		target_compile_definitions(FFTW3 INTERFACE FFTW_THREADS)
+	endif()
 endif()
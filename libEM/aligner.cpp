@@ -182,7 +182,7 @@ EMData* ScaleAlignerABS::align_using_base(EMData * this_img, EMData * to,
 			delete aligned;
 		}
 		//clean up scaled image data
-		delete des_data;
+		EMUtil::em_free(des_data);
 
 		t.set_scale(i);
 
@@ -231,7 +231,7 @@ EMData* ScaleAligner::align(EMData * this_img, EMData *to,
 			bestscale = i;
 		}
 		//clean up scaled image data
-		delete des_data;
+		EMUtil::em_free(des_data);
 
 		t.set_scale(i);
 
@@ -503,10 +503,8 @@ EMData *RotationalAligner::align(EMData * this_img, EMData *to,
 	int ambig180 = params.set_default("ambig180",0);
 
 	EMData* rot_aligned = RotationalAligner::align_180_ambiguous(this_img,to,rfp_mode,zscore);
-	Transform * tmp = rot_aligned->get_attr("xform.align2d");
-	Dict rot = tmp->get_rotation("2d");
+	Dict rot = rot_aligned->get_attr_transform(EMData::ATTR_XFORM_ALIGN2D).get_rotation("2d");
 	float rotate_angle_solution = rot["alpha"];
-	delete tmp;
 
 	// Don't resolve the 180 degree ambiguity here
 	if (ambig180) {
@@ -649,17 +647,13 @@ EMData *RotateTranslateAlignerIterative::align(EMData * this_img, EMData *to,
 
 		// First do a translational alignment
 		EMData * trans_align = moving_img->align("translational", to, trans_params, cmp_name, cmp_params);
-		Transform * tt = trans_align->get_attr("xform.align2d");
-		t = *tt*t;
-		delete tt;
+		t = trans_align->get_attr_transform(EMData::ATTR_XFORM_ALIGN2D)*t;
 
 		//now do rotation
 		EMData * rottrans_align = trans_align->align("rotational_iterative", to, rot_params, cmp_name, cmp_params);
-		Transform * rt = rottrans_align->get_attr("xform.align2d");
-		t = *rt*t;
+		t = rottrans_align->get_attr_transform(EMData::ATTR_XFORM_ALIGN2D)*t;
 		delete trans_align; trans_align = 0;
 		delete rottrans_align; rottrans_align = 0;
-		delete rt;
 
 		//this minimizes interpolation errors (all images that are futher processed will be interpolated at most twice)
 		if(it > 0){delete moving_img;}
@@ -766,10 +760,8 @@ EMData *RotateTranslateAligner::align(EMData * this_img, EMData *to,
 	int zscore = params.set_default("zscore",0);
 	int rfp_mode = params.set_default("rfp_mode",2);
 	EMData *rot_align  =  RotationalAligner::align_180_ambiguous(this_img,to,rfp_mode,zscore);
-	Transform * tmp = rot_align->get_attr("xform.align2d");
-	Dict rot = tmp->get_rotation("2d");
+	Dict rot = rot_align->get_attr_transform(EMData::ATTR_XFORM_ALIGN2D).get_rotation("2d");
 	float rotate_angle_solution = rot["alpha"];
-	delete tmp;
 
 	EMData *rot_align_180 = rot_align->process("math.rotate.180");
 
@@ -830,10 +822,8 @@ EMData *RotateTranslateAlignerBispec::align(EMData * this_img, EMData *to, const
 	int rfp = params.set_default("rfpn",4);			// rfpn and size were determined empirically. rfpn<4 shows obvious alignment shifts
 	int size = params.set_default("size",16);		// size=32 and size=16 seem generally to give equivalent results
 	EMData *rot_align  =  this_img->align("rotational_bispec", to,Dict("rfpn",rfp,"size",size));
-	Transform * tmp = rot_align->get_attr("xform.align2d");
-	Dict rot = tmp->get_rotation("2d");
+	Dict rot = rot_align->get_attr_transform(EMData::ATTR_XFORM_ALIGN2D).get_rotation("2d");
 	float rotate_angle_solution = rot["alpha"];
-	delete tmp;
 
 	Dict trans_params;
 	trans_params["intonly"]  = false;
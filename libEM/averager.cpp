@@ -993,12 +993,13 @@ void CtfCWautoAverager::add_image(EMData * image)
 		result->to_zero();
 	}
 
-	Ctf *ctf = (Ctf *)image->get_attr("ctf");
+	const Ctf *src_ctf = image->get_attr_ctf();
+	if (!src_ctf) throw NotExistingObjectException("ctf", "The image has no CTF parameters");
+	CtfCopy ctf(src_ctf);		// local copy, so the bfactor change below doesn't touch the image's cached Ctf
 //string cc=ctf->to_string();
 //FILE *out=fopen("ctf.txt","a");
 //fprintf(out,"%s\n",cc.c_str());
 //fclose(out);
-	float b=ctf->bfactor;
 	ctf->bfactor=100.0;			// FIXME - this is a temporary fixed B-factor which does a (very) little sharpening
 
 //	if (nimg==1) unlink("snr.hdf");
@@ -1009,8 +1010,6 @@ void CtfCWautoAverager::add_image(EMData * image)
 	EMData *ctfi = result-> copy();
 	ctf->compute_2d_complex(ctfi,Ctf::CTF_AMP);
 
-	ctf->bfactor=b;	// return to its original value
-
 	float *outd = result->get_data();
 	float *ind = fft->get_data();
 	float *snrd = snr->get_data();
@@ -1039,7 +1038,6 @@ void CtfCWautoAverager::add_image(EMData * image)
 	snr->process_inplace("math.absvalue");
 	snrsum->add(*snr);
 
-	delete ctf;
 	delete fft;
 	delete snr;
 	delete ctfi;
@@ -1112,8 +1110,9 @@ void CtfCAutoAverager::add_image(EMData * image)
 		result->to_zero();
 	}
 
-	Ctf *ctf = (Ctf *)image->get_attr("ctf");
-	float b=ctf->bfactor;
+	const Ctf *src_ctf = image->get_attr_ctf();
+	if (!src_ctf) throw NotExistingObjectException("ctf", "The image has no CTF parameters");
+	CtfCopy ctf(src_ctf);		// local copy, so the bfactor change below doesn't touch the image's cached Ctf
 	ctf->bfactor=0;			// NO B-FACTOR CORRECTION !
 
 	EMData *snr = result -> copy();
@@ -1121,8 +1120,6 @@ void CtfCAutoAverager::add_image(EMData * image)
 	EMData *ctfi = result-> copy();
 	ctf->compute_2d_complex(ctfi,Ctf::CTF_AMP);
 
-	ctf->bfactor=b;	// return to its original value
-
 	float *outd = result->get_data();
 	float *ind = fft->get_data();
 	float *snrd = snr->get_data();
@@ -1154,7 +1151,6 @@ void CtfCAutoAverager::add_image(EMData * image)
 	snr->process_inplace("math.absvalue");
 	snrsum->add(*snr);
 
-	delete ctf;
 	delete fft;
 	delete snr;
 	delete ctfi;
@@ -1236,13 +1232,13 @@ void CtfWtAverager::add_image(EMData * image)
 		result->to_zero();
 	}
 
-	Ctf *ctf = (Ctf *)image->get_attr("ctf");
+	const Ctf *src_ctf = image->get_attr_ctf();
+	if (!src_ctf) throw NotExistingObjectException("ctf", "The image has no CTF parameters");
+	CtfCopy ctf(src_ctf);		// local copy, so the bfactor change below doesn't touch the image's cached Ctf
 
 	EMData *ctfi = result-> copy();
-	float b=ctf->bfactor;
 	ctf->bfactor=0;		// no B-factor used in weight
 	ctf->compute_2d_complex(ctfi,Ctf::CTF_INTEN);
-	ctf->bfactor=b;	// return to its original value
 
 	float *outd = result->get_data();
 	float *ind = fft->get_data();
@@ -1262,7 +1258,6 @@ void CtfWtAverager::add_image(EMData * image)
 	}
 	ctfsum->add(*ctfi);
 
-	delete ctf;
 	delete fft;
 	delete ctfi;
 }
@@ -1332,14 +1327,12 @@ void CtfWtFiltAverager::add_image(EMData * image)
 
 	
 	EMData *ctfi = results[0]-> copy();
-	if (image->has_attr("ctf")) {
-		Ctf *ctf = (Ctf *)image->get_attr("ctf");
+	const Ctf *src_ctf = image->get_attr_ctf();
+	if (src_ctf) {
+		CtfCopy ctf(src_ctf);
 
-		float b=ctf->bfactor;
-		ctf->bfactor=0;		// no B-factor used in weight, not strictly threadsafe, but shouldn't be a problem
+		ctf->bfactor=0;		// no B-factor used in weight, applied to the local copy only
 		ctf->compute_2d_complex(ctfi,Ctf::CTF_INTEN);
-		ctf->bfactor=b;	// return to its original value
-		delete ctf;
 	}
 	else {
 		ctfi->to_one();
@@ -618,8 +618,7 @@ float DotCmp::cmp(EMData* image, EMData* with) const
 				}
 			}
 		} else {
-			// this little bit of manual loop unrolling makes the dot product as fast as sqeuclidean with -O2
-			for (size_t i=0; i<totsize; i++) result += x_data[i]*y_data[i];
+			result = Util::array_dot(x_data, y_data, totsize);
 
 			if (normalize) {
 				square_sum1 = image->get_attr("square_sum");
@@ -1235,19 +1234,16 @@ float PhaseCmp::cmp(EMData * image, EMData *with) const
 
 	// weighting based on SNR estimate from CTF
 	if (snrweight) {
-		Ctf *ctf = NULL;
-		if (!image->has_attr("ctf")) {
-			if (!with->has_attr("ctf")) throw InvalidCallException("SNR weight with no CTF parameters");
-			ctf=with->get_attr("ctf");
-		}
-		else ctf=image->get_attr("ctf");
+		const Ctf *src_ctf = image->get_attr_ctf();
+		if (!src_ctf) src_ctf = with->get_attr_ctf();
+		if (!src_ctf) throw InvalidCallException("SNR weight with no CTF parameters");
+		CtfCopy ctf(src_ctf);
 
 		float ds=1.0f/(ctf->apix*ny);
 		snr=ctf->compute_1d(ny,ds,Ctf::CTF_SNR); // note that this returns ny/2 values
 		for (int i=0; i<snr.size(); i++) {
 			if (snr[i]<=0) snr[i]=0.001;		// make sure that points don't get completely excluded due to SNR estimation issues, or worse, contribute with a negative weight
 		}
-		if(ctf) {delete ctf; ctf=0;}
 		np=snr.size();
 	}
 	// weighting based on empirical SNR function (not really good)
@@ -1492,19 +1488,16 @@ float FRCCmp::cmp(EMData * image, EMData * with) const
 
 	vector<float> snr;
 	if (snrweight) {
-		Ctf *ctf = NULL;
-		if (!image->has_attr("ctf")) {
-			if (!with->has_attr("ctf")) throw InvalidCallException("SNR weight with no CTF parameters");
-			ctf=with->get_attr("ctf");
-		}
-		else ctf=image->get_attr("ctf");
+		const Ctf *src_ctf = image->get_attr_ctf();
+		if (!src_ctf) src_ctf = with->get_attr_ctf();
+		if (!src_ctf) throw InvalidCallException("SNR weight with no CTF parameters");
+		CtfCopy ctf(src_ctf);
 
 		float ds=1.0f/(ctf->apix*ny);
 		snr=ctf->compute_1d(ny,ds,Ctf::CTF_SNR);
 		for (int i=0; i<snr.size(); i++) {
 			if (snr[i]<=0) snr[i]=0.001;		// make sure that points don't get completely excluded due to SNR estimation issues, or worse, contribute with a negative weight
 		}
-		if(ctf) {delete ctf; ctf=0;}
 	}
 
 	vector<float> amp;
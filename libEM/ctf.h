@@ -314,6 +314,32 @@ namespace EMAN
 
 	};
 
+	/** CtfCopy is a modifiable stack copy of a Ctf of either model.
+	 * Use it when code needs to change parameters (e.g. bfactor) of a
+	 * Ctf it does not own, such as the one returned by EMData::get_attr_ctf().
+	 */
+	class CtfCopy
+	{
+	  public:
+		explicit CtfCopy(const Ctf * src)
+		{
+			if (dynamic_cast<const EMAN1Ctf *>(src)) ctf = &eman1;
+			else ctf = &eman2;
+			ctf->copy_from(src);
+		}
+
+		Ctf *operator->() { return ctf; }
+		Ctf *get() { return ctf; }
+
+	  private:
+		CtfCopy(const CtfCopy &);
+		CtfCopy & operator=(const CtfCopy &);
+
+		EMAN1Ctf eman1;
+		EMAN2Ctf eman2;
+		Ctf *ctf;
+	};
+
 }
 
 
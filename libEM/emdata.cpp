@@ -53,6 +53,10 @@
 #include <algorithm> // fill
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #ifdef WIN32
 	#define M_PI 3.14159265358979323846f
 #endif	//WIN32
@@ -78,7 +82,7 @@ EMData::EMData() :
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0),
+		attr_dict(), rdata(0), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0),
 		zoff(0), all_translation(),	path(""), pathnum(0), rot_fp(0)
 
 {
@@ -109,7 +113,7 @@ EMData::EMData(const string& filename, int image_index) :
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
+		attr_dict(), rdata(0), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
 		all_translation(),	path(filename), pathnum(image_index), rot_fp(0)
 {
 	ENTERFUNC;
@@ -142,26 +146,30 @@ EMData::EMData(const EMData& that) :
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(that.attr_dict), rdata(0), supp(0), flags(that.flags), changecount(that.changecount), nx(that.nx), ny(that.ny), nz(that.nz),
+		attr_dict(that.attr_dict), rdata(0), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(that.flags), changecount(that.changecount), nx(that.nx), ny(that.ny), nz(that.nz),
 		nxy(that.nx*that.ny), nxyz((size_t)that.nx*that.ny*that.nz), xoff(that.xoff), yoff(that.yoff), zoff(that.zoff),all_translation(that.all_translation),	path(that.path),
 		pathnum(that.pathnum), rot_fp(0)
 {
 	ENTERFUNC;
 	
-	float* data = that.rdata;
 	size_t num_bytes = (size_t)nx*ny*nz*sizeof(float);
+#ifdef EMAN2_USING_CUDA
+	if (that.compact_data) that.widen_compact_data();
+	float* data = that.rdata;
 	if (data && num_bytes != 0)
 	{
 		rdata = (float*)EMUtil::em_malloc(num_bytes);
 		EMUtil::em_memcpy(rdata, data, num_bytes);
 	}
-#ifdef EMAN2_USING_CUDA
 	if (EMData::usecuda == 1 && num_bytes != 0 && that.cudarwdata != 0) {
 		//cout << "That copy constructor" << endl;
 		if(!rw_alloc()) throw UnexpectedBehaviorException("Bad alloc");
 		cudaError_t error = cudaMemcpy(cudarwdata,that.cudarwdata,num_bytes,cudaMemcpyDeviceToDevice);
 		if ( error != cudaSuccess ) throw UnexpectedBehaviorException("cudaMemcpy failed in EMData copy construction with error: " + string(cudaGetErrorString(error)));
 	}
+#else
+	// copy on write, the pixels are only duplicated when one of the images calls get_data()
+	if (num_bytes != 0) share_rdata(that);
 #endif //EMAN2_USING_CUDA
 
 	if (that.rot_fp != 0) rot_fp = new EMData(*(that.rot_fp));
@@ -182,14 +190,22 @@ EMData& EMData::operator=(const EMData& that)
 	{
 		free_memory(); // Free memory sets nx,ny and nz to 0
 
+#ifdef EMAN2_USING_CUDA
+		if (that.compact_data) that.widen_compact_data();
+#endif
 		// Only copy the rdata if it exists, we could be in a scenario where only the header has been read
 		float* data = that.rdata;
-		size_t num_bytes = that.nx*that.ny*that.nz*sizeof(float);
-		if (data && num_bytes != 0)
+		size_t num_bytes = (size_t)that.nx*that.ny*that.nz*sizeof(float);
+		if ((data || that.compact_data) && num_bytes != 0)
 		{
+#ifdef EMAN2_USING_CUDA
 			nx = 1; // This prevents a memset in set_size
 			set_size(that.nx,that.ny,that.nz);
 			EMUtil::em_memcpy(rdata, data, num_bytes);
+#else
+			share_rdata(that);
+			set_size(that.nx,that.ny,that.nz,true);
+#endif
 		}
 
 		flags = that.flags;
@@ -198,6 +214,7 @@ EMData& EMData::operator=(const EMData& that)
 
 		path = that.path;
 		pathnum = that.pathnum;
+		clear_hot_attrs();
 		attr_dict = that.attr_dict;
 
 		xoff = that.xoff;
@@ -222,6 +239,47 @@ EMData& EMData::operator=(const EMData& that)
 	return *this;
 }
 
+void EMData::swap(EMData& that)
+{
+	ENTERFUNC;
+
+	if (this == &that) return;
+
+#ifdef EMAN2_USING_CUDA
+	// the device buffers are tracked in a list by address, so they are copied instead
+	EMData tmp(that);
+	that = *this;
+	*this = tmp;
+#else
+	std::swap(rdata, that.rdata);
+	std::swap(rdata_shared, that.rdata_shared);
+	std::swap(compact_data, that.compact_data);
+	std::swap(compact_type, that.compact_type);
+	std::swap(hot_attrs, that.hot_attrs);
+	std::swap(supp, that.supp);
+	attr_dict.swap(that.attr_dict);
+	std::swap(flags, that.flags);
+	std::swap(changecount, that.changecount);
+	std::swap(nx, that.nx);
+	std::swap(ny, that.ny);
+	std::swap(nz, that.nz);
+	std::swap(nxy, that.nxy);
+	std::swap(nxyz, that.nxyz);
+	std::swap(xoff, that.xoff);
+	std::swap(yoff, that.yoff);
+	std::swap(zoff, that.zoff);
+	std::swap(all_translation, that.all_translation);
+	path.swap(that.path);
+	std::swap(pathnum, that.pathnum);
+	std::swap(rot_fp, that.rot_fp);
+#ifdef FFT_CACHING
+	std::swap(fftcache, that.fftcache);
+#endif //FFT_CACHING
+#endif //EMAN2_USING_CUDA
+
+	EXITFUNC;
+}
+
 EMData::EMData(int nx, int ny, int nz, bool is_real) :
 #ifdef EMAN2_USING_CUDA
 		cudarwdata(0), cudarodata(0), num_bytes(0), nextlistitem(0), prevlistitem(0), roneedsupdate(0), cudadirtybit(0),
@@ -229,7 +287,7 @@ EMData::EMData(int nx, int ny, int nz, bool is_real) :
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(), rdata(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
+		attr_dict(), rdata(0), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(0), changecount(0), nx(0), ny(0), nz(0), nxy(0), nxyz(0), xoff(0), yoff(0), zoff(0),
 		all_translation(),	path(""), pathnum(0), rot_fp(0)
 {
 	ENTERFUNC;
@@ -284,7 +342,7 @@ EMData::EMData(float* data, const int x, const int y, const int z, const Dict& a
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(attr_dict), rdata(data), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
+		attr_dict(attr_dict), rdata(data), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
 		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0)
 {
 	ENTERFUNC;
@@ -309,7 +367,7 @@ EMData::EMData(float* data, float* cudadata, const int x, const int y, const int
 #ifdef FFT_CACHING
 	fftcache(0),
 #endif //FFT_CACHING
-		attr_dict(attr_dict), rdata(data), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
+		attr_dict(attr_dict), rdata(data), rdata_shared(0), rdata_pinned(false), compact_data(0), compact_type(EMUtil::EM_FLOAT), compact_readers(0), hot_attrs(0), supp(0), flags(0), changecount(0), nx(x), ny(y), nz(z), nxy(x*y), nxyz((size_t)x*y*z), xoff(0),
 		yoff(0), zoff(0), all_translation(), path(""), pathnum(0), rot_fp(0)
 {
 	ENTERFUNC;
@@ -339,6 +397,7 @@ EMData::~EMData()
 	if (fftcache!=0) { delete fftcache; fftcache=0;}
 #endif //FFT_CACHING
 	free_memory();
+	clear_hot_attrs();
 
 #ifdef EMAN2_USING_CUDA
 	if(cudarwdata){rw_free();}
@@ -734,31 +793,38 @@ EMData *EMData::get_rotated_clip(const Transform &xform,
 	EMData *result = new EMData();
 	result->set_size(size[0],size[1],size[2]);
 
-	if (nz==1) {
+	// the coordinates of one output slice are transformed first, then interpolated together
+	const size_t nslice = (size_t)size[0]*size[1];
+	vector<float> xs(nslice), ys(nslice), zs(nz==1 ? 0 : nslice);
+	vector<char> inside(nslice);
+	float *rdata = result->get_data();
+
+	// a 2D image fills only the first slice
+	const int zmin = nz==1 ? 0 : -size[2]/2;
+	const int zmax = nz==1 ? 1 : (size[2]+1)/2;
+	for (int z=zmin; z<zmax; z++) {
+		size_t i = 0;
 		for (int y=-size[1]/2; y<(size[1]+1)/2; y++) {
-			for (int x=-size[0]/2; x<(size[0]+1)/2; x++) {
-				Vec3f xv=xform.transform(Vec3f((float)x,(float)y,0.0f));
-				float v = 0;
-
-				if (xv[0]<0||xv[1]<0||xv[0]>nx-2||xv[1]>ny-2) v=0.;
-				else v=sget_value_at_interp(xv[0],xv[1]);
-				result->set_value_at(x+size[0]/2,y+size[1]/2,v);
-			}
-		}
-	}
-	else {
-		for (int z=-size[2]/2; z<(size[2]+1)/2; z++) {
-			for (int y=-size[1]/2; y<(size[1]+1)/2; y++) {
-				for (int x=-size[0]/2; x<(size[0]+1)/2; x++) {
-					Vec3f xv=xform.transform(Vec3f((float)x,(float)y,(float)z));
-					float v = 0;
-
-					if (xv[0]<0||xv[1]<0||xv[2]<0||xv[0]>nx-2||xv[1]>ny-2||xv[2]>nz-2) v=0.;
-					else v=sget_value_at_interp(xv[0],xv[1],xv[2]);
-					result->set_value_at(x+size[0]/2,y+size[1]/2,z+size[2]/2,v);
+			for (int x=-size[0]/2; x<(size[0]+1)/2; x++, i++) {
+				Vec3f xv=xform.transform(Vec3f((float)x,(float)y,(float)z));
+				xs[i] = xv[0];
+				ys[i] = xv[1];
+				if (nz==1) {
+					inside[i] = !(xv[0]<0||xv[1]<0||xv[0]>nx-2||xv[1]>ny-2);
+				}
+				else {
+					zs[i] = xv[2];
+					inside[i] = !(xv[0]<0||xv[1]<0||xv[2]<0||xv[0]>nx-2||xv[1]>ny-2||xv[2]>nz-2);
 				}
 			}
 		}
+
+		float *slice = rdata + (z-zmin)*nslice;
+		if (nz==1) sget_values_at_interp(&xs[0], &ys[0], nslice, slice);
+		else sget_values_at_interp(&xs[0], &ys[0], &zs[0], nslice, slice);
+		for (i = 0; i < nslice; i++) {
+			if (!inside[i]) slice[i] = 0;
+		}
 	}
 	result->update();
 
@@ -2777,7 +2843,7 @@ vector<float> EMData::calc_radial_dist(int n, float x0, float dx, int inten)
 			break;
 	}
 			
-	float * data = get_data();
+	const float * data = get_const_data();
 
 	// We do 2D separately to avoid the hypot3 call
 	if (nz==1) {
@@ -3017,7 +3083,7 @@ vector<float> EMData::calc_radial_dist(int n, float x0, float dx, int nwedge, fl
 	int step=is_complex()?2:1;
 	float astep=(float)(M_PI*2.0/nwedge);
 	if (is_complex()) astep/=2;							// Since we only have the right 1/2 of Fourier space
-	float* data = get_data();
+	const float* data = get_const_data();
 	for (i=0; i<n*nwedge; i++) ret[i]=norm[i]=0.0;
 
 	// We do 2D separately to avoid the hypot3 call
@@ -3093,7 +3159,127 @@ void EMData::cconj() {
 	EXITFUNC;
 }
 
-void EMData::update_stat() const
+namespace {
+	// update_stat() sums images in blocks of this many values, one or more blocks per thread
+	const size_t STAT_BLOCK = 1 << 16;
+
+	struct StatSums
+	{
+		float min, max;
+		double sum, square_sum;
+		size_t n_nonzero;
+	};
+
+	struct StatJob
+	{
+		const float *data;
+		const void *compact;		// compact pixels, read instead of data
+		EMUtil::EMDataType compact_type;
+		size_t size;
+		int step;
+		int groups;
+		StatSums *blocks;
+	};
+
+	// the requested statistics groups of every step-th value of d[0..n)
+	void stat_sums(const float *d, size_t n, int step, int groups, StatSums& s)
+	{
+		const bool extrema = (groups & EMData::STAT_EXTREMA) != 0;
+		const bool moments = (groups & EMData::STAT_MOMENTS) != 0;
+		const bool nonzero = (groups & EMData::STAT_NONZERO) != 0;
+
+		float max = -FLT_MAX;
+		float min = -max;
+		double sum = 0;
+		double square_sum = 0;
+		size_t n_nonzero = 0;
+		size_t i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+		if (step == 1) {
+			const size_t n4 = n & ~(size_t)3;
+			float t[4];
+			if (extrema) {
+				__m128 vmax = _mm_set1_ps(max);
+				__m128 vmin = _mm_set1_ps(min);
+				for (size_t j = 0; j < n4; j += 4) {
+					const __m128 v = _mm_loadu_ps(d + j);
+					vmax = _mm_max_ps(v, vmax);
+					vmin = _mm_min_ps(v, vmin);
+				}
+				_mm_storeu_ps(t, vmax);
+				max = Util::get_max(Util::get_max(t[0], t[1]), Util::get_max(t[2], t[3]));
+				_mm_storeu_ps(t, vmin);
+				min = Util::get_min(Util::get_min(t[0], t[1]), Util::get_min(t[2], t[3]));
+			}
+			if (moments || nonzero) {
+				// sums are kept in double, like the scalar loop, since sigma is a difference of them
+				const __m128 zero = _mm_setzero_ps();
+				__m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+				__m128d q0 = _mm_setzero_pd(), q1 = _mm_setzero_pd();
+				__m128i nz = _mm_setzero_si128();
+				for (size_t j = 0; j < n4; j += 4) {
+					const __m128 v = _mm_loadu_ps(d + j);
+					const __m128d lo = _mm_cvtps_pd(v);
+					const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+					s0 = _mm_add_pd(s0, lo);
+					s1 = _mm_add_pd(s1, hi);
+					q0 = _mm_add_pd(q0, _mm_mul_pd(lo, lo));
+					q1 = _mm_add_pd(q1, _mm_mul_pd(hi, hi));
+					// the comparison gives -1 in each lane that is nonzero
+					nz = _mm_sub_epi32(nz, _mm_castps_si128(_mm_cmpneq_ps(v, zero)));
+				}
+				double u[2];
+				_mm_storeu_pd(u, _mm_add_pd(s0, s1));
+				sum = u[0] + u[1];
+				_mm_storeu_pd(u, _mm_add_pd(q0, q1));
+				square_sum = u[0] + u[1];
+				int c[4];
+				_mm_storeu_si128((__m128i *)c, nz);
+				n_nonzero = (size_t)c[0] + c[1] + c[2] + c[3];
+			}
+			i = n4;
+		}
+#endif
+
+		for (; i < n; i += step) {
+			float v = d[i];
+			max = Util::get_max(max, v);
+			min = Util::get_min(min, v);
+			sum += v;
+			square_sum += v * (double)(v);
+			if (v != 0) n_nonzero++;
+		}
+
+		s.min = min;
+		s.max = max;
+		s.sum = sum;
+		s.square_sum = square_sum;
+		s.n_nonzero = n_nonzero;
+	}
+
+	void stat_worker(size_t begin, size_t end, void *arg)
+	{
+		const StatJob *job = static_cast<const StatJob *>(arg);
+		// compact pixels are converted a block at a time, the image is not widened
+		vector<float> buf(job->compact ? STAT_BLOCK : 0);
+		for (size_t b = begin; b < end; ++b) {
+			const size_t first = b * STAT_BLOCK;
+			const size_t last = std::min(job->size, first + STAT_BLOCK);
+			const float *d;
+			if (job->compact) {
+				EMUtil::compact_to_float(job->compact, job->compact_type, first, last - first, &buf[0]);
+				d = &buf[0];
+			}
+			else {
+				d = job->data + first;
+			}
+			stat_sums(d, last - first, job->step, job->groups, job->blocks[b]);
+		}
+	}
+}
+
+void EMData::update_stat(int groups) const
 {
 	ENTERFUNC;
 //	printf("update stat %f %d\n",(float)attr_dict["mean"],flags);
@@ -3102,53 +3288,80 @@ void EMData::update_stat() const
 		EXITFUNC;
 		return;
 	}
-	if (rdata==0) return;
+	if (rdata==0 && compact_data==0) return;
 
-	float* data = get_data();
-	float max = -FLT_MAX;
-	float min = -max;
+	// NEEDUPD set through set_flags() carries no group bits, then all groups are stale
+	int stale = (flags & EMDATA_STALE_ALL) >> 15;
+	if (stale == 0) stale = STAT_ALL;
 
-	double sum = 0;
-	double square_sum = 0;
+	groups &= stale;
+	// the nonzero statistics are derived from the sums of the moments
+	if (groups & STAT_NONZERO) groups |= STAT_MOMENTS;
 
-	int step = 1;
-	if (is_complex() && !is_ri()) {
-		step = 2;
-	}
+	if (groups) {
+		int step = 1;
+		if (is_complex() && !is_ri()) {
+			step = 2;
+		}
 
-	int n_nonzero = 0;
+		size_t size = (size_t)nx*ny*nz;
+		size_t nblocks = (size + STAT_BLOCK - 1) / STAT_BLOCK;
+
+		// the blocks, and so the rounding, do not depend on the number of threads
+		vector<StatSums> blocks(nblocks);
+		const void *compact = compact_data;
+		StatJob job = { compact ? 0 : get_const_data(), compact, compact_type, size, step, groups, &blocks[0] };
+		Util::parallel_for(nblocks, stat_worker, &job, 0, 16);
+
+		float max = -FLT_MAX;
+		float min = -max;
+		double sum = 0;
+		double square_sum = 0;
+		size_t n_nonzero = 0;
+
+		for (size_t b = 0; b < nblocks; ++b) {
+			max = Util::get_max(max, blocks[b].max);
+			min = Util::get_min(min, blocks[b].min);
+			sum += blocks[b].sum;
+			square_sum += blocks[b].square_sum;
+			n_nonzero += blocks[b].n_nonzero;
+		}
 
-	size_t size = (size_t)nx*ny*nz;
+		if (groups & STAT_EXTREMA) {
+			attr_dict["minimum"] = min;
+			attr_dict["maximum"] = max;
+		}
 
-	for (size_t i = 0; i < size; i += step) {
-		float v = data[i];
-		max = Util::get_max(max, v);
-		min = Util::get_min(min, v);
-		sum += v;
-		square_sum += v * (double)(v);
-		if (v != 0) n_nonzero++;
-	}
+		size_t n     = size / step;
+		double mean  = sum  / n;
+		double var   = (square_sum - sum*sum / n) / (n-1);
+		double sigma = var >= 0.0 ? std::sqrt(var) : 0.0;
 
-	size_t n     = size / step;
-	double mean  = sum  / n;
-	double var   = (square_sum - sum*sum / n) / (n-1);
-	double sigma = var >= 0.0 ? std::sqrt(var) : 0.0;
-	n_nonzero    = Util::get_max(1, n_nonzero);
-	double varn  = (square_sum - sum*sum / n_nonzero) / (n_nonzero-1);
-	double sigma_nonzero = varn >= 0.0 ? std::sqrt(varn) : 0.0;
-	double mean_nonzero  = sum / n_nonzero; // previous version overcounted! G2
+		if (groups & STAT_MOMENTS) {
+			attr_dict["mean"] = (float)(mean);
+			attr_dict["sigma"] = (float)(sigma);
+			attr_dict["square_sum"] = (float)(square_sum);
+		}
+
+		if (groups & STAT_NONZERO) {
+			if (n_nonzero < 1) n_nonzero = 1;
+			double varn  = (square_sum - sum*sum / n_nonzero) / (n_nonzero-1);
+			double sigma_nonzero = varn >= 0.0 ? std::sqrt(varn) : 0.0;
+			double mean_nonzero  = sum / n_nonzero; // previous version overcounted! G2
+
+			attr_dict["mean_nonzero"] = (float)(mean_nonzero);
+			attr_dict["sigma_nonzero"] = (float)(sigma_nonzero);
+		}
+	}
 
-	attr_dict["minimum"] = min;
-	attr_dict["maximum"] = max;
-	attr_dict["mean"] = (float)(mean);
-	attr_dict["sigma"] = (float)(sigma);
-	attr_dict["square_sum"] = (float)(square_sum);
-	attr_dict["mean_nonzero"] = (float)(mean_nonzero);
-	attr_dict["sigma_nonzero"] = (float)(sigma_nonzero);
 	attr_dict["is_complex"] = (int) is_complex();
 	attr_dict["is_complex_ri"] = (int) is_ri();
 
-	flags &= ~EMDATA_NEEDUPD;
+	stale &= ~groups;
+	flags = (flags & ~EMDATA_STALE_ALL) | (stale << 15);
+	if (stale == 0) {
+		flags &= ~EMDATA_NEEDUPD;
+	}
 
 	if (rot_fp != 0)
 	{
@@ -3432,6 +3645,32 @@ float EMData::calc_dist(EMData * second_img, int y_index) const
 }
 
 
+namespace {
+	struct FastSigmaBoxes
+	{
+		float *des;
+		size_t nxy;
+		double value;		// of the mask
+		double count;		// pixels in the mask
+		double edge;		// the value outside the image
+	};
+
+	/* The box sums are of the image less its edge mean, which then counts as 0 outside
+	 * the image. The statistic is the one the convolutions compute for a general mask.
+	 */
+	void fast_sigma_slice(int z, const double *sums, const double *sums2, void *arg)
+	{
+		const FastSigmaBoxes *job = static_cast<const FastSigmaBoxes *>(arg);
+		float *des = job->des + (size_t)z * job->nxy;
+		for (size_t i = 0; i < job->nxy; ++i) {
+			double sum = sums[i] + job->count * job->edge;
+			double sum2 = sums2[i] + 2 * job->edge * sums[i] + job->count * job->edge * job->edge;
+			double mean = job->value * sum / job->count;
+			des[i] = (float)(job->value * sum2 - mean * mean);
+		}
+	}
+}
+
 EMData * EMData::calc_fast_sigma_image( EMData* mask)
 {
 	ENTERFUNC;
@@ -3451,13 +3690,43 @@ EMData * EMData::calc_fast_sigma_image( EMData* mask)
 		throw ImageDimensionException("Can not calculate variance map using an image that is larger than this image");
 
 	size_t P = 0;
+	bool box = true;	// a constant mask is a box, summed-area tables replace the convolutions
+	const float *mdata = mask->get_const_data();
 	for(size_t i = 0; i < mask->get_size(); ++i){
-		if (mask->get_value_at(i) != 0){
+		if (mdata[i] != 0){
 			++P;
 		}
+		if (mdata[i] != mdata[0]) box = false;
 	}
 	float normfac = 1.0f/(float)P;
 
+	if (box && P > 0) {
+		// the box of pixel x covers [x + ceil((nx+mnx)/2) - nx/2 - mnx + 1, x + ceil((nx+mnx)/2) - nx/2],
+		// where the convolutions of the padded images put it
+		int x0 = (nx + mnx + 1) / 2 - nx / 2 - mnx + 1;
+		int y0 = ny == 1 ? 0 : (ny + mny + 1) / 2 - ny / 2 - mny + 1;
+		int z0 = nz == 1 ? 0 : (nz + mnz + 1) / 2 - nz / 2 - mnz + 1;
+
+		vector<float> shifted(get_const_data(), get_const_data() + get_size());
+		float edge = get_edge_mean();
+		for (size_t i = 0; i < shifted.size(); ++i) shifted[i] -= edge;
+
+		EMData *s = new EMData(nx, ny, nz);
+		FastSigmaBoxes job;
+		job.des = s->get_data();
+		job.nxy = (size_t)nx * ny;
+		job.value = mdata[0];
+		job.count = (double)P;
+		job.edge = edge;
+		Util::box_sums(&shifted[0], nx, ny, nz, x0, y0, z0, mnx, mny, mnz, true, fast_sigma_slice, &job);
+		s->update();
+		s->process_inplace("math.sqrt");
+
+		if (maskflag) delete mask;
+		EXITFUNC;
+		return s;
+	}
+
 //	bool undoclip = false;
 
 	int nxc = nx+mnx; int nyc = ny+mny; int nzc = nz+mnz;
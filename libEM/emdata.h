@@ -89,6 +89,24 @@ namespace EMAN
 	{
 		friend class GLUtil;
 
+	public:
+		/** Interned names of the header attributes which reconstructors and aligners read
+		 * once per particle. Their parsed values are cached on first use, so the typed
+		 * accessors (get_attr_transform(), get_attr_ctf(), ...) neither search attr_dict
+		 * nor allocate a new Transform or Ctf on each call.
+		 */
+		enum HotAttr {
+			ATTR_APIX_X,
+			ATTR_APIX_Y,
+			ATTR_APIX_Z,
+			ATTR_XFORM_PROJECTION,
+			ATTR_XFORM_ALIGN2D,
+			ATTR_XFORM_ALIGN3D,
+			ATTR_CTF,
+			ATTR_CLASS_PTCL_IDXS,
+			NUM_HOT_ATTRS
+		};
+
 		/** For all image I/O */
 		#include "emdata_io.h"
 
@@ -115,6 +133,17 @@ namespace EMAN
 		enum FFTPLACE { FFT_OUT_OF_PLACE, FFT_IN_PLACE };
 		enum WINDOWPLACE { WINDOW_OUT_OF_PLACE, WINDOW_IN_PLACE };
 
+		/** Groups of the image statistics kept in the attribute dictionary. After the
+		 * image changes, each group is recomputed only when one of its attributes is
+		 * requested, so e.g. reading "mean" does not pay for "minimum" and "maximum".
+		 */
+		enum StatGroup {
+			STAT_EXTREMA = 1,	// minimum, maximum
+			STAT_MOMENTS = 2,	// mean, sigma, square_sum
+			STAT_NONZERO = 4,	// mean_nonzero, sigma_nonzero
+			STAT_ALL = 7
+		};
+
 		/** Construct an empty EMData instance. It has no image data. */
 		EMData();
 		~ EMData();
@@ -171,6 +200,13 @@ namespace EMAN
 		*/
 		EMData& operator=(const EMData& that);
 
+		/** Exchange everything, pixels and header, with another image. No pixels are
+		 * copied, so this is how an image is moved: swapping with an empty EMData leaves
+		 * that empty, like a moved-from object.
+		 * @param that the EMData to exchange with
+		*/
+		void swap(EMData& that);
+
 
 		/** Get an inclusive clip. Pads to fill if larger than this image.
 		 * .
@@ -817,17 +853,90 @@ namespace EMAN
 			EMDATA_FH = 1 << 11,        // is the complex image a FH image
 			EMDATA_CPU_NEEDS_UPDATE = 1 << 12, // CUDA related: is the CPU version of the image out out data
 			EMDATA_GPU_NEEDS_UPDATE = 1 << 13, // CUDA related: is the GPU version of the image out out data
-			EMDATA_GPU_RO_NEEDS_UPDATE = 1 << 14 // // CUDA related: is the GPU RO version of the image out out data
+			EMDATA_GPU_RO_NEEDS_UPDATE = 1 << 14, // // CUDA related: is the GPU RO version of the image out out data
+			EMDATA_STALE_EXTREMA = STAT_EXTREMA << 15,	// per StatGroup, the group needs an update
+			EMDATA_STALE_MOMENTS = STAT_MOMENTS << 15,
+			EMDATA_STALE_NONZERO = STAT_NONZERO << 15,
+			EMDATA_STALE_ALL = STAT_ALL << 15
 		};
 
-		void update_stat() const;
+		/** Recompute the requested statistics groups if they are out of date.
+		 * @param groups StatGroup bits. 0 only refreshes the cheap attributes.
+		 */
+		void update_stat(int groups = STAT_ALL) const;
 		void save_byteorder_to_dict(ImageIO * imageio);
 
+		/** Extend a real image along x to the padded size an in-place FFT needs, unless
+		 * it already is padded.
+		 * @return the real-space x size
+		 */
+		int fft_pad_inplace();
+
+		/** Give this image a private copy of rdata if it is shared with copies of it
+		 * (copy on write) or mapped from a file. Called by get_data() before handing out
+		 * a writable pointer.
+		 */
+		void unshare_rdata() const;
+
+		/** Drop this image's reference to rdata, freeing it if no copy still uses it.
+		 * @param free_data false to never free rdata, when the caller owns it. File
+		 * mappings are always released.
+		 */
+		void release_rdata(bool free_data = true);
+
+		/** Make rdata (currently unset) refer to that's pixel buffer instead of a copy of it,
+		 * or give it a copy if that's pixels have been handed out by export_data().
+		 */
+		void share_rdata(const EMData& that);
+
+		/** Pixel data shared between copies of an image (copy on write), or a read-only
+		 * view of a memory mapped file (see read_image_mapped()).
+		 */
+		struct SharedData
+		{
+			int refs;			// number of images using the data
+			void *map;			// the file mapping, 0 if the data was allocated with EMUtil::em_malloc
+			size_t map_size;
+		};
+
+		/** Free shared pixel data once its last user is gone. */
+		static void free_shared_rdata(SharedData *shared, float *data);
+
+		/** Convert compact_data to float in rdata, and free it. Called by get_data() and
+		 * get_const_data() the first time float pixels are needed. The conversion runs
+		 * outside rdata_shared_mutex, if several threads race the first result is kept.
+		 */
+		void widen_compact_data() const;
+
+		/** Parsed values of the HotAttr attributes, see emdata_metadata.cpp */
+		struct HotAttrCache;
+
+		/** @return the cache with the slot of key filled, 0 if the image has no such attribute */
+		HotAttrCache *fill_hot_attr(HotAttr key) const;
+
+		/** Forget the cached value of attribute key, which is being changed or removed */
+		void hot_attr_changed(const string & key) const;
+
+		/** Forget all cached attribute values, after attr_dict was replaced */
+		void clear_hot_attrs() const;
+
 	private:
 		/** to store all image header info */
 		mutable Dict attr_dict;
 		/** image real data */
 		mutable float *rdata;
+		/** set while rdata is shared with copies of this image or mapped from a file */
+		mutable SharedData *rdata_shared;
+		/** set once a pointer to rdata outlives the call which handed it out (see export_data()),
+		 * rdata is then copied rather than shared by copy() */
+		mutable bool rdata_pinned;
+		/** reduced precision pixel data (see set_storage_type()), rdata is 0 while it is set */
+		mutable void *compact_data;
+		mutable EMUtil::EMDataType compact_type;
+		/** threads converting compact_data outside rdata_shared_mutex, the last one frees it */
+		mutable int compact_readers;
+		/** typed values of the HotAttr attributes in attr_dict, allocated on first use */
+		mutable HotAttrCache *hot_attrs;
 		/** supplementary data array */
 		float *supp;
 
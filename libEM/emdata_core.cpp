@@ -47,18 +47,224 @@ using namespace EMAN;
 using std::cout;
 using std::endl;
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif	//_WIN32
+
 #ifdef EMAN2_USING_CUDA
 #include "cuda/cuda_processor.h"
 #include "cuda/cuda_cmp.h"
 #endif // EMAN2_USING_CUDA
 
-void EMData::free_memory()
+namespace {
+#ifdef _WIN32
+	MUTEX rdata_shared_mutex;
+#else
+	pthread_mutex_t rdata_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+	// op(data[i], v) for the pixels v of a compact image, converted a block at a time
+	// so that the image is not widened
+	template<class Op>
+	void apply_compact(float *data, const EMData & image, Op op)
+	{
+		const size_t block = 4096;
+		float buf[block];
+		const void *src = image.get_compact_data();
+		EMUtil::EMDataType type = image.get_storage_type();
+		size_t size = image.get_size();
+		for (size_t i = 0; i < size; i += block) {
+			size_t n = std::min(block, size - i);
+			EMUtil::compact_to_float(src, type, i, n, buf);
+			for (size_t j = 0; j < n; ++j) op(data[i + j], buf[j]);
+		}
+	}
+
+	struct AddOp { void operator()(float & d, float v) const { d += v; } };
+	struct SubOp { void operator()(float & d, float v) const { d -= v; } };
+	struct MultOp { void operator()(float & d, float v) const { d *= v; } };
+
+	struct ComplexInterpJob
+	{
+		const EMData *image;
+		const float *x, *y;
+		std::complex<float> *out;
+	};
+
+	void complex_interp_worker(size_t begin, size_t end, void *arg)
+	{
+		const ComplexInterpJob *job = static_cast<const ComplexInterpJob *>(arg);
+		for (size_t i = begin; i < end; ++i) {
+			job->out[i] = job->image->get_complex_at_interp(job->x[i], job->y[i]);
+		}
+	}
+}
+
+void EMData::free_shared_rdata(SharedData *shared, float *data)
+{
+#ifndef _WIN32
+	if (shared->map) munmap(shared->map, shared->map_size);
+	else
+#endif	//_WIN32
+	EMUtil::em_free(data);
+	delete shared;
+}
+
+void EMData::unshare_rdata() const
+{
+	Util::MUTEX_LOCK(&rdata_shared_mutex);
+	if (rdata_shared->refs == 1 && !rdata_shared->map) {		// the other copies are gone, the buffer is ours
+		delete rdata_shared;
+		rdata_shared = 0;
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		return;
+	}
+	Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+
+	// our reference keeps the shared buffer alive while it is copied
+	size_t num_bytes = nxyz*sizeof(float);
+	float *data = (float*)EMUtil::em_malloc(num_bytes);
+	if (data == 0) throw BadAllocException("Cannot allocate memory for a private copy of shared image data");
+	EMUtil::em_memcpy(data, rdata, num_bytes);
+
+	Util::MUTEX_LOCK(&rdata_shared_mutex);
+	bool last = (--rdata_shared->refs == 0);
+	Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+	if (last) free_shared_rdata(rdata_shared, rdata);
+
+	rdata = data;
+	rdata_shared = 0;
+}
+
+void EMData::release_rdata(bool free_data)
+{
+	if (rdata_shared) {
+		Util::MUTEX_LOCK(&rdata_shared_mutex);
+		bool last = (--rdata_shared->refs == 0);
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		if (last) {
+			if (free_data || rdata_shared->map) free_shared_rdata(rdata_shared, rdata);
+			else delete rdata_shared;
+		}
+		rdata_shared = 0;
+	}
+	else if (rdata && free_data) EMUtil::em_free(rdata);
+	rdata = 0;
+	rdata_pinned = false;
+
+	if (compact_data) {
+		EMUtil::em_free(compact_data);
+		compact_data = 0;
+	}
+}
+
+void EMData::share_rdata(const EMData& that)
+{
+	Util::MUTEX_LOCK(&rdata_shared_mutex);
+	if (that.compact_data) {		// a fraction of the float size, simply copied
+		size_t num_bytes = (size_t)that.nx*that.ny*that.nz*EMUtil::get_datatype_size(that.compact_type);
+		compact_data = EMUtil::em_malloc(num_bytes);
+		if (compact_data) EMUtil::em_memcpy(compact_data, that.compact_data, num_bytes);
+		compact_type = that.compact_type;
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		if (compact_data == 0) throw BadAllocException("Cannot allocate memory for a copy of compact image data");
+		return;
+	}
+	if (that.rdata == 0) {
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		return;
+	}
+	if (that.rdata_pinned) {		// a view of the pixels is out, writes through it must not show here
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		size_t num_bytes = (size_t)that.nx*that.ny*that.nz*sizeof(float);
+		rdata = (float*)EMUtil::em_malloc(num_bytes);
+		if (rdata == 0) throw BadAllocException("Cannot allocate memory for a copy of image data");
+		EMUtil::em_memcpy(rdata, that.rdata, num_bytes);
+		return;
+	}
+	if (that.rdata_shared == 0) {
+		that.rdata_shared = new SharedData;
+		that.rdata_shared->refs = 1;
+		that.rdata_shared->map = 0;
+		that.rdata_shared->map_size = 0;
+	}
+	++that.rdata_shared->refs;
+	Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+	rdata = that.rdata;
+	rdata_shared = that.rdata_shared;
+}
+
+void EMData::widen_compact_data() const
+{
+	// images are often read by several threads. rdata_shared_mutex is global, so it is
+	// only held to claim and publish, a tomogram is converted without it
+	Util::MUTEX_LOCK(&rdata_shared_mutex);
+	void *src = compact_data;
+	if (src == 0) {
+		Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+		return;
+	}
+	++compact_readers;		// keeps src alive until we are done with it
+	Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+
+	float *data = (float*)EMUtil::em_malloc(nxyz*sizeof(float));
+	if (data) EMUtil::compact_to_float(src, compact_type, 0, nxyz, data);
+
+	Util::MUTEX_LOCK(&rdata_shared_mutex);
+	bool failed = false;
+	if (compact_data == src) {		// first to finish
+		if (data) {
+			rdata = data;
+			compact_data = 0;
+			data = 0;
+		}
+		else failed = true;
+	}
+	bool release = (--compact_readers == 0 && compact_data != src);
+	Util::MUTEX_UNLOCK(&rdata_shared_mutex);
+
+	if (release) EMUtil::em_free(src);
+	if (data) EMUtil::em_free(data);		// another thread won
+	if (failed) throw BadAllocException("Cannot allocate memory to convert compact image data to float");
+}
+
+void EMData::set_storage_type(EMUtil::EMDataType type)
 {
 	ENTERFUNC;
-	if (rdata) {
-		EMUtil::em_free(rdata);
-		rdata = 0;
+
+	if (type == get_storage_type()) return;
+
+	if (type == EMUtil::EM_FLOAT) {
+		widen_compact_data();
+		return;
+	}
+
+	if (!EMUtil::is_compact_type(type)) {
+		throw InvalidValueException(type, "storage type must be EM_FLOAT, EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF");
 	}
+	if (is_complex()) {
+		throw ImageFormatException("complex images can only be stored as float");
+	}
+
+	const float *src = get_const_data();		// widens other compact types
+	if (src == 0) return;		// header only
+
+	void *data = EMUtil::em_malloc(nxyz*EMUtil::get_datatype_size(type));
+	if (data == 0) throw BadAllocException("Cannot allocate memory for compact image data");
+	EMUtil::float_to_compact(src, nxyz, type, data);
+
+	release_rdata();
+	compact_data = data;
+	compact_type = type;
+	update();
+
+	EXITFUNC;
+}
+
+void EMData::free_memory()
+{
+	ENTERFUNC;
+	release_rdata();
 
 	if (supp) {
 		EMUtil::em_free(supp);
@@ -83,10 +289,7 @@ void EMData::free_memory()
 void EMData::free_rdata()
 {
 	ENTERFUNC;
-	if (rdata) {
-		EMUtil::em_free(rdata);
-		rdata = 0;
-	}
+	release_rdata();
 	EXITFUNC;
 }
 
@@ -174,6 +377,7 @@ return (x-subx0)*2+(y-suby0)*(size_t)nx+(z-subz0)*(size_t)nx*(size_t)ny;
 
 void EMData::set_complex_at(const int &x,const int &y,const std::complex<float> &val) {
 	if (abs(x)>=nx/2 || abs(y)>ny/2) return;
+	if (rdata_shared) unshare_rdata();
 	if (x==0) {
 		if (y==0) { rdata[0]=val.real(); rdata[1]=0; }
 		else if (y==ny/2 || y==-ny/2) { rdata[ny/2*nx]=val.real(); rdata[ny/2*nx+1]=0; }
@@ -211,6 +415,7 @@ void EMData::set_complex_at(const int &x,const int &y,const std::complex<float>
 
 void EMData::set_complex_at(const int &x,const int &y,const int &z,const std::complex<float> &val) {
 if (abs(x)>=nx/2 || abs(y)>ny/2 || abs(z)>nz/2) return;
+if (rdata_shared) unshare_rdata();
 
 size_t idx;
 
@@ -254,6 +459,7 @@ return;
 
 size_t EMData::add_complex_at(const int &x,const int &y,const int &z,const std::complex<float> &val) {
 if (abs(x)>=nx/2 || abs(y)>ny/2 || abs(z)>nz/2) return nxyz;
+if (rdata_shared) unshare_rdata();
 
 //if (x==0 && abs(y)==16 && abs(z)==1) printf("## %d %d %d\n",x,y,z);
 size_t idx;
@@ -312,6 +518,7 @@ if (abs(x)>=fullnx/2 || abs(y)>fullny/2 || abs(z)>fullnz/2) return nxyz;
 	rdata[idx]+=(float)val.real();
 	rdata[idx+1]+=(float)-val.imag();
 }*/
+if (rdata_shared) unshare_rdata();
 float cc=1.0;
 if (x<0) {
 	x*=-1;
@@ -339,18 +546,7 @@ void EMData::add(float f,int keepzero)
 	if( is_real() )
 	{
 		if (f != 0) {
-
-			size_t size = nxyz;
-			if (keepzero) {
-				for (size_t i = 0; i < size; i++) {
-					if (data[i]) data[i] += f;
-				}
-			}
-			else {
-				for (size_t i = 0; i < size; i++) {
-					data[i] += f;
-				}
-			}
+			Util::array_op(data, f, nxyz, Util::ARRAY_ADD, keepzero != 0);
 			update();
 		}
 	}
@@ -397,13 +593,14 @@ void EMData::add(const EMData & image)
 		throw ImageFormatException( "not support add between real image and complex image");
 	}
 	else {
-
-		const float *src_data = image.get_data();
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] += src_data[i];
+		if (image.get_compact_data()) {
+			apply_compact(data, image, AddOp());
+		}
+		else {
+			Util::array_op(data, image.get_const_data(), size, Util::ARRAY_ADD);
 		}
 		update();
 	}
@@ -423,13 +620,10 @@ void EMData::addsquare(const EMData & image)
 	}
 	else {
 
-		const float *src_data = image.get_data();
-		size_t size = nxyz;
+		const float *src_data = image.get_const_data();
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] += src_data[i]*src_data[i];
-		}
+		Util::array_op(data, src_data, nxyz, Util::ARRAY_ADDSQUARE);
 		update();
 	}
 	EXITFUNC;
@@ -448,13 +642,10 @@ void EMData::subsquare(const EMData & image)
 	}
 	else {
 
-		const float *src_data = image.get_data();
-		size_t size = nxyz;
+		const float *src_data = image.get_const_data();
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] -= src_data[i]*src_data[i];
-		}
+		Util::array_op(data, src_data, nxyz, Util::ARRAY_SUBSQUARE);
 		update();
 	}
 	EXITFUNC;
@@ -479,10 +670,7 @@ void EMData::sub(float f)
 	if( is_real() )
 	{
 		if (f != 0) {
-			size_t size = nxyz;
-			for (size_t i = 0; i < size; i++) {
-				data[i] -= f;
-			}
+			Util::array_op(data, f, nxyz, Util::ARRAY_SUB);
 		}
 		update();
 	}
@@ -520,12 +708,14 @@ void EMData::sub(const EMData & em)
 		throw ImageFormatException( "not support sub between real image and complex image");
 	}
 	else {
-		const float *src_data = em.get_data();
 		size_t size = nxyz;
 		float* data = get_data();
 
-		for (size_t i = 0; i < size; i++) {
-			data[i] -= src_data[i];
+		if (em.get_compact_data()) {
+			apply_compact(data, em, SubOp());
+		}
+		else {
+			Util::array_op(data, em.get_const_data(), size, Util::ARRAY_SUB);
 		}
 		update();
 	}
@@ -550,11 +740,7 @@ void EMData::mult(float f)
 			return;
 		}
 #endif // EMAN2_USING_CUDA
-		float* data = get_data();
-		size_t size = nxyz;
-		for (size_t i = 0; i < size; i++) {
-			data[i] *= f;
-		}
+		Util::array_op(get_data(), f, nxyz, Util::ARRAY_MULT);
 		update();
 	}
 	EXITFUNC;
@@ -574,14 +760,15 @@ void EMData::mult(const EMData & em, bool prevent_complex_multiplication)
 	}
 	else
 	{
-		const float *src_data = em.get_data();
 		size_t size = nxyz;
 		float* data = get_data();
-		if( is_real() || prevent_complex_multiplication )
+		if (em.get_compact_data())
 		{
-			for (size_t i = 0; i < size; i++) {
-				data[i] *= src_data[i];
-			}
+			apply_compact(data, em, MultOp());		// compact images are real
+		}
+		else if( is_real() || prevent_complex_multiplication )
+		{
+			Util::array_op(data, em.get_const_data(), size, Util::ARRAY_MULT);
 		}
 		else mult_ri(em);
 		update();
@@ -615,7 +802,7 @@ void EMData::mult_complex_efficient(const EMData & em, const int radius)
 	if( is_real() || em.is_real() )throw ImageFormatException( "can call mult_complex_efficient unless both images are complex");
 
 
-	const float *src_data = em.get_data();
+	const float *src_data = em.get_const_data();
 
 	size_t i_radius = radius;
 	size_t k_radius = 1;
@@ -632,21 +819,20 @@ void EMData::mult_complex_efficient(const EMData & em, const int radius)
 	}
 
 
-	int s_nx = em.get_xsize();
-	int s_nxy = s_nx*em.get_ysize();
+	size_t s_nx = em.get_xsize();
+	size_t s_nxy = s_nx*em.get_ysize();
 
 	size_t r_size = nxyz;
-	int s_size = s_nxy*em.get_zsize();
+	size_t s_size = s_nxy*em.get_zsize();
 	float* data = get_data();
 
 	for (size_t k = 0; k < k_radius; ++k ) {
 		for (size_t j = 0; j < j_radius; j++) {
-			for (size_t i = 0; i < i_radius; i++) {
-				int r_idx = k*nxy + j*nx + i;
-				int s_idx = k*s_nxy + j*s_nx + i;
-				data[r_idx] *= src_data[s_idx];
-				data[r_size-r_idx-1] *= src_data[s_size-s_idx-1];
-			}
+			size_t r_idx = k*nxy + j*nx;
+			size_t s_idx = k*s_nxy + j*s_nx;
+			// a row from the origin, and its mirror image from the far end of the data
+			Util::array_op(data + r_idx, src_data + s_idx, i_radius, Util::ARRAY_MULT);
+			Util::array_op(data + r_size - r_idx - i_radius, src_data + s_size - s_idx - i_radius, i_radius, Util::ARRAY_MULT);
 		}
 	}
 
@@ -679,20 +865,16 @@ void EMData::div(const EMData & em)
 		throw ImageFormatException( "not support division between real image and complex image");
 	}
 	else {
-		const float *src_data = em.get_data();
+		const float *src_data = em.get_const_data();
 		size_t size = nxyz;
 		float* data = get_data();
 
 		if( is_real() )
 		{
-			for (size_t i = 0; i < size; i++) {
-				if(src_data[i] != 0) {
-					data[i] /= src_data[i];
-				}
-				else {
-					if (data[i]==0) continue;
-					throw InvalidValueException(src_data[i], "divide by zero");
-				}
+			// 0/0 is left as 0
+			if (Util::array_op(data, src_data, size, Util::ARRAY_DIV) != 0) {
+				update();
+				throw InvalidValueException(0, "divide by zero");
 			}
 		}
 		else
@@ -925,6 +1107,52 @@ std::complex<float> EMData::get_complex_at_interp(float xx, float yy) const
 }
 
 
+void EMData::sget_values_at_interp(const float *x, const float *y, size_t n, float *out) const
+{
+	Util::interp_bilinear(get_const_data(), nx, ny, x, y, n, out);
+}
+
+vector<float> EMData::sget_values_at_interp(const vector<float> & x, const vector<float> & y) const
+{
+	if (x.size() != y.size()) {
+		throw InvalidParameterException("x and y must have the same number of coordinates");
+	}
+
+	vector<float> result(x.size());
+	if (!x.empty()) sget_values_at_interp(&x[0], &y[0], x.size(), &result[0]);
+	return result;
+}
+
+void EMData::get_complex_at_interp(const float *x, const float *y, size_t n, std::complex<float> *out) const
+{
+	get_const_data();		// widen compact pixels before the threads read rdata
+
+	ComplexInterpJob job;
+	job.image = this;
+	job.x = x;
+	job.y = y;
+	job.out = out;
+	Util::parallel_for(n, complex_interp_worker, &job, 0, 1024);
+}
+
+void EMData::sget_values_at_interp(const float *x, const float *y, const float *z, size_t n, float *out) const
+{
+	Util::interp_trilinear(get_const_data(), nx, ny, nz, x, y, z, n, out);
+}
+
+vector<float> EMData::sget_values_at_interp(const vector<float> & x, const vector<float> & y,
+											const vector<float> & z) const
+{
+	if (x.size() != y.size() || x.size() != z.size()) {
+		throw InvalidParameterException("x, y and z must have the same number of coordinates");
+	}
+
+	vector<float> result(x.size());
+	if (!x.empty()) sget_values_at_interp(&x[0], &y[0], &z[0], x.size(), &result[0]);
+	return result;
+}
+
+
 float EMData::sget_value_at_interp(float xx, float yy, float zz) const
 {
 	int x = (int) Util::fast_floor(xx);
@@ -214,7 +214,7 @@ void set_col(const EMData * data, int col_index);
  */
 inline float get_value_at(int x, int y, int z) const
 {
-	return get_data()[(size_t)x + (size_t)y * (size_t)nx + (size_t)z * (size_t)nxy];
+	return get_const_data()[(size_t)x + (size_t)y * (size_t)nx + (size_t)z * (size_t)nxy];
 }
 
 /** Get the pixel density value at index i
@@ -222,7 +222,7 @@ inline float get_value_at(int x, int y, int z) const
  */
 inline float get_value_at_index(size_t i) const
 {
-        return *(rdata + i);
+        return get_const_data()[i];
 }
 
 /** Get the pixel density value at coordinates (x,y). 2D only.
@@ -234,7 +234,7 @@ inline float get_value_at_index(size_t i) const
  */
 inline float get_value_at(int x, int y) const
 {
-	return get_data()[x + y * nx];
+	return get_const_data()[x + y * nx];
 }
 
 
@@ -247,7 +247,7 @@ inline float get_value_at(int x, int y) const
  */
 inline float get_value_at(size_t i) const
 {
-	return get_data()[i];
+	return get_const_data()[i];
 }
 
 /** Get complex<float> value at x,y. This assumes the image is
@@ -348,6 +348,7 @@ size_t add_complex_at(const int &x,const int &y,const int &z,const std::complex<
 inline size_t add_complex_at_fast(const int &x,const int &y,const int &z,const std::complex<float> &val) {
 //if (x>=nx/2 || y>ny/2 || z>nz/2 || x<=-nx/2 || y<-ny/2 || z<-nz/2) return nxyz;
 if (abs(x)>=nx/2 || abs(y)>ny/2 || abs(z)>nz/2) return nxyz;
+if (rdata_shared) unshare_rdata();
 
 //if (x==0 && abs(y)==16 && abs(z)==1) printf("## %d %d %d\n",x,y,z);
 size_t idx;
@@ -507,6 +508,54 @@ float sget_value_at_interp(float x, float y) const;
  */
 float sget_value_at_interp(float x, float y, float z) const;
 
+
+/** sget_value_at_interp(x, y) at n points at once. This is much faster than a loop
+ * over the points: they are interpolated with SIMD instructions where available,
+ * and by get_num_threads() threads.
+ *
+ * @param x The x coordinates of the points.
+ * @param y The y coordinates of the points.
+ * @param n The number of points.
+ * @param out Receives the n interpolated values.
+ */
+void sget_values_at_interp(const float *x, const float *y, size_t n, float *out) const;
+
+
+/** sget_value_at_interp(x, y, z) at n points at once, see above.
+ *
+ * @param x The x coordinates of the points.
+ * @param y The y coordinates of the points.
+ * @param z The z coordinates of the points.
+ * @param n The number of points.
+ * @param out Receives the n interpolated values.
+ */
+void sget_values_at_interp(const float *x, const float *y, const float *z, size_t n, float *out) const;
+
+
+/** sget_value_at_interp(x, y) at each of the points (x[i], y[i]).
+ * @exception InvalidParameterException if x and y differ in length
+ * @return The interpolated values.
+ */
+vector<float> sget_values_at_interp(const vector<float> & x, const vector<float> & y) const;
+
+
+/** sget_value_at_interp(x, y, z) at each of the points (x[i], y[i], z[i]).
+ * @exception InvalidParameterException if x, y and z differ in length
+ * @return The interpolated values.
+ */
+vector<float> sget_values_at_interp(const vector<float> & x, const vector<float> & y, const vector<float> & z) const;
+
+
+/** get_complex_at_interp(x, y) at n points at once, split across get_num_threads()
+ * threads.
+ *
+ * @param x The x coordinates of the points.
+ * @param y The y coordinates of the points.
+ * @param n The number of points.
+ * @param out Receives the n complex values.
+ */
+void get_complex_at_interp(const float *x, const float *y, size_t n, std::complex<float> *out) const;
+
 /** set_value_at with Vec3i
  * @param loc location
  * @param v value
@@ -582,7 +631,7 @@ inline void set_value_at_fast(int x, int y, int z, float v)
 
 inline void set_value_at_index(size_t i, float v)
 {
-        *(rdata + i) = v;
+        get_data()[i] = v;
 }
 
 /** Set the pixel density value at coordinates (x,y).
@@ -46,6 +46,13 @@ using std::endl;
 #include <boost/shared_ptr.hpp>
 using boost::shared_ptr;
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif	//_WIN32
+
 using namespace EMAN;
 
 void EMData::read_image(const string & filename, int img_index, bool nodata,
@@ -59,6 +66,7 @@ void EMData::read_image(const string & filename, int img_index, bool nodata,
 		throw ImageFormatException("cannot create an image io");
 	}
 	else {
+		clear_hot_attrs();
 		int err = imageio->read_header(attr_dict, img_index, region, is_3d);
 		if (err) {
 			throw ImageReadException(filename, "imageio read header failed");
@@ -114,8 +122,7 @@ void EMData::read_image(const string & filename, int img_index, bool nodata,
 				}
 			}
 			else {
-				if (rdata!=0) EMUtil::em_free(rdata);
-				rdata=0;
+				release_rdata();
 			}
 
 		}
@@ -126,6 +133,123 @@ void EMData::read_image(const string & filename, int img_index, bool nodata,
 	EXITFUNC;
 }
 
+void EMData::read_image_mapped(const string & filename, int img_index, bool is_3d)
+{
+	ENTERFUNC;
+
+#ifdef _WIN32
+	read_image(filename, img_index, false, 0, is_3d);
+#else
+	ImageIO *imageio = EMUtil::get_imageio(filename, ImageIO::READ_ONLY);
+
+	if (!imageio) {
+		throw ImageFormatException("cannot create an image io");
+	}
+
+	off_t offset = 0;
+	bool mappable = imageio->get_mappable_offset(img_index, offset);
+	EMUtil::close_imageio(filename, imageio);
+	imageio = 0;
+
+	// the header is read the usual way, this also releases any old pixel data
+	read_image(filename, img_index, true, 0, is_3d);
+	size_t num_bytes = (size_t)nx*ny*nz*sizeof(float);
+
+	void *map = MAP_FAILED;
+	off_t map_offset = 0;
+	size_t map_size = 0;
+	if (mappable && num_bytes != 0) {
+		int fd = open(filename.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && offset + (off_t)num_bytes <= st.st_size) {
+			map_offset = offset % sysconf(_SC_PAGESIZE);		// mmap wants page aligned offsets
+			map_size = num_bytes + map_offset;
+			map = mmap(0, map_size, PROT_READ, MAP_PRIVATE, fd, offset - map_offset);
+		}
+		if (fd >= 0) close(fd);
+	}
+
+	if (map == MAP_FAILED) {
+		read_image(filename, img_index, false, 0, is_3d);
+	}
+	else {
+		set_size(nx, ny, nz, true);
+		rdata_shared = new SharedData;
+		rdata_shared->refs = 1;
+		rdata_shared->map = map;
+		rdata_shared->map_size = map_size;
+		rdata = (float *)((char *)map + map_offset);
+		update();
+	}
+#endif	//_WIN32
+
+	EXITFUNC;
+}
+
+void EMData::detach_mapped()
+{
+	ENTERFUNC;
+	if (rdata_shared && rdata_shared->map) unshare_rdata();
+	EXITFUNC;
+}
+
+void EMData::read_image_compact(const string & filename, int img_index,
+								const Region * region, bool is_3d)
+{
+	ENTERFUNC;
+
+	ImageIO *imageio = EMUtil::get_imageio(filename, ImageIO::READ_ONLY);
+
+	if (!imageio) {
+		throw ImageFormatException("cannot create an image io");
+	}
+
+	EMUtil::EMDataType type = imageio->get_compact_type(img_index, region);
+	EMUtil::close_imageio(filename, imageio);
+	imageio = 0;
+
+	if (type == EMUtil::EM_FLOAT) {
+		read_image(filename, img_index, false, region, is_3d);
+		EXITFUNC;
+		return;
+	}
+
+	// the header is read the usual way, this also releases any old pixel data
+	read_image(filename, img_index, true, region, is_3d);
+
+	if (region) {
+		nx = (int)region->get_width();
+		if (nx <= 0) nx = 1;
+		ny = (int)region->get_height();
+		if (ny <= 0) ny = 1;
+		nz = (int)region->get_depth();
+		if (nz <= 0) nz = 1;
+	}
+	set_size(nx, ny, nz, true);
+
+	// zeroed, for the parts of a region outside the image
+	void *data = EMUtil::em_calloc(nxyz, EMUtil::get_datatype_size(type));
+	if (data == 0) {
+		throw BadAllocException("Cannot allocate memory for compact image data");
+	}
+
+	imageio = EMUtil::get_imageio(filename, ImageIO::READ_ONLY);
+	int err = imageio ? imageio->read_compact_data(data, img_index, region) : 1;
+	EMUtil::close_imageio(filename, imageio);
+	imageio = 0;
+
+	if (err) {
+		EMUtil::em_free(data);
+		throw ImageReadException(filename, "imageio read data failed");
+	}
+
+	compact_data = data;
+	compact_type = type;
+	update();
+
+	EXITFUNC;
+}
+
 void EMData::read_binedimage(const string & filename, int img_index, int binfactor, bool fast, bool is_3d)
 {
 	ENTERFUNC;
@@ -136,6 +260,7 @@ void EMData::read_binedimage(const string & filename, int img_index, int binfact
 		throw ImageFormatException("cannot create an image io");
 	}
 	else {
+		clear_hot_attrs();
 		int err = imageio->read_header(attr_dict, img_index, 0, is_3d);
 		if (err) {
 			throw ImageReadException(filename, "imageio read header failed");
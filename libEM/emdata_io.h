@@ -65,6 +65,50 @@ void read_image(const string & filename, int img_index = 0,
 				bool header_only = false,
 				const Region * region = 0, bool is_3d = false);
 
+/** read an image as a read-only view of the memory mapped file instead of copying the
+ * pixels into memory. Processes reading the same file share the page cache, and only the
+ * pages actually used are read from disk. The first write through get_data() (or
+ * set_value_at() etc.) gives the image a private copy of the pixels. Only possible when
+ * the file stores the image exactly as EMData holds it, i.e. native endian 32 bit float
+ * MRC/MRCS/FEI raw data. Anything else is read normally with read_image().
+ * The file must not be changed while it is mapped: pixels not yet copied show the new
+ * contents, and a truncated file kills the process with SIGBUS on access. Call
+ * detach_mapped() before the file is rewritten.
+ *
+ * @param filename The image file name.
+ * @param img_index The nth image you want to read.
+ * @param is_3d  Whether to treat the image as a single 3D or a
+ *   set of 2Ds. This is a hint for certain image formats which
+ *   has no difference between 3D image and set of 2Ds.
+ * @exception ImageFormatException
+ * @exception ImageReadException
+ */
+void read_image_mapped(const string & filename, int img_index = 0, bool is_3d = false);
+
+/** If the pixels are a view of a memory mapped file (see read_image_mapped()), give the
+ * image its own copy of them, so it no longer depends on the file. Copies of the image
+ * made before the call keep using the mapping until they are detached or written to.
+ */
+void detach_mapped();
+
+/** read an image keeping 8 and 16 bit integer pixels (e.g. movie frames or counting mode
+ * data) in their file type instead of widening them to float, at 1/4 or 1/2 the memory.
+ * They are converted the first time get_data() or get_const_data() is called, see
+ * get_storage_type(). MRC files (and whole images in HDF files) support this, anything
+ * else is read normally with read_image().
+ *
+ * @param filename The image file name.
+ * @param img_index The nth image you want to read.
+ * @param region To read only a region of the image.
+ * @param is_3d  Whether to treat the image as a single 3D or a
+ *   set of 2Ds. This is a hint for certain image formats which
+ *   has no difference between 3D image and set of 2Ds.
+ * @exception ImageFormatException
+ * @exception ImageReadException
+ */
+void read_image_compact(const string & filename, int img_index = 0,
+						const Region * region = 0, bool is_3d = false);
+
 /** read in a binned image, bin while reading. For use in huge files(tomograms)
  * @param filename The image file name.
  * @param img_index The nth image you want to read.
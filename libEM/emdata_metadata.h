@@ -63,11 +63,17 @@ EMData *get_fft_amplitude2D();
 EMData *get_fft_phase();
 
 /** Get the image pixel density data in a 1D float array.
+ * If the pixels are shared with copies of this image (see copy()), this image first gets
+ * a private copy of them, so callers may write through the returned pointer. Use
+ * get_const_data() when only reading. Pointers obtained before a copy() must not be used
+ * to write afterwards, call get_data() again. Compact pixels (see set_storage_type())
+ * are converted to float.
  * @return The image pixel density data.
  */
 #ifdef EMAN2_USING_CUDA
 inline float *get_data() const
 {
+	if (compact_data) widen_compact_data();
 	if(rdata == 0){
 		rdata = (float*)malloc(num_bytes);
 		cudadirtybit = 1;
@@ -79,13 +85,62 @@ inline float *get_data() const
 	return rdata;
 }
 #else
-inline float *get_data() const { return rdata; }
+inline float *get_data() const
+{
+	if (compact_data) widen_compact_data();
+	if (rdata_shared) unshare_rdata();
+	return rdata;
+}
 #endif
 
-/** Get the image pixel density data in a 1D float array - const version of get_data
+/** Get the image pixel density data for a view which outlives the call, such as the numpy
+ * array of EMNumPy::em2numpy(). Writes through the view must stay in this image, so from
+ * then on copies of it get their own pixels rather than sharing them (see copy()).
+ * @return The image pixel density data.
+ */
+inline float *export_data() const
+{
+	float *data = get_data();
+	rdata_pinned = true;
+	return data;
+}
+
+/** Get the image pixel density data in a 1D float array - const version of get_data.
+ * Unlike get_data() this does not duplicate pixels shared with copies of this image.
+ * Compact pixels are converted to float, as by get_data().
  * @return The image pixel density data.
  */
+#ifdef EMAN2_USING_CUDA
 inline const float * get_const_data() const { return get_data(); }
+#else
+inline const float * get_const_data() const
+{
+	if (compact_data) widen_compact_data();
+	return rdata;
+}
+#endif
+
+/** Get the type the pixels are stored in. 8 and 16 bit data read with
+ * read_image_compact(), or converted with set_storage_type(), stays in that type until
+ * get_data() or get_const_data() is called. Statistics, add(), sub(), mult(), do_fft()
+ * and clipping read it without converting the whole image.
+ * @return EM_FLOAT, or the compact type: EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF
+ */
+inline EMUtil::EMDataType get_storage_type() const { return compact_data ? compact_type : EMUtil::EM_FLOAT; }
+
+/** Convert the pixels to another storage type, see get_storage_type(). Storing floats
+ * as integers rounds them and clamps them to the range of the type, half floats keep
+ * 11 significant bits.
+ * @param type EM_FLOAT, EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF
+ * @exception InvalidValueException if type is not one of these
+ * @exception ImageFormatException if a complex image is to be stored compactly
+ */
+void set_storage_type(EMUtil::EMDataType type);
+
+/** Get the compact pixels, see get_storage_type().
+ * @return the samples, 0 if the pixels are stored as float
+ */
+inline const void * get_compact_data() const { return compact_data; }
 
 /**  Set the data explicitly
 * data pointer must be allocated using malloc!
@@ -95,7 +150,7 @@ inline const float * get_const_data() const { return get_data(); }
 * @param z the number of pixels in the z direction
 */
 inline void set_data(float* data, const int x, const int y, const int z) {
-	if (rdata) { EMUtil::em_free(rdata); rdata = 0; }
+	release_rdata();
 #ifdef EMAN2_USING_CUDA
 	//cout << "set data" << endl;
 //	free_cuda_memory();
@@ -108,6 +163,7 @@ inline void set_data(float* data, const int x, const int y, const int z) {
 }
 
 inline void set_data(float* data) {
+	release_rdata(false);	// the caller owns the old buffer
 	rdata = data;
 }
 
@@ -141,7 +197,7 @@ void read_data(string fsp,size_t loc,const Region* area=0,const int file_nx=0, c
 /** Mark EMData as changed, statistics, etc will be updated at need.*/
 inline void update()
 {
-	flags |= EMDATA_NEEDUPD;
+	flags |= EMDATA_NEEDUPD | EMDATA_STALE_ALL;
 	changecount++;
 #ifdef FFT_CACHING
 	if (fftcache!=0) { delete fftcache; fftcache=0; }
@@ -152,7 +208,7 @@ inline void update()
 /** turn off updates. Useful to avoid wasteful recacling stats */
 inline void clearupdate()
 {
-	flags &= ~EMDATA_NEEDUPD;
+	flags &= ~(EMDATA_NEEDUPD | EMDATA_STALE_ALL);
 	changecount--;
 }
 
@@ -551,6 +607,42 @@ EMObject get_attr(const string & attr_name) const;
  */
 EMObject get_attr_default(const string & attr_name, const EMObject & em_obj = EMObject()) const;
 
+/** Get an apix attribute (ATTR_APIX_X, ATTR_APIX_Y or ATTR_APIX_Z) without searching
+ * the attribute dictionary. 1.0 if the image has no such attribute.
+ *
+ * @param key The interned attribute name.
+ * @return The attribute value.
+ * @exception InvalidValueException when key is not an apix attribute
+ */
+float get_attr_apix(HotAttr key) const;
+
+/** Get a transform attribute (ATTR_XFORM_PROJECTION, ATTR_XFORM_ALIGN2D or
+ * ATTR_XFORM_ALIGN3D). The Transform is parsed once and owned by the image, copy it
+ * if it must outlive the next change to the attribute.
+ *
+ * @param key The interned attribute name.
+ * @return The attribute value.
+ * @exception NotExistingObjectException when the attribute does not exist
+ * @exception InvalidValueException when key is not a transform attribute
+ */
+const Transform & get_attr_transform(HotAttr key) const;
+
+/** Get the "ctf" attribute, parsed once and owned by the image, unlike get_ctf()
+ * and get_attr("ctf") which return a new Ctf each time.
+ *
+ * @return The CTF parameters, 0 if the image has none.
+ */
+const Ctf * get_attr_ctf() const;
+
+/** Get the "class_ptcl_idxs" attribute of a class average without copying it.
+ *
+ * @return The particle indices, empty if the image has none.
+ */
+const vector<int> & get_attr_class_ptcl_idxs() const;
+
+/** @return The attribute name interned as key. */
+static const char *get_hot_attr_name(HotAttr key);
+
 /** Set a header attribute's value.
  *
  * @param key The header attribute name.
@@ -94,6 +94,53 @@ EMData * EMData::process(Processor * p) const
 	EXITFUNC;
 }
 
+EMData* EMData::process_move(const string & processorname, const Dict & params)
+{
+	ENTERFUNC;
+	Processor *f = Factory < Processor >::get(processorname, params);
+	EMData * result = 0;
+	if (f) {
+		try {
+			result = process_move(f);
+		}
+		catch (...) {
+			delete f;
+			throw;
+		}
+		delete f;
+		f = 0;
+	}
+	EXITFUNC;
+	return result;
+}
+
+EMData * EMData::process_move(Processor * p)
+{
+	ENTERFUNC;
+	EMData * result = 0;
+	if (!p) return result;
+
+	if (!p->works_inplace()) {
+		result = p->process(this);
+		EMData empty;
+		swap(empty);
+		return result;
+	}
+
+	result = new EMData();
+	result->swap(*this);
+	try {
+		p->process_inplace(result);
+	}
+	catch (...) {
+		swap(*result);
+		delete result;
+		throw;
+	}
+	EXITFUNC;
+	return result;
+}
+
 float EMData::cmp(const string & cmpname, EMData * with, const Dict & params)
 {
 	ENTERFUNC;
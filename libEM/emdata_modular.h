@@ -69,6 +69,25 @@ EMData * process(const string & processorname, const Dict & params = Dict()) con
  * */
 EMData * process(Processor * p) const;
 
+/** Apply a processor to this image, moving its pixels into the returned image instead
+ * of copying them, and leave this image empty (0x0x0). For chains like
+ * a = a.process(...) in which the source is discarded anyway. Processors which can
+ * work in place (see Processor::works_inplace()) then allocate nothing; the others
+ * behave as process() followed by freeing this image.
+ * If the processor throws, this image is given back its pixels, which may have been
+ * partially processed.
+ * @param processorname Processor Name.
+ * @param params Processor parameters in a keyed dictionary.
+ * @return the processed result, a new image
+ * @exception NotExistingObjectError If the processor doesn't exist.
+ * */
+EMData * process_move(const string & processorname, const Dict & params = Dict());
+
+/** process_move() with an instance of Processor.
+ * @param p the processor pointer
+ * */
+EMData * process_move(Processor * p);
+
 /** Compare this image with another image.
  * @param cmpname Comparison algorithm name.
  * @param with The image you want to compare to.
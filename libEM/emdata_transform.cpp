@@ -99,7 +99,18 @@ EMData *EMData::do_fft() const
 
 		float *d = dat->get_data();
 		//std::cout<<" do_fft "<<rdata[5]<<"  "<<d[5]<<std::endl;
-		EMfft::real_to_complex_nd(get_data(), d, nxreal, ny, nz);
+		if (compact_data) {
+			// convert the rows straight into the padded layout of an in-place transform
+			const size_t nrows = (size_t)ny*nz;
+			for (size_t row = 0; row < nrows; ++row) {
+				EMUtil::compact_to_float(compact_data, compact_type, row*nxreal, nxreal, d + row*nx2);
+			}
+			EMfft::real_to_complex_nd(d, d, nxreal, ny, nz);
+		}
+		else {
+			// an out of place transform leaves its input alone, so the pixels need not be unshared
+			EMfft::real_to_complex_nd(const_cast<float *>(get_const_data()), d, nxreal, ny, nz);
+		}
 
 		dat->update();
 		dat->set_fftpad(true);
@@ -119,23 +130,14 @@ EMData *EMData::do_fft() const
 	}
 }
 
-void EMData::do_fft_inplace()
+int EMData::fft_pad_inplace()
 {
-	ENTERFUNC;
-
-	if ( is_complex() ) {
-		LOGERR("real image expected. Input image is complex image.");
-		throw ImageFormatException("real image expected. Input image is complex image.");
-	}
-
-	size_t offset;
 	int nxreal;
-	get_data(); // Required call if GPU caching is being used. Otherwise harmless
 	if (!is_fftpadded()) {
 		// need to extend the matrix along x
 		// meaning nx is the un-fftpadded size
 		nxreal = nx;
-		offset = 2 - nx%2;
+		size_t offset = 2 - nx%2;
 		if (1 == offset) set_fftodd(true);
 		else             set_fftodd(false);
 		int nxnew = nx + offset;
@@ -151,9 +153,23 @@ void EMData::do_fft_inplace()
 		}
 		set_fftpad(true);
 	} else {
-		offset = is_fftodd() ? 1 : 2;
+		size_t offset = is_fftodd() ? 1 : 2;
 		nxreal = nx - offset;
 	}
+	return nxreal;
+}
+
+void EMData::do_fft_inplace()
+{
+	ENTERFUNC;
+
+	if ( is_complex() ) {
+		LOGERR("real image expected. Input image is complex image.");
+		throw ImageFormatException("real image expected. Input image is complex image.");
+	}
+
+	get_data(); // Required call if GPU caching is being used. Otherwise harmless
+	int nxreal = fft_pad_inplace();
 	EMfft::real_to_complex_nd(rdata, rdata, nxreal, ny, nz);
 
 	set_complex(true);
@@ -166,6 +182,114 @@ void EMData::do_fft_inplace()
 	//return this;
 }
 
+namespace {
+	void fft_batch(const vector<float *> & real_data, const vector<float *> & complex_data, int nx, int ny, int nz, int nthreads)
+	{
+#ifdef USE_FFTW3
+		EMfft::real_to_complex_nd_batch(real_data, complex_data, nx, ny, nz, nthreads);
+#else
+		for (size_t i = 0; i < real_data.size(); ++i) EMfft::real_to_complex_nd(real_data[i], complex_data[i], nx, ny, nz);
+#endif	//USE_FFTW3
+	}
+
+	// Shared argument checks of do_fft_many() and do_fft_inplace_many()
+	void check_fft_many(const vector<EMData *> & images)
+	{
+		for (size_t i = 0; i < images.size(); ++i) {
+			if (images[i] == 0) throw NullPointerException("NULL image in do_fft_many");
+			if (images[i]->is_complex()) throw ImageFormatException("real images expected. Input image is complex image.");
+			if (!EMUtil::is_same_size(images[i], images[0])) throw ImageDimensionException("do_fft_many requires images of the same size");
+		}
+	}
+}
+
+vector<EMData *> EMData::do_fft_many(const vector<EMData *> & images, int nthreads)
+{
+	ENTERFUNC;
+	check_fft_many(images);
+
+	vector<EMData *> ffts;
+	if (images.empty()) return ffts;
+
+	const EMData *first = images[0];
+	const int nxreal = first->nx;
+	const int nx2 = nxreal + 2 - nxreal%2;
+
+	// as in do_fft(), float images are transformed out of place from their own pixels, which
+	// need not be unshared, and compact images are converted straight into the padded output
+	vector<float *> real_data, complex_data, padded_data;
+	ffts.reserve(images.size());
+	try {
+		for (size_t i = 0; i < images.size(); ++i) {
+			EMData *dat = images[i]->copy_head();
+			ffts.push_back(dat);
+			dat->set_size(nx2, first->ny, first->nz);
+			dat->set_fftodd(nxreal%2 == 1);
+
+			const EMData *img = images[i];
+			float *d = dat->get_data();
+			if (img->compact_data) {
+				const size_t nrows = (size_t)img->ny*img->nz;
+				for (size_t row = 0; row < nrows; ++row) {
+					EMUtil::compact_to_float(img->compact_data, img->compact_type, row*nxreal, nxreal, d + row*nx2);
+				}
+				padded_data.push_back(d);
+			}
+			else {
+				real_data.push_back(const_cast<float *>(img->get_const_data()));
+				complex_data.push_back(d);
+			}
+		}
+
+		if (!real_data.empty()) fft_batch(real_data, complex_data, nxreal, first->ny, first->nz, nthreads);
+		if (!padded_data.empty()) fft_batch(padded_data, padded_data, nxreal, first->ny, first->nz, nthreads);
+	}
+	catch (...) {
+		for (size_t i = 0; i < ffts.size(); ++i) delete ffts[i];
+		throw;
+	}
+
+	for (size_t i = 0; i < ffts.size(); ++i) {
+		EMData *dat = ffts[i];
+		dat->update();
+		dat->set_fftpad(true);
+		dat->set_complex(true);
+		dat->set_attr("is_intensity",false);
+		if(dat->get_ysize()==1 && dat->get_zsize()==1) dat->set_complex_x(true);
+		dat->set_ri(true);
+	}
+
+	EXITFUNC;
+	return ffts;
+}
+
+void EMData::do_fft_inplace_many(const vector<EMData *> & images, int nthreads)
+{
+	ENTERFUNC;
+	check_fft_many(images);
+	if (images.empty()) return;
+
+	vector<float *> data(images.size());
+	int nxreal = 0;
+	for (size_t i = 0; i < images.size(); ++i) {
+		images[i]->get_data(); // Required call if GPU caching is being used. Otherwise harmless
+		nxreal = images[i]->fft_pad_inplace();
+		data[i] = images[i]->rdata;
+	}
+
+	fft_batch(data, data, nxreal, images[0]->ny, images[0]->nz, nthreads);
+
+	for (size_t i = 0; i < images.size(); ++i) {
+		EMData *img = images[i];
+		img->set_complex(true);
+		if(img->ny==1 && img->nz==1)  img->set_complex_x(true);
+		img->set_ri(true);
+		img->update();
+	}
+
+	EXITFUNC;
+}
+
 #ifdef EMAN2_USING_CUDA
 
 #include "cuda/cuda_emfft.h"
@@ -1828,20 +1952,34 @@ void EMData::insert_clip(const EMData * const block, const IntPoint &origin) {
 	}
 #endif
 */
-	float *src = block->get_data() + zd0 * src_secsize + yd0 * nx1 + xd0;
 	float *dst = get_data() + z0 * dst_secsize + y0 * nx + x0;
-	
-	size_t src_gap = src_secsize - (y1-y0) * nx1;
 	size_t dst_gap = dst_secsize - (y1-y0) * nx;
-	
-	for (int i = z0; i < z1; i++) {
-		for (int j = y0; j < y1; j++) {
-			EMUtil::em_memcpy(dst, src, clipped_row_size);
-			src += nx1;
-			dst += nx;
+	size_t src_gap = src_secsize - (y1-y0) * nx1;
+
+	if (block->compact_data) {
+		// compact rows are converted as they are copied, block is not widened
+		size_t src = zd0 * src_secsize + yd0 * nx1 + xd0;
+		for (int i = z0; i < z1; i++) {
+			for (int j = y0; j < y1; j++) {
+				EMUtil::compact_to_float(block->compact_data, block->compact_type, src, x1-x0, dst);
+				src += nx1;
+				dst += nx;
+			}
+			src += src_gap;
+			dst += dst_gap;
+		}
+	}
+	else {
+		const float *src = block->get_const_data() + zd0 * src_secsize + yd0 * nx1 + xd0;
+		for (int i = z0; i < z1; i++) {
+			for (int j = y0; j < y1; j++) {
+				EMUtil::em_memcpy(dst, src, clipped_row_size);
+				src += nx1;
+				dst += nx;
+			}
+			src += src_gap;
+			dst += dst_gap;
 		}
-		src += src_gap;
-		dst += dst_gap;
 	}
 	
 #ifdef EMAN2_USING_CUDA	
@@ -92,6 +92,28 @@ void do_ift_inplace_cuda();
 void do_fft_inplace();
 
 
+/** Fourier transform a set of equal size real images in one call. Gives the same
+ * result as calling do_fft() on each image, but the FFT plan is looked up once and
+ * the transforms are spread over several threads. The images are not changed.
+ * @param images the real images, all of the same size
+ * @param nthreads the number of threads, 0 for Util::get_num_threads()
+ * @exception ImageFormatException If an image is complex.
+ * @exception ImageDimensionException If the images are not all the same size.
+ * @return The FFTs in real/imaginary format, owned by the caller.
+ */
+static vector<EMData *> do_fft_many(const vector<EMData *> & images, int nthreads = 0);
+
+
+/** In-place version of do_fft_many(). Gives the same result as calling
+ * do_fft_inplace() on each image.
+ * @param images the real images, all of the same size
+ * @param nthreads the number of threads, 0 for Util::get_num_threads()
+ * @exception ImageFormatException If an image is complex.
+ * @exception ImageDimensionException If the images are not all the same size.
+ */
+static void do_fft_inplace_many(const vector<EMData *> & images, int nthreads = 0);
+
+
 /** return the inverse fourier transform (IFT) image of the current
  * image. the current image may be changed if it is in amplitude/phase
  * format as opposed to real/imaginary format - if this change is
@@ -35,6 +35,7 @@
 
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include "emfft.h"
 #include "log.h"
 
@@ -75,6 +76,169 @@ MUTEX fft_mutex;
 pthread_mutex_t fft_mutex=PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+#ifdef USE_FFTW3
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace {
+	// Writes the wisdom, creating the directory of the file first (~/.eman2 on a new account)
+	bool export_wisdom(const string & fname)
+	{
+		if (fname.empty()) return false;
+#ifndef _WIN32
+		string::size_type slash = fname.rfind('/');
+		if (slash != string::npos && slash > 0) mkdir(fname.substr(0, slash).c_str(), 0755);
+#endif	//_WIN32
+		return fftwf_export_wisdom_to_filename(fname.c_str()) != 0;
+	}
+
+	/** Runtime FFTW planner configuration shared by all EMfft transforms.
+	 * Initialized from the environment the first time a plan is requested, and
+	 * writes the wisdom file back at exit if any measured plans were created.
+	 */
+	struct FFTWPlannerState
+	{
+		FFTWPlannerState() : initialized(false), mode(EMfft::PLAN_ESTIMATE), nthreads(1), dirty(false) {}
+		~FFTWPlannerState()
+		{
+			if (dirty) export_wisdom(wisdom_file);
+		}
+
+		bool initialized;
+		int mode;
+		int nthreads;	// threads used for transforms of at least EMFFTW3_THREAD_MIN_SIZE elements
+		bool dirty;		// FFTW measured new plans since the wisdom was last saved
+		string wisdom_file;
+	};
+
+	FFTWPlannerState planner;
+
+	// Bumped with fft_mutex held whenever planner.nthreads changes. Threads compare it with their own
+	// copy without the lock, a stale read only means the new count is used from the next lookup on
+	volatile int planner_generation = 1;
+
+	// Must be called with fft_mutex held
+	void init_planner()
+	{
+		if (planner.initialized) return;
+		planner.initialized = true;
+
+#ifdef FFTW_THREADS
+		if (!fftwf_init_threads()) {
+			LOGWARN("FFTW threads could not be initialized, all transforms will be single threaded");
+		}
+		else {
+			const char *nt = getenv("EMAN2_FFTW_THREADS");
+			if (nt != NULL && atoi(nt) > 0) planner.nthreads = atoi(nt);
+		}
+#endif	//FFTW_THREADS
+
+		const char *env = getenv("EMAN2_FFTW_PLANNER");
+		if (env != NULL) {
+			string m(env);
+			if (m == "measure") planner.mode = EMfft::PLAN_MEASURE;
+			else if (m == "patient") planner.mode = EMfft::PLAN_PATIENT;
+			else if (m != "estimate") {
+				LOGWARN("Unknown EMAN2_FFTW_PLANNER '%s', using estimate", env);
+			}
+		}
+
+		planner.wisdom_file = EMfft::get_wisdom_file();
+		struct stat st;
+		if (!planner.wisdom_file.empty() && stat(planner.wisdom_file.c_str(), &st) == 0) {
+			if (!fftwf_import_wisdom_from_filename(planner.wisdom_file.c_str())) {
+				LOGWARN("Could not read FFTW wisdom from '%s'", planner.wisdom_file.c_str());
+			}
+		}
+	}
+
+	unsigned int planner_flags(int mode)
+	{
+		switch (mode) {
+			case EMfft::PLAN_MEASURE: return FFTW_MEASURE;
+			case EMfft::PLAN_PATIENT: return FFTW_PATIENT;
+			default: return FFTW_ESTIMATE;
+		}
+	}
+}
+
+void EMfft::set_plan_mode(int mode)
+{
+	if (mode != PLAN_ESTIMATE && mode != PLAN_MEASURE && mode != PLAN_PATIENT) throw InvalidValueException(mode, "Unknown FFTW plan mode");
+
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+	planner.mode = mode;
+	Util::MUTEX_UNLOCK(&fft_mutex);
+}
+
+int EMfft::get_plan_mode()
+{
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+	int mode = planner.mode;
+	Util::MUTEX_UNLOCK(&fft_mutex);
+	return mode;
+}
+
+void EMfft::set_num_threads(int nthreads)
+{
+	if (nthreads < 1) throw InvalidValueException(nthreads, "The number of FFT threads must be at least 1");
+
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+#ifdef FFTW_THREADS
+	planner.nthreads = nthreads;
+	++planner_generation;
+#else
+	if (nthreads > 1) {
+		LOGWARN("EMAN2 was built without FFTW threads, transforms stay single threaded");
+	}
+#endif	//FFTW_THREADS
+	Util::MUTEX_UNLOCK(&fft_mutex);
+}
+
+int EMfft::get_num_threads()
+{
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+	int nthreads = planner.nthreads;
+	Util::MUTEX_UNLOCK(&fft_mutex);
+	return nthreads;
+}
+
+string EMfft::get_wisdom_file()
+{
+	const char *env = getenv("EMAN2_FFTW_WISDOM");
+	if (env != NULL) return string(env);
+
+	const char *home = getenv("HOME");
+	if (home == NULL) return string();
+	return string(home) + "/.eman2/fftwf_wisdom";
+}
+
+bool EMfft::load_wisdom(const string & filename)
+{
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+	const string & fname = filename.empty() ? planner.wisdom_file : filename;
+	bool ret = !fname.empty() && fftwf_import_wisdom_from_filename(fname.c_str());
+	Util::MUTEX_UNLOCK(&fft_mutex);
+	return ret;
+}
+
+bool EMfft::save_wisdom(const string & filename)
+{
+	Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+	const string & fname = filename.empty() ? planner.wisdom_file : filename;
+	bool ret = export_wisdom(fname);
+	if (ret && fname == planner.wisdom_file) planner.dirty = false;
+	Util::MUTEX_UNLOCK(&fft_mutex);
+	return ret;
+}
+#endif // USE_FFTW3
+
 #ifdef FFTW_PLAN_CACHING
 // The only thing important about these constants is that they don't equal each other
 const int EMfft::EMAN2_REAL_2_COMPLEX = 1;
@@ -82,122 +246,235 @@ const int EMfft::EMAN2_COMPLEX_2_REAL = 2;
 
 
 #ifdef USE_FFTW3
-EMfft::EMfftw3_cache::EMfftw3_cache() :
-		num_plans(0)
+namespace {
+	// Key of the thread local storage holding each thread's EMfftw3_cache::ThreadPlans
+#ifdef _WIN32
+	DWORD thread_plans_key = TLS_OUT_OF_INDEXES;
+	// Windows has no destructors for thread local storage, so the views are freed at exit
+	vector<void *> all_thread_plans;
+#else
+	pthread_key_t thread_plans_key;
+#endif	//_WIN32
+
+	bool warned_cache_size = false;
+}
+
+bool EMfft::EMfftw3_cache::PlanKey::operator<(const PlanKey & that) const
 {
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
-	{
-		rank[i] = 0;
-		plan_dims[i][0] = 0; plan_dims[i][1] = 0; plan_dims[i][2] = 0;
-		r2c[i] = -1;
-		ip[i] = -1;
-		fftwplans[i] = NULL;
+	if (rank != that.rank) return rank < that.rank;
+	for (int i = 0; i < 3; ++i) {
+		if (dims[i] != that.dims[i]) return dims[i] < that.dims[i];
 	}
+	if (r2c != that.r2c) return r2c < that.r2c;
+	if (ip != that.ip) return ip < that.ip;
+	if (al != that.al) return al < that.al;
+	return nt < that.nt;
+}
+
+EMfft::EMfftw3_cache::EMfftw3_cache()
+{
+#ifdef _WIN32
+	thread_plans_key = TlsAlloc();
+#else
+	pthread_key_create(&thread_plans_key, &EMfftw3_cache::delete_thread_plans);
+#endif	//_WIN32
+}
+
+void EMfft::EMfftw3_cache::delete_thread_plans(void *thread_plans)
+{
+	// Only the map is freed, the plans belong to the shared cache
+	delete static_cast<ThreadPlans *>(thread_plans);
+}
+
+EMfft::EMfftw3_cache::ThreadPlans *EMfft::EMfftw3_cache::thread_plans()
+{
+#ifdef _WIN32
+	ThreadPlans *tp = static_cast<ThreadPlans *>(TlsGetValue(thread_plans_key));
+#else
+	ThreadPlans *tp = static_cast<ThreadPlans *>(pthread_getspecific(thread_plans_key));
+#endif	//_WIN32
+
+	if (tp == NULL) {
+		tp = new ThreadPlans();
+#ifdef _WIN32
+		TlsSetValue(thread_plans_key, tp);
+		Util::MUTEX_LOCK(&fft_mutex);
+		all_thread_plans.push_back(tp);
+		Util::MUTEX_UNLOCK(&fft_mutex);
+#else
+		pthread_setspecific(thread_plans_key, tp);
+#endif	//_WIN32
+	}
+
+	return tp;
 }
 
 void EMfft::EMfftw3_cache::debug_plans()
 {
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
+	int i = 0;
+	for (PlanMap::const_iterator it = plans.begin(); it != plans.end(); ++it, ++i)
 	{
-		cout << "Plan " << i << " has dims " << plan_dims[i][0] << " " 
-				<< plan_dims[i][1] << " " << 
-				plan_dims[i][2] << ", rank " <<
-				rank[i] << ", rc flag " 
-				<< r2c[i] << ", ip flag " << ip[i] << endl;
+		const PlanKey & k = it->first;
+		cout << "Plan " << i << " has dims " << k.dims[0] << " " 
+				<< k.dims[1] << " " << 
+				k.dims[2] << ", rank " <<
+				k.rank << ", rc flag " 
+				<< k.r2c << ", ip flag " << k.ip << ", aligned flag " << k.al << ", threads " << k.nt << endl;
 	}
 }
 
 EMfft::EMfftw3_cache::~EMfftw3_cache()
 {
-	for(int i = 0; i < EMFFTW3_CACHE_SIZE; ++i)
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	for (PlanMap::iterator it = plans.begin(); it != plans.end(); ++it)
 	{
-		if (fftwplans[i] != NULL)
-		{
-			int mrt = Util::MUTEX_LOCK(&fft_mutex);
-			fftwf_destroy_plan(fftwplans[i]);
-			mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-			fftwplans[i] = NULL;
-		}
+		fftwf_destroy_plan(it->second);
 	}
+	plans.clear();
+#ifdef _WIN32
+	for (size_t i = 0; i < all_thread_plans.size(); ++i) delete_thread_plans(all_thread_plans[i]);
+	all_thread_plans.clear();
+#endif	//_WIN32
+	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
 }
 
-fftwf_plan EMfft::EMfftw3_cache::get_plan(const int rank_in, const int x, const int y, const int z, const int r2c_flag, const int ip_flag, fftwf_complex* complex_data, float* real_data )
+fftwf_plan EMfft::EMfftw3_cache::plan_transform(const PlanKey & key, fftwf_complex* complex_data, float* real_data, unsigned int flags)
 {
-
-	if ( rank_in > 3 || rank_in < 1 ) throw InvalidValueException(rank_in, "Error, can not get an FFTW plan using rank out of the range [1,3]");
-	if ( r2c_flag != EMAN2_REAL_2_COMPLEX && r2c_flag != EMAN2_COMPLEX_2_REAL ) throw InvalidValueException(r2c_flag, "The selected real to complex flag is not supported");
-	
-// 	static int num_added = 0;
-// 	cout << "Was asked for " << rank_in << " " << x << " " << y << " " << z << " " << r2c_flag << endl;
-	
+	const int x = key.dims[0], y = key.dims[1], z = key.dims[2];
 	int dims[3];
 	dims[0] = z;
 	dims[1] = y;
 	dims[2] = x;
-	
-	int mrt = Util::MUTEX_LOCK(&fft_mutex);
-	
-	// First check to see if we already have the plan
-	int i;
-	for (i=0; i<num_plans; i++) {
-		if (plan_dims[i][0]==x && plan_dims[i][1]==y && plan_dims[i][2]==z && rank[i]==rank_in && r2c[i]==r2c_flag && ip[i]==ip_flag) {
-			mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-			return fftwplans[i];
-		}
-	}
-	
+
 	fftwf_plan plan;
-	// Create the plan
 	if ( y == 1 && z == 1 )
 	{
-		if ( r2c_flag == EMAN2_REAL_2_COMPLEX )
-			plan = fftwf_plan_dft_r2c_1d(x, real_data, complex_data, FFTW_ESTIMATE);
-		else // r2c_flag == EMAN2_COMPLEX_2_REAL, this is guaranteed by the error checking at the beginning of the function
-			plan = fftwf_plan_dft_c2r_1d(x, complex_data, real_data, FFTW_ESTIMATE);
+		if ( key.r2c == EMAN2_REAL_2_COMPLEX )
+			plan = fftwf_plan_dft_r2c_1d(x, real_data, complex_data, flags);
+		else // key.r2c == EMAN2_COMPLEX_2_REAL, this is guaranteed by the error checking in get_plan
+			plan = fftwf_plan_dft_c2r_1d(x, complex_data, real_data, flags);
 	}
 	else
 	{
-		if ( r2c_flag == EMAN2_REAL_2_COMPLEX )
-			plan = fftwf_plan_dft_r2c(rank_in, dims + (3 - rank_in), real_data, complex_data, FFTW_ESTIMATE);
-		else // r2c_flag == EMAN2_COMPLEX_2_REAL, this is guaranteed by the error checking at the beginning of the function
-			plan = fftwf_plan_dft_c2r(rank_in, dims + (3 - rank_in), complex_data, real_data, FFTW_ESTIMATE);
+		if ( key.r2c == EMAN2_REAL_2_COMPLEX )
+			plan = fftwf_plan_dft_r2c(key.rank, dims + (3 - key.rank), real_data, complex_data, flags);
+		else // key.r2c == EMAN2_COMPLEX_2_REAL, this is guaranteed by the error checking in get_plan
+			plan = fftwf_plan_dft_c2r(key.rank, dims + (3 - key.rank), complex_data, real_data, flags);
 	}
+	return plan;
+}
 
-	if (fftwplans[EMFFTW3_CACHE_SIZE-1] != NULL )
+fftwf_plan EMfft::EMfftw3_cache::make_plan(const PlanKey & key, fftwf_complex* complex_data, float* real_data)
+{
+	const int x = key.dims[0], y = key.dims[1], z = key.dims[2];
+
+	unsigned int flags = planner_flags(planner.mode);
+	if ( !key.al ) flags |= FFTW_UNALIGNED;
+
+	// FFTW overwrites both arrays while measuring, so anything but FFTW_ESTIMATE is planned on scratch
+	// arrays. The plan is only ever executed through the new-array interface, so this is safe.
+	float *scratch_c = NULL, *scratch_r = NULL;
+	if ( planner.mode != PLAN_ESTIMATE )
 	{
-		fftwf_destroy_plan(fftwplans[EMFFTW3_CACHE_SIZE-1]);
-		fftwplans[EMFFTW3_CACHE_SIZE-1] = NULL;
+		size_t complex_size = (size_t)(x/2+1)*2*y*z;
+		scratch_c = (float *) fftwf_malloc(complex_size*sizeof(float));
+		if ( !key.ip && scratch_c != NULL ) scratch_r = (float *) fftwf_malloc((size_t)x*y*z*sizeof(float));
+
+		if ( scratch_c == NULL || ( !key.ip && scratch_r == NULL ) )
+		{
+			LOGWARN("Not enough memory to measure an FFTW plan for %d x %d x %d, using estimate", x, y, z);
+			if ( scratch_c != NULL ) fftwf_free(scratch_c);
+			scratch_c = NULL;
+			flags = ( flags & FFTW_UNALIGNED ) | FFTW_ESTIMATE;
+		}
+		else
+		{
+			complex_data = (fftwf_complex *) scratch_c;
+			real_data = key.ip ? scratch_c : scratch_r;
+		}
+	}
+
+#ifdef FFTW_THREADS
+	// the thread count is global planner state, hence the need for fft_mutex to be held here
+	fftwf_plan_with_nthreads(key.nt);
+#endif	//FFTW_THREADS
+
+	// A plan in the wisdom costs nothing to make again, only new measurements need saving
+	const bool measured = ( flags & FFTW_ESTIMATE ) == 0;
+	fftwf_plan plan = NULL;
+#ifdef FFTW_WISDOM_ONLY
+	if ( measured ) plan = plan_transform(key, complex_data, real_data, flags | FFTW_WISDOM_ONLY);
+#endif	//FFTW_WISDOM_ONLY
+	if ( plan == NULL ) {
+		plan = plan_transform(key, complex_data, real_data, flags);
+		if ( measured ) planner.dirty = true;
+	}
+
+#ifdef FFTW_THREADS
+	// back to serial, so plans made outside the cache never pick up the thread count
+	fftwf_plan_with_nthreads(1);
+#endif	//FFTW_THREADS
+
+	if ( scratch_c != NULL ) fftwf_free(scratch_c);
+	if ( scratch_r != NULL ) fftwf_free(scratch_r);
+
+	return plan;
+}
+
+fftwf_plan EMfft::EMfftw3_cache::get_plan(const int rank_in, const int x, const int y, const int z, const int r2c_flag, const int ip_flag, fftwf_complex* complex_data, float* real_data)
+{
+
+	if ( rank_in > 3 || rank_in < 1 ) throw InvalidValueException(rank_in, "Error, can not get an FFTW plan using rank out of the range [1,3]");
+	if ( r2c_flag != EMAN2_REAL_2_COMPLEX && r2c_flag != EMAN2_COMPLEX_2_REAL ) throw InvalidValueException(r2c_flag, "The selected real to complex flag is not supported");
+
+	PlanKey key;
+	key.rank = rank_in;
+	key.dims[0] = x;
+	key.dims[1] = y;
+	key.dims[2] = z;
+	key.r2c = r2c_flag;
+	key.ip = ip_flag;
+	// Plans made for SIMD aligned arrays may only be executed on equally aligned arrays
+	key.al = ( fftwf_alignment_of(real_data) == 0 && fftwf_alignment_of((float *) complex_data) == 0 );
+	ThreadPlans *tp = thread_plans();
+	// Small transforms don't gain anything from threads, so they always get a serial plan. Large
+	// ones use the thread's copy of the thread count, only fetched again after it was changed
+	key.nt = 1;
+	if ( (size_t)x*y*z >= EMFFTW3_THREAD_MIN_SIZE ) {
+		if ( tp->generation != planner_generation ) {
+			Util::MUTEX_LOCK(&fft_mutex);
+			init_planner();
+			tp->nthreads = planner.nthreads;
+			tp->generation = planner_generation;
+			Util::MUTEX_UNLOCK(&fft_mutex);
+		}
+		key.nt = tp->nthreads;
+	}
+
+	// Lock free lookup in this thread's own view of the cache
+	PlanMap::const_iterator it = tp->plans.find(key);
+	if ( it != tp->plans.end() ) return it->second;
+
+	int mrt = Util::MUTEX_LOCK(&fft_mutex);
+	init_planner();
+
+	fftwf_plan plan;
+	it = plans.find(key);
+	if ( it != plans.end() ) {
+		plan = it->second;
+	}
+	else {
+		plan = make_plan(key, complex_data, real_data);
+		plans[key] = plan;
+		if ( plans.size() > EMFFTW3_CACHE_SIZE && !warned_cache_size ) {
+			warned_cache_size = true;
+			LOGWARN("More than %d different FFT plans are cached, plans are only freed at exit", EMFFTW3_CACHE_SIZE);
+		}
 	}
-					
-	int upper_limit = num_plans;
-	if ( upper_limit == EMFFTW3_CACHE_SIZE ) upper_limit -= 1;
-	for (int i=upper_limit-1; i>0; i--)
-	{
-		fftwplans[i]=fftwplans[i-1];
-		rank[i]=rank[i-1];
-		r2c[i]=r2c[i-1];
-		ip[i]=ip[i-1];
-		plan_dims[i][0]=plan_dims[i-1][0];
-		plan_dims[i][1]=plan_dims[i-1][1];
-		plan_dims[i][2]=plan_dims[i-1][2];
-	}
-		//dimplan[0]=-1;
-
-	plan_dims[0][0]=x;
-	plan_dims[0][1]=y;
-	plan_dims[0][2]=z;
-	r2c[0]=r2c_flag;
-	ip[0]=ip_flag;
-	fftwplans[0] = plan;
-	rank[0]=rank_in;
-	if (num_plans<EMFFTW3_CACHE_SIZE) num_plans++;
-// 			debug_plans();
-// 			cout << "Created plan 0" << endl;
-// 	++num_added;
-// 	cout << "I have created " << num_added << " plans" << endl;
 	mrt = Util::MUTEX_UNLOCK(&fft_mutex);
-	return fftwplans[0];
 
+	tp->plans[key] = plan;
+	return plan;
 }
 
 // Static init
@@ -442,232 +719,139 @@ int EMfft::complex_to_real_nd(float *complex_data, float *real_data, int nx, int
 	return 0;
 }
 
-#endif	//USE_FFTW3
+#ifdef FFTW_PLAN_CACHING
+namespace {
+	// Arguments of batch_worker(), see EMfft::transform_batch()
+	struct FFTBatchJob
+	{
+		const vector<float *> *real_data;
+		const vector<float *> *complex_data;
+		int nx, ny, nz;
+		bool r2c;
+		bool ip;
+		bool aligned;	// whether plan requires SIMD aligned arrays
+		fftwf_plan plan;
+		vector< std::pair<size_t, size_t> > *failed;	// the rest of each range that threw, redone by the calling thread
+	};
 
-#ifdef NATIVE_FFT
-#include "sparx/native_fft.h"
-int EMfft::real_to_complex_1d(float *real_data, float *complex_data, int n)
+#ifdef _WIN32
+	MUTEX batch_mutex;
+#else
+	pthread_mutex_t batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif	//_WIN32
+
+	void batch_item(const FFTBatchJob *job, size_t i)
+	{
+		float *rd = (*job->real_data)[i];
+		float *cd = (*job->complex_data)[i];
+		bool aligned = ( fftwf_alignment_of(rd) == 0 && fftwf_alignment_of(cd) == 0 );
+
+		if ( (rd == cd) == job->ip && ( aligned || !job->aligned ) ) {
+			if ( job->r2c ) fftwf_execute_dft_r2c(job->plan, rd, (fftwf_complex *) cd);
+			else fftwf_execute_dft_c2r(job->plan, (fftwf_complex *) cd, rd);
+		}
+		// an image that doesn't match the shared plan gets its own
+		else if ( job->r2c ) EMfft::real_to_complex_nd(rd, cd, job->nx, job->ny, job->nz);
+		else EMfft::complex_to_real_nd(cd, rd, job->nx, job->ny, job->nz);
+	}
+
+	void batch_worker(size_t begin, size_t end, void *arg)
+	{
+		const FFTBatchJob *job = static_cast<const FFTBatchJob *>(arg);
+		size_t i = begin;
+		// Only planning an image of its own can throw, before its data is touched. The exception
+		// may not leave a worker thread, so the image is left for the calling thread to redo
+		try {
+			for (; i < end; ++i) batch_item(job, i);
+		}
+		catch (...) {
+			Util::MUTEX_LOCK(&batch_mutex);
+			job->failed->push_back(std::make_pair(i, end));		// within the reserved size, cannot throw
+			Util::MUTEX_UNLOCK(&batch_mutex);
+		}
+	}
+}
+
+int EMfft::transform_batch(const vector<float *> & real_data, const vector<float *> & complex_data, int nx, int ny, int nz, int nthreads, int r2c_flag)
 {
-	//int complex_size = n + 2 - n%2;
-	float * work = (float*) malloc((2*n+15)*sizeof(float));
-	if (!work) {
-		fprintf(stderr,"real_to_complex_1d: failed to allocate work\n");
-		LOGERR("real_to_complex_1d: failed to allocate work\n");	
+	if ( real_data.size() != complex_data.size() ) throw InvalidValueException((int)complex_data.size(), "The number of real and complex buffers must be the same");
+	if ( real_data.empty() ) return 0;
+
+	FFTBatchJob job;
+	job.real_data = &real_data;
+	job.complex_data = &complex_data;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.r2c = ( r2c_flag == EMAN2_REAL_2_COMPLEX );
+	job.ip = ( real_data[0] == complex_data[0] );
+	job.aligned = ( fftwf_alignment_of(real_data[0]) == 0 && fftwf_alignment_of(complex_data[0]) == 0 );
+	job.plan = plan_cache.get_plan(get_rank(ny, nz), nx, ny, nz, r2c_flag, job.ip, (fftwf_complex *) complex_data[0], real_data[0]);
+
+	// one entry per range at most
+	vector< std::pair<size_t, size_t> > failed;
+	failed.reserve(std::min(real_data.size(), (size_t)(nthreads > 0 ? nthreads : Util::get_num_threads())));
+	job.failed = &failed;
+
+	Util::parallel_for(real_data.size(), &batch_worker, &job, nthreads);
+
+	// whatever threw on a worker thread throws again here
+	std::sort(failed.begin(), failed.end());
+	for (size_t r = 0; r < failed.size(); ++r) {
+		for (size_t i = failed[r].first; i < failed[r].second; ++i) batch_item(&job, i);
 	}
-	
-	rffti(n, work);
-	memcpy(&complex_data[1], real_data, n * sizeof(float));
-	rfftf(n, &complex_data[1], work);
-	complex_data[0] = complex_data[1] ;
-	complex_data[1] = 0.0f ;
-	if (n%2 == 0)  complex_data[n+1] = 0.0f ;
-
-	free(work);
 	return 0;
 }
-/*{
-	//int complex_size = n + 2 - n%2;
-	
-	//memcpy(complex_data, real_data, n * sizeof(float));
-	//float * work = (float*) malloc((2*n+15)*sizeof(float));
-	//if (!work) {
-	//	fprintf(stderr,"real_to_complex_1d: failed to allocate work\n");
-	//	LOGERR("real_to_complex_1d: failed to allocate work\n");	
-	//}
-	//Nativefft::fmrs_1rf(complex_data, work, n);
-	//cout<<"doing rfftf"<<endl;
-	//rffti(n, work);
-	
-	//rfftf(n, real_data, work);
-	
-	//cout<<"doing fftr_q"<<endl;
-	int l=(int)(log2(n));
-        Util::fftr_q(real_data,l);
+#endif	//FFTW_PLAN_CACHING
 
-	//free(work);
+int EMfft::real_to_complex_nd_batch(const vector<float *> & real_data, const vector<float *> & complex_data, int nx, int ny, int nz, int nthreads)
+{
+#ifdef FFTW_PLAN_CACHING
+	return transform_batch(real_data, complex_data, nx, ny, nz, nthreads, EMAN2_REAL_2_COMPLEX);
+#else
+	for (size_t i = 0; i < real_data.size(); ++i) real_to_complex_nd(real_data[i], complex_data[i], nx, ny, nz);
 	return 0;
-}//
+#endif	//FFTW_PLAN_CACHING
+}
+
+int EMfft::complex_to_real_nd_batch(const vector<float *> & complex_data, const vector<float *> & real_data, int nx, int ny, int nz, int nthreads)
 {
-	int complex_size = n + 2 - n%2;
-	
-	memcpy(complex_data, real_data, n * sizeof(float));
-	float * work = (float*) malloc(complex_size*sizeof(float));
-	if (!work) {
-		fprintf(stderr,"real_to_complex_1d: failed to allocate work\n");
-		LOGERR("real_to_complex_1d: failed to allocate work\n");	
-	}
-	
-	Nativefft::fmrs_1rf(complex_data, work, n);
-	
-	free(work);
+#ifdef FFTW_PLAN_CACHING
+	return transform_batch(real_data, complex_data, nx, ny, nz, nthreads, EMAN2_COMPLEX_2_REAL);
+#else
+	for (size_t i = 0; i < real_data.size(); ++i) complex_to_real_nd(complex_data[i], real_data[i], nx, ny, nz);
 	return 0;
-}*/
+#endif	//FFTW_PLAN_CACHING
+}
 
-int EMfft::complex_to_real_1d(float *complex_data, float *real_data, int n)
+#endif	//USE_FFTW3
+
+#ifdef NATIVE_FFT
+#include "emfft_native.h"
+int EMfft::real_to_complex_1d(float *real_data, float *complex_data, int n)
 {
-	//here, n is the "logical" size of DFT, not the array size
-	float * work = (float*) malloc((2*n+15)*sizeof(float));
-	if (!work) {
-		fprintf(stderr,"real_to_complex_1d: failed to allocate work\n");
-		LOGERR("complex_to_real_1d: failed to allocate work\n");	
-	}
-	
-	rffti(n, work);
-	
-	memcpy(&real_data[1], &complex_data[2], (n-1) * sizeof(float));
-	real_data[0] = complex_data[0] ;
-	rfftb(n, real_data, work);
-	//  Normalize
-	float nrm = 1.0f/float(n);
-	for (int i = 0; i<n; i++) real_data[i] *= nrm;
-	free(work);
+	NativeFFT::real_to_complex(real_data, complex_data, n, 1, 1);
 	return 0;
 }
-/*{
-	int complex_size = n + 2 - n%2;
-	
-	//here, n is the "logical" size of DFT, not the array size
-	memcpy(real_data, complex_data, complex_size * sizeof(float));
-	float * work = (float*)malloc(complex_size*sizeof(float));
-	if (!work) {
-		fprintf(stderr,"real_to_complex_1d: failed to allocate work\n");
-		LOGERR("complex_to_real_1d: failed to allocate work\n");	
-	}
-	
-	Nativefft::fmrs_1rb(real_data, work, n);
-	
-	free(work);
+
+int EMfft::complex_to_real_1d(float *complex_data, float *real_data, int n)
+{
+	//  Normalize, as the native inverse always has
+	NativeFFT::complex_to_real(complex_data, real_data, n, 1, 1, 1.0f/float(n));
 	return 0;
-}*/
+}
 
 int EMfft::real_to_complex_nd(float *real_data, float *complex_data, int nx, int ny, int nz)
 {
-	const int rank = get_rank(ny, nz);
-	const int complex_nx = nx + 2 - nx%2;
-	
-	switch(rank) {
-		case 1:		//for 1D fft
-			real_to_complex_1d(real_data, complex_data, nx);
-			return 0;
-		case 2:		//for 2D fft
-		{
-			/*if(real_data != complex_data) {
-				for (int j = 0; j < ny; j++) {
-					memcpy(&complex_data[complex_nx*j], &real_data[nx*j], nx*sizeof(float));	
-				}
-			}
-			float * work = (float*) malloc(complex_nx*sizeof(float));
-	   		if (!work) {
-	   			fprintf(stderr,"real_to_complex_nd(2df): failed to allocate work\n");
-	   			LOGERR("real_to_complex_nd(2df): failed to allocate work\n");
-	   		}
-	   		
-	   		// 2d inplace fft, overwrite y
-	   		int status = Nativefft::fmrs_2rf(complex_data, work, complex_nx, nx, ny);
-	   		if (status !=0) {
-	      		fprintf(stderr, "real_to_complex_nd(2df): status = %d\n", status);
-	      		LOGWARN("real_to_complex_nd(2df): status = %d\n", status);
-	   		}
-	   	 
-	   		free(work);*/
-			
-	   		int status = Nativefft::ftp_2rf(real_data, complex_data, complex_nx, nx, ny);
-	   		if (status !=0) {
-	      		fprintf(stderr, "real_to_complex_nd(2df): status = %d\n", status);
-	      		LOGWARN("real_to_complex_nd(2df): status = %d\n", status);
-	   		}
-	   		return 0;
-		}
-	   	case 3:		//for 3D fft
-	   	{
-			/*if(real_data != complex_data) {
-				for (int k = 0; k<nz; k++) {
-		      		for (int j = 0; j < ny; j++) {
-		         		memcpy(&complex_data[complex_nx*ny*k+j*complex_nx], &real_data[nx*ny*k+j*nx], nx*sizeof(float));
-		      		}
-				}
-			}
-			float * work = (float*) malloc(1*sizeof(float));//malloc(complex_nx*sizeof(float));
-	   		if (!work) {
-	   			fprintf(stderr,"real_to_complex_nd(3df): failed to allocate work\n");
-	   			LOGERR("real_to_complex_nd(3df): failed to allocate work\n");
-	   		}*/
-	   		
-	   		// 3d inplace fft, overwrite complex_data
-	   		int status = Nativefft::ftp_3rf(real_data, complex_data, complex_nx, nx, ny, nz);
-	   		if (status !=0) {
-	      		fprintf(stderr, "real_to_complex_nd(3df): status = %d\n", status);
-	      		LOGWARN("real_to_complex_nd(3df): status = %d\n", status);
-	   		}
-	   		
-	   		//free(work);
-	   		return 0;
-	   	}
-	   	default:
-	   		LOGERR("Never should be here...\n");
-	   		return -1;	
-	}
+	NativeFFT::real_to_complex(real_data, complex_data, nx, ny, nz);
+	return 0;
 }
 
 int EMfft::complex_to_real_nd(float *complex_data, float *real_data, int nx, int ny, int nz)
 {
-	const int rank = get_rank(ny, nz);
-	const int complex_nx = nx + 2 - nx%2;
-	
-	switch(rank) {
-		case 1:		//for 1D ift
-			complex_to_real_1d(complex_data, real_data, nx);
-			return 0;
-		case 2:		//for 2D ift
-		/*{	
-			if(real_data != complex_data) {
-				memcpy(real_data, complex_data, complex_nx*ny*sizeof(float));
-			}
-			
-			float * work = (float*) malloc(complex_nx*sizeof(float));
-			if (!work) {
-				fprintf(stderr,"complex_to_real_nd(2db): failed to allocate work\n");
-				LOGERR("complex_to_real_nd(2db): failed to allocate work\n");
-			}
-			
-			// 2d inplace ift, overwrite real_data
-	   		int status = Nativefft::fmrs_2rb(real_data, work, complex_nx, nx, ny);
-	   		if (status !=0) {
-	      		fprintf(stderr, "complex_to_real_nd(2db): status = %d\n", status);
-	      		LOGWARN("complex_to_real_nd(2db): status = %d\n", status);
-			}
-			
-			free(work);
-			return 0;
-		}*/
-		{	//  Only out of place!
-			memcpy(real_data, complex_data, complex_nx*ny*sizeof(float));
-			
-			// 2d inplace ift, overwrite real_data
-	   		int status = Nativefft::ftp_2rb(real_data, complex_nx, nx, ny);
-
-	   		if (status !=0) {
-	      		fprintf(stderr, "complex_to_real_nd(2db): status = %d\n", status);
-	      		LOGWARN("complex_to_real_nd(2db): status = %d\n", status);
-			}
-			return 0;
-		}
-		case 3:		//for 3D ift
-		{	// Only out of place!
-			memcpy(real_data, complex_data, complex_nx*ny*nz*sizeof(float));
-	   		
-	   		// 3d inplace fft, overwrite real_data
-	   		int status = Nativefft::ftp_3rb(real_data, complex_nx, nx, ny, nz);
-	   		if (status !=0) {
-	      		fprintf(stderr, "complex_to_real_nd(3db): status = %d\n", status);
-	      		LOGWARN("complex_to_real_nd(3db): status = %d\n", status);
-	   		}
-	   		return 0;
-		}
-	   	default:
-	   		LOGERR("Never should be here...\n");
-	   		return -1;
-	}
+	const float nrm = 1.0f/(float(nx)*float(ny)*float(nz));
+	NativeFFT::complex_to_real(complex_data, real_data, nx, ny, nz, nrm);
+	return 0;
 }
 #endif	//NATIVE_FFT
 
@@ -39,6 +39,13 @@
 #ifdef USE_FFTW3
 
 #include <fftw3.h>
+#include <string>
+#include <map>
+#include <vector>
+
+using std::string;
+using std::map;
+using std::vector;
  
 namespace EMAN
 {
@@ -47,6 +54,57 @@ namespace EMAN
 	class EMfft
 	{
 	  public:
+		/** Planner rigor used when new FFTW plans are created.
+		 * PLAN_ESTIMATE plans instantly but produces slower transforms. PLAN_MEASURE
+		 * and PLAN_PATIENT time candidate algorithms the first time a size is seen,
+		 * which is expensive, but the result is kept in the FFTW wisdom file so
+		 * later runs reuse the tuned plans.
+		 */
+		enum PlanMode {
+			PLAN_ESTIMATE = 0,
+			PLAN_MEASURE = 1,
+			PLAN_PATIENT = 2
+		};
+
+		/** Set the planner rigor for plans created from now on. Plans already in the
+		 * cache are kept. The initial mode is taken from the EMAN2_FFTW_PLANNER
+		 * environment variable (estimate, measure or patient), defaulting to estimate.
+		 * @param mode one of PlanMode
+		 * @exception InvalidValueException if mode is not a PlanMode
+		 */
+		static void set_plan_mode(int mode);
+		static int get_plan_mode();
+
+		/** Set the number of threads used for large transforms. Transforms smaller than
+		 * EMFFTW3_THREAD_MIN_SIZE elements always run on one thread. Plans already in the
+		 * cache are kept, threaded plans are cached like any other. The initial value is
+		 * taken from the EMAN2_FFTW_THREADS environment variable, defaulting to 1.
+		 * Has no effect unless EMAN2 was built with FFTW threads (ENABLE_FFTW_THREADS).
+		 * @param nthreads number of threads, at least 1
+		 * @exception InvalidValueException if nthreads is less than 1
+		 */
+		static void set_num_threads(int nthreads);
+		static int get_num_threads();
+
+		/** Import FFTW wisdom from a file. This is done automatically for the default
+		 * wisdom file the first time a plan is needed.
+		 * @param filename wisdom file, if empty the default wisdom file is used
+		 * @return true if the wisdom was read successfully
+		 */
+		static bool load_wisdom(const string & filename = "");
+
+		/** Export the accumulated FFTW wisdom to a file. This is done automatically for
+		 * the default wisdom file at exit if any measured plans were created.
+		 * @param filename wisdom file, if empty the default wisdom file is used
+		 * @return true if the wisdom was written successfully
+		 */
+		static bool save_wisdom(const string & filename = "");
+
+		/** The default wisdom file, $EMAN2_FFTW_WISDOM if set, otherwise
+		 * $HOME/.eman2/fftwf_wisdom
+		 */
+		static string get_wisdom_file();
+
 		static int real_to_complex_1d(float *real_data, float *complex_data, int n);
 		static int complex_to_real_1d(float *complex_data, float *real_data, int n);
 		static int complex_to_complex_1d_f(float *in, float *out, int n); // ming add
@@ -56,17 +114,41 @@ namespace EMAN
 		static int complex_to_real_nd(float *complex_data, float *real_data, int nx, int ny,
 									  int nz);
 		static int complex_to_complex_nd(float *complex_data_in, float *complex_data_out, int nx,int ny,int nz);// ming add
+
+		/** Real to complex transform of a set of equal size images held in separate buffers.
+		 * The plan is looked up once and the images are split across nthreads threads.
+		 * @param real_data the real images, in-place if the same as complex_data
+		 * @param complex_data the complex outputs, must have the same length as real_data
+		 * @param nx the x size of one real image
+		 * @param ny the y size of one image
+		 * @param nz the z size of one image
+		 * @param nthreads the number of threads, 0 for Util::get_num_threads()
+		 */
+		static int real_to_complex_nd_batch(const vector<float *> & real_data, const vector<float *> & complex_data, int nx, int ny, int nz, int nthreads = 0);
+		static int complex_to_real_nd_batch(const vector<float *> & complex_data, const vector<float *> & real_data, int nx, int ny, int nz, int nthreads = 0);
 	  private:
 #ifdef FFTW_PLAN_CACHING
-#define EMFFTW3_CACHE_SIZE 32
+// Number of cached plans above which a warning is printed once. Not a bound, see EMfftw3_cache
+#define EMFFTW3_CACHE_SIZE 256
+// Transforms with at least this many real elements use the threaded planner (e.g. 128^3 or 1024^2)
+#define EMFFTW3_THREAD_MIN_SIZE 1048576
 		static const int EMAN2_REAL_2_COMPLEX;
 		static const int EMAN2_COMPLEX_2_REAL;
+
+		// Shared implementation of the *_batch transforms
+		static int transform_batch(const vector<float *> & real_data, const vector<float *> & complex_data, int nx, int ny, int nz, int nthreads, int r2c_flag);
+
 		/** EMfftw3_cache
-		 * An ecapsulation of FFTW3 plan caching. Keeps an array of plans and records of important details.
+		 * An ecapsulation of FFTW3 plan caching. Keeps a map of plans keyed on all the details that matter.
 		 * Main interface is get_plan(...)
 		 * If asked for a plan that is not currently stored this class will create the plan and then return
 		 * it. If asked for a plan that IS stored than the pre-existing plan is returned.
-		 * The number of plans that can be cached is determined by the compile time flag EMFFTW3_CACHE_SIZE.
+		 * Every thread has its own read-only view of the cache, so looking up a known plan takes no lock.
+		 * Only a miss in the thread's view takes fft_mutex, to copy the plan from the shared cache or to
+		 * create it. For this to be safe, plans are never evicted, they live until the program exits:
+		 * another thread may be executing any plan it found in its view, with no lock to wait for.
+		 * This leaves the cache unbounded, but there is one plan per distinct size, layout and thread
+		 * count, a few KB each, and programs use a handful of box sizes.
 		 * Although FFTW3 documentation states that plan caching is performed internally, tests on Fedora Core
 		 * 6 using rpms indicated that the costs of an associated MD5 algorithm in FFTW3 were prohibitive. 
 		 * Hence this implementation. Using FFTW plan caching usually results in a dramatic performance boost.
@@ -92,23 +174,55 @@ namespace EMAN
 			 * @return and fftwf_plan corresponding to the input arguments
 			 */
 			fftwf_plan get_plan(const int rank, const int x, const int y, const int z, const int r2c_flag,const int ip_flag, fftwf_complex* complex_data, float* real_data);
+
+			/** Everything that distinguishes one cached plan from another */
+			struct PlanKey
+			{
+				int rank;
+				// dimensions of the plan (always in 3D, if dimensions are "unused" they are taken to be 1)
+				int dims[3];
+				// real to complex or vice versa
+				int r2c;
+				// whether or not the plan is inplace
+				int ip;
+				// whether the plan requires SIMD aligned arrays
+				int al;
+				// number of threads the plan was made for
+				int nt;
+
+				bool operator<(const PlanKey & that) const;
+			};
+			typedef map<PlanKey, fftwf_plan> PlanMap;
+
+			/** A thread's view of the cache: the plans it has looked up, and its copy of the FFT thread
+			 * count, refreshed when EMfft::set_num_threads() changes it */
+			struct ThreadPlans
+			{
+				ThreadPlans() : nthreads(1), generation(0) {}
+				PlanMap plans;
+				int nthreads;
+				int generation;
+			};
+
+			// Frees a thread's view of the cache when the thread exits
+			static void delete_thread_plans(void *thread_plans);
 		private:
+			// Creates a new plan with the current planner rigor. Measured plans are made on scratch
+			// arrays, since FFTW overwrites the arrays while timing
+			fftwf_plan make_plan(const PlanKey & key, fftwf_complex* complex_data, float* real_data);
+
+			// The FFTW plan for key with the given planner flags, NULL if FFTW_WISDOM_ONLY is set and
+			// the wisdom has none
+			static fftwf_plan plan_transform(const PlanKey & key, fftwf_complex* complex_data, float* real_data, unsigned int flags);
+
+			// The calling thread's view of the cache, created on first use
+			ThreadPlans *thread_plans();
+
 			// Prints useful debug information to standard out
 			void debug_plans();
 			
-			// Store the number of plans currently contained in this EMfftw3_cache object
-			int num_plans;
-
-			// Store the rank of the plan
-			int rank[EMFFTW3_CACHE_SIZE];
-			// Store the dimensions of the plan (always in 3D, if dimensions are "unused" they are taken to be 1)
-			int plan_dims[EMFFTW3_CACHE_SIZE][3];
-			// store whether the plan was real to complex or vice versa
-			int r2c[EMFFTW3_CACHE_SIZE];
-			// Store the plans themselves
-			fftwf_plan fftwplans[EMFFTW3_CACHE_SIZE];
-			// Store whether or not the plan was inplace
-			int ip[EMFFTW3_CACHE_SIZE];
+			// All plans created so far, only accessed with fft_mutex held
+			PlanMap plans;
 		};
 
 		static EMfftw3_cache plan_cache;
@@ -0,0 +1,670 @@
+/**
+ * $Id$
+ */
+
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ *
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * */
+
+#ifdef NATIVE_FFT
+
+#include "emfft_native.h"
+#include "util.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NATIVE_FFT_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NATIVE_FFT_SSE2
+#endif
+
+using namespace EMAN;
+using std::map;
+using std::vector;
+
+namespace {
+	/* The engine is written against these small vector types, one float per lane.
+	 * sfloat is always available and is used when there are too few independent
+	 * transforms to fill the vector lanes.
+	 */
+	struct sfloat
+	{
+		enum { lanes = 1 };
+		float v;
+		static sfloat set1(float f) { sfloat r; r.v = f; return r; }
+	};
+	inline sfloat operator+(sfloat a, sfloat b) { a.v += b.v; return a; }
+	inline sfloat operator-(sfloat a, sfloat b) { a.v -= b.v; return a; }
+	inline sfloat operator*(sfloat a, sfloat b) { a.v *= b.v; return a; }
+
+#if defined(NATIVE_FFT_AVX)
+	struct vfloat
+	{
+		enum { lanes = 8 };
+		__m256 v;
+		static vfloat set1(float f) { vfloat r; r.v = _mm256_set1_ps(f); return r; }
+	};
+	inline vfloat operator+(vfloat a, vfloat b) { a.v = _mm256_add_ps(a.v, b.v); return a; }
+	inline vfloat operator-(vfloat a, vfloat b) { a.v = _mm256_sub_ps(a.v, b.v); return a; }
+	inline vfloat operator*(vfloat a, vfloat b) { a.v = _mm256_mul_ps(a.v, b.v); return a; }
+#elif defined(NATIVE_FFT_SSE2)
+	struct vfloat
+	{
+		enum { lanes = 4 };
+		__m128 v;
+		static vfloat set1(float f) { vfloat r; r.v = _mm_set1_ps(f); return r; }
+	};
+	inline vfloat operator+(vfloat a, vfloat b) { a.v = _mm_add_ps(a.v, b.v); return a; }
+	inline vfloat operator-(vfloat a, vfloat b) { a.v = _mm_sub_ps(a.v, b.v); return a; }
+	inline vfloat operator*(vfloat a, vfloat b) { a.v = _mm_mul_ps(a.v, b.v); return a; }
+#else
+	typedef sfloat vfloat;
+#endif
+
+	void *alloc_lanes(size_t n)
+	{
+#if defined(NATIVE_FFT_AVX) || defined(NATIVE_FFT_SSE2)
+		void *p = _mm_malloc(n, 32);
+#else
+		void *p = malloc(n);
+#endif
+		if (!p) {
+			throw BadAllocException("NativeFFT: can not allocate work buffer");
+		}
+		return p;
+	}
+
+	void free_lanes(void *p)
+	{
+#if defined(NATIVE_FFT_AVX) || defined(NATIVE_FFT_SSE2)
+		_mm_free(p);
+#else
+		free(p);
+#endif
+	}
+
+	/* A plan for complex transforms of one length: the radix of each Stockham pass,
+	 * the forward twiddle factors of each pass and, for odd radices without a
+	 * dedicated butterfly, the R-th roots of unity.
+	 */
+	struct ComplexPlan
+	{
+		int n;
+		int max_radix;
+		vector<int> radix;
+		vector<int> stride;
+		vector< vector<float> > twr, twi;
+		vector< vector<float> > rootr, rooti;
+	};
+
+	ComplexPlan *create_plan(int n)
+	{
+		ComplexPlan *p = new ComplexPlan;
+		p->n = n;
+		p->max_radix = 1;
+
+		int m = n;
+		while (m % 4 == 0) { p->radix.push_back(4); m /= 4; }
+		while (m % 2 == 0) { p->radix.push_back(2); m /= 2; }
+		while (m % 3 == 0) { p->radix.push_back(3); m /= 3; }
+		while (m % 5 == 0) { p->radix.push_back(5); m /= 5; }
+		for (int f = 7; m > 1; f += 2) {
+			while (m % f == 0) { p->radix.push_back(f); m /= f; }
+		}
+
+		const double twopi = 2.0 * M_PI;
+		int ns = 1;
+		for (size_t s = 0; s < p->radix.size(); s++) {
+			const int r = p->radix[s];
+			if (r > p->max_radix) p->max_radix = r;
+			p->stride.push_back(ns);
+
+			// twiddle for lane k of leg q is exp(-2 pi i q k / (ns r)), q = 1..r-1
+			vector<float> wr((r - 1) * ns + 1), wi((r - 1) * ns + 1);
+			for (int q = 1; q < r; q++) {
+				for (int k = 0; k < ns; k++) {
+					double a = -twopi * q * k / (double)(ns * r);
+					wr[(q - 1) * ns + k] = (float)cos(a);
+					wi[(q - 1) * ns + k] = (float)sin(a);
+				}
+			}
+			p->twr.push_back(wr);
+			p->twi.push_back(wi);
+
+			vector<float> cr(r), ci(r);
+			for (int t = 0; t < r; t++) {
+				double a = -twopi * t / (double)r;
+				cr[t] = (float)cos(a);
+				ci[t] = (float)sin(a);
+			}
+			p->rootr.push_back(cr);
+			p->rooti.push_back(ci);
+
+			ns *= r;
+		}
+		return p;
+	}
+
+#ifdef _WIN32
+	MUTEX native_fft_mutex;
+#else
+	pthread_mutex_t native_fft_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+	// plans are tiny and only one exists per length, so they are never freed
+	const ComplexPlan& get_plan(int n)
+	{
+		static map<int, ComplexPlan*> plans;
+
+		Util::MUTEX_LOCK(&native_fft_mutex);
+		map<int, ComplexPlan*>::iterator it = plans.find(n);
+		ComplexPlan *p = 0;
+		if (it == plans.end()) {
+			p = create_plan(n);
+			plans[n] = p;
+		}
+		else {
+			p = it->second;
+		}
+		Util::MUTEX_UNLOCK(&native_fft_mutex);
+
+		return *p;
+	}
+
+	// (re, im) *= (c, s) or its conjugate for the inverse
+	template<class V, bool INV>
+	inline void twiddle(V& re, V& im, float c, float s)
+	{
+		const V vc = V::set1(c);
+		const V vs = V::set1(INV ? -s : s);
+		const V t = re * vc - im * vs;
+		im = re * vs + im * vc;
+		re = t;
+	}
+
+	/* One Stockham pass of radix R on n points where ns points have been combined
+	 * so far: input j + q*n/R, with j = g*ns + k, goes to output g*ns*R + k + q*ns.
+	 */
+	template<class V, bool INV>
+	void pass2(const ComplexPlan& p, int s, const V *xr, const V *xi, V *yr, V *yi)
+	{
+		const int m = p.n / 2;
+		const int ns = p.stride[s];
+		const float *wr = &p.twr[s][0], *wi = &p.twi[s][0];
+
+		for (int g = 0; g < m; g += ns) {
+			for (int k = 0; k < ns; k++) {
+				const int j = g + k;
+				const V ar0 = xr[j], ai0 = xi[j];
+				V ar1 = xr[j + m], ai1 = xi[j + m];
+				if (k) twiddle<V, INV>(ar1, ai1, wr[k], wi[k]);
+
+				const int o = g * 2 + k;
+				yr[o] = ar0 + ar1;       yi[o] = ai0 + ai1;
+				yr[o + ns] = ar0 - ar1;  yi[o + ns] = ai0 - ai1;
+			}
+		}
+	}
+
+	template<class V, bool INV>
+	void pass3(const ComplexPlan& p, int s, const V *xr, const V *xi, V *yr, V *yi)
+	{
+		const int m = p.n / 3;
+		const int ns = p.stride[s];
+		const float *wr = &p.twr[s][0], *wi = &p.twi[s][0];
+		const V half = V::set1(0.5f);
+		const V sin60 = V::set1(INV ? -0.866025403784438647f : 0.866025403784438647f);
+
+		for (int g = 0; g < m; g += ns) {
+			for (int k = 0; k < ns; k++) {
+				const int j = g + k;
+				const V ar0 = xr[j], ai0 = xi[j];
+				V ar1 = xr[j + m], ai1 = xi[j + m];
+				V ar2 = xr[j + 2 * m], ai2 = xi[j + 2 * m];
+				if (k) {
+					twiddle<V, INV>(ar1, ai1, wr[k], wi[k]);
+					twiddle<V, INV>(ar2, ai2, wr[ns + k], wi[ns + k]);
+				}
+
+				const V sr = ar1 + ar2, si = ai1 + ai2;
+				const V tr = ar0 - half * sr, ti = ai0 - half * si;
+				// -i sin60 (a1 - a2) for the forward transform
+				const V ur = sin60 * (ai1 - ai2), ui = sin60 * (ar2 - ar1);
+
+				const int o = g * 3 + k;
+				yr[o] = ar0 + sr;            yi[o] = ai0 + si;
+				yr[o + ns] = tr + ur;        yi[o + ns] = ti + ui;
+				yr[o + 2 * ns] = tr - ur;    yi[o + 2 * ns] = ti - ui;
+			}
+		}
+	}
+
+	template<class V, bool INV>
+	void pass4(const ComplexPlan& p, int s, const V *xr, const V *xi, V *yr, V *yi)
+	{
+		const int m = p.n / 4;
+		const int ns = p.stride[s];
+		const float *wr = &p.twr[s][0], *wi = &p.twi[s][0];
+
+		for (int g = 0; g < m; g += ns) {
+			for (int k = 0; k < ns; k++) {
+				const int j = g + k;
+				const V ar0 = xr[j], ai0 = xi[j];
+				V ar1 = xr[j + m], ai1 = xi[j + m];
+				V ar2 = xr[j + 2 * m], ai2 = xi[j + 2 * m];
+				V ar3 = xr[j + 3 * m], ai3 = xi[j + 3 * m];
+				if (k) {
+					twiddle<V, INV>(ar1, ai1, wr[k], wi[k]);
+					twiddle<V, INV>(ar2, ai2, wr[ns + k], wi[ns + k]);
+					twiddle<V, INV>(ar3, ai3, wr[2 * ns + k], wi[2 * ns + k]);
+				}
+
+				const V t0r = ar0 + ar2, t0i = ai0 + ai2;
+				const V t1r = ar0 - ar2, t1i = ai0 - ai2;
+				const V t2r = ar1 + ar3, t2i = ai1 + ai3;
+				// (a1 - a3) times -i forward, +i inverse
+				V t3r, t3i;
+				if (INV) {
+					t3r = ai3 - ai1;
+					t3i = ar1 - ar3;
+				}
+				else {
+					t3r = ai1 - ai3;
+					t3i = ar3 - ar1;
+				}
+
+				const int o = g * 4 + k;
+				yr[o] = t0r + t2r;             yi[o] = t0i + t2i;
+				yr[o + ns] = t1r + t3r;        yi[o + ns] = t1i + t3i;
+				yr[o + 2 * ns] = t0r - t2r;    yi[o + 2 * ns] = t0i - t2i;
+				yr[o + 3 * ns] = t1r - t3r;    yi[o + 3 * ns] = t1i - t3i;
+			}
+		}
+	}
+
+	template<class V, bool INV>
+	void pass5(const ComplexPlan& p, int s, const V *xr, const V *xi, V *yr, V *yi)
+	{
+		const int m = p.n / 5;
+		const int ns = p.stride[s];
+		const float *wr = &p.twr[s][0], *wi = &p.twi[s][0];
+		const V c1 = V::set1(0.309016994374947424f);	// cos(2pi/5)
+		const V c2 = V::set1(-0.809016994374947424f);	// cos(4pi/5)
+		const V s1 = V::set1(INV ? -0.951056516295153572f : 0.951056516295153572f);
+		const V s2 = V::set1(INV ? -0.587785252292473129f : 0.587785252292473129f);
+
+		for (int g = 0; g < m; g += ns) {
+			for (int k = 0; k < ns; k++) {
+				const int j = g + k;
+				const V ar0 = xr[j], ai0 = xi[j];
+				V ar1 = xr[j + m], ai1 = xi[j + m];
+				V ar2 = xr[j + 2 * m], ai2 = xi[j + 2 * m];
+				V ar3 = xr[j + 3 * m], ai3 = xi[j + 3 * m];
+				V ar4 = xr[j + 4 * m], ai4 = xi[j + 4 * m];
+				if (k) {
+					twiddle<V, INV>(ar1, ai1, wr[k], wi[k]);
+					twiddle<V, INV>(ar2, ai2, wr[ns + k], wi[ns + k]);
+					twiddle<V, INV>(ar3, ai3, wr[2 * ns + k], wi[2 * ns + k]);
+					twiddle<V, INV>(ar4, ai4, wr[3 * ns + k], wi[3 * ns + k]);
+				}
+
+				const V b1r = ar1 + ar4, b1i = ai1 + ai4;
+				const V b2r = ar2 + ar3, b2i = ai2 + ai3;
+				const V d1r = ar1 - ar4, d1i = ai1 - ai4;
+				const V d2r = ar2 - ar3, d2i = ai2 - ai3;
+
+				const V t1r = ar0 + c1 * b1r + c2 * b2r, t1i = ai0 + c1 * b1i + c2 * b2i;
+				const V t2r = ar0 + c2 * b1r + c1 * b2r, t2i = ai0 + c2 * b1i + c1 * b2i;
+				const V u1r = s1 * d1r + s2 * d2r, u1i = s1 * d1i + s2 * d2i;
+				const V u2r = s2 * d1r - s1 * d2r, u2i = s2 * d1i - s1 * d2i;
+
+				// y1 = t1 - i u1, y4 = t1 + i u1, y2 = t2 - i u2, y3 = t2 + i u2
+				const int o = g * 5 + k;
+				yr[o] = ar0 + b1r + b2r;        yi[o] = ai0 + b1i + b2i;
+				yr[o + ns] = t1r + u1i;         yi[o + ns] = t1i - u1r;
+				yr[o + 2 * ns] = t2r + u2i;     yi[o + 2 * ns] = t2i - u2r;
+				yr[o + 3 * ns] = t2r - u2i;     yi[o + 3 * ns] = t2i + u2r;
+				yr[o + 4 * ns] = t1r - u1i;     yi[o + 4 * ns] = t1i + u1r;
+			}
+		}
+	}
+
+	// any other (odd prime) radix, as a direct O(R^2) DFT. ar/ai hold R scratch vectors.
+	template<class V, bool INV>
+	void passg(const ComplexPlan& p, int s, const V *xr, const V *xi, V *yr, V *yi, V *ar, V *ai)
+	{
+		const int r = p.radix[s];
+		const int m = p.n / r;
+		const int ns = p.stride[s];
+		const float *wr = &p.twr[s][0], *wi = &p.twi[s][0];
+		const float *cr = &p.rootr[s][0], *ci = &p.rooti[s][0];
+
+		for (int g = 0; g < m; g += ns) {
+			for (int k = 0; k < ns; k++) {
+				const int j = g + k;
+				for (int q = 0; q < r; q++) {
+					ar[q] = xr[j + q * m];
+					ai[q] = xi[j + q * m];
+					if (k && q) twiddle<V, INV>(ar[q], ai[q], wr[(q - 1) * ns + k], wi[(q - 1) * ns + k]);
+				}
+
+				const int o = g * r + k;
+				for (int q = 0; q < r; q++) {
+					V sr = ar[0], si = ai[0];
+					for (int t = 1; t < r; t++) {
+						V tr = ar[t], ti = ai[t];
+						const int e = (t * q) % r;
+						twiddle<V, INV>(tr, ti, cr[e], ci[e]);
+						sr = sr + tr;
+						si = si + ti;
+					}
+					yr[o + q * ns] = sr;
+					yi[o + q * ns] = si;
+				}
+			}
+		}
+	}
+
+	/* Scratch space for a group of transforms of length n: the data (re, im), the
+	 * ping-pong buffers for the Stockham passes and the generic radix scratch.
+	 */
+	template<class V>
+	struct Work
+	{
+		V *re, *im, *wr, *wi, *gr, *gi;
+
+		Work(const ComplexPlan& p)
+		{
+			const size_t n = p.n;
+			const size_t g = p.max_radix;
+			re = static_cast<V*>(alloc_lanes((4 * n + 2 * g) * sizeof(V)));
+			im = re + n;
+			wr = im + n;
+			wi = wr + n;
+			gr = wi + n;
+			gi = gr + g;
+		}
+
+		~Work() { free_lanes(re); }
+
+		float *fre() { return reinterpret_cast<float*>(re); }
+		float *fim() { return reinterpret_cast<float*>(im); }
+	};
+
+	/* transforms the V::lanes sequences in w.re/w.im. The result is left in w.re/w.im
+	 * after an even number of passes and in w.wr/w.wi otherwise; the returned pair is
+	 * wherever it ended up.
+	 */
+	template<class V, bool INV>
+	void fft_lanes(const ComplexPlan& p, Work<V>& w, V *&outr, V *&outi)
+	{
+		V *xr = w.re, *xi = w.im, *yr = w.wr, *yi = w.wi;
+
+		for (size_t s = 0; s < p.radix.size(); s++) {
+			switch (p.radix[s]) {
+			case 2:
+				pass2<V, INV>(p, (int)s, xr, xi, yr, yi);
+				break;
+			case 3:
+				pass3<V, INV>(p, (int)s, xr, xi, yr, yi);
+				break;
+			case 4:
+				pass4<V, INV>(p, (int)s, xr, xi, yr, yi);
+				break;
+			case 5:
+				pass5<V, INV>(p, (int)s, xr, xi, yr, yi);
+				break;
+			default:
+				passg<V, INV>(p, (int)s, xr, xi, yr, yi, w.gr, w.gi);
+				break;
+			}
+			V *t = xr; xr = yr; yr = t;
+			t = xi; xi = yi; yi = t;
+		}
+
+		outr = xr;
+		outi = xi;
+	}
+
+	/* real to complex transforms of nrows rows of length n. Two real rows a and b go
+	 * through one complex transform of z = a + i b, and are separated with
+	 * A[k] = (Z[k] + conj Z[n-k]) / 2 and B[k] = (Z[k] - conj Z[n-k]) / 2i.
+	 * Strides are in floats; each group reads all of its rows before writing any,
+	 * so in and out may be the same array.
+	 */
+	template<class V>
+	void rows_r2c(const float *in, size_t istride, float *out, size_t ostride, int n, size_t nrows)
+	{
+		const int L = V::lanes;
+		const int nh = n / 2 + 1;
+		const ComplexPlan& p = get_plan(n);
+		Work<V> w(p);
+		float *br = w.fre(), *bi = w.fim();
+
+		for (size_t r0 = 0; r0 < nrows; r0 += 2 * L) {
+			for (int l = 0; l < L; l++) {
+				const size_t ra = r0 + 2 * l, rb = ra + 1;
+				if (ra < nrows) {
+					const float *src = in + ra * istride;
+					for (int t = 0; t < n; t++) br[t * L + l] = src[t];
+				}
+				else {
+					for (int t = 0; t < n; t++) br[t * L + l] = 0;
+				}
+				if (rb < nrows) {
+					const float *src = in + rb * istride;
+					for (int t = 0; t < n; t++) bi[t * L + l] = src[t];
+				}
+				else {
+					for (int t = 0; t < n; t++) bi[t * L + l] = 0;
+				}
+			}
+
+			V *zr, *zi;
+			fft_lanes<V, false>(p, w, zr, zi);
+			const float *fr = reinterpret_cast<float*>(zr), *fi = reinterpret_cast<float*>(zi);
+
+			for (int l = 0; l < L; l++) {
+				const size_t ra = r0 + 2 * l, rb = ra + 1;
+				if (ra >= nrows) break;
+				float *da = out + ra * ostride;
+				float *db = rb < nrows ? out + rb * ostride : 0;
+				for (int k = 0; k < nh; k++) {
+					const int kn = k ? n - k : 0;
+					const float zkr = fr[k * L + l], zki = fi[k * L + l];
+					const float znr = fr[kn * L + l], zni = fi[kn * L + l];
+					da[2 * k] = 0.5f * (zkr + znr);
+					da[2 * k + 1] = 0.5f * (zki - zni);
+					if (db) {
+						db[2 * k] = 0.5f * (zki + zni);
+						db[2 * k + 1] = 0.5f * (znr - zkr);
+					}
+				}
+			}
+		}
+	}
+
+	/* the inverse of rows_r2c: Z[k] = A[k] + i B[k] over the full Hermitian spectra,
+	 * then one inverse complex transform gives a in the real and b in the imaginary
+	 * part. Like FFTW, the imaginary parts of the DC and Nyquist terms are ignored.
+	 */
+	template<class V>
+	void rows_c2r(const float *in, size_t istride, float *out, size_t ostride, int n, size_t nrows, float scale)
+	{
+		const int L = V::lanes;
+		const int nh = n / 2 + 1;
+		const ComplexPlan& p = get_plan(n);
+		Work<V> w(p);
+		float *br = w.fre(), *bi = w.fim();
+
+		for (size_t r0 = 0; r0 < nrows; r0 += 2 * L) {
+			for (int l = 0; l < L; l++) {
+				const size_t ra = r0 + 2 * l, rb = ra + 1;
+				if (ra >= nrows) {
+					for (int t = 0; t < n; t++) br[t * L + l] = bi[t * L + l] = 0;
+					continue;
+				}
+				const float *sa = in + ra * istride;
+				const float *sb = rb < nrows ? in + rb * istride : 0;
+				for (int k = 0; k < n; k++) {
+					const int kk = k < nh ? k : n - k;
+					const bool edge = kk == 0 || 2 * kk == n;
+					const float xar = sa[2 * kk], xai = edge ? 0 : sa[2 * kk + 1];
+					const float xbr = sb ? sb[2 * kk] : 0;
+					const float xbi = (sb && !edge) ? sb[2 * kk + 1] : 0;
+					if (k < nh) {
+						br[k * L + l] = xar - xbi;
+						bi[k * L + l] = xai + xbr;
+					}
+					else {
+						br[k * L + l] = xar + xbi;
+						bi[k * L + l] = xbr - xai;
+					}
+				}
+			}
+
+			V *zr, *zi;
+			fft_lanes<V, true>(p, w, zr, zi);
+			const float *fr = reinterpret_cast<float*>(zr), *fi = reinterpret_cast<float*>(zi);
+
+			for (int l = 0; l < L; l++) {
+				const size_t ra = r0 + 2 * l, rb = ra + 1;
+				if (ra >= nrows) break;
+				float *da = out + ra * ostride;
+				for (int t = 0; t < n; t++) da[t] = scale * fr[t * L + l];
+				if (rb < nrows) {
+					float *db = out + rb * ostride;
+					for (int t = 0; t < n; t++) db[t] = scale * fi[t * L + l];
+				}
+			}
+		}
+	}
+
+	/* complex transforms of ncols adjacent columns of length n, in place. Element t of
+	 * column c is the complex number at data + 2 * (c + t * estride).
+	 */
+	template<class V, bool INV>
+	void columns(float *data, int n, size_t estride, size_t ncols)
+	{
+		const int L = V::lanes;
+		const ComplexPlan& p = get_plan(n);
+		Work<V> w(p);
+		float *br = w.fre(), *bi = w.fim();
+
+		for (size_t c0 = 0; c0 < ncols; c0 += L) {
+			const int cnt = ncols - c0 < (size_t)L ? (int)(ncols - c0) : L;
+			for (int t = 0; t < n; t++) {
+				const float *src = data + 2 * (c0 + t * estride);
+				int l = 0;
+				for (; l < cnt; l++) {
+					br[t * L + l] = src[2 * l];
+					bi[t * L + l] = src[2 * l + 1];
+				}
+				for (; l < L; l++) br[t * L + l] = bi[t * L + l] = 0;
+			}
+
+			V *zr, *zi;
+			fft_lanes<V, INV>(p, w, zr, zi);
+			const float *fr = reinterpret_cast<float*>(zr), *fi = reinterpret_cast<float*>(zi);
+
+			for (int t = 0; t < n; t++) {
+				float *dst = data + 2 * (c0 + t * estride);
+				for (int l = 0; l < cnt; l++) {
+					dst[2 * l] = fr[t * L + l];
+					dst[2 * l + 1] = fi[t * L + l];
+				}
+			}
+		}
+	}
+
+	// the y and z transforms of a (nx/2+1) x ny x nz complex array
+	template<bool INV>
+	void transform_yz(float *data, int nxc, int ny, int nz)
+	{
+		if (ny > 1) {
+			const size_t slab = (size_t)nxc * ny;
+			for (int z = 0; z < nz; z++) {
+				if (nxc < vfloat::lanes) {
+					columns<sfloat, INV>(data + 2 * z * slab, ny, nxc, nxc);
+				}
+				else {
+					columns<vfloat, INV>(data + 2 * z * slab, ny, nxc, nxc);
+				}
+			}
+		}
+		if (nz > 1) {
+			const size_t slab = (size_t)nxc * ny;
+			columns<vfloat, INV>(data, nz, slab, slab);
+		}
+	}
+}
+
+void NativeFFT::real_to_complex(float *real_data, float *complex_data, int nx, int ny, int nz)
+{
+	const int nxc = nx / 2 + 1;
+	const size_t rows = (size_t)ny * nz;
+	const size_t istride = real_data == complex_data ? 2 * nxc : nx;
+
+	if (rows <= 2) {
+		rows_r2c<sfloat>(real_data, istride, complex_data, 2 * nxc, nx, rows);
+	}
+	else {
+		rows_r2c<vfloat>(real_data, istride, complex_data, 2 * nxc, nx, rows);
+	}
+	transform_yz<false>(complex_data, nxc, ny, nz);
+}
+
+void NativeFFT::complex_to_real(float *complex_data, float *real_data, int nx, int ny, int nz, float scale)
+{
+	const int nxc = nx / 2 + 1;
+	const size_t rows = (size_t)ny * nz;
+	const size_t ostride = real_data == complex_data ? 2 * nxc : nx;
+
+	transform_yz<true>(complex_data, nxc, ny, nz);
+	if (rows <= 2) {
+		rows_c2r<sfloat>(complex_data, 2 * nxc, real_data, ostride, nx, rows, scale);
+	}
+	else {
+		rows_c2r<vfloat>(complex_data, 2 * nxc, real_data, ostride, nx, rows, scale);
+	}
+}
+
+int NativeFFT::simd_width()
+{
+	return vfloat::lanes;
+}
+
+#endif	//NATIVE_FFT
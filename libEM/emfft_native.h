@@ -0,0 +1,88 @@
+/**
+ * $Id$
+ */
+
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ *
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * */
+
+#ifndef eman_emfft_native_h__
+#define eman_emfft_native_h__
+
+#ifdef NATIVE_FFT
+
+namespace EMAN
+{
+	/** NativeFFT is the FFT engine behind EMfft when EMAN2 is built with ENABLE_NATIVE_FFT,
+	 * for deployments that can not use the GPL licensed FFTW.
+	 *
+	 * It is a mixed radix (4, 2, 3, 5 and generic odd factors) Stockham FFT. Instead of
+	 * vectorizing inside one transform, it runs as many independent 1D transforms side by
+	 * side as the SIMD unit has lanes (8 with AVX, 4 with SSE2, 1 in the scalar fallback).
+	 * Multidimensional transforms supply plenty of independent rows and columns, and real
+	 * rows are transformed two at a time packed into one complex transform.
+	 * Which instruction set is used is decided at compile time (-mavx / -march=native).
+	 *
+	 * The data layout, sign convention and normalization are the same as FFTW's
+	 * r2c/c2r transforms, so it is a drop in replacement. Plans (radix factorization and
+	 * twiddle factors) are cached per transform length for the lifetime of the process.
+	 */
+	class NativeFFT
+	{
+	  public:
+		/** Real to complex transform with FFTW's layout. In-place if real_data == complex_data,
+		 * in which case the real rows must be padded to 2*(nx/2+1) floats.
+		 * @param real_data the real input
+		 * @param complex_data the (nx/2+1)*ny*nz complex output
+		 * @param nx the x size of the real image
+		 * @param ny the y size of the image
+		 * @param nz the z size of the image
+		 */
+		static void real_to_complex(float *real_data, float *complex_data, int nx, int ny, int nz);
+
+		/** Complex to real transform with FFTW's layout. Like FFTW's, it destroys the input,
+		 * even when out of place. The result is multiplied by scale, so 1/(nx*ny*nz) gives
+		 * a normalized inverse.
+		 * @param complex_data the (nx/2+1)*ny*nz complex input
+		 * @param real_data the real output, rows padded to 2*(nx/2+1) floats if in-place
+		 * @param nx the x size of the real image
+		 * @param ny the y size of the image
+		 * @param nz the z size of the image
+		 * @param scale factor applied to the result
+		 */
+		static void complex_to_real(float *complex_data, float *real_data, int nx, int ny, int nz, float scale = 1.0f);
+
+		/** The number of transforms computed side by side, i.e. the SIMD width in floats */
+		static int simd_width();
+	};
+}
+
+#endif	//NATIVE_FFT
+
+#endif	//eman_emfft_native_h__
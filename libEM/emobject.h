@@ -533,6 +533,13 @@ namespace EMAN
 			return dict.size();
 		}
 
+		/** Exchange the contents of this Dictionary with that one, without copying them
+		 */
+		void swap(Dict & that)
+		{
+			dict.swap(that.dict);
+		}
+
 		/** Get the EMObject corresponding to the particular key
 		 * Probably better to just use operator[]
 		 */
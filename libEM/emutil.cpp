@@ -52,6 +52,10 @@
 #include <boost/shared_ptr.hpp>
 using boost::shared_ptr;
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif	//__linux__
+
 //#ifdef EMAN2_USING_CUDA_MALLOC
 //#include "cuda/cuda_util.h"
 //#endif
@@ -60,6 +64,357 @@ using namespace EMAN;
 
 static const int ATTR_NAME_LEN = 128;
 
+namespace {
+	// image buffers are aligned for the widest SIMD loads, which is also a cache line
+	const size_t BUFFER_ALIGN = 64;
+	// buffers at least this large may be backed by 2 MB transparent huge pages
+	const size_t HUGE_PAGE_MIN = 4 << 20;
+	const size_t HUGE_PAGE_SIZE = 2 << 20;
+	// em_calloc() buffers at least this large come straight from calloc(). Fresh pages from
+	// the system are zeroed as they are first touched, so a huge volume costs nothing up front
+	const size_t CALLOC_MIN = 4 << 20;
+
+	/* Freed image buffers kept for reuse. Buffers are allocated in size classes, so
+	 * a freed buffer can serve any later request of the same class. 'owned' knows
+	 * every buffer allocated here, which tells them apart from malloc() buffers
+	 * EMData::set_data() took possession of.
+	 * The pool is split into stripes with a mutex each, so threads allocating different
+	 * sizes or freeing different buffers don't wait for each other. The free list of a
+	 * size class is in the stripe of the class, the 'owned' entry of a buffer in the
+	 * stripe of its address.
+	 */
+	const int POOL_STRIPES = 16;
+
+	struct PoolEntry
+	{
+		size_t size;	// the size class, or the exact size of a calloc() buffer
+		void *base;		// what calloc() returned, 0 for pool buffers
+	};
+
+	struct PoolStripe
+	{
+		PoolStripe() : cached_buffers(0), hits(0), misses(0) {}
+		map<size_t, vector<void *> > cache;
+		map<void *, PoolEntry> owned;
+		size_t cached_buffers;
+		double hits;
+		double misses;
+	};
+
+#ifdef _WIN32
+	MUTEX stripe_mutex[POOL_STRIPES];
+#else
+	pthread_mutex_t stripe_mutex[POOL_STRIPES] = {
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER
+	};
+#endif
+	PoolStripe *stripes[POOL_STRIPES];
+	// bytes cached by each stripe, kept outside the stripes so the total can be read without locks
+	volatile size_t stripe_cached_bytes[POOL_STRIPES];
+
+	// call with stripe_mutex[i] held. Never destroyed, images may be freed during exit.
+	PoolStripe &pool_stripe(int i)
+	{
+		if (stripes[i] == 0) stripes[i] = new PoolStripe;
+		return *stripes[i];
+	}
+
+	/* Pool settings, read without a lock. They stay zero (no pool, no huge pages) should
+	 * an image be allocated during static initialization, before the constructor runs.
+	 */
+	struct PoolSettings
+	{
+		PoolSettings()
+		{
+			const char *env = getenv("EMAN2_POOL_LIMIT");
+			int mb = (env == NULL) ? 256 : atoi(env);
+			limit = (size_t)(mb < 0 ? 0 : mb) << 20;
+
+			env = getenv("EMAN2_HUGE_PAGES");
+			huge_pages = (env != NULL && atoi(env) == 1);
+		}
+
+		volatile size_t limit;
+		volatile bool huge_pages;
+	};
+
+	PoolSettings pool_settings;
+
+	// the bytes cached in all stripes. Without the locks this may be slightly off while other
+	// threads allocate, so the pool limit is not exact
+	size_t total_cached()
+	{
+		size_t total = 0;
+		for (int i = 0; i < POOL_STRIPES; i++) total += stripe_cached_bytes[i];
+		return total;
+	}
+
+	// 8 classes per power of two above 4 KB, so at most 12.5% is wasted
+	size_t size_class(size_t size)
+	{
+		if (size <= 4096) {
+			return size < BUFFER_ALIGN ? BUFFER_ALIGN : (size + BUFFER_ALIGN - 1) & ~(BUFFER_ALIGN - 1);
+		}
+		size_t step = 4096 / 8;
+		while (step * 16 < size) step *= 2;
+		return (size + step - 1) / step * step;
+	}
+
+	// large classes are multiples of large powers of two, which are folded out so the classes
+	// of one octave and of neighboring octaves land in different stripes
+	int class_stripe(size_t cls)
+	{
+		size_t h = cls / BUFFER_ALIGN;
+		int shift = 0;
+		while (h > 1 && h % 2 == 0) {
+			h /= 2;
+			shift++;
+		}
+		return (int)((h + shift) % POOL_STRIPES);
+	}
+
+	// buffers are 64 byte, 4 KB or 2 MB aligned, the bits above each alignment are folded in
+	int address_stripe(const void *p)
+	{
+		size_t h = (size_t)p / BUFFER_ALIGN;
+		return (int)((h ^ (h >> 6) ^ (h >> 15)) % POOL_STRIPES);
+	}
+
+	void remember(void *p, size_t size, void *base)
+	{
+		const int s = address_stripe(p);
+		PoolEntry entry;
+		entry.size = size;
+		entry.base = base;
+		Util::MUTEX_LOCK(&stripe_mutex[s]);
+		pool_stripe(s).owned[p] = entry;
+		Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+	}
+
+	// the entry of a buffer allocated here, size 0 for any other buffer
+	PoolEntry lookup(void *p)
+	{
+		const int s = address_stripe(p);
+		PoolEntry entry;
+		entry.size = 0;
+		entry.base = 0;
+		Util::MUTEX_LOCK(&stripe_mutex[s]);
+		PoolStripe &stripe = pool_stripe(s);
+		map<void *, PoolEntry>::const_iterator it = stripe.owned.find(p);
+		if (it != stripe.owned.end()) entry = it->second;
+		Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+		return entry;
+	}
+
+	void forget(void *p)
+	{
+		const int s = address_stripe(p);
+		Util::MUTEX_LOCK(&stripe_mutex[s]);
+		pool_stripe(s).owned.erase(p);
+		Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+	}
+
+	void *raw_alloc(size_t size, bool huge_pages)
+	{
+		const size_t align = (huge_pages && size >= HUGE_PAGE_MIN) ? HUGE_PAGE_SIZE : BUFFER_ALIGN;
+		void *p = 0;
+#ifdef _WIN32
+		p = _aligned_malloc(size, align);
+#else
+		if (posix_memalign(&p, align, size) != 0) p = 0;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		if (p && align == HUGE_PAGE_SIZE) madvise(p, size, MADV_HUGEPAGE);
+#endif
+#endif	//_WIN32
+		return p;
+	}
+
+	void raw_free(void *p)
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		free(p);
+#endif	//_WIN32
+	}
+
+	// returns cached buffers, the largest of each stripe first, to the system until at most
+	// 'keep' bytes remain
+	void trim_pool(size_t keep)
+	{
+		vector<void *> released;
+		for (int s = 0; s < POOL_STRIPES && total_cached() > keep; s++) {
+			Util::MUTEX_LOCK(&stripe_mutex[s]);
+			PoolStripe &stripe = pool_stripe(s);
+			map<size_t, vector<void *> >::reverse_iterator it = stripe.cache.rbegin();
+			for (; it != stripe.cache.rend() && total_cached() > keep; ++it) {
+				while (!it->second.empty() && total_cached() > keep) {
+					released.push_back(it->second.back());
+					it->second.pop_back();
+					stripe_cached_bytes[s] -= it->first;
+					stripe.cached_buffers--;
+				}
+			}
+			Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+		}
+
+		for (size_t i = 0; i < released.size(); i++) {
+			forget(released[i]);
+			raw_free(released[i]);
+		}
+	}
+}
+
+void* EMUtil::em_malloc(const size_t size)
+{
+	const size_t cls = size_class(size);
+	const int s = class_stripe(cls);
+	void *p = 0;
+
+	Util::MUTEX_LOCK(&stripe_mutex[s]);
+	PoolStripe &stripe = pool_stripe(s);
+	map<size_t, vector<void *> >::iterator it = stripe.cache.find(cls);
+	if (it != stripe.cache.end() && !it->second.empty()) {
+		p = it->second.back();
+		it->second.pop_back();
+		stripe_cached_bytes[s] -= cls;
+		stripe.cached_buffers--;
+		stripe.hits++;
+	}
+	else {
+		stripe.misses++;
+	}
+	Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+
+	if (p) return p;
+
+	p = raw_alloc(cls, pool_settings.huge_pages);
+	if (!p) {
+		// the memory may be sitting in the pool
+		clear_pool();
+		p = raw_alloc(cls, pool_settings.huge_pages);
+		if (!p) return 0;
+	}
+
+	remember(p, cls, 0);
+	return p;
+}
+
+void* EMUtil::em_calloc(const size_t nmemb,const size_t size)
+{
+	const size_t bytes = nmemb * size;
+	if (bytes < CALLOC_MIN) {
+		void *p = em_malloc(bytes);
+		if (p) memset(p, 0, bytes);
+		return p;
+	}
+
+	// calloc() only promises malloc()'s alignment, so the buffer is aligned by hand
+	void *base = calloc(bytes + BUFFER_ALIGN, 1);
+	if (!base) {
+		clear_pool();
+		base = calloc(bytes + BUFFER_ALIGN, 1);
+		if (!base) return 0;
+	}
+	void *p = (void *)(((size_t)base + BUFFER_ALIGN) & ~(BUFFER_ALIGN - 1));
+	remember(p, bytes, base);
+	return p;
+}
+
+void* EMUtil::em_realloc(void* data,const size_t new_size)
+{
+	if (!data) return em_malloc(new_size);
+
+	const PoolEntry entry = lookup(data);
+	if (entry.size == 0) return realloc(data, new_size);
+	if (entry.base == 0 && size_class(new_size) == entry.size) return data;
+
+	// like realloc(), the old buffer is left alone if this fails
+	void *p = em_malloc(new_size);
+	if (!p) return 0;
+	memcpy(p, data, entry.size < new_size ? entry.size : new_size);
+	em_free(data);
+	return p;
+}
+
+void EMUtil::em_free(void*data)
+{
+	if (!data) return;
+
+	const int a = address_stripe(data);
+	Util::MUTEX_LOCK(&stripe_mutex[a]);
+	PoolStripe &owner = pool_stripe(a);
+	map<void *, PoolEntry>::iterator it = owner.owned.find(data);
+	if (it == owner.owned.end()) {
+		Util::MUTEX_UNLOCK(&stripe_mutex[a]);
+		free(data);
+		return;
+	}
+
+	const PoolEntry entry = it->second;
+	const bool keep = (entry.base == 0 && total_cached() + entry.size <= pool_settings.limit);
+	if (!keep) owner.owned.erase(it);
+	Util::MUTEX_UNLOCK(&stripe_mutex[a]);
+
+	if (entry.base) free(entry.base);
+	else if (!keep) raw_free(data);
+	else {
+		const int s = class_stripe(entry.size);
+		Util::MUTEX_LOCK(&stripe_mutex[s]);
+		PoolStripe &stripe = pool_stripe(s);
+		stripe.cache[entry.size].push_back(data);
+		stripe_cached_bytes[s] += entry.size;
+		stripe.cached_buffers++;
+		Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+	}
+}
+
+void EMUtil::set_pool_limit(size_t bytes)
+{
+	pool_settings.limit = bytes;
+	trim_pool(bytes);
+}
+
+size_t EMUtil::get_pool_limit()
+{
+	return pool_settings.limit;
+}
+
+void EMUtil::clear_pool()
+{
+	trim_pool(0);
+}
+
+Dict EMUtil::get_pool_stats()
+{
+	double hits = 0, misses = 0, cached_bytes = 0, cached_buffers = 0;
+	for (int s = 0; s < POOL_STRIPES; s++) {
+		Util::MUTEX_LOCK(&stripe_mutex[s]);
+		PoolStripe &stripe = pool_stripe(s);
+		hits += stripe.hits;
+		misses += stripe.misses;
+		cached_bytes += stripe_cached_bytes[s];
+		cached_buffers += stripe.cached_buffers;
+		Util::MUTEX_UNLOCK(&stripe_mutex[s]);
+	}
+
+	Dict stats;
+	stats["hits"] = hits;
+	stats["misses"] = misses;
+	stats["cached_bytes"] = cached_bytes;
+	stats["cached_buffers"] = cached_buffers;
+	stats["limit"] = (double)pool_settings.limit;
+	return stats;
+}
+
+void EMUtil::set_huge_pages(bool enable)
+{
+	pool_settings.huge_pages = enable;
+}
+
 EMUtil::ImageType EMUtil::get_image_ext_type(const string & file_ext)
 {
 	ENTERFUNC;
@@ -833,6 +1188,8 @@ const char *EMUtil::get_datatype_string(EMDataType type)
 		return "USHORT_COMPLEX";
 	case EM_FLOAT_COMPLEX:
 		return "FLOAT_COMPLEX";
+	case EM_HALF:
+		return "HALF FLOAT";
 	case EM_UNKNOWN:
 		return "UNKNOWN";
 	}
@@ -1231,6 +1588,169 @@ bool EMUtil::is_complex_type(EMDataType datatype)
 	return false;
 }
 
+size_t EMUtil::get_datatype_size(EMDataType type)
+{
+	switch (type) {
+	case EM_CHAR:
+	case EM_UCHAR:
+		return sizeof(char);
+	case EM_SHORT:
+	case EM_USHORT:
+	case EM_SHORT_COMPLEX:
+	case EM_USHORT_COMPLEX:
+	case EM_HALF:
+		return sizeof(short);
+	case EM_INT:
+	case EM_UINT:
+		return sizeof(int);
+	case EM_FLOAT:
+	case EM_FLOAT_COMPLEX:
+		return sizeof(float);
+	case EM_DOUBLE:
+		return sizeof(double);
+	case EM_UNKNOWN:
+		return 0;
+	}
+
+	return 0;
+}
+
+bool EMUtil::is_compact_type(EMDataType type)
+{
+	return (type == EM_CHAR || type == EM_UCHAR || type == EM_SHORT ||
+			type == EM_USHORT || type == EM_HALF);
+}
+
+float EMUtil::half_to_float(unsigned short h)
+{
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int exp = (h >> 10) & 0x1f;
+	unsigned int mant = h & 0x3ff;
+	unsigned int bits;
+
+	if (exp == 0x1f) {			// inf, nan
+		bits = sign | 0x7f800000 | (mant << 13);
+	}
+	else if (exp != 0) {
+		bits = sign | ((exp + 112) << 23) | (mant << 13);
+	}
+	else if (mant == 0) {
+		bits = sign;
+	}
+	else {						// subnormal, normalized for float
+		exp = 113;
+		while (!(mant & 0x400)) {
+			mant <<= 1;
+			--exp;
+		}
+		bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+	}
+
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+unsigned short EMUtil::float_to_half(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int absb = bits & 0x7fffffff;
+
+	if (absb > 0x7f800000) return (unsigned short)(sign | 0x7e00);	// nan
+	if (absb >= 0x47800000) return (unsigned short)(sign | 0x7c00);	// >= 65536, inf
+	if (absb < 0x33000000) return (unsigned short)sign;					// rounds to 0
+
+	unsigned int h, rem, halfway;
+	if (absb < 0x38800000) {	// subnormal half
+		unsigned int mant = (absb & 0x7fffff) | 0x800000;
+		int shift = 126 - (int)(absb >> 23);
+		h = mant >> shift;
+		rem = mant & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else {
+		h = (absb >> 13) - (112 << 10);
+		rem = absb & 0x1fff;
+		halfway = 0x1000;
+	}
+
+	// round to nearest even, a carry correctly rounds up into the exponent (or inf)
+	if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+
+	return (unsigned short)(sign | h);
+}
+
+namespace {
+	template<class T>
+	void compact_to_float_t(const T *src, size_t n, float *dst)
+	{
+		for (size_t i = 0; i < n; ++i) dst[i] = (float)src[i];
+	}
+
+	template<class T>
+	void float_to_compact_t(const float *src, size_t n, T *dst, float lo, float hi)
+	{
+		for (size_t i = 0; i < n; ++i) {
+			float v = src[i];
+			if (!(v >= lo)) v = lo;		// also nan
+			else if (v > hi) v = hi;
+			dst[i] = (T)std::floor(v + 0.5f);
+		}
+	}
+}
+
+void EMUtil::compact_to_float(const void *src, EMDataType type, size_t offset, size_t n, float *dst)
+{
+	switch (type) {
+	case EM_CHAR:
+		compact_to_float_t((const signed char *)src + offset, n, dst);
+		break;
+	case EM_UCHAR:
+		compact_to_float_t((const unsigned char *)src + offset, n, dst);
+		break;
+	case EM_SHORT:
+		compact_to_float_t((const short *)src + offset, n, dst);
+		break;
+	case EM_USHORT:
+		compact_to_float_t((const unsigned short *)src + offset, n, dst);
+		break;
+	case EM_HALF: {
+		const unsigned short *h = (const unsigned short *)src + offset;
+		for (size_t i = 0; i < n; ++i) dst[i] = half_to_float(h[i]);
+		break;
+	}
+	default:
+		throw InvalidValueException(type, "not a compact data type");
+	}
+}
+
+void EMUtil::float_to_compact(const float *src, size_t n, EMDataType type, void *dst)
+{
+	switch (type) {
+	case EM_CHAR:
+		float_to_compact_t(src, n, (signed char *)dst, SCHAR_MIN, SCHAR_MAX);
+		break;
+	case EM_UCHAR:
+		float_to_compact_t(src, n, (unsigned char *)dst, 0, UCHAR_MAX);
+		break;
+	case EM_SHORT:
+		float_to_compact_t(src, n, (short *)dst, SHRT_MIN, SHRT_MAX);
+		break;
+	case EM_USHORT:
+		float_to_compact_t(src, n, (unsigned short *)dst, 0, USHRT_MAX);
+		break;
+	case EM_HALF: {
+		unsigned short *h = (unsigned short *)dst;
+		for (size_t i = 0; i < n; ++i) h[i] = float_to_half(src[i]);
+		break;
+	}
+	default:
+		throw InvalidValueException(type, "not a compact data type");
+	}
+}
+
 EMData *EMUtil::vertical_acf(const EMData * image, int maxdy)
 {
 	if (!image) {
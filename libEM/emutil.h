@@ -102,7 +102,8 @@ namespace EMAN
 			EM_DOUBLE,
 			EM_SHORT_COMPLEX,
 			EM_USHORT_COMPLEX,
-			EM_FLOAT_COMPLEX
+			EM_FLOAT_COMPLEX,
+			EM_HALF				// IEEE 754 half precision, only used for EMData storage
 		};
 
 		/** Image format types.
@@ -284,6 +285,39 @@ namespace EMAN
 
 		static bool is_complex_type(EMDataType datatype);
 
+		/** Get the size of one sample of a data type
+		 * @param type the EMDataType
+		 * @return the size in bytes, 0 for EM_UNKNOWN
+		 */
+		static size_t get_datatype_size(EMDataType type);
+
+		/** Is type one of the reduced precision types EMData can store its pixels in,
+		 * EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF.
+		 */
+		static bool is_compact_type(EMDataType type);
+
+		/** Convert samples of a compact (8 bit, 16 bit or half float) buffer to float.
+		 * @param src the compact buffer
+		 * @param type the type of src, see is_compact_type()
+		 * @param offset the index in src of the first sample to convert
+		 * @param n the number of samples to convert
+		 * @param dst n floats
+		 */
+		static void compact_to_float(const void *src, EMDataType type, size_t offset, size_t n, float *dst);
+
+		/** Convert floats to a compact buffer. Integer types are rounded and clamped to
+		 * their range.
+		 * @param src n floats
+		 * @param n the number of samples to convert
+		 * @param type the type of dst, see is_compact_type()
+		 * @param dst the compact buffer, of n samples
+		 */
+		static void float_to_compact(const float *src, size_t n, EMDataType type, void *dst);
+
+		static float half_to_float(unsigned short h);
+		/** Round a float to half precision, saturating to infinity */
+		static unsigned short float_to_half(float f);
+
 		static void jump_lines(FILE * file, int nlines);
 
         static vector<string> get_euler_names(const string & euler_type);
@@ -359,27 +393,64 @@ namespace EMAN
 //#endif
 		}
 
-		inline static void* em_malloc(const size_t size) {
-			return malloc(size);
-		}
+		/** Allocate an image buffer. Buffers are 64 byte aligned, so SIMD loops and FFTW
+		 * can use their aligned code paths, and are taken from a pool of freed buffers
+		 * of the same size class when one is available.
+		 * @param size the number of bytes
+		 * @return the buffer, or 0 if out of memory
+		 */
+		static void* em_malloc(const size_t size);
+
+		/** Allocate a zeroed image buffer, aligned like em_malloc(). Buffers of 4 MB and more
+		 * come from calloc() rather than the pool, so their pages are zeroed lazily by the
+		 * system instead of all being touched up front.
+		 * @param nmemb the number of elements
+		 * @param size the size of one element
+		 * @return the buffer, or 0 if out of memory
+		 */
+		static void* em_calloc(const size_t nmemb,const size_t size);
 
-		inline static void* em_calloc(const size_t nmemb,const size_t size) {
-			return calloc(nmemb,size);
-		}
+		static void* em_realloc(void* data,const size_t new_size);
 
-		inline static void* em_realloc(void* data,const size_t new_size) {
-			return realloc(data, new_size);
-		}
 		inline static void em_memset(void* data, const int value, const size_t size) {
 			memset(data, value, size);
 		}
-		inline static void em_free(void*data) {
-			free(data);
-		}
+
+		/** Release a buffer from em_malloc(), em_calloc() or em_realloc(). Buffers from
+		 * plain malloc(), as EMData::set_data() accepts, are passed on to free().
+		 * Buffers from these functions must only be released here, never with free() or
+		 * delete, which would not match the allocation on Windows and would leave the pool
+		 * believing it still owns the address.
+		 * @param data the buffer
+		 */
+		static void em_free(void*data);
 
 		inline static void em_memcpy(void* dst,const void* const src,const size_t size) {
 			memcpy(dst,src,size);
 		}
+
+		/** Limit the memory the buffer pool keeps for reuse. Freed buffers that do not
+		 * fit are returned to the system. The initial limit is EMAN2_POOL_LIMIT (in MB)
+		 * if that is set, 256 MB otherwise.
+		 * The limit is checked without locking out other threads, so it may be overshot by
+		 * the buffers they free at the same moment.
+		 * @param bytes the limit, 0 disables the pool
+		 */
+		static void set_pool_limit(size_t bytes);
+		static size_t get_pool_limit();
+
+		/** Return every buffer cached by the pool to the system. */
+		static void clear_pool();
+
+		/** Buffer pool counters: "hits" and "misses" of em_malloc(), the "cached_bytes" and
+		 * "cached_buffers" currently held, and the "limit".
+		 */
+		static Dict get_pool_stats();
+
+		/** Ask the kernel to back buffers of 4 MB and more with transparent huge pages.
+		 * Only has an effect on Linux. Initially on if EMAN2_HUGE_PAGES is set to 1.
+		 */
+		static void set_huge_pages(bool enable);
 	  private:
 		static ImageType fast_get_image_type(const string & filename,
 											 const void *first_block,
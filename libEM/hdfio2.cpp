@@ -1286,6 +1286,51 @@ int HdfIO2::read_data(float *data, int image_index, const Region *area, bool)
 	return 0;
 }
 
+EMUtil::EMDataType HdfIO2::get_compact_type(int image_index, const Region * area)
+{
+	init();
+
+	if (area) return EMUtil::EM_FLOAT;
+
+	char ipath[50];
+	sprintf(ipath,"/MDF/images/%d/image",image_index);
+	hid_t ds = H5Dopen(file,ipath);
+
+	if (ds < 0) return EMUtil::EM_FLOAT;
+
+	hid_t dt = H5Dget_type(ds);
+	size_t size = H5Tget_size(dt);
+	H5Tclose(dt);
+	H5Dclose(ds);
+
+	// the same types read_data() reads before widening them
+	if (size == 1) return EMUtil::EM_UCHAR;
+	if (size == 2) return EMUtil::EM_USHORT;
+
+	return EMUtil::EM_FLOAT;
+}
+
+int HdfIO2::read_compact_data(void *data, int image_index, const Region * area)
+{
+	ENTERFUNC;
+
+	EMUtil::EMDataType type = get_compact_type(image_index, area);
+	if (type == EMUtil::EM_FLOAT) return 1;
+
+	char ipath[50];
+	sprintf(ipath,"/MDF/images/%d/image",image_index);
+	hid_t ds = H5Dopen(file,ipath);
+	hid_t spc = H5Dget_space(ds);
+
+	H5Dread(ds, type == EMUtil::EM_UCHAR ? H5T_NATIVE_UCHAR : H5T_NATIVE_USHORT, spc, spc, H5P_DEFAULT, data);
+
+	H5Sclose(spc);
+	H5Dclose(ds);
+
+	EXITFUNC;
+	return 0;
+}
+
 // Writes all attributes in 'dict' to the image group
 // Creation of the image dataset is also handled here
 
@@ -118,6 +118,10 @@ namespace EMAN
 		// this one is only defined in classes that implement it
 		int read_data_8bit(unsigned char *data, int image_index = 0, const Region * area = 0, bool is_3d = false, float minval = 0.0f, float maxval = 0.0f);
 
+		// 8 and 16 bit whole images only, regions are read through float
+		EMUtil::EMDataType get_compact_type(int image_index, const Region * area = 0);
+		int read_compact_data(void *data, int image_index = 0, const Region * area = 0);
+
 		/** Return the file id
 		 * For single attribute read/write*/
 		hid_t get_fileid() const {return file;}
@@ -214,6 +214,47 @@ namespace EMAN
 							   EMUtil::EMDataType filestoragetype = EMUtil::EM_FLOAT,
 							   bool use_host_endian = true) = 0;
 
+		/** Find where the pixels of an image are stored in the file, if they are stored
+		 * exactly as EMData holds them (native endian float, contiguous, no conversion,
+		 * transposition or phase flipping needed), so that they can be memory mapped
+		 * instead of read.
+		 *
+		 * @param image_index The index of the image.
+		 * @param offset Returns the byte offset of the pixels in the file.
+		 * @return true if the image can be mapped, false if it must be read with read_data().
+		 */
+		virtual bool get_mappable_offset(int /*image_index*/, off_t & /*offset*/)
+		{
+			return false;
+		}
+
+		/** Get the type read_compact_data() returns the samples of an image in, when
+		 * they are stored as 8 or 16 bit integers that read_data() would widen to float.
+		 *
+		 * @param image_index The index of the image.
+		 * @param area The region that will be read, 0 for the whole image.
+		 * @return EM_CHAR, EM_UCHAR, EM_SHORT or EM_USHORT, or EM_FLOAT if the data
+		 *         must be read with read_data().
+		 */
+		virtual EMUtil::EMDataType get_compact_type(int /*image_index*/, const Region * /*area*/ = 0)
+		{
+			return EMUtil::EM_FLOAT;
+		}
+
+		/** Read the data of an image without converting it to float, see get_compact_type().
+		 * The samples are in host byte order and otherwise have the values read_data()
+		 * returns. Parts of the region outside the image are left untouched.
+		 *
+		 * @param data An array of the (region) size in the type get_compact_type() returns.
+		 * @param image_index The index of the image to read.
+		 * @param area If provided reads only the specified region.
+		 * @return 0 if OK; 1 if error.
+		 */
+		virtual int read_compact_data(void * /*data*/, int /*image_index*/ = 0, const Region * /*area*/ = 0)
+		{
+			return 1;
+		}
+
 		/** Read CTF data from this image.
 		 *
 		 * @param ctf Used to store the CTF data.
@@ -984,36 +984,12 @@ int MrcIO::write_header(const Dict & dict, int image_index, const Region* area,
 	return 0;
 }
 
-int MrcIO::read_data(float *rdata, int image_index, const Region * area, bool)
+size_t MrcIO::read_raw_data(void *data, int image_index, const Region * area,
+							int & xlen, int & ylen, int & zlen)
 {
-	ENTERFUNC;
-
-	if (! (isFEI || is_stack)) {
-		// single image format, index can only be zero
-
-		image_index = 0;
-	}
-
-	if (is_transpose && area != 0) {
-		printf("Warning: This image dimension is in (y,x,z), "
-				"region I/O not supported, return the whole image instead.");
-	}
-
-	check_read_access(image_index, rdata);
-
-	if (area && is_complex_mode()) {
-		LOGERR("Error: cannot read a region of a complex image.");
-
-		return 1;
-	}
-
-	signed char *    scdata = (signed char *)    rdata;
-	unsigned char *  cdata  = (unsigned char *)  rdata;
-	short *          sdata  = (short *)          rdata;
-	unsigned short * usdata = (unsigned short *) rdata;
+	unsigned char * cdata = (unsigned char *) data;
 
 	size_t size = 0;
-	int xlen = 0, ylen = 0, zlen = 0;
 
 	if (isFEI) {	// FEI extended MRC
 		check_region(area, FloatSize(feimrch.nx, feimrch.ny, feimrch.nz), is_new_file, false);
@@ -1056,13 +1032,47 @@ int MrcIO::read_data(float *rdata, int image_index, const Region * area, bool)
 	    mrch.mode != MRC_UHEX) {
 
 		if (mode_size == sizeof(short)) {
-			become_host_endian < short >(sdata, size);
+			become_host_endian < short >((short *) data, size);
 		}
 		else if (mode_size == sizeof(float)) {
-			become_host_endian < float >(rdata, size);
+			become_host_endian < float >((float *) data, size);
 		}
 	}
 
+	return size;
+}
+
+int MrcIO::read_data(float *rdata, int image_index, const Region * area, bool)
+{
+	ENTERFUNC;
+
+	if (! (isFEI || is_stack)) {
+		// single image format, index can only be zero
+
+		image_index = 0;
+	}
+
+	if (is_transpose && area != 0) {
+		printf("Warning: This image dimension is in (y,x,z), "
+				"region I/O not supported, return the whole image instead.");
+	}
+
+	check_read_access(image_index, rdata);
+
+	if (area && is_complex_mode()) {
+		LOGERR("Error: cannot read a region of a complex image.");
+
+		return 1;
+	}
+
+	int xlen = 0, ylen = 0, zlen = 0;
+	size_t size = read_raw_data(rdata, image_index, area, xlen, ylen, zlen);
+
+	signed char *    scdata = (signed char *)    rdata;
+	unsigned char *  cdata  = (unsigned char *)  rdata;
+	short *          sdata  = (short *)          rdata;
+	unsigned short * usdata = (unsigned short *) rdata;
+
 	if (mrch.mode == MRC_UHEX) {
 		size_t num_pairs = size / 2;
 		size_t num_pts   = num_pairs * 2;
@@ -1745,6 +1755,83 @@ int MrcIO::get_nimg()
 	return stack_size;
 }
 
+bool MrcIO::get_mappable_offset(int image_index, off_t & offset)
+{
+	init();
+
+	if (is_new_file || mrch.mode != MRC_FLOAT || is_transpose ||
+		is_big_endian != ByteOrder::is_host_big_endian()) {
+		return false;
+	}
+
+	if (! (isFEI || is_stack)) {
+		image_index = 0;
+	}
+
+	check_read_access(image_index);
+
+	// same layout read_data() reads through process_region_io()
+	int nx, ny, nz;
+	if (isFEI) {
+		nx = feimrch.nx;  ny = feimrch.ny;  nz = feimrch.nz;
+		offset = sizeof(MrcHeader) + feimrch.next;
+	}
+	else {
+		nx = mrch.nx;  ny = mrch.ny;  nz = mrch.nz;
+		offset = sizeof(MrcHeader) + mrch.nsymbt;
+	}
+
+	if (nz == 1) {
+		offset += (off_t) image_index * nx * ny * sizeof(float);
+	}
+
+	return true;
+}
+
+EMUtil::EMDataType MrcIO::get_compact_type(int, const Region *)
+{
+	init();
+
+	if (is_new_file || is_transpose) {
+		return EMUtil::EM_FLOAT;
+	}
+
+	switch (mrch.mode) {
+	case MRC_UCHAR:
+		return EMUtil::EM_UCHAR;
+	case MRC_CHAR:
+		return EMUtil::EM_CHAR;
+	case MRC_SHORT:
+		return EMUtil::EM_SHORT;
+	case MRC_USHORT:
+		return EMUtil::EM_USHORT;
+	default:
+		return EMUtil::EM_FLOAT;
+	}
+}
+
+int MrcIO::read_compact_data(void *data, int image_index, const Region * area)
+{
+	ENTERFUNC;
+
+	if (get_compact_type(image_index, area) == EMUtil::EM_FLOAT) {
+		return 1;
+	}
+
+	if (! (isFEI || is_stack)) {
+		image_index = 0;
+	}
+
+	check_read_access(image_index);
+
+	int xlen = 0, ylen = 0, zlen = 0;
+	read_raw_data(data, image_index, area, xlen, ylen, zlen);
+
+	EXITFUNC;
+
+	return 0;
+}
+
 int MrcIO::transpose(float *data, int xlen, int ylen, int zlen) const
 {
 	float * tmp = new float[xlen*ylen];
@@ -63,6 +63,10 @@ namespace EMAN
 
 		int get_nimg();
 
+		bool get_mappable_offset(int image_index, off_t & offset);
+		EMUtil::EMDataType get_compact_type(int image_index, const Region * area = 0);
+		int read_compact_data(void *data, int image_index = 0, const Region * area = 0);
+
 	private:
 		enum MrcMode {
 			MRC_UCHAR = 0,
@@ -311,6 +315,11 @@ namespace EMAN
 		int read_mrc_header(Dict & dict, int image_index = 0, const Region * area = 0, bool is_3d = false);
 		int read_fei_header(Dict & dict, int image_index = 0, const Region * area = 0, bool is_3d = false);
 
+		/** Read the samples of an image (region) as they are stored, in host byte order.
+		 * @return the number of samples read */
+		size_t read_raw_data(void *data, int image_index, const Region * area,
+							 int & xlen, int & ylen, int & zlen);
+
 		//utility funciton to tranpose x and y dimension in case the source mrc image is mapc=2,mapr=1
 		int transpose(float *data, int nx, int ny, int nz) const;
 	};
@@ -1893,6 +1893,32 @@ void DoGFourierProcessor::create_radial_func(vector < float >&radial_mask) const
 	}
 }
 
+namespace {
+	// pixels per RealPixelProcessor::process_block() call, the unit of work of the threads
+	const size_t REAL_PIXEL_BLOCK = 65536;
+
+	struct RealPixelBlocks
+	{
+		const RealPixelProcessor *processor;
+		float *data;
+		size_t size;
+	};
+}
+
+void RealPixelProcessor::prepare(EMData * image)
+{
+	const int stats = required_stats();
+	if (stats & EMData::STAT_EXTREMA) {
+		maxval = image->get_attr("maximum");
+	}
+	if (stats & EMData::STAT_MOMENTS) {
+		mean = image->get_attr("mean");
+		sigma = image->get_attr("sigma");
+	}
+
+	calc_locals(image);
+}
+
 void RealPixelProcessor::process_inplace(EMData * image)
 {
 	if (!image) {
@@ -1900,23 +1926,29 @@ void RealPixelProcessor::process_inplace(EMData * image)
 		return;
 	}
 
-	maxval = image->get_attr("maximum");
-	mean = image->get_attr("mean");
-	sigma = image->get_attr("sigma");
-
-	calc_locals(image);
+	prepare(image);
 
 	size_t size = (size_t)image->get_xsize() *
 				  (size_t)image->get_ysize() *
 				  (size_t)image->get_zsize();
-	float *data = image->get_data();
+	RealPixelBlocks job;
+	job.processor = this;
+	job.data = image->get_data();
+	job.size = size;
 
-	for (size_t i = 0; i < size; ++i) {
-		process_pixel(&data[i]);
-	}
+	Util::parallel_for((size + REAL_PIXEL_BLOCK - 1) / REAL_PIXEL_BLOCK, block_worker, &job, 0, 16);
 	image->update();
 }
 
+void RealPixelProcessor::block_worker(size_t begin, size_t end, void *arg)
+{
+	const RealPixelBlocks *job = static_cast<const RealPixelBlocks *>(arg);
+	for (size_t b = begin; b < end; ++b) {
+		size_t first = b * REAL_PIXEL_BLOCK;
+		job->processor->process_block(job->data + first, std::min(REAL_PIXEL_BLOCK, job->size - first));
+	}
+}
+
 void CoordinateProcessor::process_inplace(EMData * image)
 {
 	if (!image) {
@@ -1924,9 +1956,14 @@ void CoordinateProcessor::process_inplace(EMData * image)
 		return;
 	}
 
-	maxval = image->get_attr("maximum");
-	mean = image->get_attr("mean");
-	sigma = image->get_attr("sigma");
+	const int stats = required_stats();
+	if (stats & EMData::STAT_EXTREMA) {
+		maxval = image->get_attr("maximum");
+	}
+	if (stats & EMData::STAT_MOMENTS) {
+		mean = image->get_attr("mean");
+		sigma = image->get_attr("sigma");
+	}
 	nx = image->get_xsize();
 	ny = image->get_ysize();
 	nz = image->get_zsize();
@@ -2326,6 +2363,339 @@ void BoxStatProcessor::process_inplace(EMData * image)
 	}
 }
 
+namespace {
+	// the most histogram levels BoxMedianProcessor uses, one per distinct value for an exact median
+	const size_t MEDIAN_MAX_LEVELS = 65536;
+	// don't start threads for fewer rows than this per thread
+	const size_t MEDIAN_MIN_ROWS = 4;
+
+	/* Huang's sliding histogram median. Values (as quantized levels) are added to and
+	 * removed from a histogram as the box moves; the level of the median and the number
+	 * of values below it are kept, so finding the new median only walks as many levels
+	 * as the median changed.
+	 */
+	class SlidingMedian
+	{
+	public:
+		SlidingMedian(size_t levels) : hist(levels, 0), level(0), below(0), count(0) {}
+
+		void add(int l)
+		{
+			hist[l]++;
+			count++;
+			if (l < level) below++;
+		}
+
+		void remove(int l)
+		{
+			hist[l]--;
+			count--;
+			if (l < level) below--;
+		}
+
+		/** @return the level of the value of rank count / 2 */
+		int median()
+		{
+			const int rank = count / 2;
+			while (below > rank) below -= hist[--level];
+			while (below + hist[level] <= rank) below += hist[level++];
+			return level;
+		}
+
+	private:
+		vector<int> hist;
+		int level;		// of the last median
+		int below;		// number of values with a level < level
+		int count;
+	};
+
+	/* The rows of BoxMedianProcessor::process_inplace(). Only the pixels at least radius
+	 * from the edges are computed; row r is y = radius + r % nrows, z = z0 + r / nrows.
+	 */
+	struct MedianRows
+	{
+		const unsigned short *levels;	// of each pixel, null to sort the boxes of src instead
+		const float *values;			// of each level
+		size_t nlevels;
+		const float *src;
+		float *des;
+		int nx, ny, nz;
+		int radius, zradius;			// zradius is 0 in 2D
+		int nrows, z0;
+	};
+
+	// all the pixels of the box at column x around row (y, z), added to or removed from the histogram
+	inline void median_column(SlidingMedian & m, const MedianRows * job, int x, int y, int z, bool add)
+	{
+		const size_t nxy = (size_t)job->nx * job->ny;
+		for (int z2 = z - job->zradius; z2 <= z + job->zradius; ++z2) {
+			const unsigned short *p = job->levels + x + (size_t)(y - job->radius) * job->nx + z2 * nxy;
+			for (int y2 = -job->radius; y2 <= job->radius; ++y2, p += job->nx) {
+				if (add) m.add(*p);
+				else m.remove(*p);
+			}
+		}
+	}
+
+	void median_histogram_worker(size_t begin, size_t end, void *arg)
+	{
+		const MedianRows *job = static_cast<const MedianRows *>(arg);
+		const int nx = job->nx, n = job->radius;
+		SlidingMedian m(job->nlevels);
+
+		for (size_t r = begin; r < end; ++r) {
+			const int y = n + (int)(r % job->nrows), z = job->z0 + (int)(r / job->nrows);
+			float *des = job->des + (size_t)y * nx + (size_t)z * nx * job->ny;
+
+			for (int x = 0; x < 2 * n; ++x) median_column(m, job, x, y, z, true);
+			for (int x = n; x < nx - n; ++x) {
+				median_column(m, job, x + n, y, z, true);
+				des[x] = job->values[m.median()];
+				median_column(m, job, x - n, y, z, false);
+			}
+			for (int x = nx - 2 * n; x < nx; ++x) median_column(m, job, x, y, z, false);
+		}
+	}
+
+	// the exact fallback for too many distinct values
+	void median_sort_worker(size_t begin, size_t end, void *arg)
+	{
+		const MedianRows *job = static_cast<const MedianRows *>(arg);
+		const int nx = job->nx, n = job->radius;
+		const size_t nxy = (size_t)nx * job->ny;
+		vector<float> box((2 * n + 1) * (2 * n + 1) * (2 * job->zradius + 1));
+		const size_t mid = box.size() / 2;
+
+		for (size_t r = begin; r < end; ++r) {
+			const int y = n + (int)(r % job->nrows), z = job->z0 + (int)(r / job->nrows);
+			float *des = job->des + (size_t)y * nx + (size_t)z * nxy;
+
+			for (int x = n; x < nx - n; ++x) {
+				size_t s = 0;
+				for (int z2 = z - job->zradius; z2 <= z + job->zradius; ++z2) {
+					for (int y2 = y - n; y2 <= y + n; ++y2) {
+						const float *p = job->src + (size_t)y2 * nx + z2 * nxy;
+						for (int x2 = x - n; x2 <= x + n; ++x2) box[s++] = p[x2];
+					}
+				}
+				std::nth_element(box.begin(), box.begin() + mid, box.end());
+				des[x] = box[mid];
+			}
+		}
+	}
+
+	struct MedianQuantize
+	{
+		const float *src;
+		unsigned short *levels;
+		size_t size;
+		const vector<float> *values;	// the distinct values, or null to quantize linearly
+		float min, scale;
+		int nlevels;
+	};
+
+	// pixels per block of quantize_worker()
+	const size_t MEDIAN_QUANTIZE_BLOCK = 65536;
+
+	void quantize_worker(size_t begin, size_t end, void *arg)
+	{
+		const MedianQuantize *job = static_cast<const MedianQuantize *>(arg);
+		for (size_t b = begin; b < end; ++b) {
+			const size_t last = std::min((b + 1) * MEDIAN_QUANTIZE_BLOCK, job->size);
+			for (size_t i = b * MEDIAN_QUANTIZE_BLOCK; i < last; ++i) {
+				if (job->values) {
+					job->levels[i] = (unsigned short)(std::lower_bound(job->values->begin(), job->values->end(), job->src[i]) - job->values->begin());
+				}
+				else {
+					int l = (int)((job->src[i] - job->min) * job->scale);
+					job->levels[i] = (unsigned short)std::max(0, std::min(l, job->nlevels - 1));
+				}
+			}
+		}
+	}
+
+	// pixels per block of distinct_worker()
+	const size_t MEDIAN_DISTINCT_BLOCK = 1 << 20;
+
+	struct MedianDistinct
+	{
+		const float *src;
+		size_t size;
+		vector< vector<float> > ranges;	// the distinct values of each range, at its first block
+	};
+
+	// adds a sorted unique copy of each block to the distinct values of the range, until there are too many
+	void distinct_worker(size_t begin, size_t end, void *arg)
+	{
+		MedianDistinct *job = static_cast<MedianDistinct *>(arg);
+		vector<float> values, block, merged;
+		for (size_t b = begin; b < end && values.size() <= MEDIAN_MAX_LEVELS; ++b) {
+			block.assign(job->src + b * MEDIAN_DISTINCT_BLOCK, job->src + std::min((b + 1) * MEDIAN_DISTINCT_BLOCK, job->size));
+			std::sort(block.begin(), block.end());
+			block.erase(std::unique(block.begin(), block.end()), block.end());
+			merged.resize(values.size() + block.size());
+			merged.erase(std::set_union(values.begin(), values.end(), block.begin(), block.end(), merged.begin()), merged.end());
+			values.swap(merged);
+		}
+		job->ranges[begin].swap(values);
+	}
+
+	/* The sorted distinct values of src, for an exact histogram median. Blocks are sorted
+	 * in parallel; returns false as soon as there are more than MEDIAN_MAX_LEVELS.
+	 */
+	bool median_distinct(const float *src, size_t size, vector<float> &values)
+	{
+		MedianDistinct job;
+		job.src = src;
+		job.size = size;
+		job.ranges.resize((size + MEDIAN_DISTINCT_BLOCK - 1) / MEDIAN_DISTINCT_BLOCK);
+		Util::parallel_for(job.ranges.size(), distinct_worker, &job);
+
+		values.clear();
+		vector<float> merged;
+		for (size_t r = 0; r < job.ranges.size(); ++r) {
+			const vector<float> &v = job.ranges[r];
+			merged.resize(values.size() + v.size());
+			merged.erase(std::set_union(values.begin(), values.end(), v.begin(), v.end(), merged.begin()), merged.end());
+			values.swap(merged);
+			if (values.size() > MEDIAN_MAX_LEVELS) return false;
+		}
+		return true;
+	}
+}
+
+void BoxMedianProcessor::process_inplace(EMData * image)
+{
+	if (!image) {
+		LOGWARN("NULL Image");
+		return;
+	}
+
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+	int n = params.set_default("radius",1);
+	bool exact = params.set_default("exact",true);
+	int nlevels = params.set_default("levels",4096);
+	if (n < 0) throw InvalidValueException(n, "radius must be >= 0");
+	if (nlevels < 2 || (size_t)nlevels > MEDIAN_MAX_LEVELS) throw InvalidValueException(nlevels, "levels must be between 2 and 65536");
+
+	MedianRows job;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.radius = n;
+	job.zradius = nz > 1 ? n : 0;
+	job.nrows = ny - 2 * n;
+	job.z0 = job.zradius;
+	int nslices = nz - 2 * job.zradius;
+
+	if (job.nrows > 0 && nx > 2 * n && nslices > 0) {
+		float *data = image->get_data();
+		size_t size = (size_t)nx * ny * nz;
+		vector<float> src(data, data + size);
+
+		vector<float> values;
+		vector<unsigned short> levels;
+		MedianQuantize q;
+		q.src = &src[0];
+		q.size = size;
+		q.values = 0;
+		if (median_distinct(&src[0], size, values)) {		// few enough distinct values for a histogram
+			q.values = &values;
+		}
+		else if (!exact) {
+			q.min = image->get_attr("minimum");
+			float max = image->get_attr("maximum");
+			q.scale = nlevels / (max - q.min);
+			q.nlevels = nlevels;
+			values.resize(nlevels);
+			for (int l = 0; l < nlevels; ++l) values[l] = q.min + (l + 0.5f) / q.scale;
+		}
+		else {
+			values.clear();
+		}
+
+		job.src = &src[0];
+		job.des = data;
+		job.values = values.empty() ? 0 : &values[0];
+		job.nlevels = values.size();
+		job.levels = 0;
+		if (!values.empty()) {
+			levels.resize(size);
+			q.levels = &levels[0];
+			Util::parallel_for((size + MEDIAN_QUANTIZE_BLOCK - 1) / MEDIAN_QUANTIZE_BLOCK, quantize_worker, &q, 0, 16);
+			job.levels = &levels[0];
+		}
+
+		Util::parallel_for((size_t)job.nrows * nslices, job.levels ? median_histogram_worker : median_sort_worker,
+						   &job, 0, MEDIAN_MIN_ROWS);
+	}
+
+	image->update();
+	// We don't process pixels near the edge, so they will be "funny". Better to zero them ... I hope
+	if (nz>1) image->process_inplace("mask.zeroedge3d",Dict("x0",n,"y0",n,"z0",n));
+	else image->process_inplace("mask.zeroedge2d",Dict("x0",n,"y0",n));
+}
+
+namespace {
+	struct BoxSigmaSlices
+	{
+		float *des;
+		int nx, ny, nz;
+		int radius;
+		double count;		// pixels per box
+	};
+
+	void box_sigma_slice(int z, const double *sums, const double *sums2, void *arg)
+	{
+		const BoxSigmaSlices *job = static_cast<const BoxSigmaSlices *>(arg);
+		const int nx = job->nx, n = job->radius;
+		// only the pixels whose box is inside the image, as in BoxStatProcessor::process_inplace()
+		if (job->nz > 1 && (z < n || z >= job->nz - n)) return;
+
+		float *des = job->des + (size_t)z * nx * job->ny;
+		for (int y = n; y < job->ny - n; ++y) {
+			for (size_t i = (size_t)y * nx + n; i < (size_t)y * nx + nx - n; ++i) {
+				double mean = sums[i] / job->count;
+				des[i] = (float)sqrt(std::max(0.0, sums2[i] / job->count - mean * mean));
+			}
+		}
+	}
+}
+
+void BoxSigmaProcessor::process_inplace(EMData * image)
+{
+	if (!image) {
+		LOGWARN("NULL Image");
+		return;
+	}
+
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+	int n = params.set_default("radius",1);
+	if (n < 0) throw InvalidValueException(n, "radius must be >= 0");
+	int nzz = nz > 1 ? n : 0;
+
+	float *data = image->get_data();
+	vector<float> src(data, data + (size_t)nx * ny * nz);
+
+	BoxSigmaSlices job;
+	job.des = data;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.radius = n;
+	job.count = (double)(2 * n + 1) * (2 * n + 1) * (2 * nzz + 1);
+	Util::box_sums(&src[0], nx, ny, nz, -n, -n, -nzz, 2 * n + 1, 2 * n + 1, 2 * nzz + 1, true, box_sigma_slice, &job);
+
+	image->update();
+	// We don't process pixels near the edge, so they will be "funny". Better to zero them ... I hope
+	if (nz>1) image->process_inplace("mask.zeroedge3d",Dict("x0",n,"y0",n,"z0",n));
+	else image->process_inplace("mask.zeroedge2d",Dict("x0",n,"y0",n));
+}
+
 void DiffBlockProcessor::process_inplace(EMData * image)
 {
 	if (!image) {
@@ -2531,80 +2901,57 @@ EMData* MedianShrinkProcessor::process(const EMData *const image)
 	return ret;
 }
 
-void MedianShrinkProcessor::accrue_median(EMData* to, const EMData* const from,const int shrink_factor)
-{
-
-	int nx_old = from->get_xsize();
-	int ny_old = from->get_ysize();
-
-	int threed_shrink_factor = shrink_factor * shrink_factor;
-	int z_shrink_factor = 1;
-	if (from->get_zsize() > 1) {
-		threed_shrink_factor *= shrink_factor;
-		z_shrink_factor = shrink_factor;
-	}
-
-	float *mbuf = new float[threed_shrink_factor];
-
-
-	int nxy_old = nx_old * ny_old;
-
-	int nx = to->get_xsize();
-	int ny = to->get_ysize();
-	int nz = to->get_zsize();
-	int nxy_new = nx * ny;
-
-	float * rdata = to->get_data();
-	const float *const data_copy = from->get_const_data();
-
-	for (int l = 0; l < nz; l++) {
-		int l_min = l * shrink_factor;
-		int l_max = l * shrink_factor + z_shrink_factor;
-		size_t cur_l = (size_t)l * nxy_new;
-
-		for (int j = 0; j < ny; j++) {
-			int j_min = j * shrink_factor;
-			int j_max = (j + 1) * shrink_factor;
-			size_t cur_j = j * nx + cur_l;
+namespace {
+	// the output rows of MedianShrinkProcessor::accrue_median(), row r is y = r % ny, z = r / ny
+	struct MedianShrinkRows
+	{
+		const float *from;
+		float *to;
+		int nx_old, ny_old;
+		int nx, ny;
+		int shrink, zshrink;	// zshrink is 1 in 2D
+	};
+
+	void median_shrink_worker(size_t begin, size_t end, void *arg)
+	{
+		const MedianShrinkRows *job = static_cast<const MedianShrinkRows *>(arg);
+		const int shrink = job->shrink;
+		const size_t nxy_old = (size_t)job->nx_old * job->ny_old;
+		vector<float> mbuf(shrink * shrink * job->zshrink);
+		const size_t mid = mbuf.size() / 2;
 
-			for (int i = 0; i < nx; i++) {
-				int i_min = i * shrink_factor;
-				int i_max = (i + 1) * shrink_factor;
+		for (size_t r = begin; r < end; ++r) {
+			const int j = (int)(r % job->ny), l = (int)(r / job->ny);
+			float *to = job->to + r * job->nx;
 
+			for (int i = 0; i < job->nx; i++) {
 				size_t k = 0;
-				for (int l2 = l_min; l2 < l_max; l2++) {
-					size_t cur_l2 = l2 * nxy_old;
-
-					for (int j2 = j_min; j2 < j_max; j2++) {
-						size_t cur_j2 = j2 * nx_old + cur_l2;
-
-						for (int i2 = i_min; i2 < i_max; i2++) {
-							mbuf[k] = data_copy[i2 + cur_j2];
-							++k;
-						}
-					}
-				}
-
-				for (k = 0; k < size_t(threed_shrink_factor / 2 + 1); k++) {
-					for (int i2 = k + 1; i2 < threed_shrink_factor; i2++) {
-						if (mbuf[i2] < mbuf[k]) {
-							float f = mbuf[i2];
-							mbuf[i2] = mbuf[k];
-							mbuf[k] = f;
-						}
+				for (int l2 = l * shrink; l2 < l * shrink + job->zshrink; l2++) {
+					for (int j2 = j * shrink; j2 < (j + 1) * shrink; j2++) {
+						const float *p = job->from + (size_t)j2 * job->nx_old + l2 * nxy_old;
+						for (int i2 = i * shrink; i2 < (i + 1) * shrink; i2++) mbuf[k++] = p[i2];
 					}
 				}
-
-				rdata[i + cur_j] = mbuf[threed_shrink_factor / 2];
+				std::nth_element(mbuf.begin(), mbuf.begin() + mid, mbuf.end());
+				to[i] = mbuf[mid];
 			}
 		}
 	}
+}
 
-	if( mbuf )
-	{
-		delete[]mbuf;
-		mbuf = 0;
-	}
+void MedianShrinkProcessor::accrue_median(EMData* to, const EMData* const from,const int shrink_factor)
+{
+	MedianShrinkRows job;
+	job.from = from->get_const_data();
+	job.to = to->get_data();
+	job.nx_old = from->get_xsize();
+	job.ny_old = from->get_ysize();
+	job.nx = to->get_xsize();
+	job.ny = to->get_ysize();
+	job.shrink = shrink_factor;
+	job.zshrink = from->get_zsize() > 1 ? shrink_factor : 1;
+
+	Util::parallel_for((size_t)job.ny * to->get_zsize(), median_shrink_worker, &job, 0, 4);
 
 	to->scale_pixel((float)shrink_factor);
 }
@@ -4920,6 +5267,163 @@ void BinarizeFourierProcessor::process_inplace(EMData* image) {
 	EXITFUNC;
 }
 
+namespace {
+	const int BILATERAL_PAD = 2;	// empty cells around the grid, the radius of the blur
+	const size_t BILATERAL_MIN_LINES = 64;
+	const size_t BILATERAL_MAX_CELLS = (size_t)1 << 30;
+
+	/* A bilateral grid (Chen, Paris and Durand, SIGGRAPH 2007): the image lifted into
+	 * (x, y, z, value) space with one cell per distance_sigma in space and per value_sigma in
+	 * value. Each cell holds the sum of the values splatted into it and their number; blurring
+	 * the grid and reading it back at each voxel gives the bilateral filter, at a cost which
+	 * does not depend on distance_sigma.
+	 */
+	struct BilateralGrid
+	{
+		float *data;
+		int nx, ny, nz;
+		float spatial, range, vmin;	// cell sizes, and the value at range index 0
+		int gx, gy, gz, gr;
+		vector<float> cells;		// (sum, count) pairs, range index fastest
+		int axis;					// the axis being blurred: 0 range, 1 x, 2 y, 3 z
+	};
+
+	inline size_t grid_cell(const BilateralGrid *g, int x, int y, int z, int r)
+	{
+		return 2 * ((((size_t)z * g->gy + y) * g->gx + x) * g->gr + r);
+	}
+
+	inline int grid_index(float v, float cell)
+	{
+		return (int)floor(v / cell + 0.5f) + BILATERAL_PAD;
+	}
+
+	// splats the voxels which land in grid planes [begin, end): z planes in 3D, y rows in 2D
+	void bilateral_splat_worker(size_t begin, size_t end, void *arg)
+	{
+		BilateralGrid *g = static_cast<BilateralGrid *>(arg);
+		const bool is3d = g->nz > 1;
+		for (int z = 0; z < g->nz; ++z) {
+			const int cz = is3d ? grid_index((float)z, g->spatial) : 0;
+			if (is3d && (cz < (int)begin || cz >= (int)end)) continue;
+			for (int y = 0; y < g->ny; ++y) {
+				const int cy = grid_index((float)y, g->spatial);
+				if (!is3d && (cy < (int)begin || cy >= (int)end)) continue;
+				const float *row = g->data + ((size_t)z * g->ny + y) * g->nx;
+				for (int x = 0; x < g->nx; ++x) {
+					float *c = &g->cells[grid_cell(g, grid_index((float)x, g->spatial), cy, cz, grid_index(row[x] - g->vmin, g->range))];
+					c[0] += row[x];
+					c[1] += 1.0f;
+				}
+			}
+		}
+	}
+
+	// blurs lines of the grid along g->axis with the 5 tap binomial kernel, a gaussian of 1 cell
+	void bilateral_blur_worker(size_t begin, size_t end, void *arg)
+	{
+		BilateralGrid *g = static_cast<BilateralGrid *>(arg);
+		const int sizes[4] = { g->gr, g->gx, g->gy, g->gz };
+		const int n = sizes[g->axis];
+		size_t stride = 1;
+		for (int a = 0; a < g->axis; ++a) stride *= sizes[a];
+
+		vector<float> line(2 * (n + 2 * BILATERAL_PAD), 0.0f);
+		for (size_t l = begin; l < end; ++l) {
+			float *c = &g->cells[2 * (l % stride + l / stride * stride * n)];
+			for (int i = 0; i < n; ++i) {
+				line[2 * (i + BILATERAL_PAD)] = c[2 * i * stride];
+				line[2 * (i + BILATERAL_PAD) + 1] = c[2 * i * stride + 1];
+			}
+			for (int i = 0; i < n; ++i) {
+				const float *v = &line[2 * i];
+				for (int k = 0; k < 2; ++k) {
+					c[2 * i * stride + k] = (v[k] + 4.0f * v[k + 2] + 6.0f * v[k + 4] + 4.0f * v[k + 6] + v[k + 8]) / 16.0f;
+				}
+			}
+		}
+	}
+
+	// reads the grid back at each voxel of the planes [begin, end): z in 3D, y in 2D
+	void bilateral_slice_worker(size_t begin, size_t end, void *arg)
+	{
+		BilateralGrid *g = static_cast<BilateralGrid *>(arg);
+		const bool is3d = g->nz > 1;
+		const int z0 = is3d ? (int)begin : 0, z1 = is3d ? (int)end : 1;
+		const int y0 = is3d ? 0 : (int)begin, y1 = is3d ? g->ny : (int)end;
+		for (int z = z0; z < z1; ++z) {
+			const float fz = is3d ? z / g->spatial + BILATERAL_PAD : 0;
+			const int iz = (int)fz;
+			for (int y = y0; y < y1; ++y) {
+				const float fy = y / g->spatial + BILATERAL_PAD;
+				const int iy = (int)fy;
+				float *row = g->data + ((size_t)z * g->ny + y) * g->nx;
+				for (int x = 0; x < g->nx; ++x) {
+					const float fx = x / g->spatial + BILATERAL_PAD, fr = (row[x] - g->vmin) / g->range + BILATERAL_PAD;
+					const int ix = (int)fx, ir = (int)fr;
+					const float t[4] = { fr - ir, fx - ix, fy - iy, fz - iz };
+
+					// linear interpolation between the 16 (8 in 2D) surrounding cells
+					double sum = 0, count = 0;
+					for (int corner = 0; corner < (is3d ? 16 : 8); ++corner) {
+						float w = 1.0f;
+						for (int a = 0; a < 4; ++a) w *= (corner >> a & 1) ? t[a] : 1.0f - t[a];
+						const float *c = &g->cells[grid_cell(g, ix + (corner >> 1 & 1), iy + (corner >> 2 & 1), iz + (corner >> 3 & 1), ir + (corner & 1))];
+						sum += w * c[0];
+						count += w * c[1];
+					}
+					if (count > 0) row[x] = (float)(sum / count);
+				}
+			}
+		}
+	}
+
+	/* The bilateral filter through a bilateral grid, with a gaussian range kernel. Each
+	 * step is split between Util::get_num_threads() threads.
+	 */
+	void bilateral_grid_filter(EMData *image, float distance_sigma, float value_sigma, int niter)
+	{
+		if (distance_sigma <= 0) throw InvalidValueException(distance_sigma, "distance_sigma must be positive");
+		if (value_sigma <= 0) throw InvalidValueException(value_sigma, "value_sigma must be positive");
+
+		BilateralGrid g;
+		g.data = image->get_data();
+		g.nx = image->get_xsize();
+		g.ny = image->get_ysize();
+		g.nz = image->get_zsize();
+		g.spatial = distance_sigma;
+		g.range = value_sigma;
+		const size_t size = (size_t)g.nx * g.ny * g.nz;
+		const bool is3d = g.nz > 1;
+
+		// two cells more than the last index, since the slicing reads index + 1
+		g.gx = grid_index((float)(g.nx - 1), g.spatial) + BILATERAL_PAD + 2;
+		g.gy = grid_index((float)(g.ny - 1), g.spatial) + BILATERAL_PAD + 2;
+		g.gz = is3d ? grid_index((float)(g.nz - 1), g.spatial) + BILATERAL_PAD + 2 : 1;
+
+		for (int iter = 0; iter < niter; ++iter) {
+			g.vmin = *std::min_element(g.data, g.data + size);
+			const float vmax = *std::max_element(g.data, g.data + size);
+			g.gr = grid_index(vmax - g.vmin, g.range) + BILATERAL_PAD + 2;
+
+			const size_t ncells = (size_t)g.gx * g.gy * g.gz * g.gr;
+			if (ncells > BILATERAL_MAX_CELLS) {
+				throw InvalidValueException((float)ncells, "bilateral grid too large, increase distance_sigma or value_sigma");
+			}
+			g.cells.assign(2 * ncells, 0.0f);
+
+			Util::parallel_for(is3d ? g.gz : g.gy, bilateral_splat_worker, &g, 0, 1);
+			for (g.axis = 0; g.axis < (is3d ? 4 : 3); ++g.axis) {
+				const int sizes[4] = { g.gr, g.gx, g.gy, g.gz };
+				Util::parallel_for(ncells / sizes[g.axis], bilateral_blur_worker, &g, 0, BILATERAL_MIN_LINES);
+			}
+			Util::parallel_for(is3d ? g.nz : g.ny, bilateral_slice_worker, &g, 0, 1);
+		}
+
+		image->update();
+	}
+}
+
 void BilateralProcessor::process_inplace(EMData * image)
 {
 	if (!image) {
@@ -4930,6 +5434,12 @@ void BilateralProcessor::process_inplace(EMData * image)
 	float distance_sigma = params["distance_sigma"];
 	float value_sigma = params["value_sigma"];
 	int max_iter = params["niter"];
+
+	if (params.set_default("grid", false)) {
+		bilateral_grid_filter(image, distance_sigma, value_sigma, max_iter);
+		return;
+	}
+
 	int half_width = params["half_width"];
 
 	if (half_width < distance_sigma) {
@@ -6836,96 +7346,331 @@ void AddMaskShellProcessor::process_inplace(EMData * image)
 	image->update();
 }
 
-void SegmentSubunitProcessor::process_inplace(EMData * image)
-{
-	if (!image) {
-		LOGWARN("NULL Image");
-		return;
+namespace {
+	const int FLOOD_LEVELS = 65536;				// density quantization of the bucket queue
+	const unsigned short FLOOD_QUEUED = 65535;	// label store value of a voxel waiting in the queue
+	const int FLOOD_TILE = 32;					// edge of a block of the tiled label store
+
+	inline int highest_bit(unsigned long long w)
+	{
+		int b = 0;
+		if (w >> 32) { w >>= 32; b += 32; }
+		if (w >> 16) { w >>= 16; b += 16; }
+		if (w >> 8) { w >>= 8; b += 8; }
+		if (w >> 4) { w >>= 4; b += 4; }
+		if (w >> 2) { w >>= 2; b += 2; }
+		if (w >> 1) b += 1;
+		return b;
 	}
 
-	float thr = params["thr"];
-	string symname=(string)params["sym"];
-	Symmetry3D* sym = Factory<Symmetry3D>::get(symname);
-	
-	int nx = image->get_xsize();
-	int ny = image->get_ysize();
-	int nz = image->get_zsize();
+	struct FloodEntry
+	{
+		size_t index;
+		size_t order;	// of the push, so equal densities pop most recent first
+	};
 
-	if (ny == 1 || nz==1) {
-		LOGERR("Error: segment.subunit works only in 3-D");
-		return;
-	}
+	// orders the entries of a level by exact density, then by order
+	struct FloodOrder
+	{
+		const float *data;
 
-	// there are other strategies which might allow us to avoid the extra copy, but this will have to do for now
-	EMData *image1=new EMData(nx,ny,nz);
-	image1->to_zero();
-	EMData *image2=image->copy();
-	
-	// We're using image2 here temporarily to seed image1. We will reinitialize it when done
-	image2->process_inplace("mask.sharp",Dict("inner_radius",(int)nz/5));		// we don't want to seed too close to the middle
-	IntPoint ml=image2->calc_max_location();		// highest pixel value, now we symmetrize
+		FloodOrder(const float *data) : data(data) {}
 
-	// Seed the multi-level mask
-	int i=0;
-	vector<Transform> transforms = sym->get_syms();
-	for(vector<Transform>::const_iterator trans_it = transforms.begin(); trans_it != transforms.end(); trans_it++) {
-		Transform t = *trans_it;
-		i++;
-		Vec3f xf = t.transform(ml[0]-nx/2,ml[1]-ny/2,ml[2]-nz/2);
-		image1->set_value_at((int)(xf[0]+nx/2),(int)(xf[1]+ny/2),(int)(xf[2]+nz/2),(float)i);
-	}
-	memcpy(image2->get_data(),image1->get_data(),image1->get_size()*sizeof(float)); // copy the seed from image 1 to image 2
-	
-	
-		
-	// We progressively lower the threshold, sort of like a very coarse watershed
-	float max=(float)image->get_attr("maximum");
-	float gap=max-thr;
-	if (gap<=0) throw InvalidParameterException("SegmentSubunitProcessor: threshold must be < max value");
-		
-	for (int ti=0; ti<12; ti++) {
-		float thr2=max-(ti+1)*gap/12.0;
-		printf("threshold %1.4f\n",thr2);
-		int change=1;
-		while (change) {
-			change=0;
-			for (int z = 1; z < nz - 1; z++) {
-				for (int y = 1; y < ny - 1; y++) {
-					for (int x = 1; x < nx - 1; x++) {
-						// Skip the voxel if already part of a mask or if below threshold
-						if (image1->get_value_at(x,y,z)>0 || image->get_value_at(x,y,z)<thr2) continue;
+		bool operator()(const FloodEntry &a, const FloodEntry &b) const
+		{
+			const float va = data[a.index], vb = data[b.index];
+			return va < vb || (va == vb && a.order < b.order);
+		}
+	};
+
+	/* Priority queue of voxel indices by density. The density is quantized to FLOOD_LEVELS steps
+	 * between low and high, and a three level bitmap of the nonempty levels finds the highest one
+	 * in three word scans. Each level is a heap on the exact density, so an outlier which squeezes
+	 * the rest of the map into a few levels costs time, not order. Levels release their memory
+	 * when they drain, so only the current flood front is held.
+	 */
+	class BucketQueue
+	{
+	  public:
+		BucketQueue(const float *data, float low, float high) :
+			buckets(FLOOD_LEVELS), order(data), count(0), top(0), low(low)
+		{
+			scale = high > low ? (FLOOD_LEVELS - 1) / (high - low) : 0;
+			std::fill(bits, bits + FLOOD_LEVELS / 64, 0ULL);
+			std::fill(groups, groups + FLOOD_LEVELS / 4096, 0ULL);
+		}
 
-						// Note that this produces a directional bias in the case of ambiguous pixels
-						// While this could be improved upon slightly, there can be truly ambiguous cases
-						// and at least this method is deterministic
-						if		(image1->get_value_at(x-1,y,z)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x-1,y,z)); change=1; }
-						else if (image1->get_value_at(x+1,y,z)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x+1,y,z)); change=1; }
-						else if (image1->get_value_at(x,y-1,z)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x,y-1,z)); change=1; }
-						else if (image1->get_value_at(x,y+1,z)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x,y+1,z)); change=1; }
-						else if (image1->get_value_at(x,y,z-1)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x,y,z-1)); change=1; }
-						else if (image1->get_value_at(x,y,z+1)>0) { image2->set_value_at_fast(x,y,z,image1->get_value_at(x,y,z+1)); change=1; }
+		void push(size_t i)
+		{
+			int b = (int)((order.data[i] - low) * scale);
+			if (b < 0) b = 0;
+			else if (b >= FLOOD_LEVELS) b = FLOOD_LEVELS - 1;
 
+			vector<FloodEntry> &bucket = buckets[b];
+			FloodEntry e = { i, count++ };
+			bucket.push_back(e);
+			std::push_heap(bucket.begin(), bucket.end(), order);
+			bits[b >> 6] |= 1ULL << (b & 63);
+			groups[b >> 12] |= 1ULL << ((b >> 6) & 63);
+			top |= 1ULL << (b >> 12);
+		}
+
+		// the densest voxel, false when empty
+		bool pop(size_t &i)
+		{
+			if (!top) return false;
+			const int g = highest_bit(top);
+			const int w = (g << 6) | highest_bit(groups[g]);
+			const int b = (w << 6) | highest_bit(bits[w]);
+
+			vector<FloodEntry> &bucket = buckets[b];
+			std::pop_heap(bucket.begin(), bucket.end(), order);
+			i = bucket.back().index;
+			bucket.pop_back();
+			if (bucket.empty()) {
+				vector<FloodEntry>().swap(bucket);
+				bits[w] &= ~(1ULL << (b & 63));
+				if (!bits[w]) {
+					groups[g] &= ~(1ULL << (w & 63));
+					if (!groups[g]) top &= ~(1ULL << g);
+				}
+			}
+			return true;
+		}
+
+	  private:
+		vector< vector<FloodEntry> > buckets;
+		FloodOrder order;
+		size_t count;
+		unsigned long long bits[FLOOD_LEVELS / 64];
+		unsigned long long groups[FLOOD_LEVELS / 4096];
+		unsigned long long top;
+		float low, scale;
+	};
+
+	// one label per voxel, addressed by the linear index
+	class DenseLabels
+	{
+	  public:
+		DenseLabels(int nx, int ny, int nz) : labels((size_t)nx * ny * nz, 0) {}
+
+		unsigned short get(size_t i, int, int, int) const { return labels[i]; }
+		void set(size_t i, int, int, int, unsigned short l) { labels[i] = l; }
+
+	  private:
+		vector<unsigned short> labels;
+	};
+
+	/* labels in FLOOD_TILE^3 blocks, allocated the first time one of their voxels is queued,
+	 * so the parts of the map the flood never reaches cost nothing
+	 */
+	class TiledLabels
+	{
+	  public:
+		TiledLabels(int nx, int ny, int nz) :
+			tx((nx + FLOOD_TILE - 1) / FLOOD_TILE), ty((ny + FLOOD_TILE - 1) / FLOOD_TILE),
+			tiles((size_t)tx * ty * ((nz + FLOOD_TILE - 1) / FLOOD_TILE)) {}
+
+		unsigned short get(size_t, int x, int y, int z) const
+		{
+			const vector<unsigned short> &t = tiles[tile(x, y, z)];
+			return t.empty() ? 0 : t[offset(x, y, z)];
+		}
+
+		void set(size_t, int x, int y, int z, unsigned short l)
+		{
+			vector<unsigned short> &t = tiles[tile(x, y, z)];
+			if (t.empty()) {
+				if (l == 0) return;
+				t.assign(FLOOD_TILE * FLOOD_TILE * FLOOD_TILE, 0);
+			}
+			t[offset(x, y, z)] = l;
+		}
+
+	  private:
+		size_t tile(int x, int y, int z) const
+		{
+			return x / FLOOD_TILE + (y / FLOOD_TILE + (size_t)(z / FLOOD_TILE) * ty) * tx;
+		}
+
+		static int offset(int x, int y, int z)
+		{
+			return x % FLOOD_TILE + (y % FLOOD_TILE + z % FLOOD_TILE * FLOOD_TILE) * FLOOD_TILE;
+		}
+
+		int tx, ty;
+		vector< vector<unsigned short> > tiles;
+	};
+
+	struct FloodNeighbours
+	{
+		int n;
+		int dx[26], dy[26], dz[26];
+		ptrdiff_t offset[26];
+
+		// the 6 face neighbours, or all 26
+		FloodNeighbours(int connectivity, int nx, int ny) : n(0)
+		{
+			for (int z = -1; z <= 1; z++) {
+				for (int y = -1; y <= 1; y++) {
+					for (int x = -1; x <= 1; x++) {
+						int d = abs(x) + abs(y) + abs(z);
+						if (d == 0 || (connectivity == 6 && d > 1)) continue;
+						dx[n] = x; dy[n] = y; dz[n] = z;
+						offset[n] = x + ((ptrdiff_t)y + (ptrdiff_t)z * ny) * nx;
+						n++;
 					}
 				}
 			}
-			memcpy(image1->get_data(),image2->get_data(),image1->get_size()*sizeof(float));
 		}
-// 		char fs[20];
-// 		sprintf(fs,"lvl%d.hdf",ti);
-// 		image1->write_image(fs);
+	};
+
+	/* Seeded priority flood behind segment.watershed and segment.subunit. Voxels >= thr inside
+	 * the 1 voxel border are visited in decreasing density. Each takes the largest label among
+	 * its labeled neighbours. One without any starts a new segment while there are fewer than
+	 * maxseg, and otherwise is dropped until the flood reaches it from a neighbour. The queue
+	 * starts with the voxels next to the labels already in the store and, if maxima is set,
+	 * the local maxima, one per plateau. nseg is the number of labels in use, before and after.
+	 */
+	template <class Labels>
+	void priority_flood(const EMData *image, Labels &labels, float thr, int connectivity,
+						bool maxima, int &nseg, int maxseg, bool verbose)
+	{
+		const int nx = image->get_xsize(), ny = image->get_ysize(), nz = image->get_zsize();
+		const size_t nxy = (size_t)nx * ny;
+		const float *data = image->get_const_data();
+		const FloodNeighbours nb(connectivity, nx, ny);
+		BucketQueue queue(data, thr, image->get_attr("maximum"));
+
+		size_t nqueued = 0;
+		for (int z = 1; z < nz - 1; z++) {
+			for (int y = 1; y < ny - 1; y++) {
+				for (int x = 1; x < nx - 1; x++) {
+					size_t i = x + y * (size_t)nx + z * nxy;
+					float v = data[i];
+					if (v < thr || labels.get(i, x, y, z)) continue;
+
+					bool labeled = false, highest = maxima;
+					for (int k = 0; k < nb.n; k++) {
+						int xx = x + nb.dx[k], yy = y + nb.dy[k], zz = z + nb.dz[k];
+						size_t j = i + nb.offset[k];
+						unsigned short l = labels.get(j, xx, yy, zz);
+						if (l && l != FLOOD_QUEUED) { labeled = true; break; }
+						if (!highest) continue;
+						// the border is never segmented, so it does not count against a maximum
+						if (xx > 0 && xx < nx - 1 && yy > 0 && yy < ny - 1 && zz > 0 && zz < nz - 1 && data[j] > v) highest = false;
+						// the rest of a plateau is reached by the flood from the maximum queued first
+						else if (l == FLOOD_QUEUED && data[j] == v) highest = false;
+					}
+					if (labeled || highest) {
+						labels.set(i, x, y, z, FLOOD_QUEUED);
+						queue.push(i);
+						nqueued++;
+					}
+				}
+			}
+		}
+		if (verbose) printf("%ld voxels queued, starting flood\n", (long)nqueued);
+
+		bool seeding = nseg < maxseg;
+		size_t i;
+		while (queue.pop(i)) {
+			const int z = (int)(i / nxy), y = (int)(i % nxy / nx), x = (int)(i % nx);
+
+			unsigned short lvl = 0;
+			for (int k = 0; k < nb.n; k++) {
+				unsigned short l = labels.get(i + nb.offset[k], x + nb.dx[k], y + nb.dy[k], z + nb.dz[k]);
+				if (l != FLOOD_QUEUED && l > lvl) lvl = l;	// use the highest numbered border segment (arbitrary)
+			}
+			if (lvl == 0) {
+				if (nseg >= maxseg) {
+					if (seeding && verbose) printf("Requested number of segments achieved at density %1.4g\n", data[i]);
+					seeding = false;
+					labels.set(i, x, y, z, 0);		// the flood will queue it again from a labeled neighbour
+					continue;
+				}
+				lvl = (unsigned short)++nseg;
+				if (verbose) printf("%d %d %d\t%d\t%1.3g\n", x, y, z, nseg, data[i]);
+			}
+			labels.set(i, x, y, z, lvl);
+
+			for (int k = 0; k < nb.n; k++) {
+				int xx = x + nb.dx[k], yy = y + nb.dy[k], zz = z + nb.dz[k];
+				size_t j = i + nb.offset[k];
+				if (xx < 1 || xx >= nx - 1 || yy < 1 || yy >= ny - 1 || zz < 1 || zz >= nz - 1) continue;
+				if (data[j] < thr || labels.get(j, xx, yy, zz)) continue;
+				labels.set(j, xx, yy, zz, FLOOD_QUEUED);
+				queue.push(j);
+			}
+		}
 	}
-	
-// 	image1->write_image("multilev.hdf");
-// 	image1->process_inplace("threshold.abovetozero",Dict("maxval",(float)1.01f));
-// 	image->mult(*image1);
 
-	// our final return value is the multilevel mask
-	memcpy(image->get_data(),image1->get_data(),image1->get_size()*sizeof(float));
+	// replaces the image with the labels
+	template <class Labels>
+	void write_labels(EMData *image, const Labels &labels)
+	{
+		const int nx = image->get_xsize(), ny = image->get_ysize(), nz = image->get_zsize();
+		float *data = image->get_data();
+		size_t i = 0;
+		for (int z = 0; z < nz; z++) {
+			for (int y = 0; y < ny; y++) {
+				for (int x = 0; x < nx; x++, i++) data[i] = labels.get(i, x, y, z);
+			}
+		}
+		image->update();
+	}
+}
+
+void SegmentSubunitProcessor::process_inplace(EMData * image)
+{
+	if (!image) {
+		LOGWARN("NULL Image");
+		return;
+	}
+
+	float thr = params["thr"];
+	string symname=(string)params["sym"];
+	Symmetry3D* sym = Factory<Symmetry3D>::get(symname);
 	
-	delete image1;
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+
+	if (ny == 1 || nz==1) {
+		LOGERR("Error: segment.subunit works only in 3-D");
+		return;
+	}
+
+	float max=(float)image->get_attr("maximum");
+	if (max-thr<=0) throw InvalidParameterException("SegmentSubunitProcessor: threshold must be < max value");
+
+	EMData *image2=image->copy();
+	image2->process_inplace("mask.sharp",Dict("inner_radius",(int)nz/5));		// we don't want to seed too close to the middle
+	IntPoint ml=image2->calc_max_location();		// highest pixel value, now we symmetrize
 	delete image2;
+
+	// Seed the multi-level mask
+	DenseLabels labels(nx,ny,nz);
+	int i=0;
+	vector<Transform> transforms = sym->get_syms();
+	if (transforms.size()>=FLOOD_QUEUED) throw InvalidParameterException("SegmentSubunitProcessor: too many symmetry operations");
+	for(vector<Transform>::const_iterator trans_it = transforms.begin(); trans_it != transforms.end(); trans_it++) {
+		Transform t = *trans_it;
+		i++;
+		Vec3f xf = t.transform(ml[0]-nx/2,ml[1]-ny/2,ml[2]-nz/2);
+		int x=(int)(xf[0]+nx/2), y=(int)(xf[1]+ny/2), z=(int)(xf[2]+nz/2);
+		if (x<0 || x>=nx || y<0 || y>=ny || z<0 || z>=nz) continue;
+		labels.set(x+(size_t)y*nx+(size_t)z*nx*ny,x,y,z,(unsigned short)i);
+	}
+
+	// Grow the seeds down to the threshold in order of decreasing density, a watershed without new segments.
+	// Ambiguous voxels go to the highest numbered neighbouring subunit, which is arbitrary but deterministic
+	priority_flood(image,labels,thr,6,false,i,i,false);
+
+	// our final return value is the multilevel mask
+	write_labels(image,labels);
+
 	delete sym;
-	image->update();
 }
 
 
@@ -7538,6 +8283,60 @@ void StripeXYProcessor::process_inplace(EMData * image)
 }
 
 
+namespace {
+	struct LocalNormBoxes
+	{
+		float *data;		// multiplied by the normalization
+		float *fraction;	// of each box above the threshold, from the first pass
+		int nx, ny, nz;
+		int radius, zradius;
+	};
+
+	// the number of pixels of the box of (x, y, z) clipped to the image, along one axis
+	inline int clipped_box(int x, int r, int n)
+	{
+		return std::min(x + r + 1, n) - std::max(x - r, 0);
+	}
+
+	// the first pass: the fraction of each box above the threshold, which is 0 below 0.001
+	void local_norm_fraction_slice(int z, const double *sums, const double *, void *arg)
+	{
+		const LocalNormBoxes *job = static_cast<const LocalNormBoxes *>(arg);
+		const int nx = job->nx, ny = job->ny;
+		float *fraction = job->fraction + (size_t)z * nx * ny;
+		const int cz = clipped_box(z, job->zradius, job->nz);
+
+		for (int y = 0; y < ny; ++y) {
+			const int cyz = cz * clipped_box(y, job->radius, ny);
+			for (int x = 0; x < nx; ++x) {
+				size_t i = x + (size_t)y * nx;
+				float f = (float)(sums[i] / (cyz * clipped_box(x, job->radius, nx)));
+				fraction[i] = f < 0.001f ? 0 : f;
+			}
+		}
+	}
+
+	// the second pass: data times fraction over the mean of the box, as the Gaussian version
+	void local_norm_scale_slice(int z, const double *sums, const double *, void *arg)
+	{
+		const LocalNormBoxes *job = static_cast<const LocalNormBoxes *>(arg);
+		const int nx = job->nx, ny = job->ny;
+		const size_t offset = (size_t)z * nx * ny;
+		const int cz = clipped_box(z, job->zradius, job->nz);
+
+		for (int y = 0; y < ny; ++y) {
+			const int cyz = cz * clipped_box(y, job->radius, ny);
+			for (int x = 0; x < nx; ++x) {
+				size_t i = x + (size_t)y * nx;
+				float mean = (float)(sums[i] / (cyz * clipped_box(x, job->radius, nx)));
+				float f = job->fraction[offset + i];
+				// EMData::div() leaves the pixels divided by 0 unchanged
+				job->data[offset + i] *= mean != 0 ? f / mean : f;
+			}
+		}
+	}
+}
+
 void LocalNormProcessor::process_inplace(EMData * image)
 {
 	if (!image) {
@@ -7547,6 +8346,32 @@ void LocalNormProcessor::process_inplace(EMData * image)
 	float apix = params["apix"];
 	float threshold = params["threshold"];
 	float radius = params["radius"];
+	int boxradius = params.set_default("boxradius",0);
+
+	if (boxradius > 0) {
+		LocalNormBoxes job;
+		job.nx = image->get_xsize();
+		job.ny = image->get_ysize();
+		job.nz = image->get_zsize();
+		job.radius = boxradius;
+		job.zradius = job.nz > 1 ? boxradius : 0;
+		const size_t size = (size_t)job.nx * job.ny * job.nz;
+		const int box = 2 * boxradius + 1, zbox = 2 * job.zradius + 1;
+
+		// the same masks as threshold.binary and threshold.belowtozero
+		job.data = image->get_data();
+		vector<float> masked(size), fraction(size);
+		for (size_t i = 0; i < size; ++i) masked[i] = job.data[i] >= threshold ? 1.0f : 0.0f;
+		job.fraction = &fraction[0];
+		Util::box_sums(&masked[0], job.nx, job.ny, job.nz, -boxradius, -boxradius, -job.zradius, box, box, zbox,
+					   false, local_norm_fraction_slice, &job);
+
+		for (size_t i = 0; i < size; ++i) masked[i] = job.data[i] < threshold ? 0.0f : job.data[i];
+		Util::box_sums(&masked[0], job.nx, job.ny, job.nz, -boxradius, -boxradius, -job.zradius, box, box, zbox,
+					   false, local_norm_scale_slice, &job);
+		image->update();
+		return;
+	}
 
 	if (apix > 0) {
 		int ny = image->get_ysize();
@@ -8006,20 +8831,25 @@ void AutoMask3DProcessor::process_inplace(EMData * image)
 	float thr1 = params.set_default("threshold1",mean + sig * 2);
 	float thr2 = params.set_default("threshold2",mean + sig * 1);
 	
+	// keep the blobs above threshold2 which reach threshold1 somewhere
+	int nx = image->get_xsize();
+	int ny = image->get_ysize();
+	int nz = image->get_zsize();
+	size_t size = (size_t)nx*ny*nz;
+
 	EMData *mask=image->copy();
-	mask->process_inplace("threshold.binary",Dict("value",thr1));
-	
-	EMData *mask2=image->copy();
-	mask2->process_inplace("threshold.binary",Dict("value",thr2));
-	float maskmean=mask->get_attr("mean");
-	for (int i=0; i<1000; i++){
-		mask->process_inplace("mask.addshells",Dict("nshells",2));
-		mask->mult(*mask2);
-		if (float(mask->get_attr("mean"))==maskmean) 
-			break;
-		maskmean=mask->get_attr("mean");
-// 		printf("%d\t%f\n", i, maskmean);
+	mask->process_inplace("threshold.binary",Dict("value",thr2));
+	vector<int> labels(size);
+	vector<Util::Component> blobs=Util::label_components(mask->get_const_data(),&labels[0],nx,ny,nz,0.5f,18);
+
+	const float *src=image->get_const_data();
+	vector<float> seeded(blobs.size()+1,0.0f);
+	for (size_t i=0; i<size; i++) {
+		if (labels[i] && src[i]>=thr1) seeded[labels[i]]=1.0f;
 	}
+	float *m=mask->get_data();
+	for (size_t i=0; i<size; i++) m[i]=seeded[labels[i]];
+	mask->update();
 	
 	
 	// below copied from mask.auto3d
@@ -8043,11 +8873,8 @@ void AutoMask3DProcessor::process_inplace(EMData * image)
 	}
 
 	delete mask;
-	delete mask2;
 }
 
-// Originally this was done recursively, but there were issues with exceeding the maximum recursion depth,
-// so switched to a vector-style algorithm instead
 void AutoMaskDustProcessor::process_inplace(EMData * imagein)
 {
 	if (!imagein) {
@@ -8064,51 +8891,24 @@ void AutoMaskDustProcessor::process_inplace(EMData * imagein)
 	unsigned int voxels=params.set_default("voxels",27);
 	float threshold=params.set_default("threshold",1.5);
 
-	mask = new EMData();
-	mask->set_size(nx, ny, nz);
-	mask->to_one();
-
-	for (int zz = 0; zz < nz; zz++) {
-		for (int yy = 0; yy < ny; yy++) {
-			for (int xx = 0; xx < nx; xx++) {
-				if (image->get_value_at(xx,yy,zz)>threshold && mask->get_value_at(xx,yy,zz)==1.0) {
-					vector<Vec3i> pvec;
-					pvec.push_back(Vec3i(xx,yy,zz));
-					for (uint i=0; i<pvec.size(); i++) {
-						// Duplicates will occur the way the algorithm is constructed, so we eliminate them as we encounter them
-						if (mask->sget_value_at(pvec[i])==0.0f) {
-							pvec.erase(pvec.begin()+i);
-							i--;
-							continue;
-						}
-
-						// mask out the points in the volume
-						mask->set_value_at(pvec[i],0.0f);
-
-						int x=pvec[i][0];
-						int y=pvec[i][1];
-						int z=pvec[i][2];
-						// Any neighboring values above threshold we haven't already set get added to the list
-						if (image->sget_value_at(x-1,y,z)>threshold && mask->get_value_at(x-1,y,z)==1.0) pvec.push_back(Vec3i(x-1,y,z));
-						if (image->sget_value_at(x+1,y,z)>threshold && mask->get_value_at(x+1,y,z)==1.0) pvec.push_back(Vec3i(x+1,y,z));
-						if (image->sget_value_at(x,y-1,z)>threshold && mask->get_value_at(x,y-1,z)==1.0) pvec.push_back(Vec3i(x,y-1,z));
-						if (image->sget_value_at(x,y+1,z)>threshold && mask->get_value_at(x,y+1,z)==1.0) pvec.push_back(Vec3i(x,y+1,z));
-						if (image->sget_value_at(x,y,z-1)>threshold && mask->get_value_at(x,y,z-1)==1.0) pvec.push_back(Vec3i(x,y,z-1));
-						if (image->sget_value_at(x,y,z+1)>threshold && mask->get_value_at(x,y,z+1)==1.0) pvec.push_back(Vec3i(x,y,z+1));
-					}
+	// the 6-connected blobs above threshold, of which the small ones are masked out
+	size_t size = (size_t)nx*ny*nz;
+	vector<int> labels(size);
+	vector<Util::Component> blobs=Util::label_components(image->get_const_data(),&labels[0],nx,ny,nz,threshold,6);
 
-					// If the blob is too big, then we don't mask it out after all, but we set the value
-					// to 2.0 so we know the voxels have already been examined, and don't check them again
-					if (pvec.size()>voxels) {
-						if (verbose) printf("%d\t%d\t%d\tvoxels: %d\n",xx,yy,zz,(int)pvec.size());
-						for (uint i=0; i<pvec.size(); i++) mask->set_value_at(pvec[i],2.0);
-					}
-				}
-			}
+	vector<float> keep(blobs.size()+1,1.0f);
+	for (size_t i=0; i<blobs.size(); i++) {
+		if (blobs[i].voxels>voxels) {
+			if (verbose) printf("%d\t%d\t%d\tvoxels: %d\n",blobs[i].min[0],blobs[i].min[1],blobs[i].min[2],(int)blobs[i].voxels);
 		}
+		else keep[i+1]=0.0f;
 	}
 
-	mask->process_inplace("threshold.binary",Dict("value",0.5));
+	mask = new EMData();
+	mask->set_size(nx, ny, nz);
+	float *m = mask->get_data();
+	for (size_t i=0; i<size; i++) m[i]=keep[labels[i]];
+	mask->update();
 
 	// Now we expand the mask by 1 pixel and blur the edge
 	mask->mult(-1.0f);
@@ -8203,24 +9003,27 @@ void AutoMask3D2Processor::process_inplace(EMData * image)
 	}
 
 
-	// iteratively 'flood fills' the map... recursion would be better
-	int done=0;
-	int iter=0;
-	while (!done) {
-		iter++;
-		done=1;
-		if (verbose && iter%10==0) printf("%d iterations\n",iter);
-		for (k=1; k<nz-1; ++k) {
-			for (j=1; j<ny-1; ++j) {
-				for (i=1; i<nx-1; ++i) {
-					l=i+j*nx+k*nx*ny;
-					if (dat2[l]) continue;
-					if (dat[l]>threshold && (dat2[l-1]||dat2[l+1]||dat2[l+nx]||dat2[l-nx]||dat2[l-nxy]||dat2[l+nxy])) {
-						dat2[l]=1.0;
-						done=0;
-					}
-				}
-			}
+	// 'flood fills' the map from the seeds: interior voxels above threshold which are
+	// 6-connected to a seed. Each voxel enters the frontier once, when it is set.
+	size_t size = (size_t)nx*ny*nz;
+	vector<size_t> frontier;
+	for (l=0; l<size; ++l) {
+		if (dat2[l]) frontier.push_back(l);
+	}
+
+	const int di[6] = { -1, 1, 0, 0, 0, 0 }, dj[6] = { 0, 0, -1, 1, 0, 0 }, dk[6] = { 0, 0, 0, 0, -1, 1 };
+	while (!frontier.empty()) {
+		l=frontier.back();
+		frontier.pop_back();
+		for (int m=0; m<6; ++m) {
+			i=(int)(l%nx)+di[m];
+			j=(int)(l/nx%ny)+dj[m];
+			k=(int)(l/nxy)+dk[m];
+			if (i<1 || i>nx-2 || j<1 || j>ny-2 || k<1 || k>nz-2) continue;
+			size_t n=i+(size_t)j*nx+(size_t)k*nxy;
+			if (dat2[n] || !(dat[n]>threshold)) continue;
+			dat2[n]=1.0;
+			frontier.push_back(n);
 		}
 	}
 
@@ -8260,47 +9063,41 @@ void IterBinMaskProcessor::process_inplace(EMData * image)
 
 	float val1 = params["val1"];
 	float val2 = params["val2"];
+	bool euclidean = params.set_default("euclidean", false);
 
 	int nx = image->get_xsize();
 	int ny = image->get_ysize();
 	int nz = image->get_zsize();
-	EMData *image2 = new EMData(nx,ny,nz);
-
-	// Got a compile warning complaining that these things were never used. Hope I didn't break anything - apologies if so (d.woolford)
-//	float *dat = image->get_data();
-//	float *dat2 = image2->get_data();
-
 
 	float *d = image->get_data();
-	float *d2 = image2->get_data();
-
-	const int nxy = nx * ny;
 	size_t size = (size_t)nx * ny * nz;
 
-	// TODO: THIS IS EXTREMELY INEFFICIENT
-	if (nz != 1) {
-		for (int l = 1; l <= (int) val1+val2; ++l) {
-			for (size_t i=0; i<size; i++) d2[i]=d[i];
-			for (int k = 1; k < nz - 1; ++k) {
-				for (int j = 1; j < ny - 1; ++j) {
-					for (int i = 1; i < nx - 1; ++i) {
-						size_t t = i + j*nx+(size_t)k*nx*ny;
-						if (d[t]) continue;
-						if (d2[t - 1] || d2[t + 1] || d2[t + nx] || d2[t - nx] || d2[t + nxy] || d2[t - nxy]) d[t] = (float) l + 1;
-					}
-				}
+	// The shells grow through the interior only (not the outermost layer of pixels), so in
+	// the city-block case a nonzero pixel on an edge or corner of the box, which has no
+	// interior neighbour, never seeds anything. Shell l is then every zero interior pixel
+	// at distance l from the mask, found all at once from one distance map.
+	vector<float> dist(d, d + size);
+	const bool is3d = (nz != 1);
+	if (!euclidean) {
+		for (int k = 0; k < nz; ++k) {
+			for (int j = 0; j < ny; ++j) {
+				int edges = (j == 0 || j == ny - 1) + (is3d && (k == 0 || k == nz - 1));
+				float *row = &dist[(j + (size_t)k * ny) * nx];
+				if (edges > 1) std::fill(row, row + nx, 0.0f);
+				else if (edges == 1) row[0] = row[nx - 1] = 0;
 			}
 		}
 	}
-	else {
-		for (int l = 1; l <= (int) val1+val2; ++l) {
-			for (size_t i=0; i<size; i++) d2[i]=d[i];
-			for (int j = 1; j < ny - 1; ++j) {
-				for (int i = 1; i < nx - 1; ++i) {
-					size_t t = i + j * nx;
-					if (d[t]) continue;
-					if (d2[t - 1] || d2[t + 1] || d2[t + nx] || d2[t - nx]) d[t] = (float) l + 1;
-				}
+	Util::distance_transform(&dist[0], &dist[0], nx, ny, nz, euclidean);
+
+	const float maxshell = (int) val1+val2;
+	for (int k = is3d ? 1 : 0; k < (is3d ? nz - 1 : 1); ++k) {
+		for (int j = 1; j < ny - 1; ++j) {
+			for (int i = 1; i < nx - 1; ++i) {
+				size_t t = i + j * nx + (size_t)k * nx * ny;
+				if (d[t]) continue;
+				float l = ceil(dist[t]);
+				if (l <= maxshell) d[t] = l + 1;
 			}
 		}
 	}
@@ -8314,7 +9111,6 @@ void IterBinMaskProcessor::process_inplace(EMData * image)
 	for (size_t i = 0; i < size; ++i) if (d[i]) d[i]=vec[(int)d[i]];
 
 	image->update();
-	delete image2;
 }
 
 EMData* DirectionalSumProcessor::process(const EMData* const image ) {
@@ -10093,6 +10889,290 @@ int EMAN::multi_processors(EMData * image, vector < string > processornames)
 	return 0;
 }
 
+namespace {
+	struct PipelineBlocks
+	{
+		vector < RealPixelProcessor * > processors;
+		float *data;
+		size_t size;
+	};
+
+	// pixels per block, small enough to stay in cache from one processor to the next
+	const size_t PIPELINE_BLOCK = 4096;
+
+	// the Dict in which a Fourier filter finds its cutoff as given, before it converts it
+	// with the image nx, which is that of the Fourier image when the filters are merged
+	Dict real_space_cutoff(const Dict & params, int nxreal)
+	{
+		Dict p = params;
+		if (p.has_key("cutoff_pixels") && !p.has_key("sigma") && !p.has_key("cutoff_abs") && !p.has_key("cutoff_freq")) {
+			p["cutoff_abs"] = (float)p["cutoff_pixels"] / nxreal;
+		}
+		return p;
+	}
+}
+
+ProcessorPipeline::ProcessorPipeline()
+{
+}
+
+ProcessorPipeline::ProcessorPipeline(const vector < pair < string, Dict > > & steps)
+{
+	for (size_t i = 0; i < steps.size(); i++) {
+		add(steps[i].first, steps[i].second);
+	}
+}
+
+ProcessorPipeline::~ProcessorPipeline()
+{
+	for (size_t i = 0; i < stages.size(); i++) {
+		if (stages[i].filter) delete stages[i].filter;
+	}
+	for (size_t i = 0; i < steps.size(); i++) {
+		delete steps[i].processor;
+	}
+}
+
+void ProcessorPipeline::add(const string & processorname, const Dict & params)
+{
+	Processor *p = Factory < Processor >::get(processorname, params);
+	Step step;
+	step.processor = p;
+	step.params = params;
+	steps.push_back(step);
+
+	StageType type = STAGE_SINGLE;
+	RealPixelProcessor *pixel = dynamic_cast < RealPixelProcessor * >(p);
+	if (pixel) {
+		type = STAGE_PIXEL;
+	}
+	else if (p->is_fourier_filter() && !(params.has_key("return_radial") && (bool)params["return_radial"])) {
+		type = STAGE_FOURIER;
+	}
+
+	// a pixel processor which needs image statistics can only start a pass, since
+	// the statistics of the partly processed image are not known
+	bool merge = !stages.empty() && stages.back().type == type && type != STAGE_SINGLE;
+	if (merge && pixel && pixel->required_stats() != 0) merge = false;
+
+	if (merge) {
+		stages.back().last++;
+	}
+	else {
+		Stage stage;
+		stage.type = type;
+		stage.first = steps.size() - 1;
+		stage.last = steps.size();
+		stage.filter = 0;
+		stages.push_back(stage);
+	}
+}
+
+void ProcessorPipeline::process_inplace(EMData * image)
+{
+	if (!image) {
+		LOGWARN("NULL Image");
+		return;
+	}
+
+	for (size_t i = 0; i < stages.size(); i++) {
+		Stage & stage = stages[i];
+
+		// processors like the Fourier filters convert their parameters in place, the
+		// next image starts from the parameters as given
+		for (size_t j = stage.first; j < stage.last; j++) {
+			steps[j].processor->set_params(steps[j].params);
+		}
+
+		if (stage.type == STAGE_PIXEL) {
+			run_pixels(stage, image);
+		}
+		else if (stage.type == STAGE_FOURIER && stage.last - stage.first > 1) {
+			run_fourier(stage, image);
+		}
+		else {
+			Processor *p = steps[stage.first].processor;
+			if (p->works_inplace()) {
+				p->process_inplace(image);
+			}
+			else {
+				EMData *result = p->process(image);
+				image->swap(*result);
+				delete result;
+			}
+		}
+	}
+}
+
+EMData *ProcessorPipeline::process(const EMData * const image)
+{
+	EMData *result = image->copy();
+	try {
+		process_inplace(result);
+	}
+	catch (...) {
+		delete result;
+		throw;
+	}
+	return result;
+}
+
+void ProcessorPipeline::run_pixels(const Stage & stage, EMData * image)
+{
+	PipelineBlocks job;
+	for (size_t j = stage.first; j < stage.last; j++) {
+		RealPixelProcessor *p = static_cast < RealPixelProcessor * >(steps[j].processor);
+		p->prepare(image);
+		job.processors.push_back(p);
+	}
+	job.data = image->get_data();
+	job.size = image->get_size();
+
+	Util::parallel_for((job.size + PIPELINE_BLOCK - 1) / PIPELINE_BLOCK, pixel_worker, &job, 0, 64);
+	image->update();
+}
+
+void ProcessorPipeline::pixel_worker(size_t begin, size_t end, void *arg)
+{
+	const PipelineBlocks *job = static_cast < const PipelineBlocks * >(arg);
+	for (size_t b = begin; b < end; b++) {
+		size_t first = b * PIPELINE_BLOCK;
+		size_t n = std::min(PIPELINE_BLOCK, job->size - first);
+		for (size_t j = 0; j < job->processors.size(); j++) {
+			job->processors[j]->process_block(job->data + first, n);
+		}
+	}
+}
+
+void ProcessorPipeline::run_fourier(Stage & stage, EMData * image)
+{
+	const bool complex_input = image->is_complex();
+	const int nxreal = complex_input ? image->get_xsize() - 2 + image->is_fftodd() : image->get_xsize();
+
+	// the filters which override A/pix do it in the image header too
+	for (size_t j = stage.first; j < stage.last; j++) {
+		if (steps[j].params.has_key("apix")) {
+			float apix = steps[j].params["apix"];
+			image->set_attr("apix_x", apix);
+			image->set_attr("apix_y", apix);
+			image->set_attr("apix_z", apix);
+		}
+	}
+
+	EMData *filter = stage.filter;
+	if (!filter || filter->get_xsize() != nxreal + 2 - nxreal%2 || filter->get_ysize() != image->get_ysize() ||
+		filter->get_zsize() != image->get_zsize() || filter->is_fftodd() != (nxreal%2 == 1) ||
+		(float)filter->get_attr("apix_x") != (float)image->get_attr("apix_x") ||
+		(float)filter->get_attr("apix_y") != (float)image->get_attr("apix_y") ||
+		(float)filter->get_attr("apix_z") != (float)image->get_attr("apix_z")) {
+		if (filter) delete filter;
+		stage.filter = 0;
+		filter = make_filter(stage, image);
+		stage.filter = filter;
+	}
+
+	if (complex_input) {
+		const bool ap = !image->is_ri();
+		image->ap2ri();
+		image->mult(*filter);
+		if (ap) image->ri2ap();		// hand back the format it came in
+	}
+	else {
+		image->do_fft_inplace();
+		image->mult(*filter);
+		image->do_ift_inplace();
+		image->depad();
+	}
+	image->update();
+}
+
+EMData *ProcessorPipeline::make_filter(const Stage & stage, const EMData * image)
+{
+	const int nxreal = image->is_complex() ? image->get_xsize() - 2 + image->is_fftodd() : image->get_xsize();
+	const int ny = image->get_ysize(), nz = image->get_zsize();
+
+	// the filters are applied one after the other to a Fourier image of ones
+	EMData *filter = new EMData();
+	filter->set_size(nxreal + 2 - nxreal%2, ny, nz);
+	filter->set_complex(true);
+	if (ny == 1 && nz == 1) filter->set_complex_x(true);
+	filter->set_ri(true);
+	filter->set_fftpad(true);
+	filter->set_fftodd(nxreal%2 == 1);
+	filter->set_attr("apix_x", (float)image->get_attr("apix_x"));
+	filter->set_attr("apix_y", (float)image->get_attr("apix_y"));
+	filter->set_attr("apix_z", (float)image->get_attr("apix_z"));
+
+	float *data = filter->get_data();
+	for (size_t i = 0; i < filter->get_size(); i += 2) {
+		data[i] = 1.0f;
+		data[i + 1] = 0;
+	}
+	filter->update();
+
+	try {
+		for (size_t j = stage.first; j < stage.last; j++) {
+			steps[j].processor->set_params(real_space_cutoff(steps[j].params, nxreal));
+			steps[j].processor->process_inplace(filter);
+		}
+	}
+	catch (...) {
+		delete filter;
+		throw;
+	}
+	return filter;
+}
+
+namespace {
+	// don't start threads for fewer rows than this per thread
+	const size_t TRANSFORM_MIN_ROWS = 64;
+
+	/* Real space resampling for TransformProcessor::transform(). The output rows are
+	 * numbered j + k * ny; the threads get consecutive rows, so in 3D each works on a slab
+	 * of slices. Along a row the source coordinates step by the first column of the matrix.
+	 */
+	struct TransformRows
+	{
+		const float *src;
+		float *des;
+		int nx, ny, nz;
+		vector<float> m;	// the inverse transform, 3x4 row major
+		int radius2;		// with zerocorners only the rows within this squared radius of the center are resampled, -1 for all
+	};
+
+	void transform_rows_worker(size_t begin, size_t end, void *arg)
+	{
+		const TransformRows *job = static_cast<const TransformRows *>(arg);
+		const int nx = job->nx, ny = job->ny, nz = job->nz;
+		const float *m = &job->m[0];
+
+		for (size_t r = begin; r < end; ++r) {
+			const int j = (int)(r % ny), k = (int)(r / ny);
+			const float y = (float)(j - ny / 2), z = (float)(k - nz / 2);
+
+			int first = 0, last = nx;
+			if (job->radius2 >= 0) {
+				int yz2 = (j - ny / 2) * (j - ny / 2) + (k - nz / 2) * (k - nz / 2);
+				if (yz2 > job->radius2) continue;	// the row stays 0
+				int half = (int)floor(sqrt((float)(job->radius2 - yz2)));
+				first = std::max(nx / 2 - half, 0);
+				last = std::min(nx / 2 + half + 1, nx);
+			}
+
+			const float x = (float)(first - nx / 2);
+			float *des = job->des + (size_t)r * nx + first;
+			if (nz == 1) {
+				Util::interp_bilinear_line(job->src, nx, ny, m[0] * x + m[1] * y + m[3], m[4] * x + m[5] * y + m[7],
+										   m[0], m[4], last - first, des);
+			}
+			else {
+				Util::interp_trilinear_line(job->src, nx, ny, nz, m[0] * x + m[1] * y + m[2] * z + m[3],
+											m[4] * x + m[5] * y + m[6] * z + m[7], m[8] * x + m[9] * y + m[10] * z + m[11],
+											m[0], m[4], m[8], last - first, des);
+			}
+		}
+	}
+}
 
 float* TransformProcessor::transform(const EMData* const image, const Transform& t) const {
 
@@ -10102,7 +11182,6 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 	int nx = image->get_xsize();
 	int ny = image->get_ysize();
 	int nz = image->get_zsize();
-	int nxy = nx*ny;
 	int N	= ny;
 
 	int zerocorners = params.set_default("zerocorners",0);
@@ -10111,45 +11190,26 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 	const float * const src_data = image->get_const_data();
 	float *des_data = (float *) EMUtil::em_calloc(sizeof(float)*nx,ny*nz);
 
-	if ((nz == 1)&&(image -> is_real()))  {
-		Vec2f offset(nx/2,ny/2);
-		for (int j = 0; j < ny; j++) {
-			for (int i = 0; i < nx; i++) {
-				Vec2f coord(i-nx/2,j-ny/2);
-				Vec2f soln = inv*coord;
-				soln += offset;
-
-				float x2 = soln[0];
-				float y2 = soln[1];
-
-				if (x2 < 0 || x2 >= nx || y2 < 0 || y2 >= ny ) {
-					des_data[i + j * nx] = 0; // It may be tempting to set this value to the
-					// mean but in fact this is not a good thing to do. Talk to S.Ludtke about it.
-				}
-				else {
-					int ii = Util::fast_floor(x2);
-					int jj = Util::fast_floor(y2);
-					int k0 = ii + jj * nx;
-					int k1 = k0 + 1;
-					int k2 = k0 + nx;
-					int k3 = k0 + nx + 1;
-
-					if (ii == nx - 1) {
-						k1--;
-						k3--;
-					}
-					if (jj == ny - 1) {
-						k2 -= nx;
-						k3 -= nx;
-					}
-
-					float t = x2 - ii;
-					float u = y2 - jj;
-
-					des_data[i + j * nx] = Util::bilinear_interpolate(src_data[k0],src_data[k1], src_data[k2], src_data[k3],t,u);
-				}
-			}
-		}
+	if (image->is_real()) {
+		TransformRows job;
+		job.src = src_data;
+		job.des = des_data;
+		job.nx = nx;
+		job.ny = ny;
+		job.nz = nz;
+		// the source coordinates are relative to the center, which moves into the translation
+		job.m = inv.get_matrix();
+		job.m[3] += nx/2;
+		job.m[7] += ny/2;
+		if (nz > 1) job.m[11] += nz/2;
+		job.radius2 = -1;
+		if (zerocorners) {
+			int r = std::min(nx, ny);
+			if (nz > 1) r = std::min(r, nz);
+			r /= 2;
+			job.radius2 = r * r;
+		}
+		Util::parallel_for((size_t)ny * nz, transform_rows_worker, &job, 0, TRANSFORM_MIN_ROWS);
 	}
 	if ((nz == 1)&&(image -> is_complex())&&(nx%2==0)&&((2*(nx-ny)-3)*(2*(nx-ny)-3)==1)&&(zerocorners==0) )	 {
 	  //printf("Hello 2-d complex  TransformProcessor \n");
@@ -10949,71 +12009,6 @@ float* TransformProcessor::transform(const EMData* const image, const Transform&
 				  des_data[IndexOut+1] = tempIb;
 		}}}	 // end z, y, x loops through new coordinates
 	}	//	end	 rotations in Fourier Space	 3D
-	if ((nz > 1)&&(image -> is_real())) {
-		size_t l=0, ii, k0, k1, k2, k3, k4, k5, k6, k7;
-		Vec3f offset(nx/2,ny/2,nz/2);
-		float x2, y2, z2, tuvx, tuvy, tuvz;
-		int ix, iy, iz;
-		for (int k = 0; k < nz; ++k) {
-			for (int j = 0; j < ny; ++j) {
-				for (int i = 0; i < nx; ++i,++l) {
-					Vec3f coord(i-nx/2,j-ny/2,k-nz/2);
-					Vec3f soln = inv*coord;
-					soln += offset;
-
-					x2 = soln[0];
-					y2 = soln[1];
-					z2 = soln[2];
-
-					if (x2 < 0 || y2 < 0 || z2 < 0 || x2 >= nx	|| y2 >= ny	 || z2>= nz ) {
-						des_data[l] = 0;
-					}
-					else {
-						ix = Util::fast_floor(x2);
-						iy = Util::fast_floor(y2);
-						iz = Util::fast_floor(z2);
-						tuvx = x2-ix;
-						tuvy = y2-iy;
-						tuvz = z2-iz;
-						ii = ix + iy * nx + iz * nxy;
-
-						k0 = ii;
-						k1 = k0 + 1;
-						k2 = k0 + nx;
-						k3 = k0 + nx+1;
-						k4 = k0 + nxy;
-						k5 = k1 + nxy;
-						k6 = k2 + nxy;
-						k7 = k3 + nxy;
-
-						if (ix == nx - 1) {
-							k1--;
-							k3--;
-							k5--;
-							k7--;
-						}
-						if (iy == ny - 1) {
-							k2 -= nx;
-							k3 -= nx;
-							k6 -= nx;
-							k7 -= nx;
-						}
-						if (iz == nz - 1) {
-							k4 -= nxy;
-							k5 -= nxy;
-							k6 -= nxy;
-							k7 -= nxy;
-						}
-
-						des_data[l] = Util::trilinear_interpolate(src_data[k0],
-								src_data[k1], src_data[k2], src_data[k3], src_data[k4],
-								src_data[k5], src_data[k6], src_data[k7], tuvx, tuvy, tuvz);
-					}
-				}
-			}
-		}
-	}
-
 	EXITFUNC;
 	return des_data;
 }
@@ -11267,200 +12262,122 @@ void ScaleTransformProcessor::process_inplace(EMData* image) {
 	}
 }
 
-struct WSsortlist { float pix; short x,y,z; };
-
-int WScmp(const void *a, const void *b) { float x=((WSsortlist*)b)->pix-((WSsortlist*)a)->pix; return (x>0)-(x<0); }		// comparison function for qsort
-
-// inefficient since a copy was probably already made, but best we can do
-void WatershedProcessor::process_inplace(EMData *image) {
-	EMData *tmp=process(image);
-	memcpy(image->get_data(),tmp->get_data(),image->get_size()*sizeof(float));
-	delete tmp;
-}
-
-EMData *WatershedProcessor::process(const EMData* const image) {
-	//unsigned int nseg = params.set_default("nseg",12);
-	int nseg = params.set_default("nseg",12);
-	float thr = params.set_default("thr",0.5f);
-	int segbymerge = params.set_default("segbymerge",0);
-	int verbose = params.set_default("verbose",0);
-	if (nseg<=1) throw InvalidValueException(nseg,"nseg must be greater than 1");
-
-	if (segbymerge) { segbymerge=nseg; nseg=4096; }		// set max number of segments to a large (but not infinite) value. Too many will make connectivity matrix too big
-
-	EMData *ret=new EMData(image->get_xsize(),image->get_ysize(),image->get_zsize());
-	ret->to_zero();
-
-
-	int nx=image->get_xsize();
-	int ny=image->get_ysize();
-	int nz=image->get_zsize();
-	if (nz==1) throw ImageDimensionException("Only 3-D data supported");
-
-	// Count the number of above threshold pixels
-	size_t n2seg = 0;
-	for (int z=0; z<nz; z++) {
-		for (int y=0; y<ny; y++) {
-			for (int x=0; x<nx; x++) {
-				if (image->get_value_at(x,y,z)>=thr) n2seg++;
-			}
-		}
-	}
-	if (verbose) printf("%ld voxels above threshold\n",n2seg);
-
-	// Extract the pixels for sorting
-//	WSsortlist srt[n2seg];
-	WSsortlist * srt = new WSsortlist[n2seg+1];
-	size_t i=0;
-	for (int z=1; z<nz-1; z++) {
-		for (int y=1; y<ny-1; y++) {
-			for (int x=1; x<nx-1; x++) {
-				if (image->get_value_at(x,y,z)>=thr) {
-					srt[i].pix=image->get_value_at(x,y,z);
-					srt[i].x=x;
-					srt[i].y=y;
-					srt[i].z=z;
-					i++;
-				}
-			}
-		}
-	}
-	if (verbose) printf("Voxels extracted, sorting\n");
-
-	// actual sort
-	qsort(&srt,n2seg,sizeof(WSsortlist),WScmp);
-	if (verbose) printf("Voxels sorted (%1.4g max), starting watershed\n",srt[0].pix);
-
-	// now we start with the highest value and fill in the segments
-	float cseg=1.0;
-	int start=n2seg;
-	for (i=0; i<n2seg; i++) {
-		int x=srt[i].x;
-		int y=srt[i].y;
-		int z=srt[i].z;
-		float lvl=0;
-		for (int zz=z-1; zz<=z+1; zz++) {
-			for (int yy=y-1; yy<=y+1; yy++) {
-				for (int xx=x-1; xx<=x+1; xx++) {
-					float v=ret->get_value_at(xx,yy,zz);
-					if (v>lvl) lvl=v;				// use the highest numbered border segment (arbitrary)
-				}
-			}
-		}
-		if (lvl==0) {
-			if (verbose) printf("%d %d %d\t%1.0f\t%1.3g\n",x,y,z,cseg,srt[i].pix);
-			lvl=cseg;
-			cseg+=1.0;
-		}
-		if (lvl>nseg) {
-			start=i;
-			if (verbose) printf("Requested number of segments achieved at density %1.4g\n",srt[i].pix);
-			break;
-		}		// This means we've made as many segments as we need, so we switch to flood-filling
-		ret->set_value_at_fast(x,y,z,lvl);
-	}
-
-	// We have as many segments as we'll get, but not all voxels have been segmented, so we do a progressive flood fill in density order
-	size_t chg=1;
-	while (chg) {
-		chg=0;
-		for (i=start; i<n2seg; i++) {
-			int x=srt[i].x;
-			int y=srt[i].y;
-			int z=srt[i].z;
-			if (ret->get_value_at(x,y,z)!=0) continue;	// This voxel is already done
-
-			float lvl=0;
-			for (int zz=z-1; zz<=z+1; zz++) {
-				for (int yy=y-1; yy<=y+1; yy++) {
-					for (int xx=x-1; xx<=x+1; xx++) {
-					float v=ret->get_value_at(xx,yy,zz);
-					if (v>lvl) lvl=v;				// use the highest numbered border segment (arbitrary)
-					}
-				}
-			}
-			if (lvl==0) continue;					// we just skip voxels without any segmented neighbors
-			ret->set_value_at_fast(x,y,z,lvl);
-			chg+=1;
-		}
-		if (verbose) printf("%ld voxels changed\n",chg);
-	}
-
-	if (segbymerge) {
-		if (cseg<segbymerge) return ret;
-	}
-	else if (cseg<=nseg) return ret;		// We don't have too many segments, so we just return now
+namespace {
+	/* merges the pair of segments with the largest contact, relative to the larger of the two,
+	 * until segbymerge remain. The contact is weighted by the density across it.
+	 */
+	template <class Labels>
+	void merge_segments(const EMData *image, Labels &labels, int nseg, int segbymerge, bool verbose)
+	{
+		const int nx = image->get_xsize(), ny = image->get_ysize(), nz = image->get_zsize();
+		const size_t nxy = (size_t)nx * ny;
+		const float *data = image->get_const_data();
+		const FloodNeighbours nb(26, nx, ny);
 
-	if (verbose) printf("Merging segments\n");
-	// If requested, we now merge segments with the most surface contact until we have the correct final number
-	if (segbymerge) {
-		int nsegstart=(int)cseg;	// number of segments we actually generated
-		nseg=(int)cseg;
-		EMData *mx=new EMData(nsegstart,nsegstart,1);		// This will be a "contact matrix" among segments
-		float *mxd=mx->get_data();
+		int nsegstart = nseg + 1;		// the labels run from 1 to nseg
+		EMData *mx = new EMData(nsegstart, nsegstart, 1);		// This will be a "contact matrix" among segments
+		float *mxd = mx->get_data();
 
 		// each cycle of the while loop, we eliminate one segment by merging
-		int sub1=-1,sub2=-1;		// sub2 will be merged into sub1
-		nseg++;						// since we don't actually remove one on the first pass, but decrement the counter
-		while (segbymerge<nseg) {
+		int sub1 = -1, sub2 = -1;		// sub2 will be merged into sub1
+		nseg = nsegstart + 1;			// since we don't actually remove one on the first pass, but decrement the counter
+		while (segbymerge < nseg) {
 			mx->to_zero();
 
-			for (i=0; i<n2seg; i++) {
-				int x=srt[i].x;
-				int y=srt[i].y;
-				int z=srt[i].z;
-
-				int v1=(int)ret->get_value_at(x,y,z);
-				if (v1==sub2) { ret->set_value_at_fast(x,y,z,sub1); v1=sub1; }
-				mxd[v1+v1*nsegstart]++;					// the diagonal is a count of the number of voxels in the segment
-				for (int zz=z-1; zz<=z+1; zz++) {
-					for (int yy=y-1; yy<=y+1; yy++) {
-						for (int xx=x-1; xx<=x+1; xx++) {
-							int v2=(int)ret->get_value_at(xx,yy,zz);
-							if (v2==sub2) v2=sub1;		// pretend that any sub2 values are actually sub1
-							if (v1==v2) continue;
-							mxd[v1+v2*nsegstart]+=image->get_value_at(xx,yy,zz);		// We weight the connectivity by the image value
+			for (int z = 1; z < nz - 1; z++) {
+				for (int y = 1; y < ny - 1; y++) {
+					for (int x = 1; x < nx - 1; x++) {
+						size_t i = x + y * (size_t)nx + z * nxy;
+						int v1 = labels.get(i, x, y, z);
+						if (v1 == 0) continue;
+						if (v1 == sub2) { labels.set(i, x, y, z, (unsigned short)sub1); v1 = sub1; }
+						mxd[v1 + v1 * nsegstart]++;					// the diagonal is a count of the number of voxels in the segment
+						for (int k = 0; k < nb.n; k++) {
+							size_t j = i + nb.offset[k];
+							int v2 = labels.get(j, x + nb.dx[k], y + nb.dy[k], z + nb.dz[k]);
+							if (v2 == sub2) v2 = sub1;		// pretend that any sub2 values are actually sub1
+							if (v1 == v2) continue;
+							mxd[v1 + v2 * nsegstart] += data[j];		// We weight the connectivity by the image value
 						}
 					}
 				}
 			}
 			mx->update();
 			nseg--;					// number of segments left
-			if (verbose && sub1==-1) { mx->write_image("contactmx.hdf",0); }		// for debugging
+			if (verbose && sub1 == -1) { mx->write_image("contactmx.hdf", 0); }		// for debugging
 
-			sub1=-1;
-			sub2=-1;
+			sub1 = -1;
+			sub2 = -1;
 			// contact matrix complete, now figure out which 2 segments to merge
 			// diagonal of matrix is a count of the 'volume' of the segment. off-diagonal elements are surface area of contact region (roughly)
 			// we want to normalize the surface area elements so they are roughly proportional to the size of the segment, so we don't merge
 			// based on total contact area, but contact area as a fraction of the total area.
-			float bestv=-1.0;
-			for (int s1=1; s1<nsegstart; s1++) {
-				for (int s2=1; s2<nsegstart; s2++) {
-					if (s1==s2) continue;				// ignore the diagonal
-					float v=mxd[s1+s2*nsegstart];
-					if (v==0) continue;					// empty segment
-//					v/=(pow(mxd[s1+s1*nsegstart],0.6667f)+pow(mxd[s2+s2*nsegstart],0.6667f));	// normalize by the sum of the estimated surface areas (no shape effects)
-					v/=max(mxd[s1+s1*nsegstart],mxd[s2+s2*nsegstart]);	// normalize by the sum of the estimated surface areas (no shape effects)
-					if (v>bestv) { bestv=v; sub1=s1; sub2=s2; }
-				}
-			}
-			float mv=0;
-			int mvl=0;
-			for (i=nsegstart+1; i<nsegstart*nsegstart; i+=nsegstart+1)
-				if (mxd[i]>mv) { mv=mxd[i]; mvl=i/nsegstart; }
-			if (verbose) printf("Merging %d to %d (%1.0f, %d)\n",sub2,sub1,mv,mvl);
-			if (sub1==-1) {
+			float bestv = -1.0;
+			for (int s1 = 1; s1 < nsegstart; s1++) {
+				for (int s2 = 1; s2 < nsegstart; s2++) {
+					if (s1 == s2) continue;				// ignore the diagonal
+					float v = mxd[s1 + s2 * nsegstart];
+					if (v == 0) continue;					// empty segment
+					v /= max(mxd[s1 + s1 * nsegstart], mxd[s2 + s2 * nsegstart]);	// normalize by the sum of the estimated surface areas (no shape effects)
+					if (v > bestv) { bestv = v; sub1 = s1; sub2 = s2; }
+				}
+			}
+			float mv = 0;
+			int mvl = 0;
+			for (int i = nsegstart + 1; i < nsegstart * nsegstart; i += nsegstart + 1)
+				if (mxd[i] > mv) { mv = mxd[i]; mvl = i / nsegstart; }
+			if (verbose) printf("Merging %d to %d (%1.0f, %d)\n", sub2, sub1, mv, mvl);
+			if (sub1 == -1) {
 				if (verbose) printf("Unable to find segments to merge, aborting\n");
 				break;
 			}
 		}
 
+		delete mx;
 	}
 
-	delete [] srt;
+	template <class Labels>
+	void watershed(EMData *image, Labels &labels, float thr, int nseg, int segbymerge, bool verbose)
+	{
+		int maxseg = segbymerge ? 4096 : nseg;		// set max number of segments to a large (but not infinite) value. Too many will make connectivity matrix too big
+		int cseg = 0;
+		priority_flood(image, labels, thr, 26, true, cseg, maxseg, verbose);
+
+		// If requested, we now merge segments with the most surface contact until we have the correct final number
+		if (segbymerge && cseg >= segbymerge) {
+			if (verbose) printf("Merging segments\n");
+			merge_segments(image, labels, cseg, segbymerge, verbose);
+		}
 
-	return ret;
+		write_labels(image, labels);
+	}
+}
+
+void WatershedProcessor::process_inplace(EMData *image) {
+	if (!image) {
+		LOGWARN("NULL Image");
+		return;
+	}
+
+	int nseg = params.set_default("nseg",12);
+	float thr = params.set_default("thr",0.5f);
+	int segbymerge = params.set_default("segbymerge",0);
+	int verbose = params.set_default("verbose",0);
+	bool sparselabels = params.set_default("sparselabels",false);
+	if (nseg<=1) throw InvalidValueException(nseg,"nseg must be greater than 1");
+	if (nseg>=FLOOD_QUEUED) throw InvalidValueException(nseg,"nseg must be less than 65535");
+	if (image->get_zsize()==1) throw ImageDimensionException("Only 3-D data supported");
+
+	if (segbymerge) segbymerge=nseg;
+
+	if (sparselabels) {
+		TiledLabels labels(image->get_xsize(),image->get_ysize(),image->get_zsize());
+		watershed(image,labels,thr,nseg,segbymerge,verbose!=0);
+	}
+	else {
+		DenseLabels labels(image->get_xsize(),image->get_ysize(),image->get_zsize());
+		watershed(image,labels,thr,nseg,segbymerge,verbose!=0);
+	}
 }
 
 EMData* ScaleTransformProcessor::process(const EMData* const image) {
@@ -12177,10 +13094,8 @@ void TomoTiltEdgeMaskProcessor::process_inplace( EMData* image )
 	bool fim = params.set_default("angle_fim", false);
 	float alt;
 	if ( fim ) {
-		Transform* t = (Transform*)image->get_attr("xform.projection");
-		Dict d = t->get_params("eman");
+		Dict d = image->get_attr_transform(EMData::ATTR_XFORM_PROJECTION).get_params("eman");
 		alt = (float) d["alt"];
-		if(t) {delete t; t=0;}
 	}
 	else alt = params.set_default("angle", 0.0f);
 
@@ -13514,81 +14429,27 @@ void ObjLabelProcessor::process_inplace(EMData * image)
 	int nx = image->get_xsize();
 	int ny = image->get_ysize();
 	int nz = image->get_zsize();
+	size_t nxy = (size_t)nx*ny;
 
-	int y1;
-	bool spanLeft, spanRight;
-	vector<Vec3i> pvec;
-	float cx,cy;
-	int npx;
+	// the 4-connected objects of each slice, numbered on from those of the slices before
+	float *data=image->get_data();
+	vector<int> labels(nxy);
+	vector<float> centers(2);	// centers[2*i] is the center of object i, 0 being the background
 	int count=0;
-	vector<float> centers(2);
 	for (int zz = 0; zz < nz; zz++) {
-
-		for (int yy = 0; yy < ny; yy++) {
-			for (int xx = 0; xx < nx; xx++) {
-				if (image->get_value_at(xx,yy,zz)>0){
-					pvec.push_back(Vec3i(xx,yy,zz));
-					if (writecenter && count<0){
-						cx/=npx;cy/=npx;
-						centers.push_back(cx);
-						centers.push_back(cy);
-						cx=cy=0;npx=0;
-					}
-					count--;
-				}
-				while(!pvec.empty())
-				{
-					Vec3i v=pvec.back();
-					int x=v[0],y=v[1],z=v[2];
-//					printf("%d\t%d\t%d\n",x,y,z);
-					pvec.pop_back();
-					y1 = y;
-					while(y1 > 0 && image->get_value_at(x,y1,zz)>0) y1--;
-//					y1++;
-					spanLeft = spanRight = 0;
-					bool nowstop=0;
-					while(1)
-					{
-						if(image->get_value_at(x,y1,zz)>0){
-							image->set_value_at(x,y1,zz,count);
-							if (writecenter){
-								cx+=x;cy+=y1;npx++;
-							}
-						}
-
-//						printf("\t %d\t%d\t%d\n",x,y1,z);
-						if(!spanLeft && x > 0 && image->get_value_at(x-1,y1,zz)>0)
-						{
-							pvec.push_back(Vec3i(x-1,y1,zz));
-							spanLeft = 1;
-						}
-						else if(spanLeft && x > 0 && image->get_value_at(x-1,y1,zz)<=0)
-						{
-							spanLeft = 0;
-						}
-						if(!spanRight && x < nx - 1 && image->get_value_at(x+1,y1,zz)>0)
-						{
-							pvec.push_back(Vec3i(x+1,y1,zz));
-							spanRight = 1;
-						}
-						else if(spanRight && x < nx - 1 && image->get_value_at(x+1,y1,zz)<=0)
-						{
-							spanRight = 0;
-						}
-						y1++;
-						if (nowstop)
-							break;
-						if (y1 >= ny-1 || image->get_value_at(x,y1,zz)<=0)
-							nowstop=1;
-					}
-				}
-
-
+		float *slice=data+zz*nxy;
+		vector<Util::Component> objs=Util::label_components(slice,&labels[0],nx,ny,1,0,6);
+		for (size_t i=0; i<nxy; i++) slice[i]=labels[i] ? (float)(labels[i]+count) : 0.0f;
+		if (writecenter) {
+			for (size_t i=0; i<objs.size(); i++) {
+				centers.push_back(objs[i].center[0]);
+				centers.push_back(objs[i].center[1]);
 			}
 		}
+		count+=(int)objs.size();
 	}
-	printf("%d objects.\n",-count);
-	image->mult(-1);
+	printf("%d objects.\n",count);
+	image->update();
 	if (writecenter) image->set_attr("obj_centers",centers);
 }
 
@@ -14096,6 +14957,238 @@ void ManhattanDistanceProcessor::process_inplace(EMData * image)
 	}
 }
 
+namespace {
+	typedef unsigned long long BitWord;
+	const int WORD_BITS = 64;
+	const size_t MORPH_MIN_ROWS = 16;
+
+	/* A binary image with 64 voxels per word. Each row of nx voxels takes its own words,
+	 * voxel x being bit x % 64 of word x / 64; the bits past nx are always 0.
+	 */
+	struct BitVolume
+	{
+		int nx, ny, nz, words;
+		BitWord last;	// the bits of the last word of a row which are in the image
+		vector<BitWord> bits;
+
+		BitVolume(int nx, int ny, int nz) :
+			nx(nx), ny(ny), nz(nz), words((nx + WORD_BITS - 1) / WORD_BITS),
+			last(nx % WORD_BITS ? ((BitWord)1 << nx % WORD_BITS) - 1 : ~(BitWord)0),
+			bits((size_t)words * ny * nz, 0)
+		{
+		}
+
+		BitWord *row(int y, int z) { return &bits[((size_t)z * ny + y) * words]; }
+		const BitWord *row(int y, int z) const { return &bits[((size_t)z * ny + y) * words]; }
+
+		// removes the voxels which are set in b
+		void subtract(const BitVolume & b)
+		{
+			for (size_t i = 0; i < bits.size(); ++i) bits[i] &= ~b.bits[i];
+		}
+	};
+
+	/* The structuring element, as runs [dx0, dx1] of x offsets for each (dy, dz) */
+	struct ElementRow
+	{
+		int dy, dz;
+		vector< pair<int, int> > runs;
+	};
+
+	/* The voxels of selem which are nonzero, centered on (nx / 2, ny / 2, nz / 2), or
+	 * without selem the ball of radius in city-block distance.
+	 */
+	vector<ElementRow> structuring_element(EMData *selem, int radius, bool is3d)
+	{
+		vector<ElementRow> element;
+		const int sx = selem ? selem->get_xsize() : 2 * radius + 1;
+		const int sy = selem ? selem->get_ysize() : 2 * radius + 1;
+		const int sz = selem ? selem->get_zsize() : (is3d ? 2 * radius + 1 : 1);
+		vector<bool> on(sx);
+		for (int z = 0; z < sz; ++z) {
+			for (int y = 0; y < sy; ++y) {
+				ElementRow r;
+				r.dy = y - sy / 2;
+				r.dz = z - sz / 2;
+				for (int x = 0; x < sx; ++x) {
+					if (selem) on[x] = selem->get_value_at(x, y, z) != 0;
+					else on[x] = abs(x - sx / 2) + abs(r.dy) + abs(r.dz) <= radius;
+				}
+				for (int x = 0; x < sx; ++x) {
+					if (!on[x]) continue;
+					int x1 = x;
+					while (x1 + 1 < sx && on[x1 + 1]) ++x1;
+					r.runs.push_back(make_pair(x - sx / 2, x1 - sx / 2));
+					x = x1;
+				}
+				if (!r.runs.empty()) element.push_back(r);
+			}
+		}
+		return element;
+	}
+
+	/* out(x) = in(x - dx) over a row of words, shifting in 0 */
+	void shift_row(const BitWord *in, BitWord *out, int words, int dx)
+	{
+		const int q = abs(dx) / WORD_BITS, r = abs(dx) % WORD_BITS;
+		for (int w = 0; w < words; ++w) {
+			BitWord v = 0;
+			if (dx >= 0) {
+				if (w - q >= 0) v = in[w - q] << r;
+				if (r && w - q - 1 >= 0) v |= in[w - q - 1] >> (WORD_BITS - r);
+			}
+			else {
+				if (w + q < words) v = in[w + q] >> r;
+				if (r && w + q + 1 < words) v |= in[w + q + 1] << (WORD_BITS - r);
+			}
+			out[w] = v;
+		}
+	}
+
+	struct MorphJob
+	{
+		const BitVolume *in;
+		BitVolume *out;
+		const vector<ElementRow> *element;
+		int pad;		// words of 0 on each side of a row, enough for the largest x offset
+		bool erode;
+	};
+
+	/* Dilation: out(p) = OR over the offsets o of in(p - o). Erosion: out(p) = AND over o of
+	 * in(p + o), counting voxels outside the image as 0. A run of n x offsets costs log2(n)
+	 * word-wide shifts, by widening the run covered by t in steps of doubling size. The rows
+	 * are padded so that no bit is lost on the way.
+	 */
+	void morph_rows_worker(size_t begin, size_t end, void *arg)
+	{
+		const MorphJob *job = static_cast<const MorphJob *>(arg);
+		const BitVolume & in = *job->in;
+		const int words = in.words, sign = job->erode ? -1 : 1;
+		const int padded = words + 2 * job->pad;
+		vector<BitWord> src(padded, 0), t(padded), u(padded);
+
+		for (size_t l = begin; l < end; ++l) {
+			const int y = (int)(l % in.ny), z = (int)(l / in.ny);
+			BitWord *acc = job->out->row(y, z);
+			for (int w = 0; w < words; ++w) acc[w] = job->erode ? ~(BitWord)0 : 0;
+
+			for (size_t e = 0; e < job->element->size(); ++e) {
+				const ElementRow & r = (*job->element)[e];
+				const int sy = y - sign * r.dy, sz = z - sign * r.dz;
+				if (sy < 0 || sy >= in.ny || sz < 0 || sz >= in.nz) {
+					if (job->erode) {
+						for (int w = 0; w < words; ++w) acc[w] = 0;
+						break;
+					}
+					continue;
+				}
+				std::copy(in.row(sy, sz), in.row(sy, sz) + words, src.begin() + job->pad);
+				for (size_t k = 0; k < r.runs.size(); ++k) {
+					shift_row(&src[0], &t[0], padded, sign * r.runs[k].first);
+					for (int covered = 1, n = r.runs[k].second - r.runs[k].first + 1; covered < n; ) {
+						const int step = std::min(covered, n - covered);
+						shift_row(&t[0], &u[0], padded, sign * step);
+						for (int w = 0; w < padded; ++w) t[w] = job->erode ? t[w] & u[w] : t[w] | u[w];
+						covered += step;
+					}
+					const BitWord *tw = &t[job->pad];
+					for (int w = 0; w < words; ++w) acc[w] = job->erode ? acc[w] & tw[w] : acc[w] | tw[w];
+				}
+			}
+			acc[words - 1] &= in.last;
+		}
+	}
+
+	/* iters dilations or erosions of v, each split between Util::get_num_threads() threads by rows */
+	void morph_binary(BitVolume & v, const vector<ElementRow> & element, bool erode, int iters)
+	{
+		BitVolume tmp(v.nx, v.ny, v.nz);
+		MorphJob job;
+		job.element = &element;
+		job.erode = erode;
+		job.pad = 1;
+		for (size_t e = 0; e < element.size(); ++e) {
+			for (size_t k = 0; k < element[e].runs.size(); ++k) {
+				const int reach = std::max(abs(element[e].runs[k].first), abs(element[e].runs[k].second));
+				job.pad = std::max(job.pad, reach / WORD_BITS + 1);
+			}
+		}
+		for (int i = 0; i < iters; ++i) {
+			job.in = &v;
+			job.out = &tmp;
+			Util::parallel_for((size_t)v.ny * v.nz, morph_rows_worker, &job, 0, MORPH_MIN_ROWS);
+			v.bits.swap(tmp.bits);
+		}
+	}
+
+	struct BitImageJob
+	{
+		float *data;
+		BitVolume *bits;
+		float thresh;
+	};
+
+	// the rows [begin, end) of the image as bits, set where data >= thresh like threshold.binary
+	void pack_rows_worker(size_t begin, size_t end, void *arg)
+	{
+		const BitImageJob *job = static_cast<const BitImageJob *>(arg);
+		const int nx = job->bits->nx;
+		for (size_t l = begin; l < end; ++l) {
+			const float *d = job->data + l * nx;
+			BitWord *row = &job->bits->bits[l * job->bits->words];
+			for (int x = 0; x < nx; ++x) {
+				if (d[x] >= job->thresh) row[x / WORD_BITS] |= (BitWord)1 << x % WORD_BITS;
+			}
+		}
+	}
+
+	void unpack_rows_worker(size_t begin, size_t end, void *arg)
+	{
+		const BitImageJob *job = static_cast<const BitImageJob *>(arg);
+		const int nx = job->bits->nx;
+		for (size_t l = begin; l < end; ++l) {
+			float *d = job->data + l * nx;
+			const BitWord *row = &job->bits->bits[l * job->bits->words];
+			for (int x = 0; x < nx; ++x) d[x] = (row[x / WORD_BITS] >> x % WORD_BITS & 1) ? 1.0f : 0.0f;
+		}
+	}
+
+	void pack_binary(EMData *image, float thresh, BitVolume & bits)
+	{
+		BitImageJob job;
+		job.data = image->get_data();
+		job.bits = &bits;
+		job.thresh = thresh;
+		Util::parallel_for((size_t)bits.ny * bits.nz, pack_rows_worker, &job, 0, MORPH_MIN_ROWS);
+	}
+
+	void unpack_binary(const BitVolume & bits, EMData *image)
+	{
+		BitImageJob job;
+		job.data = image->get_data();
+		job.bits = const_cast<BitVolume *>(&bits);
+		Util::parallel_for((size_t)bits.ny * bits.nz, unpack_rows_worker, &job, 0, MORPH_MIN_ROWS);
+		image->update();
+	}
+
+	/* Sets up a binary morphology processor from its parameters: bits gets the image, thresholded
+	 * like threshold.binary, and element gets selem, or else the city-block ball of the given
+	 * radius. Returns iters, the number of times each dilation or erosion is repeated.
+	 */
+	int morph_setup(Dict & params, float default_thresh, EMData *image, BitVolume & bits, vector<ElementRow> & element)
+	{
+		int iters = params.set_default("iters", 1);
+		int radius = params.set_default("radius", 1);
+		float thresh = params.set_default("thresh", default_thresh);
+		EMData *selem = 0;
+		if (params.has_key("selem")) selem = params["selem"];
+
+		pack_binary(image, thresh, bits);
+		element = structuring_element(selem, radius, image->get_zsize() > 1);
+		return iters;
+	}
+}
+
 EMData* BinaryDilationProcessor::process(const EMData* const image)
 {
 	EMData* proc = image->copy();
@@ -14105,43 +15198,17 @@ EMData* BinaryDilationProcessor::process(const EMData* const image)
 
 void BinaryDilationProcessor::process_inplace(EMData *image)
 {
-	int iters = params.set_default("iters",1);
-	int radius = params.set_default("radius",1);
-	float thresh = params.set_default("threshold",0.01);
-
 	if (!image) {
 		LOGWARN("NULL Image");
 		return;
 	}
 
-	int nx = image->get_xsize();
-	int ny = image->get_ysize();
-	int nz = image->get_zsize();
-	int imsize = nx*ny*nz;
-
-	EMData *binarized = image->process("threshold.binary",Dict("value",thresh));
-	memcpy(image->get_data(),binarized->get_data(),imsize*sizeof(float));
-	delete binarized;
-	image->update();
-
-	if ( radius == 0 || iters == 0) {
-		return;
-	}
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.01f,image,bits,element);
 
-	image->mult(-1);
-	image->add(1);
-	for (int iter = 0; iter < iters; iter++) {
-		image->process_inplace("math.distance.manhattan");
-		for (int i=0; i < nx; i++){
-			for (int j=0; j < ny; j++){
-				for ( int k=0; k < nz; k++) {
-					image->set_value_at_fast(i,j,k,(image->get_value_at(i,j,k)<=radius)?1:0);
-				}
-			}
-		}
-	}
-	image->sub(1);
-	image->mult(-1);
+	morph_binary(bits,element,false,iters);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryErosionProcessor::process(const EMData* const image)
@@ -14153,39 +15220,17 @@ EMData* BinaryErosionProcessor::process(const EMData* const image)
 
 void BinaryErosionProcessor::process_inplace(EMData *image)
 {
-	int iters = params.set_default("iters",1);
-	int radius = params.set_default("radius",1);
-	float thresh = params.set_default("thresh",0.01);
-
 	if (!image) {
 		LOGWARN("NULL Image");
 		return;
 	}
 
-	int nx = image->get_xsize();
-	int ny = image->get_ysize();
-	int nz = image->get_zsize();
-	int imsize = nx*ny*nz;
-
-	EMData *binarized = image->process("threshold.binary",Dict("value",thresh));
-	memcpy(image->get_data(),binarized->get_data(),imsize*sizeof(float));
-	delete binarized;
-	image->update();
-
-	if ( radius == 0 || iters == 0) {
-		return;
-	}
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.01f,image,bits,element);
 
-	for (int iter = 0; iter < iters; iter++) {
-		image->process_inplace("math.distance.manhattan");
-		for (int i=0; i < nx; i++){
-			for (int j=0; j < ny; j++){
-				for (int k=0; k < nz; k++) {
-					image->set_value_at_fast(i,j,k,(image->get_value_at(i,j,k)<=radius)?1:0);
-				}
-			}
-		}
-	}
+	morph_binary(bits,element,true,iters);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryOpeningProcessor::process(const EMData* const image)
@@ -14197,14 +15242,13 @@ EMData* BinaryOpeningProcessor::process(const EMData* const image)
 
 void BinaryOpeningProcessor::process_inplace(EMData *image)
 {
-	int iters=params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		image->process_inplace("morph.dilate.binary",params);
-		image->process_inplace("morph.erode.binary",params);
-	}
+	morph_binary(bits,element,true,iters);
+	morph_binary(bits,element,false,iters);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryClosingProcessor::process(const EMData* const image)
@@ -14216,14 +15260,13 @@ EMData* BinaryClosingProcessor::process(const EMData* const image)
 
 void BinaryClosingProcessor::process_inplace(EMData *image)
 {
-	int iters=params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		image->process_inplace("morph.erode.binary",params);
-		image->process_inplace("morph.dilate.binary",params);
-	}
+	morph_binary(bits,element,false,iters);
+	morph_binary(bits,element,true,iters);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryInternalGradientProcessor::process(const EMData* const image)
@@ -14235,16 +15278,14 @@ EMData* BinaryInternalGradientProcessor::process(const EMData* const image)
 
 void BinaryInternalGradientProcessor::process_inplace(EMData *image)
 {
-	int iters=params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		EMData *cpy = image->copy();
-		cpy->process_inplace("morph.erode.binary",params);
-		image->sub(*cpy);
-		delete cpy;
-	}
+	BitVolume eroded(bits);
+	morph_binary(eroded,element,true,iters);
+	bits.subtract(eroded);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryExternalGradientProcessor::process(const EMData* const image)
@@ -14256,16 +15297,14 @@ EMData* BinaryExternalGradientProcessor::process(const EMData* const image)
 
 void BinaryExternalGradientProcessor::process_inplace(EMData *image)
 {
-	int iters = params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		EMData *cpy = image->copy();
-		image->process_inplace("morph.dilate.binary",params);
-		image->sub(*cpy);
-		delete cpy;
-	}
+	BitVolume dilated(bits);
+	morph_binary(dilated,element,false,iters);
+	dilated.subtract(bits);
+	unpack_binary(dilated,image);
 }
 
 EMData* BinaryMorphGradientProcessor::process(const EMData* const image)
@@ -14277,16 +15316,15 @@ EMData* BinaryMorphGradientProcessor::process(const EMData* const image)
 
 void BinaryMorphGradientProcessor::process_inplace(EMData *image)
 {
-	int iters = params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		EMData *eroded = image->process("morph.erode.binary",params);
-		image->process_inplace("morph.dilate.binary",params);
-		image->sub(*eroded);
-		delete eroded;
-	}
+	BitVolume eroded(bits);
+	morph_binary(eroded,element,true,iters);
+	morph_binary(bits,element,false,iters);
+	bits.subtract(eroded);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryTopHatProcessor::process(const EMData* const image)
@@ -14298,15 +15336,16 @@ EMData* BinaryTopHatProcessor::process(const EMData* const image)
 
 void BinaryTopHatProcessor::process_inplace(EMData *image)
 {
-	int iters=params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		EMData* open = image->process("morph.open.binary",params);
-		image->sub(*open);
-		delete open;
-	}
+	// the image less its opening
+	BitVolume opened(bits);
+	morph_binary(opened,element,true,iters);
+	morph_binary(opened,element,false,iters);
+	bits.subtract(opened);
+	unpack_binary(bits,image);
 }
 
 EMData* BinaryBlackHatProcessor::process(const EMData* const image)
@@ -14318,15 +15357,16 @@ EMData* BinaryBlackHatProcessor::process(const EMData* const image)
 
 void BinaryBlackHatProcessor::process_inplace(EMData *image)
 {
-	int iters=params.set_default("iters",1);
-	float thresh = params.set_default("thresh",0.5);
-	image->process_inplace("threshold.binary",Dict("value",thresh));
+	BitVolume bits(image->get_xsize(),image->get_ysize(),image->get_zsize());
+	vector<ElementRow> element;
+	int iters = morph_setup(params,0.5f,image,bits,element);
 
-	for (int i = 0; i < iters; i++){
-		EMData* close = image->process("morph.close.binary",params);
-		image->sub(*close);
-		delete close;
-	}
+	// the closing of the image less the image
+	BitVolume closed(bits);
+	morph_binary(closed,element,false,iters);
+	morph_binary(closed,element,true,iters);
+	closed.subtract(bits);
+	unpack_binary(closed,image);
 }
 
 EMData* ZThicknessProcessor::process(const EMData* const image)
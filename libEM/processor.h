@@ -46,10 +46,13 @@
 #include <cfloat>
 #include <climits>
 #include <cstring>
+#include <algorithm>
+#include <utility>
 
 using std::vector;
 using std::map;
 using std::string;
+using std::pair;
 
 namespace EMAN
 {
@@ -112,6 +115,23 @@ namespace EMAN
 		 * */
 		virtual EMData* process(const EMData * const image);
 
+		/** @return false for processors which can only be processed out-of-place, whose
+		 * process_inplace() throws. EMData::process_move() relies on this.
+		 */
+		virtual bool works_inplace() const
+		{
+			return true;
+		}
+
+		/** @return true for processors which multiply the Fourier transform of the image
+		 * by a filter that depends only on the image size and header, not on its pixels.
+		 * ProcessorPipeline merges consecutive ones into one filter.
+		 */
+		virtual bool is_fourier_filter() const
+		{
+			return false;
+		}
+
 		/** To process multiple images using the same algorithm.
 		 * @param images Multiple images to be processed.
 		 */
@@ -338,6 +358,11 @@ The basic design of EMAN Processors: <br>\
 	  public:
 		void process_inplace(EMData * image);
 
+		bool is_fourier_filter() const
+		{
+			return true;
+		}
+
 		static string get_group_desc()
 		{
 			return "Fourier Filter processors are a group of processor in the frequency domain. Before using such processors on an image, the image must be transformed from real space to the fourier space. FourierProcessor class is the base class of fourier space processors. Each specific processor is either a lowpass filter processor, or a highpass filter processor, or neighter. The unit of lowpass and highpass parameters are in terms of Nyquist, valid range is [0,0.5]. ";
@@ -693,6 +718,8 @@ The basic design of EMAN Processors: <br>\
 			}
 
 			void process_inplace(EMData *image) { throw InvalidCallException("inplace not supported"); }
+
+			bool works_inplace() const { return false; }
 			
 			virtual EMData* process(const EMData* const image);
 			
@@ -743,6 +770,8 @@ The basic design of EMAN Processors: <br>\
 			}
 
 			void process_inplace(EMData *image) { throw InvalidCallException("inplace operation not supported"); }
+
+			bool works_inplace() const { return false; }
 			
 			virtual EMData* process(const EMData* const image);
 			
@@ -1160,7 +1189,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
-			//d.put("selem",EMObject::EMDATA, "The structuring element with which you want to dilate.");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1202,7 +1231,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
-			//d.put("selem",EMObject::EMDATA, "The structuring element with which you want to dilate.");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1236,7 +1265,7 @@ The basic design of EMAN Processors: <br>\
 
 		string get_desc() const
 		{
-			return "Performs a morphological k-pixel opening of a (binary) image.";
+			return "Performs a morphological k-pixel closing of a (binary) image.";
 		}
 
 		TypeDict get_param_types() const
@@ -1245,6 +1274,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1278,7 +1308,7 @@ The basic design of EMAN Processors: <br>\
 
 		string get_desc() const
 		{
-			return "Performs a morphological k-pixel closing of a (binary) image.";
+			return "Performs a morphological k-pixel opening of a (binary) image.";
 		}
 
 		TypeDict get_param_types() const
@@ -1287,6 +1317,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1329,6 +1360,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1371,6 +1403,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1413,6 +1446,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1455,6 +1489,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1497,6 +1532,7 @@ The basic design of EMAN Processors: <br>\
 			d.put("radius", EMObject::INT, "The number of pixels (radius) to dilate the input image.");
 			d.put("iters",EMObject::INT, "The number of times to apply this process to the input image.");
 			d.put("thresh", EMObject::FLOAT,"Only considers densities above the threshold");
+			d.put("selem",EMObject::EMDATA, "The structuring element: its nonzero pixels, centered on (nx/2,ny/2,nz/2). Replaces radius.");
 			return d;
 		}
 
@@ -1792,6 +1828,7 @@ The basic design of EMAN Processors: <br>\
                 }
 				void process_inplace(EMData * image);
 		  		void create_radial_func(vector < float >&radial_mask) const;
+				bool is_fourier_filter() const { return false; }	// the phases it sets are random
 
                 static const string NAME;
         };
@@ -2057,23 +2094,73 @@ The basic design of EMAN Processors: <br>\
 		}
 
 	  protected:
+		friend class ProcessorPipeline;
+
+		/** Read the statistics of image required_stats() asks for and call calc_locals(),
+		 * before the image's pixels are processed
+		 */
+		void prepare(EMData * image);
+
 		virtual void process_pixel(float *x) const = 0;
+
+		/** Process the n pixels starting at data. This calls process_pixel() on each;
+		 * the subclasses get a loop without virtual calls from RealPixelKernel. Large
+		 * images are split into blocks processed by several threads at once, so this
+		 * must not change the processor.
+		 */
+		virtual void process_block(float *data, size_t n) const
+		{
+			for (size_t i = 0; i < n; ++i) {
+				process_pixel(&data[i]);
+			}
+		}
+
 		virtual void calc_locals(EMData *)
 		{
 		}
 		virtual void normalize(EMData *) const
 		{
 		}
+		/** The image statistics (EMData::StatGroup bits) process_pixel() uses.
+		 * maxval needs STAT_EXTREMA, mean and sigma need STAT_MOMENTS. Statistics
+		 * that are not asked for are not computed, and keep their default values.
+		 */
+		virtual int required_stats() const
+		{
+			return 0;
+		}
 
 		float value;
 		float maxval;
 		float mean;
 		float sigma;
+
+	  private:
+		/** Util::parallel_for() worker calling process_block() on a range of blocks */
+		static void block_worker(size_t begin, size_t end, void *arg);
+	};
+
+	/**The base of the RealPixelProcessor subclasses. Its process_block() calls
+	 * Derived::process_pixel() directly instead of through the vtable, so the compiler
+	 * inlines it and can vectorize the loop. Derived declares this class a friend to give
+	 * it access to its protected process_pixel().
+	 */
+	template<class Derived>
+	class RealPixelKernel:public RealPixelProcessor
+	{
+	  protected:
+		void process_block(float *data, size_t n) const
+		{
+			const Derived *self = static_cast<const Derived *>(this);
+			for (size_t i = 0; i < n; ++i) {
+				self->Derived::process_pixel(&data[i]);
+			}
+		}
 	};
 
 	/**f(x) = |x|
 	 */
-	class AbsoluateValueProcessor:public RealPixelProcessor
+	class AbsoluateValueProcessor:public RealPixelKernel<AbsoluateValueProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2088,6 +2175,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<AbsoluateValueProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			*x = fabs(*x);
@@ -2101,7 +2190,7 @@ The basic design of EMAN Processors: <br>\
 
 	/**f(x) = floor(x)
 	 */
-	class FloorValueProcessor:public RealPixelProcessor
+	class FloorValueProcessor:public RealPixelKernel<FloorValueProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2116,6 +2205,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<FloorValueProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			*x = floor(*x);
@@ -2129,7 +2220,7 @@ The basic design of EMAN Processors: <br>\
 
 	/** This processor can be used to correct errors when reading signed data as unsigned and vice-versa
 	 */
-	class FixSignProcessor:public RealPixelProcessor
+	class FixSignProcessor:public RealPixelKernel<FixSignProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2160,6 +2251,8 @@ The basic design of EMAN Processors: <br>\
 			}
 
 	  protected:
+		friend class RealPixelKernel<FixSignProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			switch (mode) {
@@ -2184,7 +2277,7 @@ The basic design of EMAN Processors: <br>\
 
 	/**f(x) = 0 if x = 0; f(x) = 1 if x != 0
 	 */
-	class BooleanProcessor:public RealPixelProcessor
+	class BooleanProcessor:public RealPixelKernel<BooleanProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2204,6 +2297,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<BooleanProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x != 0)
@@ -2216,7 +2311,7 @@ The basic design of EMAN Processors: <br>\
 	/**Reciprocal image as if f(x) != 0: f(x) = 1/f(x) else: f(x) = zero_to
 	 *@param zero_to  Inverted zero values are set to this value, default is 0
 	 */
-	class RecipCarefullyProcessor:public RealPixelProcessor
+	class RecipCarefullyProcessor:public RealPixelKernel<RecipCarefullyProcessor>
 	{
 		public:
 			string get_name() const
@@ -2249,6 +2344,8 @@ The basic design of EMAN Processors: <br>\
 			static const string NAME;
 
 		protected:
+			friend class RealPixelKernel<RecipCarefullyProcessor>;
+
 			void process_pixel(float *x) const
 			{
 				if (*x == 0.0) *x = zero_to;
@@ -2261,7 +2358,7 @@ The basic design of EMAN Processors: <br>\
 	/**Do a math power operation on image, f(x) = x ^ pow;
 	 *@param pow Each pixel is raised to this power
 	 */
-	class ValuePowProcessor:public RealPixelProcessor
+	class ValuePowProcessor:public RealPixelKernel<ValuePowProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2294,6 +2391,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<ValuePowProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x<0 && pwr!=(int)pwr) *x=0;
@@ -2305,7 +2404,7 @@ The basic design of EMAN Processors: <br>\
 
 	/**Do a square operation on image, f(x) = x * x;
 	 */
-	class ValueSquaredProcessor:public RealPixelProcessor
+	class ValueSquaredProcessor:public RealPixelKernel<ValueSquaredProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2326,6 +2425,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<ValueSquaredProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			(*x) *= (*x);
@@ -2334,7 +2435,7 @@ The basic design of EMAN Processors: <br>\
 
 	/**f(x) = sqrt(x)
 	 */
-	class ValueSqrtProcessor:public RealPixelProcessor
+	class ValueSqrtProcessor:public RealPixelKernel<ValueSqrtProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2354,13 +2455,15 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<ValueSqrtProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			*x = sqrt(*x);
 		}
 	};
 
-	class DiscritizeProcessor:public RealPixelProcessor
+	class DiscritizeProcessor:public RealPixelKernel<DiscritizeProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2400,16 +2503,23 @@ The basic design of EMAN Processors: <br>\
 	  protected:
 		float center,step;
 		
+		friend class RealPixelKernel<DiscritizeProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			*x = Util::fast_floor((*x-center)/(step*sigma)+0.5)*step;
 		}
+
+		int required_stats() const
+		{
+			return EMData::STAT_MOMENTS;
+		}
 	};
 
 	/**f(x) = x if x >= minval; f(x) = 0 if x < minval
 	*@param minval
 	 */
-	class ToZeroProcessor:public RealPixelProcessor
+	class ToZeroProcessor:public RealPixelKernel<ToZeroProcessor>
 	{
 		public:
 			string get_name() const
@@ -2435,6 +2545,8 @@ The basic design of EMAN Processors: <br>\
 			static const string NAME;
 
 		protected:
+			friend class RealPixelKernel<ToZeroProcessor>;
+
 			inline void process_pixel(float *x) const
 			{
 				if (*x < value) {
@@ -2446,7 +2558,7 @@ The basic design of EMAN Processors: <br>\
 	/**f(x) = x if x <= maxval; f(x) = 0 if x > maxval
 	 * @param maxval
 	 */
-	class AboveToZeroProcessor:public RealPixelProcessor
+	class AboveToZeroProcessor:public RealPixelKernel<AboveToZeroProcessor>
 	{
 	public:
 		string get_name() const
@@ -2472,6 +2584,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	protected:
+		friend class RealPixelKernel<AboveToZeroProcessor>;
+
 		inline void process_pixel(float *x) const
 		{
 			if (*x > value) {
@@ -2887,7 +3001,7 @@ The basic design of EMAN Processors: <br>\
 	/**f(x) = x-minval if x >= minval; f(x) = 0 if x < minval
 	 *@param minval the value that will be set to zero - all values below will also be set to zero. Values above get minval subtracted from them
 	 */
-	class CutToZeroProcessor:public RealPixelProcessor
+	class CutToZeroProcessor:public RealPixelKernel<CutToZeroProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2913,6 +3027,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<CutToZeroProcessor>;
+
 		void process_pixel(float *x) const
 		{
 		        *x = *x - value;
@@ -2925,7 +3041,7 @@ The basic design of EMAN Processors: <br>\
 	/**f(x) = 0 if x < value; f(x) = 1 if x >= value.
 	 *@param value The thresholding value. If a pixel value is equal to or above the threshold it is set to 1. If it is below it is set to 0
 	 */
-	class BinarizeProcessor:public RealPixelProcessor
+	class BinarizeProcessor:public RealPixelKernel<BinarizeProcessor>
 	{
 	  public:
 		string get_name() const
@@ -2951,6 +3067,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<BinarizeProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x < value)
@@ -3008,7 +3126,7 @@ The basic design of EMAN Processors: <br>\
 	 *@param range The range about 'value' which will be collapsed to 'value'
 	 *@param value The pixel value where the focus of the collapse operation is
 	 */
-	class CollapseProcessor:public RealPixelProcessor
+	class CollapseProcessor:public RealPixelKernel<CollapseProcessor>
 	{
 	  public:
 		string get_name() const
@@ -3044,6 +3162,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<CollapseProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x>value+range) *x-=range;
@@ -3057,7 +3177,7 @@ The basic design of EMAN Processors: <br>\
 	 *@param shift The amount to shift pixel values by before scaling
 	 *@param scale The scaling factor to be applied to pixel values
 	 */
-	class LinearXformProcessor:public RealPixelProcessor
+	class LinearXformProcessor:public RealPixelKernel<LinearXformProcessor>
 	{
 	  public:
 		LinearXformProcessor():shift(0), scale(0)
@@ -3096,6 +3216,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<LinearXformProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			*x = (*x) * scale + shift;
@@ -3110,7 +3232,7 @@ The basic design of EMAN Processors: <br>\
 	 *@param low Pixels are divided by (low - high) prior to the exponential operation
 	 *@param high Pixels are divided by (low - high) prior to the exponential operation
 	 */
-	class ExpProcessor:public RealPixelProcessor
+	class ExpProcessor:public RealPixelKernel<ExpProcessor>
 	{
 	  public:
 		ExpProcessor():low(0), high(0)
@@ -3150,6 +3272,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<ExpProcessor>;
+
 	/**
 	 * '40' is used to avoid floating number overflow.
 	 */
@@ -3170,7 +3294,7 @@ The basic design of EMAN Processors: <br>\
 	/**f(x) = f(x) if f(x) is finite | to if f(x) is not finite
 	 *@param to Pixels which are not finite will be set to this value
 	 */
-	class FiniteProcessor:public RealPixelProcessor
+	class FiniteProcessor:public RealPixelKernel<FiniteProcessor>
 	{
 		public:
 			FiniteProcessor():to(0)
@@ -3208,6 +3332,8 @@ The basic design of EMAN Processors: <br>\
 			static const string NAME;
 
 		protected:
+			friend class RealPixelKernel<FiniteProcessor>;
+
 			/**
 			*
 			*/
@@ -3220,7 +3346,7 @@ The basic design of EMAN Processors: <br>\
 	 *@param low The lower limit of the range that will be set to 1
 	 *@param high The upper limit of the range that will be set to 1
 	 */
-	class RangeThresholdProcessor:public RealPixelProcessor
+	class RangeThresholdProcessor:public RealPixelKernel<RangeThresholdProcessor>
 	{
 	  public:
 		RangeThresholdProcessor():low(0), high(0)
@@ -3259,6 +3385,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<RangeThresholdProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x >= low && *x <= high) {
@@ -3278,7 +3406,7 @@ The basic design of EMAN Processors: <br>\
 	 *@param value1 A number reflecting total standard deviations in the right direction
 	 *@param value2 A number reflecting total standard deviations in the left direction
 	 */
-	class SigmaProcessor:public RealPixelProcessor
+	class SigmaProcessor:public RealPixelKernel<SigmaProcessor>
 	{
 	  public:
 		string get_name() const
@@ -3313,6 +3441,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<SigmaProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x < (mean - value2 * sigma) || *x > (mean + value1 * sigma))
@@ -3321,6 +3451,11 @@ The basic design of EMAN Processors: <br>\
 			}
 		}
 
+		int required_stats() const
+		{
+			return EMData::STAT_MOMENTS;
+		}
+
 	  private:
 		float value1;
 		float value2;
@@ -3328,7 +3463,7 @@ The basic design of EMAN Processors: <br>\
 
 	/**f(x) = log10(x) if x > 0; else f(x) = 0
 	 */
-	class LogProcessor:public RealPixelProcessor
+	class LogProcessor:public RealPixelKernel<LogProcessor>
 	{
 	  public:
 		string get_name() const
@@ -3348,6 +3483,8 @@ The basic design of EMAN Processors: <br>\
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<LogProcessor>;
+
 		void process_pixel(float *x) const
 		{
 			if (*x > 0)
@@ -3385,6 +3522,13 @@ The basic design of EMAN Processors: <br>\
 		{
 			return true;
 		}
+		/** The image statistics (EMData::StatGroup bits) the processor uses, as
+		 * for RealPixelProcessor::required_stats()
+		 */
+		virtual int required_stats() const
+		{
+			return 0;
+		}
 
 		int nx;
 		int ny;
@@ -3720,6 +3864,11 @@ The basic design of EMAN Processors: <br>\
 				*pixel = Util::get_gauss_rand(mean, sigma);
 			}
 		}
+
+		int required_stats() const
+		{
+			return EMData::STAT_MOMENTS;
+		}
 	};
 
 	/**a gaussian falloff to zero, radius is the 1/e of the width.
@@ -4222,10 +4371,18 @@ width is also anisotropic and relative to the radii, with 1 being equal to the r
 
 
 	/**A processor for noise reduction. pixel = median of values surrounding pixel.
+	 * The box slides along the rows over a histogram of the values (Huang's algorithm), so
+	 * the cost per pixel grows with the radius rather than with the size of the box, and
+	 * the rows are split between threads.
+	 *@param radius The radius of the search box, default is 1 which results in a 3x3 box (3 = 2xradius + 1)
+	 *@param exact If set (default) the median is exact
+	 *@param levels Number of levels values are quantized to when exact is not set
 	 */
 	class BoxMedianProcessor:public BoxStatProcessor
 	{
 	  public:
+		void process_inplace(EMData * image);
+
 		string get_name() const
 		{
 			return NAME;
@@ -4240,46 +4397,29 @@ width is also anisotropic and relative to the radii, with 1 being equal to the r
 			return "A processor for noise reduction. pixel = median of values surrounding pixel.";
 		}
 
-		static const string NAME;
-
-	  protected:
-		void process_pixel(float *pixel, const float *array, int n) const
+		TypeDict get_param_types() const
 		{
-			float *data = new float[n];
-			memcpy(data, array, sizeof(float) * n);
+			TypeDict d = BoxStatProcessor::get_param_types();
+			d.put("exact", EMObject::BOOL, "If set (default) the median is exact. The histogram then has one level per distinct value, and if there are more than 65536 of those the boxes are sorted instead, which is much slower for large radii.");
+			d.put("levels", EMObject::INT, "When exact is not set, values are quantized to this many levels between the minimum and maximum, default 4096, at most 65536.");
+			return d;
+		}
 
-			for (int i = 0; i <= n / 2; i++)
-			{
-				for (int j = i + 1; j < n; j++)
-				{
-					if (data[i] < data[j]) {
-						float t = data[i];
-						data[i] = data[j];
-						data[j] = t;
-					}
-				}
-			}
+		static const string NAME;
 
-			if (n % 2 != 0)
-			{
-				*pixel = data[n / 2];
-			}
-			else {
-				*pixel = (data[n / 2] + data[n / 2 - 1]) / 2;
-			}
-			if( data )
-			{
-				delete[]data;
-				data = 0;
-			}
-		}
+	  private:
+		void process_pixel(float *, const float *, int) const {}	// unused, process_inplace() has no per-box loop
 	};
 
 	/**pixel = standard deviation of values surrounding pixel.
+	 * The box sums come from summed-area tables (Util::box_sums()), so the cost per pixel
+	 * does not depend on the radius.
 	 */
 	class BoxSigmaProcessor:public BoxStatProcessor
 	{
 	  public:
+		void process_inplace(EMData * image);
+
 		string get_name() const
 		{
 			return NAME;
@@ -4296,20 +4436,8 @@ width is also anisotropic and relative to the radii, with 1 being equal to the r
 
 		static const string NAME;
 
-	  protected:
-		void process_pixel(float *pixel, const float *data, int n) const
-		{
-			float sum = 0;
-			float square_sum = 0;
-			for (int i = 0; i < n; i++)
-			{
-				sum += data[i];
-				square_sum += data[i] * data[i];
-			}
-
-			float mean = sum / n;
-			*pixel = sqrt(square_sum / n - mean * mean);
-		}
+	  private:
+		void process_pixel(float *, const float *, int) const {}	// unused, process_inplace() has no per-box loop
 	};
 
 	/**peak processor: pixel = max of values surrounding pixel.
@@ -5409,6 +5537,7 @@ width is also anisotropic and relative to the radii, with 1 being equal to the r
 	 *@param value_sigma eans how large the voxel has impact on its in  range domain. The larger it is, the more blurry the resulting image.
 	 *@param niter how many times to apply this processing on your data.
 	 *@param half_width processing window size = (2 * half_widthh + 1) ^ 3.
+	 *@param grid use a bilateral grid instead of the window: a gaussian range kernel, and a cost which does not depend on distance_sigma.
 	 */
 	class BilateralProcessor:public Processor
 	{
@@ -5436,6 +5565,7 @@ width is also anisotropic and relative to the radii, with 1 being equal to the r
 			d.put("value_sigma", EMObject::FLOAT, "means how large the voxel has impact on its in  range domain. The larger it is, the more blurry the resulting image.");
 			d.put("niter", EMObject::INT, "how many times to apply this processing on your data.");
 			d.put("half_width", EMObject::INT, "processing window size = (2 * half_widthh + 1) ^ 3.");
+			d.put("grid", EMObject::BOOL, "approximate the filter with a bilateral grid, whose cost does not depend on distance_sigma, using a gaussian rather than Lorentzian value kernel. half_width is ignored. Default false");
 			return d;
 		}
 
@@ -7054,6 +7184,7 @@ correction is not possible, this will allow you to approximate the correction to
 	 *@param threshold an isosurface threshold at which all desired features are visible
 	 *@param radius a normalization size similar to an lp= value
 	 *@param apix Angstrom per pixel ratio
+	 *@param boxradius if > 0, average over boxes of 2*boxradius+1 pixels instead of Gaussian filtering
 	 */
 	class LocalNormProcessor:public Processor
 	{
@@ -7081,6 +7212,7 @@ correction is not possible, this will allow you to approximate the correction to
 			d.put("threshold", EMObject::FLOAT, "Only values above the threshold will be used to compute the normalization. Generally a good isosurface value.");
 			d.put("radius", EMObject::FLOAT, "Fourier filter radius expressed in pixels in Fourier space. cutoff_pixels in filter.lowpass.gauss");
 			d.put("apix", EMObject::FLOAT, "Angstroms per pixel");
+			d.put("boxradius", EMObject::INT, "If > 0, the local averages are taken over boxes of 2*boxradius+1 pixels on a side (clipped at the edges) using summed-area tables, instead of the Gaussian filters. radius and apix are then not used. Default 0");
 			return d;
 		}
 
@@ -7256,6 +7388,8 @@ correction is not possible, this will allow you to approximate the correction to
 			throw InvalidCallException("The directional sum processor does not work inplace");
 		}
 
+		virtual bool works_inplace() const { return false; }
+
 		virtual TypeDict get_param_types() const
 		{
 			TypeDict d;
@@ -7273,17 +7407,17 @@ correction is not possible, this will allow you to approximate the correction to
 		static const string NAME;
 	};
 
-	/**'paints' a circle into the image at x,y,z with values inside r1 set to v1, values between r1 and r2 will be set to a
-	 *	value between v1 and v2, and values outside r2 will be unchanged
-	 *	@param xpoints x coordinates
-	 *	@param ypoints y coordinates
-	 *	@param zpoints z coordinates
-	 *	@param minval min value
+	/** Watershed segmentation. Voxels above threshold are flooded from the local maxima in order of decreasing density,
+	 * through a bucket queue over the quantized density, and labeled with the segment number.
+	 *	@param nseg number of segments to produce
+	 *	@param thr density threshold
+	 *	@param segbymerge reach nseg by merging the most connected segments
+	 *	@param verbose print progress
+	 *	@param sparselabels keep the labels in tiles allocated on demand; the map itself must still be in memory
 	 */
 	class WatershedProcessor:public Processor
 	{
 	  public:
-		virtual EMData* process(const EMData* const image);
 		virtual void process_inplace(EMData*);
 
 		virtual string get_name() const
@@ -7298,7 +7432,7 @@ correction is not possible, this will allow you to approximate the correction to
 
 		virtual string get_desc() const
 		{
-			return "Watershed segmentation. Warning: uses up to 2.5x the map size in RAM. This will segment all voxels above threshold except for a 1-voxel wide border on all edges.";
+			return "Watershed segmentation by a priority flood from the local maxima, in order of decreasing density. The map must be fully in memory. Beyond it, labels take 2 bytes per voxel (less with sparselabels), and each voxel on the flood front takes a 16 byte queue entry. This will segment all voxels above threshold except for a 1-voxel wide border on all edges.";
 		}
 
 		virtual TypeDict get_param_types() const
@@ -7308,6 +7442,7 @@ correction is not possible, this will allow you to approximate the correction to
 			d.put("thr",EMObject::FLOAT,"Isosurface threshold value. Pixels below this value will not be segmented. All voxels above this value will be segmented. (default=0.5)");
 			d.put("segbymerge", EMObject::INT, "If set, will achieve the specified number of segments by progressively merging the most connected segments. Can produce very different results." );
 			d.put("verbose", EMObject::INT, "If set, will print console output while running" );
+			d.put("sparselabels", EMObject::BOOL, "If set, labels are stored in 32^3 tiles allocated only where the flood reaches, which saves label memory on large maps mostly below threshold. This does not reduce the memory for the map itself. (default=false)" );
 			return d;
 		}
 
@@ -7563,8 +7698,10 @@ correction is not possible, this will allow you to approximate the correction to
 	};
 
 	/**Iterative expansion of a binary mask, val1 is number of pixels to expand, if val2!=0 will make a soft Gaussian edge starting after val2 pixels.
+	 * All the shells come from one distance transform of the mask (Util::distance_transform).
 	 * @param val1 number of pixels to expand
 	 * @param val2 number of Gaussian pixels to expand, following the first expansion
+	 * @param euclidean grow round shells by euclidean distance rather than 6-connected (4 in 2D) steps
 	 */
 	class IterBinMaskProcessor:public Processor
 	{
@@ -7591,6 +7728,7 @@ correction is not possible, this will allow you to approximate the correction to
 			TypeDict d;
 			d.put("val1", EMObject::FLOAT, "number of pixels to expand");
 			d.put("val2", EMObject::FLOAT, "number of Gaussian pixels to expand, following the first expansion");
+			d.put("euclidean", EMObject::BOOL, "grow round shells by euclidean distance rather than 6-connected (4 in 2D) steps. Default false");
 			return d;
 		}
 
@@ -8828,6 +8966,7 @@ correction is not possible, this will allow you to approximate the correction to
 	public:
 		virtual EMData* process(const EMData* const image);
 		virtual void process_inplace(EMData * image);
+		virtual bool works_inplace() const { return false; }
 
 		virtual string get_name() const
 		{
@@ -9206,7 +9345,7 @@ correction is not possible, this will allow you to approximate the correction to
 	 *   @author: Muyuan Chen
 	 *   @date: 02/2016
 	 */
-	class ReplaceValuefromListProcessor:public RealPixelProcessor
+	class ReplaceValuefromListProcessor:public RealPixelKernel<ReplaceValuefromListProcessor>
 	{
 	  public:
 		string get_name() const
@@ -9226,9 +9365,16 @@ correction is not possible, this will allow you to approximate the correction to
 		static const string NAME;
 
 	  protected:
+		friend class RealPixelKernel<ReplaceValuefromListProcessor>;
+
+		void calc_locals(EMData *)
+		{
+			vector<float> colorlst = params["colorlst"];
+			lst.swap(colorlst);
+		}
+
 		void process_pixel(float *x) const
 		{
-			vector<float> lst =params["colorlst"];
 			int num=lst.size();
 			if (*x<num){
 				*x=lst[int(*x)];
@@ -9242,6 +9388,9 @@ correction is not possible, this will allow you to approximate the correction to
 		{
 			return "Replace the value of each pixel with a value in a given array, i.e. given an array of [3,7,9], pixels with value of 0 will become 3, 1 becomes 7, 2 becomes 9. The input image has to be int, or it will be round down. Values exceed the length of array are set to zero. Designed for labeled image coloring.";
 		}
+
+	  private:
+		vector<float> lst;
 	};
 
 #ifdef SPARX_USING_CUDA
@@ -9389,6 +9538,90 @@ correction is not possible, this will allow you to approximate the correction to
 #endif
 
 
+	/** A chain of processors, created once and applied in order to any number of images.
+	 * The steps are merged where that saves passes over the image:
+	 * - consecutive RealPixelProcessors run together, block by block, in one pass
+	 * - consecutive Fourier filters (Processor::is_fourier_filter()) become one filter,
+	 *   applied with a single FFT pair. The combined filter is computed for the first
+	 *   image and reused for the following ones with the same size and A/pix.
+	 * The result is that of applying the processors one by one, up to rounding.
+	 * A pipeline keeps state between images, so each thread should use its own.
+	 *@code
+	 *      ProcessorPipeline p;
+	 *      p.add("normalize.edgemean");
+	 *      p.add("filter.lowpass.gauss", Dict("cutoff_abs", 0.1f));
+	 *      p.add("filter.highpass.gauss", Dict("cutoff_abs", 0.01f));
+	 *      p.add("math.linear", Dict("scale", 2.0f));
+	 *      for (...) p.process_inplace(image);
+	 @endcode
+	 */
+	class ProcessorPipeline
+	{
+	  public:
+		ProcessorPipeline();
+
+		/** @param steps (processor name, parameters) pairs, in the order they are applied */
+		explicit ProcessorPipeline(const vector < pair < string, Dict > > & steps);
+
+		~ProcessorPipeline();
+
+		/** Append a processor to the pipeline.
+		 * @param processorname Processor name.
+		 * @param params Processor parameters.
+		 * @exception NotExistingObjectException if the processor doesn't exist.
+		 */
+		void add(const string & processorname, const Dict & params = Dict());
+
+		/** Apply all the processors to image. */
+		void process_inplace(EMData * image);
+
+		/** Apply all the processors to a copy of image.
+		 * @return the processed copy
+		 */
+		EMData *process(const EMData * const image);
+
+		/** @return the number of processors in the pipeline */
+		size_t get_num_steps() const
+		{
+			return steps.size();
+		}
+
+		/** @return the number of passes the pipeline makes over an image, after merging */
+		size_t get_num_passes() const
+		{
+			return stages.size();
+		}
+
+	  private:
+		enum StageType { STAGE_SINGLE, STAGE_PIXEL, STAGE_FOURIER };
+
+		struct Step
+		{
+			Processor *processor;
+			Dict params;		// as given, processors change their own copy
+		};
+
+		/** A run of steps [first, last) applied in one pass */
+		struct Stage
+		{
+			StageType type;
+			size_t first, last;
+			EMData *filter;		// STAGE_FOURIER: the merged filter, 0 until needed
+		};
+
+		void run_pixels(const Stage & stage, EMData * image);
+		static void pixel_worker(size_t begin, size_t end, void *arg);
+		void run_fourier(Stage & stage, EMData * image);
+		EMData *make_filter(const Stage & stage, const EMData * image);
+
+		// not copyable, the steps own their processors
+		ProcessorPipeline(const ProcessorPipeline &);
+		ProcessorPipeline & operator=(const ProcessorPipeline &);
+
+		vector < Step > steps;
+		vector < Stage > stages;
+	};
+
 	int multi_processors(EMData * image, vector < string > processornames);
 	void dump_processors();
 	map<string, vector<string> > dump_processors_list();
@@ -514,13 +514,12 @@ EMData* FourierIterReconstructor::preprocess_slice( const EMData* const slice,
 }
 
 int FourierIterReconstructor::insert_slice(const EMData* const slice, const Transform & arg, const float weight) { 
-	Transform * rotation;
-	rotation = new Transform(arg); // assignment operator
+	Transform rotation(arg);
 	// We must use only the rotational component of the transform, scaling, translation and mirroring
 	// are not implemented in Fourier space, but are in preprocess_slice
-	rotation->set_scale(1.0);
-	rotation->set_mirror(false);
-	rotation->set_trans(0,0,0);
+	rotation.set_scale(1.0);
+	rotation.set_mirror(false);
+	rotation.set_trans(0,0,0);
 
 //	if (slice->get_attr_default("reconstruct_preproc",(int) 0)) throw ImageDimensionException("ERROR: FourierIterReconstructor requires preprocess_slice() to be called in advance");
 
@@ -531,7 +530,7 @@ int FourierIterReconstructor::insert_slice(const EMData* const slice, const Tran
 	size_t ny2sq=ny*ny/4;
 	
 	for ( vector<Transform>::const_iterator it = syms.begin(); it != syms.end(); ++it ) {
-		Transform t3d = (*rotation)*(*it);
+		Transform t3d = rotation*(*it);
 		for (int y = -iny/2; y < iny/2; y++) {
 			for (int x = 0; x < inx/2; x++) {
 
@@ -638,7 +637,6 @@ int FourierIterReconstructor::insert_slice(const EMData* const slice, const Tran
 	}
 	
 	
-	delete rotation; rotation=0;
 	return 0;
 }
 
@@ -1037,31 +1035,25 @@ int FourierReconstructor::insert_slice(const EMData* const input_slice, const Tr
 
 	if (weight==0) return -1;
 	
-Transform * rotation;
-/*	if ( input_slice->has_attr("xform.projection") ) {
-		rotation = (Transform*) (input_slice->get_attr("xform.projection")); // assignment operator
-	} else {*/
-	rotation = new Transform(arg); // assignment operator
-// 	}
+	Transform rotation(arg);
 
 	EMData *slice;
 	if (input_slice->get_attr_default("reconstruct_preproc",(int) 0)) slice=input_slice->copy();
-	else slice = preprocess_slice( input_slice, *rotation);
+	else slice = preprocess_slice( input_slice, rotation);
 
 
 	// We must use only the rotational component of the transform, scaling, translation and mirroring
 	// are not implemented in Fourier space, but are in preprocess_slice
-	rotation->set_scale(1.0);
-	rotation->set_mirror(false);
-	rotation->set_trans(0,0,0);
+	rotation.set_scale(1.0);
+	rotation.set_mirror(false);
+	rotation.set_trans(0,0,0);
 
 	// Finally to the pixel wise slice insertion
 	//slice->copy_to_cuda();
 //	EMData *s2=slice->do_ift();
 //	s2->write_image("is.hdf",-1);
-	do_insert_slice_work(slice, *rotation, weight);
+	do_insert_slice_work(slice, rotation, weight);
 	
-	delete rotation; rotation=0;
 	delete slice;
 
 // 	image->update();
@@ -1163,24 +1155,23 @@ int FourierReconstructor::determine_slice_agreement(EMData*  input_slice, const
 	}
 #endif
 
-	Transform * rotation;
-	rotation = new Transform(arg); // assignment operator
+	Transform rotation(arg);
 
  	EMData *slice;
  	if (input_slice->get_attr_default("reconstruct_preproc",(int) 0)) slice=input_slice->copy();
- 	else slice = preprocess_slice( input_slice, *rotation);
+ 	else slice = preprocess_slice( input_slice, rotation);
 
 
 	// We must use only the rotational component of the transform, scaling, translation and mirroring
 	// are not implemented in Fourier space, but are in preprocess_slice
-	rotation->set_scale(1.0);
-	rotation->set_mirror(false);
-	rotation->set_trans(0,0,0);
-	if (sub) do_insert_slice_work(slice, *rotation, -weight);
+	rotation.set_scale(1.0);
+	rotation.set_mirror(false);
+	rotation.set_trans(0,0,0);
+	if (sub) do_insert_slice_work(slice, rotation, -weight);
 	// Remove the current slice first (not threadsafe, but otherwise performance would be awful)
 	
 	// Compare
-	do_compare_slice_work(slice, *rotation,weight);
+	do_compare_slice_work(slice, rotation,weight);
 
 	input_slice->set_attr("reconstruct_norm",slice->get_attr("reconstruct_norm"));
 	input_slice->set_attr("reconstruct_absqual",slice->get_attr("reconstruct_absqual"));
@@ -1189,9 +1180,8 @@ int FourierReconstructor::determine_slice_agreement(EMData*  input_slice, const
 	input_slice->set_attr("reconstruct_weight",slice->get_attr("reconstruct_weight"));
 
 	// Now put the slice back
-	if (sub) do_insert_slice_work(slice, *rotation, weight);
+	if (sub) do_insert_slice_work(slice, rotation, weight);
 
-	delete rotation;
 	delete slice;
 
 // 	image->update();
@@ -1475,31 +1465,25 @@ int WienerFourierReconstructor::insert_slice(const EMData* const input_slice, co
 	// Are these exceptions really necessary? (d.woolford)
 	if (!input_slice) throw NullPointerException("EMData pointer (input image) is NULL");
 
-	Transform * rotation;
-/*	if ( input_slice->has_attr("xform.projection") ) {
-		rotation = (Transform*) (input_slice->get_attr("xform.projection")); // assignment operator
-	} else {*/
-	rotation = new Transform(arg); // assignment operator
-// 	}
+	Transform rotation(arg);
 
 	if (!input_slice->has_attr("ctf_snr_total")) 
 		throw NotExistingObjectException("ctf_snr_total","No SNR information present in class-average. Must use the ctf.auto or ctfw.auto averager.");
 
 	EMData *slice;
 	if (input_slice->get_attr_default("reconstruct_preproc",(int) 0)) slice=input_slice->copy();
-	else slice = preprocess_slice( input_slice, *rotation);
+	else slice = preprocess_slice( input_slice, rotation);
 
 
 	// We must use only the rotational component of the transform, scaling, translation and mirroring
 	// are not implemented in Fourier space, but are in preprocess_slice
-	rotation->set_scale(1.0);
-	rotation->set_mirror(false);
-	rotation->set_trans(0,0,0);
+	rotation.set_scale(1.0);
+	rotation.set_mirror(false);
+	rotation.set_trans(0,0,0);
 
 	// Finally to the pixel wise slice insertion
-	do_insert_slice_work(slice, *rotation, weight);
+	do_insert_slice_work(slice, rotation, weight);
 
-	delete rotation; rotation=0;
 	delete slice;
 
 // 	image->update();
@@ -1566,27 +1550,26 @@ int WienerFourierReconstructor::determine_slice_agreement(EMData*  input_slice,
 	// Are these exceptions really necessary? (d.woolford)
 	if (!input_slice) throw NullPointerException("EMData pointer (input image) is NULL");
 
-	Transform * rotation;
-	rotation = new Transform(arg); // assignment operator
+	Transform rotation(arg);
 
  	EMData *slice;
  	if (input_slice->get_attr_default("reconstruct_preproc",(int) 0)) slice=input_slice->copy();
- 	else slice = preprocess_slice( input_slice, *rotation);
+ 	else slice = preprocess_slice( input_slice, rotation);
 
 
 	// We must use only the rotational component of the transform, scaling, translation and mirroring
 	// are not implemented in Fourier space, but are in preprocess_slice
-	rotation->set_scale(1.0);
-	rotation->set_mirror(false);
-	rotation->set_trans(0,0,0);
+	rotation.set_scale(1.0);
+	rotation.set_mirror(false);
+	rotation.set_trans(0,0,0);
 
 //	tmp_data->write_image("dbug.hdf",0);
 	
 	// Remove the current slice first (not threadsafe, but otherwise performance would be awful)
-	if (sub) do_insert_slice_work(slice, *rotation, -weight);
+	if (sub) do_insert_slice_work(slice, rotation, -weight);
 
 	// Compare
-	do_compare_slice_work(slice, *rotation,weight);
+	do_compare_slice_work(slice, rotation,weight);
 
 	input_slice->set_attr("reconstruct_norm",slice->get_attr("reconstruct_norm"));
 	input_slice->set_attr("reconstruct_absqual",slice->get_attr("reconstruct_absqual"));
@@ -1594,10 +1577,9 @@ int WienerFourierReconstructor::determine_slice_agreement(EMData*  input_slice,
 	input_slice->set_attr("reconstruct_weight",slice->get_attr("reconstruct_weight"));
 
 	// Now put the slice back
-	if (sub) do_insert_slice_work(slice, *rotation, weight);
+	if (sub) do_insert_slice_work(slice, rotation, weight);
 
 
-	delete rotation;
 	delete slice;
 
 // 	image->update();
@@ -1985,13 +1967,8 @@ void BaldwinWoolfordReconstructor::insert_density_at(const float& x, const float
 
 int BaldwinWoolfordReconstructor::insert_slice(const EMData* const input_slice, const Transform & t, const float weight)
 {
-	Transform * rotation;
-	if ( input_slice->has_attr("xform.projection") ) {
-		rotation = (Transform*) (input_slice->get_attr("xform.projection")); // assignment operator
-	} else {
-		rotation = new Transform(t); // assignment operator
-	}
-	Transform tmp(*rotation);
+	Transform rotation = input_slice->has_attr("xform.projection") ? input_slice->get_attr_transform(EMData::ATTR_XFORM_PROJECTION) : t;
+	Transform tmp(rotation);
 	tmp.set_rotation(Dict("type","eman")); // resets the rotation to 0 implicitly
 
 	Vec2f trans = tmp.get_trans_2d();
@@ -2032,9 +2009,9 @@ int BaldwinWoolfordReconstructor::insert_slice(const EMData* const input_slice,
 	vector<Transform> syms = Symmetry3D::get_symmetries((string)params["sym"]);
 // 	float weight = params.set_default("weight",1.0f);
 
-	rotation->set_scale(1.0); rotation->set_mirror(false); rotation->set_trans(0,0,0);
+	rotation.set_scale(1.0); rotation.set_mirror(false); rotation.set_trans(0,0,0);
 	for ( vector<Transform>::const_iterator it = syms.begin(); it != syms.end(); ++it ) {
-		Transform t3d = (*rotation)*(*it);
+		Transform t3d = rotation*(*it);
 
 		for (int y = 0; y < tny; y++) {
 			for (int x = 0; x < tnx; x++) {
@@ -2078,7 +2055,6 @@ int BaldwinWoolfordReconstructor::insert_slice(const EMData* const input_slice,
 		}
 	}
 
-	if(rotation) {delete rotation; rotation=0;}
 	delete slice;
 
 	return 0;
@@ -738,6 +738,7 @@ EMData* EMData::mult_radial(EMData* radial) {
 #define square(x) ((x)*(x))
 vector<float> EMData::cog() {
 
+	get_const_data();	// converts compact pixels, rdata is read directly below
 	vector<float> cntog;
 	int ndim = get_ndim();
 	int i=1,j=1,k=1;
@@ -4677,12 +4678,24 @@ EMData* EMData::ft2polar(int ring_length, int nb, int ne) {
 		vcos[x] = cos(ang);
 		//printf("trigtab   %d      %f      %f  %f\n",x,ang,vsin[x],vcos[x]);
 	}
+	// all the ring points are interpolated in one batch
+	size_t npoints = (size_t)lcirc*(ring_length/2);
+	vector<float> xnew(npoints), ynew(npoints);
+	vector< complex<float> > values(npoints);
+	size_t i = 0;
 	for (unsigned int inr = nb; inr <= ne; inr++) {
-		for (unsigned int it = 0; it < ring_length/2; it++) {
-			float xnew = vsin[it] * inr;
-			float ynew = vcos[it] * inr;
-			complex<float> v1 = (complex<float>)cimage->get_complex_at_interp(xnew,ynew);
-			//printf("   %d   %d       %f  %f      (%f , %f)\n",it,inr,xnew,ynew, std::real(v1), std::imag(v1));
+		for (unsigned int it = 0; it < ring_length/2; it++, i++) {
+			xnew[i] = vsin[it] * inr;
+			ynew[i] = vcos[it] * inr;
+		}
+	}
+	if (npoints > 0) cimage->get_complex_at_interp(&xnew[0], &ynew[0], npoints, &values[0]);
+
+	i = 0;
+	for (unsigned int inr = nb; inr <= ne; inr++) {
+		for (unsigned int it = 0; it < ring_length/2; it++, i++) {
+			complex<float> v1 = values[i];
+			//printf("   %d   %d       %f  %f      (%f , %f)\n",it,inr,xnew[i],ynew[i], std::real(v1), std::imag(v1));
 			rings->set_value_at(2*it,inr-nb,std::real(v1));
 			rings->set_value_at(2*it+1,inr-nb,std::imag(v1));
 			rings->set_value_at(2*it+ring_length,inr-nb,std::real(v1));
@@ -4731,15 +4744,26 @@ EMData* EMData::ft2polargrid(int ring_length, int nb, int ne, Util::KaiserBessel
 		//printf("trigtab   %d      %f      %f  %f\n",x,ang,vsin[x],vcos[x]);
 	}
 
+	size_t npoints = (size_t)lcirc*(ring_length/2);
+	vector<float> nuxold(npoints), nuyold(npoints);
+	vector< complex<float> > values(npoints);
+	size_t i = 0;
+	for (unsigned int inr = nb; inr <= ne; inr++) {
+		for (unsigned int it = 0; it < ring_length/2; it++, i++) {
+			nuxold[i] = vsin[it] * 2*inr;
+			nuyold[i] = vcos[it] * 2*inr;
+		//if(it ==0 && inr==nb) {nuxold[i]=0.0f; nuyold[i]=0.0f;}
+		}
+	}
+	if (npoints > 0) Util::extractpoints2(nx, ny, &nuxold[0], &nuyold[0], npoints, this, kb, &values[0]);
+
+	i = 0;
 	for (unsigned int inr = nb; inr <= ne; inr++) {
-		for (unsigned int it = 0; it < ring_length/2; it++) {
-			float nuxold = vsin[it] * 2*inr;
-			float nuyold = vcos[it] * 2*inr;
-		//if(it ==0 && inr==nb) {nuxold=0.0f; nuyold=0.0f;}
-			complex<float> v1 = Util::extractpoint2(nx, ny, nuxold, nuyold, this, kb);
+		for (unsigned int it = 0; it < ring_length/2; it++, i++) {
+			complex<float> v1 = values[i];
 			rings->cmplx(it,inr-nb) = v1;
 			rings->cmplx(it+ring_length/2,inr-nb) = std::conj(v1);
-			//printf("   %d   %d       %f  %f      (%f , %f)\n",2*it,inr,nuxold,nuyold, std::real(v1), std::imag(v1));
+			//printf("   %d   %d       %f  %f      (%f , %f)\n",2*it,inr,nuxold[i],nuyold[i], std::real(v1), std::imag(v1));
 			
 		}
 	}
@@ -4830,16 +4854,27 @@ EMData* EMData::fouriergridrot2d(float ang, float scale, Util::KaiserBessel& kb)
 	ang = ang*(float)deg_rad;
 	float cang = cos(ang);
 	float sang = sin(ang);
+	// the points inside the circle are gathered, then extracted in one batch
+	vector<float> nuxold, nuyold;
+	vector<int> ixs, iys;
 	for (int iy = -nyhalf; iy < nyhalf; iy++) {
 		float ycang = iy*cang;
 		float ysang = iy*sang;
 		for (int ix = 0; ix <= nxhalf; ix++) {
-			float nuxold = (ix*cang - ysang)*scale;
-			float nuyold = (ix*sang + ycang)*scale;
-			if (nuxold*nuxold+nuyold*nuyold<cir) result->cmplx(ix,iy) = Util::extractpoint2(nx, ny, nuxold, nuyold, this, kb);
+			float nux = (ix*cang - ysang)*scale;
+			float nuy = (ix*sang + ycang)*scale;
+			if (nux*nux+nuy*nuy<cir) {
+				nuxold.push_back(nux);
+				nuyold.push_back(nuy);
+				ixs.push_back(ix);
+				iys.push_back(iy);
+			}
 			//result->cmplx(ix,iy) = extractpoint(nuxold, nuyold, kb);
 		}
 	}
+	vector< complex<float> > values(ixs.size());
+	if (!ixs.empty()) Util::extractpoints2(nx, ny, &nuxold[0], &nuyold[0], ixs.size(), this, kb, &values[0]);
+	for (size_t i = 0; i < ixs.size(); i++) result->cmplx(ixs[i],iys[i]) = values[i];
 	result->set_array_offsets();
 	result->fft_shuffle(); // reset to an unshuffled result
 	result->update();
@@ -4871,13 +4906,24 @@ EMData* EMData::fouriergridrot_shift2d(float ang, float sx, float sy, Util::Kais
 	float cang = cos(ang);
 	float sang = sin(ang);
 	float temp = -2.0f*M_PI/nxreal;
+	size_t npoints = (size_t)ny*(nxhalf+1);
+	vector<float> nuxold(npoints), nuyold(npoints);
+	vector< complex<float> > values(npoints);
+	size_t i = 0;
 	for (int iy = -nyhalf; iy < nyhalf; iy++) {
 		float ycang = iy*cang;
 		float ysang = iy*sang;
-		for (int ix = 0; ix <= nxhalf; ix++) {
-			float nuxold = ix*cang - ysang;
-			float nuyold = ix*sang + ycang;
-			result->cmplx(ix,iy) = Util::extractpoint2(nx, ny, nuxold, nuyold, this, kb);
+		for (int ix = 0; ix <= nxhalf; ix++, i++) {
+			nuxold[i] = ix*cang - ysang;
+			nuyold[i] = ix*sang + ycang;
+		}
+	}
+	Util::extractpoints2(nx, ny, &nuxold[0], &nuyold[0], npoints, this, kb, &values[0]);
+
+	i = 0;
+	for (int iy = -nyhalf; iy < nyhalf; iy++) {
+		for (int ix = 0; ix <= nxhalf; ix++, i++) {
+			result->cmplx(ix,iy) = values[i];
 			//result->cmplx(ix,iy) = extractpoint(nuxold, nuyold, kb);
 			float phase_ang = temp*(sx*ix+sy*iy);
 			result->cmplx(ix,iy) *= complex<float>(cos(phase_ang), sin(phase_ang));
@@ -7172,6 +7218,7 @@ vector<float> EMData::peak_search(int ml, float invert) {
 #define Z(k) Z[k-1]
 vector<float> EMData::phase_cog()
 {
+	get_const_data();	// converts compact pixels, rdata is read directly below
 	vector<float> ph_cntog;
 	int i=1,j=1,k=1;
 	float C=0.f,S=0.f,P=0.f,F1=0.f,SNX;
@@ -7307,6 +7354,7 @@ vector<float> EMData::phase_cog()
 #define C (1.f-R)
 float EMData::find_3d_threshold(float mass, float pixel_size)
 {
+	get_const_data();	// converts compact pixels, rdata is read directly below
 	/* Exception Handle */
 	if(get_ndim()!=3)
 		throw ImageDimensionException("The image should be 3D");
@@ -89,6 +89,11 @@ namespace EMAN
 	  public:
 		//virtual void process_inplace(EMData * image);
 
+		bool is_fourier_filter() const
+		{
+			return true;
+		}
+
 		static string get_group_desc()
 		{
 			return "Fourier Filter Processors are frequency domain processors. The input image can be either real or Fourier, and the output processed image format corresponds to that of the input file. FourierFilter class is the base class of fourier space processors. The processors can be either low-pass, high-pass, band-pass, or homomorphic. The processor parameters are in absolute frequency units, valid range is ]0,0.5], where 0.5 is Nyquist freqeuncy. ";
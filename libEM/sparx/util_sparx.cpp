@@ -6623,8 +6623,8 @@ complex<float> Util::extractpoint2(int nx, int ny, float nuxnew, float nuynew, E
 	int iyn = int(Util::round(nuynew));
 
 	// set up some temporary weighting arrays
-	static float wy[7];
-	static float wx[7];
+	float wy[7];
+	float wx[7];
 
 	float iynn = nuynew - iyn;
 	wy[0] = kb.i0win_tab(iynn+3);
@@ -6690,6 +6690,44 @@ complex<float> Util::extractpoint2(int nx, int ny, float nuxnew, float nuynew, E
 	return result;
 }
 
+namespace {
+	struct ExtractJob
+	{
+		int nx, ny;
+		const float *nux, *nuy;
+		EMData *fimage;
+		Util::KaiserBessel *kb;
+		complex<float> *out;
+	};
+
+	void extract_worker(size_t begin, size_t end, void *arg)
+	{
+		const ExtractJob *job = static_cast<const ExtractJob *>(arg);
+		for (size_t i = begin; i < end; i++) {
+			job->out[i] = Util::extractpoint2(job->nx, job->ny, job->nux[i], job->nuy[i], job->fimage, *job->kb);
+		}
+	}
+}
+
+void Util::extractpoints2(int nx, int ny, const float *nux, const float *nuy, size_t n, EMData *fimage,
+						  Util::KaiserBessel& kb, complex<float> *out) {
+	if (nx - 2 != ny)
+		throw ImageDimensionException("extractpoint requires ny == nx");
+
+	// cmplx() calls get_data(), which must not copy the pixels from several threads at once
+	fimage->get_data();
+
+	ExtractJob job;
+	job.nx = nx;
+	job.ny = ny;
+	job.nux = nux;
+	job.nuy = nuy;
+	job.fimage = fimage;
+	job.kb = &kb;
+	job.out = out;
+	Util::parallel_for(n, extract_worker, &job, 0, 256);
+}
+
 /*
 complex<float> Util::extractpoint2(int nx, int ny, float nuxnew, float nuynew, EMData *fimage, Util::KaiserBessel& kb) {
 
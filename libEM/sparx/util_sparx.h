@@ -484,6 +484,12 @@ class FakeKaiserBessel : public KaiserBessel {
 
 		static std::complex<float> extractpoint2(int nx, int ny, float nuxnew, float nuynew, EMData *fimage, Util::KaiserBessel& kb);
 
+		/** extractpoint2() at the n points (nux[i], nuy[i]), split across get_num_threads()
+		 * threads. fimage must have the array offsets extractpoint2() expects.
+		 */
+		static void extractpoints2(int nx, int ny, const float *nux, const float *nuy, size_t n, EMData *fimage,
+								   Util::KaiserBessel& kb, std::complex<float> *out);
+
 		/*static float quadris(float x, float y, int nx, int ny, float* image);*/
 		static float bilinear(float xold, float yold, int nsam, int nrow, float* xim);
 
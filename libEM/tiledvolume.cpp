@@ -0,0 +1,556 @@
+/*
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cfloat>
+
+#include "tiledvolume.h"
+#include "processor.h"
+#include "util.h"
+
+using namespace EMAN;
+
+namespace {
+	const int DEFAULT_TILE_SIZE = 256;
+	const size_t DEFAULT_MEMORY_BUDGET = 1024;	// MB, EMAN2_TILE_MEMORY overrides
+
+	/** Copy the box [x0,x1)x[y0,y1)x[z0,z1) (volume coordinates) between two blocks of the volume
+	 * @param src the source block, whose (0,0,0) is at sx,sy,sz in the volume
+	 * @param dst the destination block, whose (0,0,0) is at dx,dy,dz in the volume
+	 */
+	void copy_box(const EMData *src, int sx, int sy, int sz, EMData *dst, int dx, int dy, int dz,
+				  int x0, int y0, int z0, int x1, int y1, int z1)
+	{
+		const float *s = src->get_const_data();
+		float *d = dst->get_data();
+		size_t snx = src->get_xsize(), sny = src->get_ysize();
+		size_t dnx = dst->get_xsize(), dny = dst->get_ysize();
+		size_t row = (x1 - x0) * sizeof(float);
+
+		for (int z = z0; z < z1; ++z) {
+			for (int y = y0; y < y1; ++y) {
+				const float *sp = s + (x0 - sx) + ((y - sy) + (z - sz) * sny) * snx;
+				float *dp = d + (x0 - dx) + ((y - dy) + (z - dz) * dny) * dnx;
+				EMUtil::em_memcpy(dp, sp, row);
+			}
+		}
+	}
+}
+
+TiledVolume::TiledVolume(const string & fname, bool rw, int tsize, size_t budget) :
+	filename(fname), writable(rw), nx(0), ny(0), nz(0), tile_size(tsize > 0 ? tsize : DEFAULT_TILE_SIZE),
+	ntx(0), nty(0), ntz(0), memory_budget(budget), cached_bytes(0)
+{
+	ENTERFUNC;
+
+	EMData hdr;
+	hdr.read_image(filename, 0, true);
+	nx = hdr.get_xsize();
+	ny = hdr.get_ysize();
+	nz = hdr.get_zsize();
+	attr_dict = hdr.get_attr_dict();
+
+	if (writable && (int)attr_dict["datatype"] != EMUtil::EM_FLOAT) {
+		throw ImageWriteException(filename, "TiledVolume can only modify files storing floats");
+	}
+
+	if (memory_budget == 0) {
+		const char *env = getenv("EMAN2_TILE_MEMORY");
+		long mb = env ? atol(env) : 0;
+		memory_budget = (mb > 0 ? (size_t)mb : DEFAULT_MEMORY_BUDGET) << 20;
+	}
+
+	ntx = (nx + tile_size - 1) / tile_size;
+	nty = (ny + tile_size - 1) / tile_size;
+	ntz = (nz + tile_size - 1) / tile_size;
+	on_disk.assign((size_t)ntx * nty * ntz, true);
+
+	EXITFUNC;
+}
+
+TiledVolume::~TiledVolume()
+{
+	if (writable) {
+		try {
+			flush();
+		}
+		catch (E2Exception & e) {
+			LOGERR("TiledVolume: failed to write %s: %s", filename.c_str(), e.what());
+		}
+	}
+
+	for (map<size_t, Tile>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+		delete it->second.data;
+	}
+}
+
+TiledVolume *TiledVolume::create(const string & filename, int nx, int ny, int nz, const Dict & attr_dict,
+								 int tile_size, size_t memory_budget)
+{
+	ENTERFUNC;
+
+	if (nx <= 0 || ny <= 0 || nz <= 0) {
+		throw InvalidValueException(nx <= 0 ? nx : (ny <= 0 ? ny : nz), "TiledVolume size <= 0");
+	}
+
+	EMUtil::ImageType imgtype = EMUtil::get_image_ext_type(Util::get_filename_ext(filename));
+	if (imgtype != EMUtil::IMAGE_MRC && imgtype != EMUtil::IMAGE_HDF) {
+		throw ImageFormatException("TiledVolume supports only MRC and HDF files");
+	}
+
+	if (Util::is_file_exist(filename)) remove(filename.c_str());
+
+	EMData hdr;
+	vector<string> keys = attr_dict.keys();
+	for (vector<string>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+		// the size is set below, and statistics of some other data would be wrong
+		if (*it == "nx" || *it == "ny" || *it == "nz" || *it == "minimum" || *it == "maximum" ||
+			*it == "mean" || *it == "sigma" || *it == "square_sum" || *it == "mean_nonzero" ||
+			*it == "sigma_nonzero" || *it == "median") continue;
+		hdr.set_attr(*it, attr_dict[*it]);
+	}
+	hdr.set_size(nx, ny, nz, true);		// header only, nothing is allocated
+
+	if (imgtype == EMUtil::IMAGE_HDF) {
+		// HdfIO2 creates the dataset without writing anything when there is no data
+		hdr.write_image(filename, 0, imgtype, false);
+	}
+	else {
+		// write the last voxel so the file has its full size and any region can be read
+		hdr.write_image(filename, 0, imgtype, true);
+		EMData last(1, 1, 1);
+		Region r(nx - 1, ny - 1, nz - 1, 1, 1, 1);
+		last.write_image(filename, 0, imgtype, false, &r);
+	}
+
+	TiledVolume *ret = new TiledVolume(filename, true, tile_size, memory_budget);
+	ret->on_disk.assign(ret->on_disk.size(), false);
+
+	EXITFUNC;
+	return ret;
+}
+
+Region TiledVolume::tile_region(size_t index) const
+{
+	int tx = index % ntx;
+	int ty = (index / ntx) % nty;
+	int tz = index / ((size_t)ntx * nty);
+
+	int x0 = tx * tile_size, y0 = ty * tile_size, z0 = tz * tile_size;
+
+	return Region(x0, y0, z0, Util::get_min(tile_size, nx - x0),
+				  Util::get_min(tile_size, ny - y0), Util::get_min(tile_size, nz - z0));
+}
+
+TiledVolume::Tile & TiledVolume::get_tile(size_t index, bool overwrite)
+{
+	map<size_t, Tile>::iterator it = tiles.find(index);
+	if (it != tiles.end()) {
+		lru.splice(lru.begin(), lru, it->second.lru_pos);
+		return it->second;
+	}
+
+	Region r = tile_region(index);
+	int w = (int)r.get_width(), h = (int)r.get_height(), d = (int)r.get_depth();
+	size_t bytes = (size_t)w * h * d * sizeof(float);
+	evict(bytes);
+
+	EMData *data = new EMData();
+	if (on_disk[index] && !overwrite) {
+		data->read_image(filename, 0, false, &r);
+	}
+	else {
+		data->set_size(w, h, d);
+		if (!overwrite) data->to_zero();
+	}
+
+	lru.push_front(index);
+	Tile & tile = tiles[index];
+	tile.data = data;
+	tile.dirty = false;
+	tile.lru_pos = lru.begin();
+	cached_bytes += bytes;
+
+	return tile;
+}
+
+void TiledVolume::evict(size_t bytes)
+{
+	while (!lru.empty() && cached_bytes + bytes > memory_budget) {
+		size_t index = lru.back();
+		Tile & tile = tiles[index];
+		if (tile.dirty) write_tile(tile, index);
+
+		cached_bytes -= tile.data->get_size() * sizeof(float);
+		delete tile.data;
+		tiles.erase(index);
+		lru.pop_back();
+	}
+}
+
+void TiledVolume::write_tile(Tile & tile, size_t index)
+{
+	Region r = tile_region(index);
+
+	// write_image may byte swap the data it writes, so write a (copy on write) copy
+	EMData *out = tile.data->copy();
+	out->write_image(filename, 0, EMUtil::IMAGE_UNKNOWN, false, &r, EMUtil::EM_FLOAT);
+	delete out;
+
+	tile.dirty = false;
+	on_disk[index] = true;
+}
+
+void TiledVolume::flush()
+{
+	for (map<size_t, Tile>::iterator it = tiles.begin(); it != tiles.end(); ++it) {
+		if (it->second.dirty) write_tile(it->second, it->first);
+	}
+}
+
+void TiledVolume::set_memory_budget(size_t bytes)
+{
+	memory_budget = bytes;
+	evict(0);
+}
+
+float TiledVolume::get_value_at(int x, int y, int z)
+{
+	if (x < 0 || y < 0 || z < 0 || x >= nx || y >= ny || z >= nz) return 0;
+
+	size_t index = x / tile_size + ntx * (y / tile_size + (size_t)nty * (z / tile_size));
+	return get_tile(index).data->get_value_at(x % tile_size, y % tile_size, z % tile_size);
+}
+
+void TiledVolume::set_value_at(int x, int y, int z, float v)
+{
+	if (!writable) throw ImageWriteException(filename, "TiledVolume is read only");
+	if (x < 0 || y < 0 || z < 0 || x >= nx || y >= ny || z >= nz) {
+		throw OutofRangeException(0, nx - 1, x, "TiledVolume::set_value_at");
+	}
+
+	size_t index = x / tile_size + ntx * (y / tile_size + (size_t)nty * (z / tile_size));
+	Tile & tile = get_tile(index);
+	tile.data->set_value_at_fast(x % tile_size, y % tile_size, z % tile_size, v);
+	tile.dirty = true;
+}
+
+EMData *TiledVolume::get_clip(const Region & area, float fill)
+{
+	ENTERFUNC;
+
+	int x0 = (int)area.x_origin(), y0 = (int)area.y_origin(), z0 = (int)area.z_origin();
+	int w = (int)area.get_width(), h = (int)area.get_height(), d = (int)area.get_depth();
+	if (h <= 0) h = 1;
+	if (d <= 0) d = 1;
+
+	EMData *ret = new EMData();
+	ret->set_size(w, h, d);
+	if (x0 < 0 || y0 < 0 || z0 < 0 || x0 + w > nx || y0 + h > ny || z0 + d > nz) ret->to_value(fill);
+
+	// the part inside the volume
+	int bx0 = Util::get_max(x0, 0), bx1 = Util::get_min(x0 + w, nx);
+	int by0 = Util::get_max(y0, 0), by1 = Util::get_min(y0 + h, ny);
+	int bz0 = Util::get_max(z0, 0), bz1 = Util::get_min(z0 + d, nz);
+
+	for (int tz = bz0 / tile_size; bz0 < bz1 && tz <= (bz1 - 1) / tile_size; ++tz) {
+		for (int ty = by0 / tile_size; by0 < by1 && ty <= (by1 - 1) / tile_size; ++ty) {
+			for (int tx = bx0 / tile_size; bx0 < bx1 && tx <= (bx1 - 1) / tile_size; ++tx) {
+				int tx0 = tx * tile_size, ty0 = ty * tile_size, tz0 = tz * tile_size;
+				Tile & tile = get_tile(tx + ntx * (ty + (size_t)nty * tz));
+				copy_box(tile.data, tx0, ty0, tz0, ret, x0, y0, z0,
+						 Util::get_max(bx0, tx0), Util::get_max(by0, ty0), Util::get_max(bz0, tz0),
+						 Util::get_min(bx1, tx0 + tile_size), Util::get_min(by1, ty0 + tile_size),
+						 Util::get_min(bz1, tz0 + tile_size));
+			}
+		}
+	}
+
+	ret->update();
+
+	EXITFUNC;
+	return ret;
+}
+
+void TiledVolume::insert_clip(const EMData * block, const IntPoint & origin)
+{
+	ENTERFUNC;
+
+	if (!writable) throw ImageWriteException(filename, "TiledVolume is read only");
+
+	int x0 = origin[0], y0 = origin[1], z0 = origin[2];
+	int bx0 = Util::get_max(x0, 0), bx1 = Util::get_min(x0 + block->get_xsize(), nx);
+	int by0 = Util::get_max(y0, 0), by1 = Util::get_min(y0 + block->get_ysize(), ny);
+	int bz0 = Util::get_max(z0, 0), bz1 = Util::get_min(z0 + block->get_zsize(), nz);
+
+	for (int tz = bz0 / tile_size; bz0 < bz1 && tz <= (bz1 - 1) / tile_size; ++tz) {
+		for (int ty = by0 / tile_size; by0 < by1 && ty <= (by1 - 1) / tile_size; ++ty) {
+			for (int tx = bx0 / tile_size; bx0 < bx1 && tx <= (bx1 - 1) / tile_size; ++tx) {
+				size_t index = tx + ntx * (ty + (size_t)nty * tz);
+				Region r = tile_region(index);
+				int tx0 = tx * tile_size, ty0 = ty * tile_size, tz0 = tz * tile_size;
+				int ix0 = Util::get_max(bx0, tx0), ix1 = Util::get_min(bx1, tx0 + (int)r.get_width());
+				int iy0 = Util::get_max(by0, ty0), iy1 = Util::get_min(by1, ty0 + (int)r.get_height());
+				int iz0 = Util::get_max(bz0, tz0), iz1 = Util::get_min(bz1, tz0 + (int)r.get_depth());
+
+				// a tile which is overwritten entirely need not be read first
+				bool whole = (ix0 == tx0 && iy0 == ty0 && iz0 == tz0 && ix1 - ix0 == (int)r.get_width() &&
+							  iy1 - iy0 == (int)r.get_height() && iz1 - iz0 == (int)r.get_depth());
+				Tile & tile = get_tile(index, whole);
+				copy_box(block, x0, y0, z0, tile.data, tx0, ty0, tz0, ix0, iy0, iz0, ix1, iy1, iz1);
+				tile.data->update();
+				tile.dirty = true;
+			}
+		}
+	}
+
+	EXITFUNC;
+}
+
+Dict TiledVolume::get_stats()
+{
+	ENTERFUNC;
+
+	double sum = 0, square_sum = 0;
+	float minval = FLT_MAX, maxval = -FLT_MAX;
+	size_t ntiles = on_disk.size();
+
+	for (size_t i = 0; i < ntiles; ++i) {
+		EMData *data = get_tile(i).data;
+		const float *d = data->get_const_data();
+		size_t n = data->get_size();
+		for (size_t j = 0; j < n; ++j) {
+			float v = d[j];
+			sum += v;
+			square_sum += v * (double)v;
+			if (v < minval) minval = v;
+			if (v > maxval) maxval = v;
+		}
+	}
+
+	// same definitions as the EMData attributes
+	double n = (double)nx * ny * nz;
+	double var = n > 1 ? (square_sum - sum * sum / n) / (n - 1) : 0;
+
+	Dict ret;
+	ret["mean"] = (float)(sum / n);
+	ret["sigma"] = (float)(var > 0 ? std::sqrt(var) : 0);
+	ret["square_sum"] = (float)square_sum;
+	ret["minimum"] = minval;
+	ret["maximum"] = maxval;
+
+	EXITFUNC;
+	return ret;
+}
+
+void TiledVolume::process_to(TiledVolume & out, const string & processorname, const Dict & params, int halo)
+{
+	ENTERFUNC;
+
+	string name = processorname;
+	Dict pp = params;
+
+	// normalization of the whole volume, with NormalizeProcessor's definitions of mean and sigma
+	if (name == "normalize" || name == "normalize.unitlen" || name == "normalize.unitsum" || name == "normalize.maxmin") {
+		Dict st = get_stats();
+		float mean = 0, sigma = 1;
+		if (name == "normalize") {
+			mean = st["mean"];
+			sigma = st["sigma"];
+		}
+		else if (name == "normalize.unitlen") {
+			sigma = std::sqrt((float)st["square_sum"]);
+			if (sigma == 0) sigma = 1;
+		}
+		else if (name == "normalize.unitsum") {
+			sigma = (float)st["mean"] * ((float)nx * ny * nz);
+			if (sigma == 0) sigma = 1;
+		}
+		else {
+			float maxval = st["maximum"], minval = st["minimum"];
+			mean = (maxval - minval) / 2;
+			sigma = (maxval + minval) / 2;
+		}
+
+		if (sigma == 0 || !Util::goodf(&sigma)) {
+			LOGWARN("cannot do normalization on image with sigma = 0");
+			sigma = 1;
+			mean = 0;
+		}
+
+		name = "math.linear";
+		pp.clear();
+		pp["scale"] = 1.0f / sigma;
+		pp["shift"] = -mean / sigma;
+		halo = 0;
+	}
+
+	Processor *proc = Factory < Processor >::get(name, pp);
+
+	// circular masks are centered on the volume, not on each tile
+	bool is_mask = (dynamic_cast < CircularMaskProcessor * >(proc) != 0);
+	float mdx = pp.set_default("dx", 0.0f), mdy = pp.set_default("dy", 0.0f), mdz = pp.set_default("dz", 0.0f);
+	if (is_mask && pp.has_key("outer_radius") && (float)pp["outer_radius"] < 0) {
+		pp["outer_radius"] = (float)(nx / 2 + (float)pp["outer_radius"] + 1);
+	}
+
+	size_t ntiles = on_disk.size();
+	for (size_t i = 0; i < ntiles; ++i) {
+		Region r = tile_region(i);
+		int x0 = (int)r.x_origin(), y0 = (int)r.y_origin(), z0 = (int)r.z_origin();
+		int w = (int)r.get_width(), h = (int)r.get_height(), d = (int)r.get_depth();
+
+		// the tile with its halo, clipped to the volume
+		int bx0 = Util::get_max(x0 - halo, 0), bx1 = Util::get_min(x0 + w + halo, nx);
+		int by0 = Util::get_max(y0 - halo, 0), by1 = Util::get_min(y0 + h + halo, ny);
+		int bz0 = Util::get_max(z0 - halo, 0), bz1 = Util::get_min(z0 + d + halo, nz);
+		EMData *block = get_clip(Region(bx0, by0, bz0, bx1 - bx0, by1 - by0, bz1 - bz0));
+
+		if (is_mask) {
+			pp["dx"] = (float)(nx / 2 - bx0 - (bx1 - bx0) / 2) + mdx;
+			pp["dy"] = (float)(ny / 2 - by0 - (by1 - by0) / 2) + mdy;
+			pp["dz"] = (float)(nz / 2 - bz0 - (bz1 - bz0) / 2) + mdz;
+			proc->set_params(pp);
+		}
+
+		proc->process_inplace(block);
+
+		if (halo > 0) {
+			EMData *inner = block->get_clip(Region(x0 - bx0, y0 - by0, z0 - bz0, w, h, d));
+			delete block;
+			block = inner;
+		}
+
+		out.insert_clip(block, IntPoint(x0, y0, z0));
+		delete block;
+	}
+
+	delete proc;
+
+	EXITFUNC;
+}
+
+void TiledVolume::process_inplace(const string & processorname, const Dict & params, int halo)
+{
+	ENTERFUNC;
+
+	if (!writable) throw ImageWriteException(filename, "TiledVolume is read only");
+
+	if (halo <= 0) {
+		process_to(*this, processorname, params, 0);
+	}
+	else {
+		// tiles must not be modified before their neighbors have been processed
+		string tmpname = Util::remove_filename_ext(filename) + ".tiledtmp." + Util::get_filename_ext(filename);
+		TiledVolume *tmp = process(tmpname, processorname, params, halo);
+
+		size_t ntiles = on_disk.size();
+		for (size_t i = 0; i < ntiles; ++i) {
+			Region r = tile_region(i);
+			EMData *block = tmp->get_clip(r);
+			insert_clip(block, IntPoint((int)r.x_origin(), (int)r.y_origin(), (int)r.z_origin()));
+			delete block;
+		}
+
+		delete tmp;
+		remove(tmpname.c_str());
+	}
+
+	EXITFUNC;
+}
+
+TiledVolume *TiledVolume::process(const string & outfile, const string & processorname, const Dict & params, int halo)
+{
+	TiledVolume *out = create(outfile, nx, ny, nz, attr_dict, tile_size, memory_budget);
+	process_to(*out, processorname, params, halo);
+	out->flush();
+
+	return out;
+}
+
+TiledVolume *TiledVolume::bin(const string & outfile, int factor)
+{
+	ENTERFUNC;
+
+	if (factor < 1) throw InvalidValueException(factor, "TiledVolume::bin factor must be >= 1");
+
+	int onx = nx / factor, ony = ny / factor, onz = nz > 1 ? nz / factor : 1;
+	if (onx < 1 || ony < 1 || onz < 1) throw InvalidValueException(factor, "TiledVolume::bin factor larger than the volume");
+
+	Dict dict = attr_dict;
+	if (dict.has_key("apix_x")) dict["apix_x"] = (float)dict["apix_x"] * factor;
+	if (dict.has_key("apix_y")) dict["apix_y"] = (float)dict["apix_y"] * factor;
+	if (dict.has_key("apix_z") && nz > 1) dict["apix_z"] = (float)dict["apix_z"] * factor;
+	TiledVolume *out = create(outfile, onx, ony, onz, dict, tile_size, memory_budget);
+
+	// blocks of about one input tile, made of whole factor^3 cells
+	int step = Util::get_max(tile_size / factor, 1);
+	int zfactor = nz > 1 ? factor : 1;
+
+	Dict shrink;
+	shrink["n"] = (float)factor;
+
+	for (int z = 0; z < onz; z += step) {
+		for (int y = 0; y < ony; y += step) {
+			for (int x = 0; x < onx; x += step) {
+				int w = Util::get_min(step, onx - x), h = Util::get_min(step, ony - y), d = Util::get_min(step, onz - z);
+				EMData *block = get_clip(Region(x * factor, y * factor, z * zfactor, w * factor, h * factor, d * zfactor));
+				block->process_inplace("math.meanshrink", shrink);
+				out->insert_clip(block, IntPoint(x, y, z));
+				delete block;
+			}
+		}
+	}
+
+	out->flush();
+
+	EXITFUNC;
+	return out;
+}
+
+void TiledVolume::mult(TiledVolume & image)
+{
+	ENTERFUNC;
+
+	if (!writable) throw ImageWriteException(filename, "TiledVolume is read only");
+	if (image.nx != nx || image.ny != ny || image.nz != nz) {
+		throw ImageDimensionException("can not multiply volumes of different sizes");
+	}
+
+	size_t ntiles = on_disk.size();
+	for (size_t i = 0; i < ntiles; ++i) {
+		EMData *other = image.get_clip(tile_region(i));		// first, image may be this
+		Tile & tile = get_tile(i);
+		tile.data->mult(*other);
+		tile.dirty = true;
+		delete other;
+	}
+
+	EXITFUNC;
+}
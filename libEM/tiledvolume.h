@@ -0,0 +1,204 @@
+/*
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef eman__tiledvolume_h__
+#define eman__tiledvolume_h__
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "emdata.h"
+
+using std::list;
+using std::map;
+using std::vector;
+
+namespace EMAN
+{
+	/** TiledVolume is a disk backed 3D volume for maps which do not fit in memory, such as
+	 * 4k x 4k x 2k tomograms. The volume is split into cubic tiles, which are read and
+	 * written through the regular EMData region I/O (MRC or HDF files) and kept in an LRU
+	 * cache limited by a memory budget. Modified tiles are written back when they are
+	 * evicted, on flush() and when the TiledVolume is deleted.
+	 *
+	 * Processors can be streamed over the tiles with process() / process_inplace(). Each
+	 * tile is processed together with a halo of its neighbors, which must be at least as wide
+	 * as the processor's reach (e.g. ~3 sigma of a real space Gaussian filter) for the result
+	 * to match processing the whole volume. Circular masks (mask.sharp, mask.soft, ...) are
+	 * centered on the volume rather than on each tile, and normalize, normalize.unitlen,
+	 * normalize.unitsum and normalize.maxmin use the statistics of the whole volume. Other
+	 * processors which depend on global properties of the image only see one tile at a time.
+	 *
+	 * The header statistics of files written this way are not updated.
+	 */
+	class TiledVolume
+	{
+	  public:
+		/** Open an existing volume.
+		 * @param filename MRC or HDF file containing a single volume
+		 * @param writable true to allow modifying the file
+		 * @param tile_size the edge length of the tiles, 0 for the default (256)
+		 * @param memory_budget maximum bytes of tile data to cache, 0 for the default (1 GB)
+		 * @exception ImageReadException if the file can not be read
+		 */
+		explicit TiledVolume(const string & filename, bool writable = false, int tile_size = 0, size_t memory_budget = 0);
+
+		/** Writes back any modified tiles. */
+		~TiledVolume();
+
+		/** Create a new zero filled volume on disk. No memory is allocated for the data.
+		 * @param filename the new MRC or HDF file. It is overwritten if it exists.
+		 * @param nx the x size of the volume
+		 * @param ny the y size of the volume
+		 * @param nz the z size of the volume
+		 * @param attr_dict header attributes to store, e.g. apix_x
+		 * @param tile_size the edge length of the tiles, 0 for the default
+		 * @param memory_budget maximum bytes of tile data to cache, 0 for the default
+		 * @return a writable TiledVolume, to be deleted by the caller
+		 * @exception ImageFormatException if filename is not an MRC or HDF file
+		 */
+		static TiledVolume *create(const string & filename, int nx, int ny, int nz, const Dict & attr_dict = Dict(),
+								   int tile_size = 0, size_t memory_budget = 0);
+
+		string get_filename() const { return filename; }
+		int get_xsize() const { return nx; }
+		int get_ysize() const { return ny; }
+		int get_zsize() const { return nz; }
+		int get_tile_size() const { return tile_size; }
+
+		/** @return the header attributes of the volume */
+		Dict get_attr_dict() const { return attr_dict; }
+
+		/** Change the memory budget, evicting tiles if it shrank
+		 * @param bytes maximum bytes of tile data to cache. At least one tile is always cached.
+		 */
+		void set_memory_budget(size_t bytes);
+		size_t get_memory_budget() const { return memory_budget; }
+
+		/** @return bytes of tile data currently cached */
+		size_t get_cached_bytes() const { return cached_bytes; }
+
+		float get_value_at(int x, int y, int z);
+		void set_value_at(int x, int y, int z, float v);
+
+		/** Read a block of the volume into memory. The region may extend outside the volume.
+		 * @param area the block to read
+		 * @param fill the value for voxels outside the volume
+		 * @return the block, to be deleted by the caller
+		 */
+		EMData *get_clip(const Region & area, float fill = 0);
+
+		/** Write a block into the volume. The parts of the block outside the volume are ignored.
+		 * @param block the data to write
+		 * @param origin the position of the block's (0,0,0) in the volume
+		 */
+		void insert_clip(const EMData * block, const IntPoint & origin);
+
+		/** Compute the statistics of the whole volume by streaming over the tiles.
+		 * @return mean, sigma, square_sum, minimum and maximum
+		 */
+		Dict get_stats();
+
+		/** Apply a processor to the volume tile by tile, writing the result back to this file.
+		 * With a halo, neighboring tiles must be read before they are modified, so the result
+		 * is first streamed to a temporary file next to this one.
+		 * @param processorname the processor
+		 * @param params the processor parameters
+		 * @param halo the number of voxels of context around each tile the processor sees
+		 */
+		void process_inplace(const string & processorname, const Dict & params = Dict(), int halo = 0);
+
+		/** Apply a processor to the volume tile by tile, writing the result to a new file.
+		 * @param outfile the file to create for the result
+		 * @param processorname the processor
+		 * @param params the processor parameters
+		 * @param halo the number of voxels of context around each tile the processor sees
+		 * @return the processed volume, to be deleted by the caller
+		 */
+		TiledVolume *process(const string & outfile, const string & processorname, const Dict & params = Dict(), int halo = 0);
+
+		/** Bin the volume by averaging factor^3 blocks of voxels (like math.meanshrink).
+		 * @param outfile the file to create for the result
+		 * @param factor the integer binning factor
+		 * @return the binned volume, to be deleted by the caller
+		 */
+		TiledVolume *bin(const string & outfile, int factor);
+
+		/** Multiply the volume voxel by voxel by another volume of the same size, e.g. a mask.
+		 * @param image the volume to multiply by
+		 */
+		void mult(TiledVolume & image);
+
+		/** Write all modified tiles to the file. */
+		void flush();
+
+	  private:
+		TiledVolume(const TiledVolume &);
+		TiledVolume & operator=(const TiledVolume &);
+
+		struct Tile
+		{
+			EMData *data;
+			bool dirty;
+			list<size_t>::iterator lru_pos;
+		};
+
+		/** @return the region of the volume covered by tile index */
+		Region tile_region(size_t index) const;
+
+		/** Get a tile, reading it unless it is cached. The tile becomes the most recently used.
+		 * @param index the tile index
+		 * @param overwrite the caller will overwrite the entire tile, so its data need not be read
+		 */
+		Tile & get_tile(size_t index, bool overwrite = false);
+
+		/** Write back and drop least recently used tiles until another bytes fit the budget */
+		void evict(size_t bytes);
+		void write_tile(Tile & tile, size_t index);
+
+		/** Stream processorname over the tiles of this volume into out (of the same size) */
+		void process_to(TiledVolume & out, const string & processorname, const Dict & params, int halo);
+
+		string filename;
+		bool writable;
+		int nx, ny, nz;
+		int tile_size;
+		int ntx, nty, ntz;
+		Dict attr_dict;
+
+		size_t memory_budget;
+		size_t cached_bytes;
+		map<size_t, Tile> tiles;
+		list<size_t> lru;			// most recently used first
+
+		/** tiles which exist in the file. A new volume has none, they read as zero. */
+		vector<bool> on_disk;
+	};
+}
+
+#endif	//eman__tiledvolume_h__
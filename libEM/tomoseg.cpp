@@ -26,6 +26,7 @@
  */
 
 #include "tomoseg.h"
+#include "util.h"
 #include <algorithm>
 using namespace EMAN;
 
@@ -148,46 +149,48 @@ int TomoSeg::generate_objects(int numo, float maxdist, int nowslice){
 		return 0;
 	}
 
-	// Calculate area of each segment	
-	EMData *rank=skelmap->process("threshold.notzero");
-	rank->process_inplace("morph.object.density",Dict("thresh",0,"more_neighbor",true));
-	int nx=rank->get_xsize();
-	int ny=rank->get_ysize();
+	// Label the 8-connected segments and rank them by area
+	int nx=skelmap->get_xsize();
+	int ny=skelmap->get_ysize();
+	EMData *bw=skelmap->process("threshold.notzero");
+	vector<int> labels((size_t)nx*ny);
+	vector<Util::Component> segs=Util::label_components(bw->get_const_data(),&labels[0],nx,ny,1,0.5f,18);
+	delete bw;
+
+	vector< std::pair<int,int> > rank;	// (-area, label), so the largest come first
+	for (int i=0; i<(int)segs.size(); i++)
+		rank.push_back(std::make_pair(-(int)segs[i].voxels,i+1));
+	std::sort(rank.begin(),rank.end());
 	
-	// Take numo largest objects
-	for (int i=0; i<numo; i++){
-		float max=rank->get_attr("maximum");
-		vector <Vec3i> pts;
-		float curid=-1;
-		bool branch=false;
-		if (max<=0)
-			break;
-		for (int x=0; x<nx; x++){
-			for (int y=0; y<ny; y++){
-				if (rank->get_value_at(x,y)==max){
-					if (curid<0)
-						curid=skelmap->get_value_at(x,y);
-					if (curid==skelmap->get_value_at(x,y)){
-						int nb=check_neighbors(x,y);
-						if (nb>2) branch=true;
-						pts.push_back(Vec3i(x,y,nb));
-						rank->set_value_at_fast(x,y,0);
-					}
-				}
-			}
+	// Take numo largest objects, collecting their points in one pass
+	int nobj=std::min(numo,(int)rank.size());
+	vector<int> slot(segs.size()+1,-1);
+	for (int i=0; i<nobj; i++) slot[rank[i].second]=i;
+	vector< vector<Vec3i> > pts(nobj);
+	vector<bool> branch(nobj,false);
+	for (int x=0; x<nx; x++){
+		for (int y=0; y<ny; y++){
+			int s=slot[labels[x+(size_t)y*nx]];
+			if (s<0)
+				continue;
+			int nb=check_neighbors(x,y);
+			if (nb>2) branch[s]=true;
+			pts[s].push_back(Vec3i(x,y,nb));
 		}
-		if(verb) printf("id=%d,  size=%d",int(curid),int(pts.size()));
-		if (branch){
+	}
+
+	for (int i=0; i<nobj; i++){
+		if(verb) printf("id=%d,  size=%d",int(skelmap->get_value_at(pts[i][0][0],pts[i][0][1])),int(pts[i].size()));
+		if (branch[i]){
 			if (verb) printf("\n\thave branch, throw out.\n");
 		}
 		else{
-			objs.push_back(TomoObject(pts,maxdist,nowslice));
+			objs.push_back(TomoObject(pts[i],maxdist,nowslice));
 			if (verb) printf("   \t%d points\n",objs.back().get_size() );
 		}
 		
 	}
 	
-	delete rank;
 	return 1;
 }
 
@@ -44,6 +44,7 @@
 #include <sstream>
 
 #include <cstring>
+#include <climits>
 
 #include <ctype.h>
 #include <sys/types.h>
@@ -97,6 +98,466 @@ int Util::MUTEX_UNLOCK(MUTEX *mutex)
 }
 
 
+namespace {
+	int num_threads = 0;	// 0 until initialized from the environment
+
+	struct ParallelRange
+	{
+		size_t begin, end;
+		Util::RangeWorker worker;
+		void *arg;
+	};
+
+#ifdef WIN32
+	unsigned __stdcall parallel_range_thread(void *r)
+#else
+	void *parallel_range_thread(void *r)
+#endif
+	{
+		ParallelRange *range = static_cast<ParallelRange *>(r);
+		range->worker(range->begin, range->end, range->arg);
+		return 0;
+	}
+}
+
+void Util::set_num_threads(int nthreads)
+{
+	if (nthreads < 1) throw InvalidValueException(nthreads, "The number of threads must be at least 1");
+	num_threads = nthreads;
+}
+
+int Util::get_num_threads()
+{
+	if (num_threads == 0) {
+		const char *env = getenv("EMAN2_NUM_THREADS");
+		int nt = (env == NULL) ? 1 : atoi(env);
+		num_threads = (nt < 1) ? 1 : nt;
+	}
+	return num_threads;
+}
+
+void Util::parallel_for(size_t n, RangeWorker worker, void *arg, int nthreads, size_t min_per_thread)
+{
+	if (n == 0) return;
+	if (nthreads <= 0) nthreads = get_num_threads();
+	if (min_per_thread < 1) min_per_thread = 1;
+	if ((size_t)nthreads > n / min_per_thread) nthreads = (int)(n / min_per_thread);
+	if (nthreads <= 1) {
+		worker(0, n, arg);
+		return;
+	}
+
+	vector<ParallelRange> ranges(nthreads);
+	for (int i = 0; i < nthreads; ++i) {
+		ranges[i].begin = n * i / nthreads;
+		ranges[i].end = n * (i + 1) / nthreads;
+		ranges[i].worker = worker;
+		ranges[i].arg = arg;
+	}
+
+#ifdef WIN32
+	vector<HANDLE> threads(nthreads, (HANDLE)0);
+	for (int i = 1; i < nthreads; ++i) {
+		threads[i] = (HANDLE)_beginthreadex(NULL, 0, parallel_range_thread, &ranges[i], 0, NULL);
+		if (threads[i] == 0) parallel_range_thread(&ranges[i]);
+	}
+	parallel_range_thread(&ranges[0]);
+	for (int i = 1; i < nthreads; ++i) {
+		if (threads[i] != 0) {
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+	}
+#else
+	vector<pthread_t> threads(nthreads);
+	vector<bool> started(nthreads, false);
+	for (int i = 1; i < nthreads; ++i) {
+		started[i] = (pthread_create(&threads[i], NULL, parallel_range_thread, &ranges[i]) == 0);
+		// if the thread can't be created, do the work here instead
+		if (!started[i]) parallel_range_thread(&ranges[i]);
+	}
+	parallel_range_thread(&ranges[0]);
+	for (int i = 1; i < nthreads; ++i) {
+		if (started[i]) pthread_join(threads[i], NULL);
+	}
+#endif	//WIN32
+}
+
+namespace {
+	struct BoxSumsJob
+	{
+		const float *data;
+		int nx, ny, nz;
+		int x0, y0, z0, bx, by, bz;
+		bool squares;
+		Util::BoxSumsSlice slice;
+		void *arg;
+	};
+
+	/* The 2D box sums of input slice z added to (sign 1) or subtracted from (sign -1)
+	 * sums, using the summed-area table of the slice: table[x + y * (nx + 1)] is the sum
+	 * (of squares) over [0, x) * [0, y).
+	 */
+	void add_slice_box_sums(const BoxSumsJob *job, int z, bool squares, double sign, vector<double> & table, double *sums)
+	{
+		const int nx = job->nx, ny = job->ny, tx = nx + 1;
+		const float *data = job->data + (size_t)z * nx * ny;
+
+		for (int y = 0; y < ny; ++y) {
+			const float *row = data + (size_t)y * nx;
+			const double *above = &table[(size_t)y * tx];
+			double *t = &table[(size_t)(y + 1) * tx];
+			double run = 0;
+			for (int x = 0; x < nx; ++x) {
+				run += squares ? (double)row[x] * row[x] : row[x];
+				t[x + 1] = above[x + 1] + run;
+			}
+		}
+
+		for (int y = 0; y < ny; ++y) {
+			const int ylo = std::max(0, std::min(ny, y + job->y0));
+			const int yhi = std::max(0, std::min(ny, y + job->y0 + job->by));
+			const double *lo = &table[(size_t)ylo * tx], *hi = &table[(size_t)yhi * tx];
+			double *s = sums + (size_t)y * nx;
+			for (int x = 0; x < nx; ++x) {
+				const int xlo = std::max(0, std::min(nx, x + job->x0));
+				const int xhi = std::max(0, std::min(nx, x + job->x0 + job->bx));
+				s[x] += sign * (hi[xhi] - hi[xlo] - lo[xhi] + lo[xlo]);
+			}
+		}
+	}
+
+	void box_sums_worker(size_t begin, size_t end, void *arg)
+	{
+		const BoxSumsJob *job = static_cast<const BoxSumsJob *>(arg);
+		const size_t nxy = (size_t)job->nx * job->ny;
+		vector<double> table((size_t)(job->nx + 1) * (job->ny + 1), 0.0);
+		vector<double> sums(nxy, 0.0), sums2(job->squares ? nxy : 0, 0.0);
+
+		for (int sq = 0; sq <= (job->squares ? 1 : 0); ++sq) {
+			double *s = sq ? &sums2[0] : &sums[0];
+			// the box of the first slice, less its last input slice
+			for (int z = (int)begin + job->z0; z < (int)begin + job->z0 + job->bz - 1; ++z) {
+				if (z >= 0 && z < job->nz) add_slice_box_sums(job, z, sq != 0, 1, table, s);
+			}
+		}
+
+		for (size_t k = begin; k < end; ++k) {
+			const int last = (int)k + job->z0 + job->bz - 1, first = (int)k + job->z0;
+			for (int sq = 0; sq <= (job->squares ? 1 : 0); ++sq) {
+				if (last >= 0 && last < job->nz) add_slice_box_sums(job, last, sq != 0, 1, table, sq ? &sums2[0] : &sums[0]);
+			}
+			job->slice((int)k, &sums[0], job->squares ? &sums2[0] : 0, job->arg);
+			for (int sq = 0; sq <= (job->squares ? 1 : 0); ++sq) {
+				if (first >= 0 && first < job->nz) add_slice_box_sums(job, first, sq != 0, -1, table, sq ? &sums2[0] : &sums[0]);
+			}
+		}
+	}
+}
+
+void Util::box_sums(const float *data, int nx, int ny, int nz, int x0, int y0, int z0, int bx, int by, int bz,
+					bool squares, BoxSumsSlice slice, void *arg)
+{
+	if (bx < 1 || by < 1 || bz < 1) throw InvalidValueException(std::min(bx, std::min(by, bz)), "box sizes must be at least 1");
+
+	BoxSumsJob job;
+	job.data = data;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.x0 = x0;
+	job.y0 = y0;
+	job.z0 = z0;
+	job.bx = bx;
+	job.by = by;
+	job.bz = bz;
+	job.squares = squares;
+	job.slice = slice;
+	job.arg = arg;
+
+	// each thread first sums bz - 1 slices to start its running sum
+	parallel_for(nz, box_sums_worker, &job, 0, std::max(4, bz));
+}
+
+namespace {
+	const size_t DISTANCE_MIN_LINES = 16;
+
+	struct DistanceJob
+	{
+		const float *data;
+		float *dist;
+		int nx, ny, nz;
+		int axis;			// the lines run along x, y or z
+		bool euclidean;
+		bool first, last;	// the first pass reads data, the last one writes the final distances
+	};
+
+	/* Squared euclidean distance transform of one line: d[q] = min over p of (q - p)^2 + f[p],
+	 * the lower envelope of the parabolas rooted at the p with f[p] < FLT_MAX. v holds the
+	 * roots of the envelope and z the boundaries between them.
+	 */
+	void euclidean_distance_line(const double *f, double *d, int n, int *v, double *z)
+	{
+		int k = -1;
+		for (int q = 0; q < n; ++q) {
+			if (f[q] >= FLT_MAX) continue;
+			double s = 0;
+			while (k >= 0) {
+				s = ((f[q] + (double)q * q) - (f[v[k]] + (double)v[k] * v[k])) / (2.0 * (q - v[k]));
+				if (s > z[k]) break;
+				k--;
+			}
+			k++;
+			v[k] = q;
+			z[k] = k ? s : -FLT_MAX;
+		}
+
+		if (k < 0) {
+			for (int q = 0; q < n; ++q) d[q] = FLT_MAX;
+			return;
+		}
+		z[k + 1] = FLT_MAX;
+
+		k = 0;
+		for (int q = 0; q < n; ++q) {
+			while (z[k + 1] < q) k++;
+			d[q] = (double)(q - v[k]) * (q - v[k]) + f[v[k]];
+		}
+	}
+
+	/* City-block distance transform of one line: d[q] = min over p of |q - p| + f[p] */
+	void cityblock_distance_line(const double *f, double *d, int n)
+	{
+		d[0] = f[0];
+		for (int q = 1; q < n; ++q) d[q] = std::min(f[q], d[q - 1] + 1);
+		for (int q = n - 2; q >= 0; --q) d[q] = std::min(d[q], d[q + 1] + 1);
+	}
+
+	void distance_worker(size_t begin, size_t end, void *arg)
+	{
+		const DistanceJob *job = static_cast<const DistanceJob *>(arg);
+		const int nx = job->nx;
+		const size_t nxy = (size_t)nx * job->ny;
+		const int n = job->axis == 0 ? nx : (job->axis == 1 ? job->ny : job->nz);
+		const size_t stride = job->axis == 0 ? 1 : (job->axis == 1 ? nx : nxy);
+
+		vector<double> f(n), d(n), z(n + 1);
+		vector<int> v(n);
+		for (size_t l = begin; l < end; ++l) {
+			size_t base = l;
+			if (job->axis == 0) base = l * nx;
+			else if (job->axis == 1) base = l % nx + l / nx * nxy;
+
+			if (job->first) {
+				for (int i = 0; i < n; ++i) f[i] = job->data[base + i * stride] ? 0 : FLT_MAX;
+			}
+			else {
+				for (int i = 0; i < n; ++i) f[i] = job->dist[base + i * stride];
+			}
+
+			if (job->euclidean) euclidean_distance_line(&f[0], &d[0], n, &v[0], &z[0]);
+			else cityblock_distance_line(&f[0], &d[0], n);
+
+			float *out = job->dist + base;
+			for (int i = 0; i < n; ++i) {
+				double r = std::min(d[i], (double)FLT_MAX);
+				if (job->last && job->euclidean && r < FLT_MAX) r = sqrt(r);
+				out[i * stride] = (float)r;
+			}
+		}
+	}
+}
+
+void Util::distance_transform(const float *data, float *dist, int nx, int ny, int nz, bool euclidean)
+{
+	DistanceJob job;
+	job.data = data;
+	job.dist = dist;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.euclidean = euclidean;
+
+	// the x pass always runs, since it also turns the array into 0 / FLT_MAX
+	const int last = nz > 1 ? 2 : (ny > 1 ? 1 : 0);
+	const size_t nxyz = (size_t)nx * ny * nz;
+	const int sizes[3] = { nx, ny, nz };
+	for (int axis = 0; axis <= last; ++axis) {
+		if (axis > 0 && sizes[axis] == 1) continue;
+		job.axis = axis;
+		job.first = (axis == 0);
+		job.last = (axis == last);
+		parallel_for(nxyz / sizes[axis], distance_worker, &job, 0, DISTANCE_MIN_LINES);
+	}
+}
+
+namespace {
+	const size_t LABEL_MIN_VOXELS = 65536;
+
+	struct LabelJob
+	{
+		const float *data;
+		int *labels;		// the union-find parents while labeling, -1 for background
+		int nx, ny, nz;
+		float threshold;
+		int noffsets;
+		int offsets[13][3];	// the neighbours (dx, dy, dz) which come before a voxel
+		vector<char> *starts;	// the first plane of each slab
+	};
+
+	int find_root(int *parent, int i)
+	{
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	// the root is always the first voxel of the component, so a parent never comes after its child
+	void unite(int *parent, int a, int b)
+	{
+		a = find_root(parent, a);
+		b = find_root(parent, b);
+		if (a < b) parent[b] = a;
+		else if (b < a) parent[a] = b;
+	}
+
+	/* Joins voxel (x, y, z) to its earlier neighbours inside [y0, y1) * [z0, nz), or with
+	 * boundary set, only to those in the plane before, which belongs to the previous slab.
+	 */
+	void unite_neighbours(const LabelJob *job, int x, int y, int z, int y0, int y1, int z0, bool boundary)
+	{
+		const int nx = job->nx;
+		const size_t i = x + ((size_t)z * job->ny + y) * nx;
+		for (int o = 0; o < job->noffsets; ++o) {
+			const int *d = job->offsets[o];
+			if (boundary && (job->nz > 1 ? d[2] : d[1]) == 0) continue;
+			const int xx = x + d[0], yy = y + d[1], zz = z + d[2];
+			if (xx < 0 || xx >= nx || yy < y0 || yy >= y1 || zz < z0) continue;
+			const size_t j = xx + ((size_t)zz * job->ny + yy) * nx;
+			if (job->labels[j] >= 0) unite(job->labels, (int)i, (int)j);
+		}
+	}
+
+	// labels the planes [begin, end): slices in 3D, rows in 2D
+	void label_slab_worker(size_t begin, size_t end, void *arg)
+	{
+		const LabelJob *job = static_cast<const LabelJob *>(arg);
+		(*job->starts)[begin] = 1;
+
+		const bool is3d = job->nz > 1;
+		const int y0 = is3d ? 0 : (int)begin, y1 = is3d ? job->ny : (int)end;
+		const int z0 = is3d ? (int)begin : 0, z1 = is3d ? (int)end : 1;
+		for (int z = z0; z < z1; ++z) {
+			for (int y = y0; y < y1; ++y) {
+				size_t i = ((size_t)z * job->ny + y) * job->nx;
+				for (int x = 0; x < job->nx; ++x, ++i) {
+					if (!(job->data[i] > job->threshold)) {
+						job->labels[i] = -1;
+						continue;
+					}
+					job->labels[i] = (int)i;
+					unite_neighbours(job, x, y, z, y0, y1, z0, false);
+				}
+			}
+		}
+	}
+}
+
+vector<Util::Component> Util::label_components(const float *data, int *labels, int nx, int ny, int nz,
+											   float threshold, int connectivity)
+{
+	if (connectivity != 6 && connectivity != 18 && connectivity != 26) {
+		throw InvalidValueException(connectivity, "connectivity must be 6, 18 or 26");
+	}
+	const size_t size = (size_t)nx * ny * nz;
+	if (size > (size_t)INT_MAX) throw InvalidValueException((float)size, "too many voxels to label");
+
+	LabelJob job;
+	job.data = data;
+	job.labels = labels;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.threshold = threshold;
+	job.noffsets = 0;
+	const int maxnonzero = connectivity == 6 ? 1 : (connectivity == 18 ? 2 : 3);
+	for (int dz = -1; dz <= 0; ++dz) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0))) continue;
+				if ((dx != 0) + (dy != 0) + (dz != 0) > maxnonzero) continue;
+				job.offsets[job.noffsets][0] = dx;
+				job.offsets[job.noffsets][1] = dy;
+				job.offsets[job.noffsets][2] = dz;
+				job.noffsets++;
+			}
+		}
+	}
+
+	const bool is3d = nz > 1;
+	const int nplanes = is3d ? nz : ny;
+	const size_t plane = size / nplanes;
+	vector<char> starts(nplanes, 0);
+	job.starts = &starts;
+	parallel_for(nplanes, label_slab_worker, &job, 0, std::max((size_t)1, LABEL_MIN_VOXELS / plane));
+
+	// join each slab to the one before
+	for (int p = 1; p < nplanes; ++p) {
+		if (!starts[p]) continue;
+		for (int y = is3d ? 0 : p; y < (is3d ? ny : p + 1); ++y) {
+			for (int x = 0; x < nx; ++x) {
+				const int z = is3d ? p : 0;
+				if (labels[x + ((size_t)z * ny + y) * nx] >= 0) unite_neighbours(&job, x, y, z, 0, ny, 0, true);
+			}
+		}
+	}
+
+	// Each voxel's parent comes before it and so already holds its label
+	vector<Component> components;
+	vector<double> sums;
+	size_t i = 0;
+	for (int z = 0; z < nz; ++z) {
+		for (int y = 0; y < ny; ++y) {
+			for (int x = 0; x < nx; ++x, ++i) {
+				if (labels[i] < 0) {
+					labels[i] = 0;
+					continue;
+				}
+				if (labels[i] == (int)i) {
+					Component c;
+					c.voxels = 0;
+					c.min = c.max = Vec3i(x, y, z);
+					components.push_back(c);
+					sums.resize(sums.size() + 3, 0.0);
+					labels[i] = (int)components.size();
+				}
+				else labels[i] = labels[labels[i]];
+
+				const int l = labels[i] - 1;
+				Component & c = components[l];
+				c.voxels++;
+				c.min[0] = std::min(c.min[0], x);
+				c.min[1] = std::min(c.min[1], y);
+				c.max[0] = std::max(c.max[0], x);
+				c.max[1] = std::max(c.max[1], y);
+				c.max[2] = z;
+				sums[3 * l] += x;
+				sums[3 * l + 1] += y;
+				sums[3 * l + 2] += z;
+			}
+		}
+	}
+
+	for (size_t l = 0; l < components.size(); ++l) {
+		const double n = (double)components[l].voxels;
+		components[l].center = Vec3f(sums[3 * l] / n, sums[3 * l + 1] / n, sums[3 * l + 2] / n);
+	}
+
+	return components;
+}
+
 ///////////////////////////////////////////
 void Util::ap2ri(float *data, size_t n)
 {
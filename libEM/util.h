@@ -108,6 +108,195 @@ namespace EMAN
 		static int MUTEX_LOCK(MUTEX *mutex);
 		static int MUTEX_UNLOCK(MUTEX *mutex);
 
+		/** Set the number of threads used by the multithreaded image operations
+		 * (batched FFTs, elementwise arithmetic, some processors). The initial value
+		 * is taken from the EMAN2_NUM_THREADS environment variable, defaulting to 1,
+		 * since EMAN2 programs normally parallelize at a higher level.
+		 * @param nthreads number of threads, at least 1
+		 * @exception InvalidValueException if nthreads is less than 1
+		 */
+		static void set_num_threads(int nthreads);
+		static int get_num_threads();
+
+		/** Worker for parallel_for(). Processes the items [begin,end). Must not throw:
+		 * an exception escaping a worker thread terminates the process. A worker
+		 * that can fail should catch, record the failed range in arg, and let the
+		 * caller redo or rethrow it once parallel_for() returns. */
+		typedef void (*RangeWorker)(size_t begin, size_t end, void *arg);
+
+		/** Split the items [0,n) into contiguous ranges and process each range on its
+		 * own thread. The calling thread processes the first range and returns once all
+		 * ranges are done. Runs inline when only one thread would be used.
+		 * @param n number of items
+		 * @param worker called once per range
+		 * @param arg passed through to worker
+		 * @param nthreads maximum number of threads, 0 for get_num_threads()
+		 * @param min_per_thread never give a thread fewer items than this
+		 */
+		static void parallel_for(size_t n, RangeWorker worker, void *arg, int nthreads = 0, size_t min_per_thread = 1);
+
+		/** Receives the results of box_sums() for output slice z: nx * ny sums, and the
+		 * sums of squares or null. Called from several threads at once, for different z. */
+		typedef void (*BoxSumsSlice)(int z, const double *sums, const double *sums2, void *arg);
+
+		/** Sums of the values of an nx * ny * nz array over a box of bx * by * bz pixels
+		 * placed at every pixel: the box of (x, y, z) is [x+x0, x+x0+bx) * [y+y0, y+y0+by) *
+		 * [z+z0, z+z0+bz), and pixels outside the array count as 0. Each slice gets a
+		 * summed-area table (integral image) in double precision and the slices are added
+		 * up with a running sum along z, so a box costs O(1) whatever its size. The output
+		 * slices are split between get_num_threads() threads.
+		 * @param data the array
+		 * @param nx the x size of the array
+		 * @param ny the y size of the array
+		 * @param nz the z size of the array, 1 in 2D
+		 * @param x0 the x offset of the box from the pixel, -radius for a centered box
+		 * @param y0 the y offset of the box
+		 * @param z0 the z offset of the box
+		 * @param bx the x size of the box
+		 * @param by the y size of the box
+		 * @param bz the z size of the box
+		 * @param squares also sum the squares of the values
+		 * @param slice called with the sums of each output slice
+		 * @param arg passed through to slice
+		 */
+		static void box_sums(const float *data, int nx, int ny, int nz, int x0, int y0, int z0, int bx, int by, int bz,
+							 bool squares, BoxSumsSlice slice, void *arg);
+
+		/** Distance from every pixel of an nx * ny * nz array to the nearest nonzero pixel,
+		 * 0 for the nonzero pixels themselves. The transform is separable, one 1D pass along
+		 * each axis, and each pass is split between get_num_threads() threads by lines. The
+		 * euclidean distance is exact (lower envelope of parabolas, Felzenszwalb and
+		 * Huttenlocher, "Distance Transforms of Sampled Functions", 2012); the city-block
+		 * distance is the number of 6-connected (4 in 2D) steps. Pixels get FLT_MAX if the
+		 * array has no nonzero pixel.
+		 * @param data the array
+		 * @param dist receives the distances, may be the same as data
+		 * @param nx the x size of the array
+		 * @param ny the y size of the array
+		 * @param nz the z size of the array
+		 * @param euclidean euclidean rather than city-block distance
+		 */
+		static void distance_transform(const float *data, float *dist, int nx, int ny, int nz, bool euclidean = true);
+
+		/** One connected component found by label_components() */
+		struct Component
+		{
+			size_t voxels;		// number of voxels
+			Vec3i min, max;		// bounding box, inclusive
+			Vec3f center;		// centroid
+		};
+
+		/** Label the connected components of the voxels of an nx * ny * nz array which are
+		 * above threshold. The array is cut into slabs (of slices, or of rows in 2D) which are
+		 * labeled with a union-find on their own threads, then the slabs are joined and the
+		 * labels, sizes, bounding boxes and centroids come out of one final scan.
+		 * @param data the array
+		 * @param labels receives nx * ny * nz labels: 0 at or below threshold, otherwise 1 to
+		 *   the number of components, numbered in the order of their first voxel
+		 * @param nx the x size of the array
+		 * @param ny the y size of the array
+		 * @param nz the z size of the array
+		 * @param threshold voxels above this belong to components
+		 * @param connectivity 6 for face, 18 for face or edge, 26 for any neighbours. In 2D
+		 *   6 is 4-connected, 18 and 26 are 8-connected.
+		 * @return the components, component i has label i + 1
+		 * @exception InvalidValueException if connectivity is not 6, 18 or 26, or the array has
+		 *   more than INT_MAX voxels
+		 */
+		static vector<Component> label_components(const float *data, int *labels, int nx, int ny, int nz,
+												  float threshold = 0, int connectivity = 6);
+
+		/** Elementwise operations of array_op() */
+		enum ArrayOp {
+			ARRAY_ADD,			// data + src
+			ARRAY_SUB,			// data - src
+			ARRAY_MULT,			// data * src
+			ARRAY_DIV,			// data / src
+			ARRAY_ADDSQUARE,	// data + src * src
+			ARRAY_SUBSQUARE		// data - src * src
+		};
+
+		/** data[i] = data[i] op src[i] for i in [0,n), the kernel of the EMData image
+		 * arithmetic. It uses the widest SIMD instructions the library was compiled for
+		 * (see simd_width()) and splits arrays of more than a few million elements across
+		 * get_num_threads() threads. Each element is computed on its own, so the result
+		 * does not depend on either.
+		 * @param data the array to modify
+		 * @param src the second operand, may not partially overlap data
+		 * @param n number of elements
+		 * @param op the operation
+		 * @return for ARRAY_DIV the number of nonzero elements divided by 0, which are left
+		 * unchanged (as are the zero ones). 0 for the other operations.
+		 */
+		static size_t array_op(float *data, const float *src, size_t n, ArrayOp op);
+
+		/** data[i] = data[i] op f for i in [0,n), like array_op(float*, const float*, size_t, ArrayOp).
+		 * @param data the array to modify
+		 * @param f the second operand
+		 * @param n number of elements
+		 * @param op ARRAY_ADD, ARRAY_SUB or ARRAY_MULT
+		 * @param keepzero leave the elements which are 0 unchanged
+		 * @exception InvalidValueException for the other operations
+		 */
+		static void array_op(float *data, float f, size_t n, ArrayOp op, bool keepzero = false);
+
+		/** The dot product of two arrays, with the float products summed in double. The
+		 * order of the summation is fixed (8 interleaved partial sums per block of 64k
+		 * elements, added in order), so the result is bitwise identical for any SIMD width
+		 * and number of threads.
+		 * @param x the first array
+		 * @param y the second array
+		 * @param n number of elements
+		 * @return the sum of x[i]*y[i]
+		 */
+		static double array_dot(const float *x, const float *y, size_t n);
+
+		/** @return the number of floats array_op() processes per instruction, 1 without SIMD */
+		static int simd_width();
+
+		/** Bilinear interpolation of a 2D image at n points, each exactly like
+		 * EMData::sget_value_at_interp(x, y): pixels outside the image count as 0. The
+		 * points are processed 8 at a time with AVX2 gathers when the library is compiled
+		 * for it, and split across get_num_threads() threads for large n.
+		 * @param data the image, nx * ny floats
+		 * @param nx the x size of the image
+		 * @param ny the y size of the image
+		 * @param x the x coordinates of the points
+		 * @param y the y coordinates of the points
+		 * @param n number of points
+		 * @param out receives the n interpolated values
+		 */
+		static void interp_bilinear(const float *data, int nx, int ny, const float *x, const float *y, size_t n, float *out);
+
+		/** Trilinear interpolation of a 3D image at n points, each exactly like
+		 * EMData::sget_value_at_interp(x, y, z). See interp_bilinear().
+		 */
+		static void interp_trilinear(const float *data, int nx, int ny, int nz, const float *x, const float *y, const float *z,
+									 size_t n, float *out);
+
+		/** Bilinear interpolation of a 2D image at the n evenly spaced points
+		 * (x + i * dx, y + i * dy), i = 0..n-1, as used by TransformProcessor to resample a
+		 * row of the output: points outside the image give 0, and the neighbors past the last
+		 * pixel are clamped to it. Single threaded; the caller splits the rows between threads.
+		 * @param data the image, nx * ny floats
+		 * @param nx the x size of the image
+		 * @param ny the y size of the image
+		 * @param x the x coordinate of the first point
+		 * @param y the y coordinate of the first point
+		 * @param dx the x step between points
+		 * @param dy the y step between points
+		 * @param n number of points
+		 * @param out receives the n interpolated values
+		 */
+		static void interp_bilinear_line(const float *data, int nx, int ny, float x, float y, float dx, float dy,
+										 size_t n, float *out);
+
+		/** Trilinear interpolation of a 3D image at the n evenly spaced points
+		 * (x + i * dx, y + i * dy, z + i * dz). See interp_bilinear_line().
+		 */
+		static void interp_trilinear_line(const float *data, int nx, int ny, int nz, float x, float y, float z,
+										  float dx, float dy, float dz, size_t n, float *out);
+
 		/** tell whether a float value is a NaN
 		 * @param number float value
 		 */
@@ -0,0 +1,654 @@
+/**
+ * $Id$
+ */
+
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ *
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * */
+
+#include "util.h"
+#include "exception.h"
+
+#include <algorithm>
+#include <vector>
+
+// the instruction set is chosen at compile time, the library is normally built with -march=native
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define UTIL_SIMD_AVX512
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define UTIL_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTIL_SIMD_SSE2
+#endif
+
+using namespace EMAN;
+using std::vector;
+
+namespace {
+	// arrays are processed in blocks of this many elements, the unit of work of the threads
+	const size_t ARRAY_BLOCK = 65536;
+	// don't start threads for less than this many blocks per thread
+	const size_t MIN_BLOCKS_PER_THREAD = 16;
+
+	inline int count_bits(int m)
+	{
+		int n = 0;
+		for (; m; m &= m - 1) n++;
+		return n;
+	}
+
+	/* The kernels are written against these small vector types. sfloat is one float,
+	 * used for the elements left over at the end of an array and when there is no SIMD.
+	 */
+	struct sfloat
+	{
+		enum { lanes = 1 };
+		typedef float type;
+		typedef bool mask;
+		static type load(const float *p) { return *p; }
+		static void store(float *p, type v) { *p = v; }
+		static type set1(float f) { return f; }
+		static type add(type a, type b) { return a + b; }
+		static type sub(type a, type b) { return a - b; }
+		static type mul(type a, type b) { return a * b; }
+		static type div(type a, type b) { return a / b; }
+		static mask nonzero(type a) { return a != 0; }
+		static mask iszero(type a) { return a == 0; }
+		static mask both(mask a, mask b) { return a && b; }
+		static type select(mask m, type a, type b) { return m ? a : b; }
+		static int count(mask m) { return m ? 1 : 0; }
+	};
+
+#if defined(UTIL_SIMD_AVX512)
+	struct vfloat
+	{
+		enum { lanes = 16 };
+		typedef __m512 type;
+		typedef __mmask16 mask;
+		static type load(const float *p) { return _mm512_loadu_ps(p); }
+		static void store(float *p, type v) { _mm512_storeu_ps(p, v); }
+		static type set1(float f) { return _mm512_set1_ps(f); }
+		static type add(type a, type b) { return _mm512_add_ps(a, b); }
+		static type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+		static type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+		static type div(type a, type b) { return _mm512_div_ps(a, b); }
+		static mask nonzero(type a) { return _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_NEQ_UQ); }
+		static mask iszero(type a) { return _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_EQ_OQ); }
+		static mask both(mask a, mask b) { return a & b; }
+		static type select(mask m, type a, type b) { return _mm512_mask_blend_ps(m, b, a); }
+		static int count(mask m) { return count_bits(m); }
+	};
+#elif defined(UTIL_SIMD_AVX)
+	struct vfloat
+	{
+		enum { lanes = 8 };
+		typedef __m256 type;
+		typedef __m256 mask;
+		static type load(const float *p) { return _mm256_loadu_ps(p); }
+		static void store(float *p, type v) { _mm256_storeu_ps(p, v); }
+		static type set1(float f) { return _mm256_set1_ps(f); }
+		static type add(type a, type b) { return _mm256_add_ps(a, b); }
+		static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+		static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+		static type div(type a, type b) { return _mm256_div_ps(a, b); }
+		static mask nonzero(type a) { return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ); }
+		static mask iszero(type a) { return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_EQ_OQ); }
+		static mask both(mask a, mask b) { return _mm256_and_ps(a, b); }
+		static type select(mask m, type a, type b) { return _mm256_blendv_ps(b, a, m); }
+		static int count(mask m) { return count_bits(_mm256_movemask_ps(m)); }
+	};
+#elif defined(UTIL_SIMD_SSE2)
+	struct vfloat
+	{
+		enum { lanes = 4 };
+		typedef __m128 type;
+		typedef __m128 mask;
+		static type load(const float *p) { return _mm_loadu_ps(p); }
+		static void store(float *p, type v) { _mm_storeu_ps(p, v); }
+		static type set1(float f) { return _mm_set1_ps(f); }
+		static type add(type a, type b) { return _mm_add_ps(a, b); }
+		static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+		static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+		static type div(type a, type b) { return _mm_div_ps(a, b); }
+		static mask nonzero(type a) { return _mm_cmpneq_ps(a, _mm_setzero_ps()); }
+		static mask iszero(type a) { return _mm_cmpeq_ps(a, _mm_setzero_ps()); }
+		static mask both(mask a, mask b) { return _mm_and_ps(a, b); }
+		static type select(mask m, type a, type b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+		static int count(mask m) { return count_bits(_mm_movemask_ps(m)); }
+	};
+#else
+	typedef sfloat vfloat;
+#endif
+
+	/* data op src over the first n - n % V::lanes elements.
+	 * @return the number of nonzero elements divided by 0
+	 */
+	template<class V>
+	size_t op_lanes(float *data, const float *src, size_t n, Util::ArrayOp op)
+	{
+		typedef typename V::type T;
+		const size_t end = n - n % V::lanes;
+		size_t bad = 0;
+
+		switch (op) {
+		case Util::ARRAY_ADD:
+			for (size_t i = 0; i < end; i += V::lanes) V::store(data + i, V::add(V::load(data + i), V::load(src + i)));
+			break;
+		case Util::ARRAY_SUB:
+			for (size_t i = 0; i < end; i += V::lanes) V::store(data + i, V::sub(V::load(data + i), V::load(src + i)));
+			break;
+		case Util::ARRAY_MULT:
+			for (size_t i = 0; i < end; i += V::lanes) V::store(data + i, V::mul(V::load(data + i), V::load(src + i)));
+			break;
+		case Util::ARRAY_DIV:
+			for (size_t i = 0; i < end; i += V::lanes) {
+				T d = V::load(data + i);
+				T s = V::load(src + i);
+				typename V::mask zero = V::iszero(s);
+				bad += V::count(V::both(zero, V::nonzero(d)));
+				V::store(data + i, V::select(zero, d, V::div(d, s)));
+			}
+			break;
+		case Util::ARRAY_ADDSQUARE:
+			for (size_t i = 0; i < end; i += V::lanes) {
+				T s = V::load(src + i);
+				V::store(data + i, V::add(V::load(data + i), V::mul(s, s)));
+			}
+			break;
+		case Util::ARRAY_SUBSQUARE:
+			for (size_t i = 0; i < end; i += V::lanes) {
+				T s = V::load(src + i);
+				V::store(data + i, V::sub(V::load(data + i), V::mul(s, s)));
+			}
+			break;
+		}
+
+		return bad;
+	}
+
+	/* data op f over the first n - n % V::lanes elements */
+	template<class V>
+	void op_scalar_lanes(float *data, float f, size_t n, Util::ArrayOp op, bool keepzero)
+	{
+		typedef typename V::type T;
+		const size_t end = n - n % V::lanes;
+		const T vf = V::set1(f);
+
+		for (size_t i = 0; i < end; i += V::lanes) {
+			T d = V::load(data + i);
+			T r;
+			if (op == Util::ARRAY_ADD) r = V::add(d, vf);
+			else if (op == Util::ARRAY_SUB) r = V::sub(d, vf);
+			else r = V::mul(d, vf);
+			if (keepzero) r = V::select(V::nonzero(d), r, d);
+			V::store(data + i, r);
+		}
+	}
+
+	/* The dot product of a block. Element i (counted from the start of the block) is
+	 * added to partial sum i % 8, the partial sums are then added in order.
+	 */
+	double dot_block(const float *x, const float *y, size_t n)
+	{
+		double part[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		size_t i = 0;
+
+#if defined(UTIL_SIMD_AVX512)
+		__m512d acc = _mm512_setzero_pd();
+		for (; i + 16 <= n; i += 16) {
+			__m512 p = _mm512_mul_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i));
+			acc = _mm512_add_pd(acc, _mm512_cvtps_pd(_mm512_castps512_ps256(p)));
+			acc = _mm512_add_pd(acc, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(p), 1))));
+		}
+		_mm512_storeu_pd(part, acc);
+#elif defined(UTIL_SIMD_AVX)
+		__m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+		for (; i + 8 <= n; i += 8) {
+			__m256 p = _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i));
+			acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(p)));
+			acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(p, 1)));
+		}
+		_mm256_storeu_pd(part, acc0);
+		_mm256_storeu_pd(part + 4, acc1);
+#elif defined(UTIL_SIMD_SSE2)
+		__m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd(), acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+		for (; i + 8 <= n; i += 8) {
+			__m128 p0 = _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i));
+			__m128 p1 = _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4));
+			acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(p0));
+			acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(p0, p0)));
+			acc2 = _mm_add_pd(acc2, _mm_cvtps_pd(p1));
+			acc3 = _mm_add_pd(acc3, _mm_cvtps_pd(_mm_movehl_ps(p1, p1)));
+		}
+		_mm_storeu_pd(part, acc0);
+		_mm_storeu_pd(part + 2, acc1);
+		_mm_storeu_pd(part + 4, acc2);
+		_mm_storeu_pd(part + 6, acc3);
+#endif
+
+		for (; i < n; ++i) {
+			float p = x[i] * y[i];
+			part[i % 8] += p;
+		}
+
+		double sum = 0;
+		for (int k = 0; k < 8; ++k) sum += part[k];
+		return sum;
+	}
+
+	struct ArrayJob
+	{
+		float *data;
+		const float *src;
+		float f;
+		size_t n;
+		Util::ArrayOp op;
+		bool keepzero;
+		vector<size_t> bad;			// per block, for ARRAY_DIV
+		const float *y;				// for array_dot()
+		vector<double> sums;		// per block, for array_dot()
+	};
+
+	void array_op_worker(size_t begin, size_t end, void *arg)
+	{
+		ArrayJob *job = static_cast<ArrayJob *>(arg);
+
+		for (size_t b = begin; b < end; ++b) {
+			size_t first = b * ARRAY_BLOCK;
+			size_t n = std::min(ARRAY_BLOCK, job->n - first);
+			float *data = job->data + first;
+			const float *src = job->src + first;
+			size_t done = n - n % vfloat::lanes;
+
+			size_t bad = op_lanes<vfloat>(data, src, n, job->op);
+			bad += op_lanes<sfloat>(data + done, src + done, n - done, job->op);
+			if (job->op == Util::ARRAY_DIV) job->bad[b] = bad;
+		}
+	}
+
+	void array_op_scalar_worker(size_t begin, size_t end, void *arg)
+	{
+		ArrayJob *job = static_cast<ArrayJob *>(arg);
+
+		for (size_t b = begin; b < end; ++b) {
+			size_t first = b * ARRAY_BLOCK;
+			size_t n = std::min(ARRAY_BLOCK, job->n - first);
+			float *data = job->data + first;
+			size_t done = n - n % vfloat::lanes;
+
+			op_scalar_lanes<vfloat>(data, job->f, n, job->op, job->keepzero);
+			op_scalar_lanes<sfloat>(data + done, job->f, n - done, job->op, job->keepzero);
+		}
+	}
+
+	void array_dot_worker(size_t begin, size_t end, void *arg)
+	{
+		ArrayJob *job = static_cast<ArrayJob *>(arg);
+
+		for (size_t b = begin; b < end; ++b) {
+			size_t first = b * ARRAY_BLOCK;
+			job->sums[b] = dot_block(job->src + first, job->y + first, std::min(ARRAY_BLOCK, job->n - first));
+		}
+	}
+
+	// points are interpolated in blocks of this many, the unit of work of the threads
+	const size_t INTERP_BLOCK = 4096;
+
+	struct InterpJob
+	{
+		const float *data;
+		int nx, ny, nz;
+		const float *x, *y, *z;		// z is 0 for 2D
+		size_t n;
+		float *out;
+	};
+
+	// EMData::sget_value_at() on a raw array
+	inline float sget(const float *data, int nx, int ny, int x, int y)
+	{
+		if (x < 0 || x >= nx || y < 0 || y >= ny) return 0;
+		return data[x + (size_t)y * nx];
+	}
+
+	inline float sget(const float *data, int nx, int ny, int nz, int x, int y, int z)
+	{
+		if (x < 0 || x >= nx || y < 0 || y >= ny || z < 0 || z >= nz) return 0;
+		return data[x + (size_t)y * nx + (size_t)z * nx * ny];
+	}
+
+	// EMData::sget_value_at_interp(xx, yy)
+	inline float bilinear(const float *data, int nx, int ny, float xx, float yy)
+	{
+		int x = Util::fast_floor(xx);
+		int y = Util::fast_floor(yy);
+
+		return Util::bilinear_interpolate(sget(data, nx, ny, x, y), sget(data, nx, ny, x + 1, y),
+										  sget(data, nx, ny, x, y + 1), sget(data, nx, ny, x + 1, y + 1),
+										  xx - x, yy - y);
+	}
+
+	// EMData::sget_value_at_interp(xx, yy, zz)
+	inline float trilinear(const float *data, int nx, int ny, int nz, float xx, float yy, float zz)
+	{
+		int x = Util::fast_floor(xx);
+		int y = Util::fast_floor(yy);
+		int z = Util::fast_floor(zz);
+
+		return Util::trilinear_interpolate(sget(data, nx, ny, nz, x, y, z), sget(data, nx, ny, nz, x + 1, y, z),
+										   sget(data, nx, ny, nz, x, y + 1, z), sget(data, nx, ny, nz, x + 1, y + 1, z),
+										   sget(data, nx, ny, nz, x, y, z + 1), sget(data, nx, ny, nz, x + 1, y, z + 1),
+										   sget(data, nx, ny, nz, x, y + 1, z + 1), sget(data, nx, ny, nz, x + 1, y + 1, z + 1),
+										   xx - x, yy - y, zz - z);
+	}
+
+	/* The interpolation of TransformProcessor: 0 outside the image, the neighbors past the
+	 * last pixel are clamped to it. Inside the last pixel this is the same as the above.
+	 */
+	inline float bilinear_clamped(const float *data, int nx, int ny, float xx, float yy)
+	{
+		if (xx < 0 || xx >= nx || yy < 0 || yy >= ny) return 0;
+
+		int x = Util::fast_floor(xx);
+		int y = Util::fast_floor(yy);
+		size_t k0 = x + (size_t)y * nx;
+		size_t dx = x < nx - 1 ? 1 : 0;
+		size_t dy = y < ny - 1 ? nx : 0;
+
+		return Util::bilinear_interpolate(data[k0], data[k0 + dx], data[k0 + dy], data[k0 + dx + dy], xx - x, yy - y);
+	}
+
+	inline float trilinear_clamped(const float *data, int nx, int ny, int nz, float xx, float yy, float zz)
+	{
+		if (xx < 0 || xx >= nx || yy < 0 || yy >= ny || zz < 0 || zz >= nz) return 0;
+
+		int x = Util::fast_floor(xx);
+		int y = Util::fast_floor(yy);
+		int z = Util::fast_floor(zz);
+		size_t k0 = x + (size_t)y * nx + (size_t)z * nx * ny;
+		size_t dx = x < nx - 1 ? 1 : 0;
+		size_t dy = y < ny - 1 ? nx : 0;
+		size_t dz = z < nz - 1 ? (size_t)nx * ny : 0;
+
+		return Util::trilinear_interpolate(data[k0], data[k0 + dx], data[k0 + dy], data[k0 + dx + dy],
+										   data[k0 + dz], data[k0 + dx + dz], data[k0 + dy + dz], data[k0 + dx + dy + dz],
+										   xx - x, yy - y, zz - z);
+	}
+
+#if defined(__AVX2__)
+	/* 8 points at a time with gathers, for the points whose 2x2(x2) neighborhood is inside
+	 * the image. The arithmetic is that of Util::bilinear_interpolate() and
+	 * Util::trilinear_interpolate(), in the same order, so the results are the same as
+	 * those of the scalar code.
+	 */
+
+	// Util::fast_floor() of 8 floats, and the fractions left over
+	inline __m256i floor8(__m256 v, __m256 & frac)
+	{
+		__m256i i = _mm256_cvttps_epi32(v);
+		// the comparison is -1 where v < 0
+		i = _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ)));
+		frac = _mm256_sub_ps(v, _mm256_cvtepi32_ps(i));
+		return i;
+	}
+
+	// true if 0 <= i < n - 1 in all lanes
+	inline bool inside8(__m256i i, int n)
+	{
+		__m256i low = _mm256_cmpgt_epi32(_mm256_setzero_si256(), i);
+		__m256i high = _mm256_cmpgt_epi32(i, _mm256_set1_epi32(n - 2));
+		return _mm256_testz_si256(_mm256_or_si256(low, high), _mm256_set1_epi32(-1)) != 0;
+	}
+
+	inline __m256 gather8(const float *data, __m256i idx, int offset)
+	{
+		return _mm256_i32gather_ps(data, _mm256_add_epi32(idx, _mm256_set1_epi32(offset)), 4);
+	}
+
+	// returns true if the 8 points were interpolated, false without touching out
+	// if any of them is too close to the edge (the caller then does them one by one)
+	bool bilinear8(const float *data, int nx, int ny, __m256 xs, __m256 ys, float *out)
+	{
+		__m256 t, u;
+		__m256i x = floor8(xs, t);
+		__m256i y = floor8(ys, u);
+		if (!inside8(x, nx) || !inside8(y, ny)) return false;
+
+		__m256i idx = _mm256_add_epi32(x, _mm256_mullo_epi32(y, _mm256_set1_epi32(nx)));
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 mt = _mm256_sub_ps(one, t), mu = _mm256_sub_ps(one, u);
+
+		__m256 r = _mm256_mul_ps(_mm256_mul_ps(mt, mu), gather8(data, idx, 0));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(t, mu), gather8(data, idx, 1)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(mt, u), gather8(data, idx, nx)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(t, u), gather8(data, idx, nx + 1)));
+		_mm256_storeu_ps(out, r);
+		return true;
+	}
+
+	// the same in 3D
+	bool trilinear8(const float *data, int nx, int ny, int nz, __m256 xs, __m256 ys, __m256 zs, float *out)
+	{
+		__m256 t, u, v;
+		__m256i x = floor8(xs, t);
+		__m256i y = floor8(ys, u);
+		__m256i z = floor8(zs, v);
+		if (!inside8(x, nx) || !inside8(y, ny) || !inside8(z, nz)) return false;
+
+		const int nxy = nx * ny;
+		__m256i idx = _mm256_add_epi32(x, _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(nx)),
+														   _mm256_mullo_epi32(z, _mm256_set1_epi32(nxy))));
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 mt = _mm256_sub_ps(one, t), mu = _mm256_sub_ps(one, u), mv = _mm256_sub_ps(one, v);
+
+		__m256 r = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mt, mu), mv), gather8(data, idx, 0));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, mu), mv), gather8(data, idx, 1)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mt, u), mv), gather8(data, idx, nx)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, u), mv), gather8(data, idx, nx + 1)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mt, mu), v), gather8(data, idx, nxy)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, mu), v), gather8(data, idx, nxy + 1)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(mt, u), v), gather8(data, idx, nxy + nx)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, u), v), gather8(data, idx, nxy + nx + 1)));
+		_mm256_storeu_ps(out, r);
+		return true;
+	}
+
+	// the coordinates a + (i + k) * d, k = 0..7, computed as in the scalar code
+	inline __m256 line8(float a, float d, size_t i)
+	{
+		__m256 k = _mm256_add_ps(_mm256_set1_ps((float)i), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+		return _mm256_add_ps(_mm256_set1_ps(a), _mm256_mul_ps(k, _mm256_set1_ps(d)));
+	}
+#endif	//__AVX2__
+
+	void interp_worker(size_t begin, size_t end, void *arg)
+	{
+		const InterpJob *job = static_cast<const InterpJob *>(arg);
+		const float *data = job->data;
+		const int nx = job->nx, ny = job->ny, nz = job->nz;
+
+#if defined(__AVX2__)
+		// the gather indices are 32 bit
+		const bool simd = (size_t)nx * ny * nz < (1u << 31) - 1;
+#endif
+
+		for (size_t b = begin; b < end; ++b) {
+			size_t i = b * INTERP_BLOCK;
+			const size_t last = std::min(i + INTERP_BLOCK, job->n);
+
+			for (; i < last; ++i) {
+#if defined(__AVX2__)
+				if (simd && i + 8 <= last && i % 8 == 0) {
+					bool done = job->z ? trilinear8(data, nx, ny, nz, _mm256_loadu_ps(job->x + i), _mm256_loadu_ps(job->y + i),
+													_mm256_loadu_ps(job->z + i), job->out + i)
+									   : bilinear8(data, nx, ny, _mm256_loadu_ps(job->x + i), _mm256_loadu_ps(job->y + i), job->out + i);
+					if (done) {
+						i += 7;
+						continue;
+					}
+				}
+#endif
+				if (job->z) job->out[i] = trilinear(data, nx, ny, nz, job->x[i], job->y[i], job->z[i]);
+				else job->out[i] = bilinear(data, nx, ny, job->x[i], job->y[i]);
+			}
+		}
+	}
+
+	void interpolate(const InterpJob & job)
+	{
+		if (job.n == 0) return;
+		Util::parallel_for((job.n + INTERP_BLOCK - 1) / INTERP_BLOCK, interp_worker, const_cast<InterpJob *>(&job), 0, 4);
+	}
+}
+
+size_t Util::array_op(float *data, const float *src, size_t n, ArrayOp op)
+{
+	if (n == 0) return 0;
+
+	ArrayJob job;
+	job.data = data;
+	job.src = src;
+	job.n = n;
+	job.op = op;
+
+	size_t nblocks = (n + ARRAY_BLOCK - 1) / ARRAY_BLOCK;
+	if (op == ARRAY_DIV) job.bad.resize(nblocks, 0);
+	parallel_for(nblocks, array_op_worker, &job, 0, MIN_BLOCKS_PER_THREAD);
+
+	size_t bad = 0;
+	for (size_t b = 0; b < job.bad.size(); ++b) bad += job.bad[b];
+	return bad;
+}
+
+void Util::array_op(float *data, float f, size_t n, ArrayOp op, bool keepzero)
+{
+	if (op != ARRAY_ADD && op != ARRAY_SUB && op != ARRAY_MULT) {
+		throw InvalidValueException(op, "only add, sub and mult take a scalar");
+	}
+	if (n == 0) return;
+
+	ArrayJob job;
+	job.data = data;
+	job.f = f;
+	job.n = n;
+	job.op = op;
+	job.keepzero = keepzero;
+
+	parallel_for((n + ARRAY_BLOCK - 1) / ARRAY_BLOCK, array_op_scalar_worker, &job, 0, MIN_BLOCKS_PER_THREAD);
+}
+
+double Util::array_dot(const float *x, const float *y, size_t n)
+{
+	if (n == 0) return 0;
+
+	ArrayJob job;
+	job.src = x;
+	job.y = y;
+	job.n = n;
+	job.sums.resize((n + ARRAY_BLOCK - 1) / ARRAY_BLOCK);
+	parallel_for(job.sums.size(), array_dot_worker, &job, 0, MIN_BLOCKS_PER_THREAD);
+
+	double sum = 0;
+	for (size_t b = 0; b < job.sums.size(); ++b) sum += job.sums[b];
+	return sum;
+}
+
+int Util::simd_width()
+{
+	return vfloat::lanes;
+}
+
+void Util::interp_bilinear(const float *data, int nx, int ny, const float *x, const float *y, size_t n, float *out)
+{
+	InterpJob job;
+	job.data = data;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = 1;
+	job.x = x;
+	job.y = y;
+	job.z = 0;
+	job.n = n;
+	job.out = out;
+	interpolate(job);
+}
+
+void Util::interp_bilinear_line(const float *data, int nx, int ny, float x, float y, float dx, float dy,
+								size_t n, float *out)
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	if ((size_t)nx * ny < (1u << 31) - 1) {
+		for (; i + 8 <= n; i += 8) {
+			if (bilinear8(data, nx, ny, line8(x, dx, i), line8(y, dy, i), out + i)) continue;
+			for (size_t k = i; k < i + 8; ++k) out[k] = bilinear_clamped(data, nx, ny, x + (float)k * dx, y + (float)k * dy);
+		}
+	}
+#endif
+	for (; i < n; ++i) out[i] = bilinear_clamped(data, nx, ny, x + (float)i * dx, y + (float)i * dy);
+}
+
+void Util::interp_trilinear_line(const float *data, int nx, int ny, int nz, float x, float y, float z,
+								 float dx, float dy, float dz, size_t n, float *out)
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	if ((size_t)nx * ny * nz < (1u << 31) - 1) {
+		for (; i + 8 <= n; i += 8) {
+			if (trilinear8(data, nx, ny, nz, line8(x, dx, i), line8(y, dy, i), line8(z, dz, i), out + i)) continue;
+			for (size_t k = i; k < i + 8; ++k) {
+				out[k] = trilinear_clamped(data, nx, ny, nz, x + (float)k * dx, y + (float)k * dy, z + (float)k * dz);
+			}
+		}
+	}
+#endif
+	for (; i < n; ++i) out[i] = trilinear_clamped(data, nx, ny, nz, x + (float)i * dx, y + (float)i * dy, z + (float)i * dz);
+}
+
+void Util::interp_trilinear(const float *data, int nx, int ny, int nz, const float *x, const float *y, const float *z,
+							size_t n, float *out)
+{
+	if (!z) {
+		throw NullPointerException("z coordinates");
+	}
+
+	InterpJob job;
+	job.data = data;
+	job.nx = nx;
+	job.ny = ny;
+	job.nz = nz;
+	job.x = x;
+	job.y = y;
+	job.z = z;
+	job.n = n;
+	job.out = out;
+	interpolate(job);
+}
@@ -61,6 +61,10 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_read_image_overloads_1_5, rea
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_read_binedimage_overloads_1_5, read_binedimage, 1, 5)
 
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_read_image_mapped_overloads_1_3, read_image_mapped, 1, 3)
+
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_read_image_compact_overloads_1_4, read_image_compact, 1, 4)
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_write_image_overloads_1_7, write_image, 1, 7)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_append_image_overloads_1_3, append_image, 1, 3)
@@ -73,12 +77,22 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_read_images_overloads_1_3, EMAN::EMD
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_read_images_ext_overloads_3_5, EMAN::EMData::read_images_ext, 3, 5)
 
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_do_fft_many_overloads_1_2, EMAN::EMData::do_fft_many, 1, 2)
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMData_do_fft_inplace_many_overloads_1_2, EMAN::EMData::do_fft_inplace_many, 1, 2)
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_set_size_overloads_1_4, EMAN::EMData::set_size, 1, 4)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_set_complex_size_overloads_1_3, EMAN::EMData::set_complex_size, 1, 3)
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_get_attr_default_overloads_1_2, EMAN::EMData::get_attr_default, 1, 2)
 
+#ifdef USE_FFTW3
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMfft_load_wisdom_overloads_0_1, EMAN::EMfft::load_wisdom, 0, 1)
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_EMfft_save_wisdom_overloads_0_1, EMAN::EMfft::save_wisdom, 0, 1)
+#endif	//USE_FFTW3
+
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_clip_inplace_overloads_1_2, EMAN::EMData::clip_inplace, 1, 2)
 
 //BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_EMData_process_inplace_overloads_1_2, EMAN::EMData::process_inplace, 1, 2)
@@ -490,6 +504,36 @@ EMData *EMData_process_wrapper2(EMData &ths,const string & processorname, const
 	PyEval_RestoreThread(_save);
 	return ret;
 }
+EMData *EMData_process_move_wrapper1(EMData &ths,const string & processorname) {
+	EMData *ret;
+	PyThreadState *_save = PyEval_SaveThread();
+
+	try {
+		ret=ths.process_move(processorname);
+	}
+	catch (std::exception &e) {
+		PyEval_RestoreThread(_save);
+		cerr << e.what() << endl;
+		throw e;
+	}
+	PyEval_RestoreThread(_save);
+	return ret;
+}
+EMData *EMData_process_move_wrapper2(EMData &ths,const string & processorname, const Dict & params) {
+	EMData *ret;
+	PyThreadState *_save = PyEval_SaveThread();
+
+	try {
+		ret=ths.process_move(processorname,params);
+	}
+	catch (std::exception &e) {
+		PyEval_RestoreThread(_save);
+		cerr << e.what() << endl;
+		throw e;
+	}
+	PyEval_RestoreThread(_save);
+	return ret;
+}
 
 float EMData_cmp_wrapper2(EMData &ths,const string & cmpname, EMData * with) {
 	float ret;
@@ -539,6 +583,9 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def(init< int, int, optional< int, bool > >(args("nx", "ny", "nz", "is_real"), "makes an image of the specified size, either real or complex.\nFor complex image, the user would specify the real-space dimensions.\n \nnx - size for x dimension\nny - size for y dimension\nnz size for z dimension(default=1)\nis_real - boolean to specify real(true) or complex(false) image(default=True)"))
 	.add_static_property("totalalloc", make_getter(EMAN::EMData::totalalloc), make_setter(EMAN::EMData::totalalloc))
 	.def("read_image", &EMAN::EMData::read_image, EMAN_EMData_read_image_overloads_1_5(args("filename", "img_index", "header_only", "region", "is_3d"), "read an image file and stores its information to this EMData object.\n\nIf a region is given, then only read a\nregion of the image file. The region will be this\nEMData object. The given region must be inside the given\nimage file. Otherwise, an error will be created.\n\nfilename The image file name.\nimg_index The nth image you want to read.\nheader_only To read only the header or both header and data.\nregion To read only a region of the image.\nis_3d  Whether to treat the image as a single 3D or a set of 2Ds. This is a hint for certain image formats which has no difference between 3D image and set of 2Ds.\nexception ImageFormatException\nexception ImageReadException"))
+	.def("read_image_mapped", &EMAN::EMData::read_image_mapped, EMAN_EMData_read_image_mapped_overloads_1_3(args("filename", "img_index", "is_3d"), "read an image as a read-only view of the memory mapped file. The pixels are copied on the first write.\nThe file must not be changed while it is mapped, call detach_mapped() first.\nOnly native endian float MRC/MRCS/FEI raw data can be mapped, other images are read normally.\n\nfilename The image file name.\nimg_index The nth image you want to read.\nis_3d  Whether to treat the image as a single 3D or a set of 2Ds.\nexception ImageFormatException\nexception ImageReadException"))
+	.def("detach_mapped", &EMAN::EMData::detach_mapped, "If the pixels are a view of a memory mapped file (see read_image_mapped()), give the image its own copy of them,\nso it no longer depends on the file. Call this before the file is rewritten.")
+	.def("read_image_compact", &EMAN::EMData::read_image_compact, EMAN_EMData_read_image_compact_overloads_1_4(args("filename", "img_index", "region", "is_3d"), "read an image keeping 8 and 16 bit integer pixels in their file type instead of widening them to float.\nThey are converted the first time float pixels are needed, see get_storage_type(). MRC files (and whole images in HDF files)\nsupport this, anything else is read normally.\n\nfilename The image file name.\nimg_index The nth image you want to read.\nregion To read only a region of the image.\nis_3d  Whether to treat the image as a single 3D or a set of 2Ds.\nexception ImageFormatException\nexception ImageReadException"))
 	.def("read_binedimage", &EMAN::EMData::read_binedimage, EMAN_EMData_read_binedimage_overloads_1_5(args("filename", "img_index", "binfactor", "fast", "is_3d"), "read an image file and stores its information to this EMData object.\nfilename The image file name.\nimg_index The nth image you want to read.\nbinfactor The amount by which to bin by. Must be an integer\nfast bin very binfactor xy slice otherwise meanshrink z slice\nis_3d  Whether to treat the image as a single 3D or a set of 2Ds. This is a hint for certain image formats which has no difference between 3D image and set of 2Ds.\nexception ImageFormatException\nexception ImageReadException"))
 	.def("write_image", &EMAN::EMData::write_image, EMAN_EMData_write_image_overloads_1_7(args("filename", "img_index", "imgtype", "header_only", "region", "filestoragetype", "use_host_endian"), "write the header and data out to an image.\n\nIf the img_index = -1, append the image to the given image file.\n\nIf the given image file already exists, this image\nformat only stores 1 image, and no region is given, then\ntruncate the image file  to  zero length before writing\ndata out. For header writing only, no truncation happens.\n\nIf a region is given, then write a region only.\n\nfilename - The image file name.\nimg_index - The nth image to write as.\nimgtype - Write to the given image format type. if not specified, use the 'filename' extension to decide.\nheader_only - To write only the header or both header and data.\nregion - Define the region to write to.\nfilestoragetype - The image data type used in the output file.\nuse_host_endian - To write in the host computer byte order.\n\nexception - ImageFormatException\nexception ImageWriteException"))
 	.def("append_image", &EMAN::EMData::append_image, EMAN_EMData_append_image_overloads_1_3(args("filename", "imgtype", "header_only"), "append to an image file; If the file doesn't exist, create one.\nfilename - The image file name.\nimgtype - Write to the given image format type. if not specified, use the 'filename' extension to decide.\nheader_only - To write only the header or both header and data."))
@@ -589,7 +636,14 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("get_3dcview", (EMAN::MCArray3D (EMAN::EMData::*)(int, int, int) const)&EMAN::EMData::get_3dcview, args("x0, y0", "z0"), "Get complex image raw pixel data in a 3D multi-array format. The\ndata coordinates is translated by (x0,y0,z0) such that\narray[z0][y0][x0] points to the pixel at the origin location.\nthe data coordiates translated by (x0,y0,z0). The\narray shares the memory space with the image data.\nIt should be used on 3D image only.\n \nx0 - X-axis translation amount.\ny0 - Y-axis translation amount.\nz0 - Z-axis translation amount.\n \nreturn 3D multi-array format of the raw data.")
 	.def("get_attr", &EMAN::EMData::get_attr, args("attr_name"), "The generic way to get any image header information\ngiven a header attribute name. If the attribute does not exist,\nit will raise an exception.\n \nattr_name - The header attribute name.\n \nreturn The attribute value.\nexception - NotExistingObjectException when attribute not exist")
 	.def("get_attr_default", &EMAN::EMData::get_attr_default, EMAN_EMData_get_attr_default_overloads_1_2(args("attr_name", "em_obj"), "The generic way to get any image header information\ngiven a header attribute name. If the attribute does not exist,\nit will return a default EMObject() object, which will be converted\nto None in Python. Or return any object user submit.\n \nattr_name - The header attribute name.\nem_obj - the default attribute to return when this attr_name not exist in attr_dict. default to None."))
+	.def("get_attr_apix", &EMAN::EMData::get_attr_apix, args("key"), "Get an apix attribute without searching the attribute dictionary.\n \nkey - EMData.HotAttr.ATTR_APIX_X, ATTR_APIX_Y or ATTR_APIX_Z\n \nreturn The attribute value, 1.0 if the image has no such attribute.")
+	.def("get_attr_transform", &EMAN::EMData::get_attr_transform, args("key"), return_value_policy< copy_const_reference >(), "Get a transform attribute, parsed once and cached by the image.\n \nkey - EMData.HotAttr.ATTR_XFORM_PROJECTION, ATTR_XFORM_ALIGN2D or ATTR_XFORM_ALIGN3D\n \nreturn A copy of the Transform.\nexception - NotExistingObjectException when attribute not exist")
+	.def("get_attr_class_ptcl_idxs", &EMAN::EMData::get_attr_class_ptcl_idxs, return_value_policy< copy_const_reference >(), "Get the class_ptcl_idxs attribute of a class average.\n \nreturn The particle indices, empty if the image has none.")
+	.def("get_hot_attr_name", &EMAN::EMData::get_hot_attr_name, args("key"), "return The attribute name interned as key.")
+	.staticmethod("get_hot_attr_name")
 	.def("set_attr", &EMAN::EMData::set_attr, args("key", "val"), "Set a header attribute's value from Python.\n \nkey - The header attribute name.\nval - The attribute value.")
+	.def("get_storage_type", &EMAN::EMData::get_storage_type, "Get the type the pixels are stored in, EM_FLOAT or a compact type (EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT, EM_HALF)\nkept until float pixels are needed.\n \nreturn the storage type")
+	.def("set_storage_type", &EMAN::EMData::set_storage_type, args("type"), "Convert the pixels to another storage type. Integer types round and clamp the values, half floats keep 11 significant bits.\n \ntype - EM_FLOAT, EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF")
 	.def("get_attr_dict", &EMAN::EMData::get_attr_dict, "Get the image attribute dictionary containing all the\nimage attribute names and attribute values.\n \nreturn The image attribute dictionary containing all attribute names and values.")
 	.def("set_attr_dict", &EMAN::EMData::set_attr_dict, args("new_dict"), "Merge the new values with the existing dictionary.\n \nnew_dict - The new attribute dictionary.")
 	.def("del_attr", &EMAN::EMData::del_attr, args("attr_name"), "Delete the attribute from dictionary.\n \nattr_name - the attribute name to be removed.")
@@ -634,6 +688,9 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("process", &EMData_process_wrapper1,args("processorname"),return_value_policy< manage_new_object >(), "Apply a processor with its parameters on a copy of this image, return result\nas a a new image. The returned image may or may not be the same size as this image.\n \nprocessorname - Processor Name.\nparams - Processor parameters in a keyed dictionary.\n \nreturn the processed result, a new image\n \nexception - NotExistingObjectError If the processor doesn't exist.")
 	.def("process", &EMData_process_wrapper2,args("processorname", "params"),return_value_policy< manage_new_object >(), "Apply a processor with its parameters on a copy of this image, return result\nas a a new image. The returned image may or may not be the same size as this image.\n \nprocessorname - Processor Name.\nparams - Processor parameters in a keyed dictionary.\n \nreturn the processed result, a new image\n \nexception - NotExistingObjectError If the processor doesn't exist.")
 	.def("process", (EMAN::EMData* (EMAN::EMData::*)(EMAN::Processor*) const )&EMAN::EMData::process, args("p"), "Call the process with an instance od Processor, usually this instance can\nbe get by (in Python) Processors.get('name', {'k':v, 'k':v})\n \np - the processor object", return_value_policy< manage_new_object >())
+	.def("process_move", &EMData_process_move_wrapper1,args("processorname"),return_value_policy< manage_new_object >(), "Like process(), but moves the pixels of this image into the result instead of copying them, leaving this image empty (0x0x0). Use for a=a.process_move(...) chains, where the source is discarded anyway.\n \nprocessorname - Processor Name.\n \nreturn the processed result, a new image\n \nexception - NotExistingObjectError If the processor doesn't exist.")
+	.def("process_move", &EMData_process_move_wrapper2,args("processorname", "params"),return_value_policy< manage_new_object >(), "Like process(), but moves the pixels of this image into the result instead of copying them, leaving this image empty (0x0x0). Use for a=a.process_move(...) chains, where the source is discarded anyway.\n \nprocessorname - Processor Name.\nparams - Processor parameters in a keyed dictionary.\n \nreturn the processed result, a new image\n \nexception - NotExistingObjectError If the processor doesn't exist.")
+	.def("swap", &EMAN::EMData::swap, args("that"), "Exchange everything, pixels and header, with another image, without copying the pixels.\n \nthat - the image to exchange with")
 	.def("process_inplace", (void (EMAN::EMData::*)(EMAN::Processor*) )&EMAN::EMData::process_inplace, args("p"), "Call the process_inplace with an instance od Processor, usually this instancecan\nbe get by (in Python) Processors.get('name', {'k':v, 'k':v}).\n \np - the processor object")
 	.def("cmp", &EMData_cmp_wrapper2, args("cmpname", "with"), "Compare this image with another image.\n \ncmpname - Comparison algorithm name.\nwith - The image you want to compare to.\nparams - Comparison parameters in a keyed dictionary, default to Null.\n \nreturn comparison score. The bigger, the better.\nexception - NotExistingObjectError If the comparison algorithm doesn't exist.")
 	.def("cmp", &EMData_cmp_wrapper3, args("cmpname", "with", "params"), "Compare this image with another image.\n \ncmpname - Comparison algorithm name.\nwith - The image you want to compare to.\nparams - Comparison parameters in a keyed dictionary, default to Null.\n \nreturn comparison score. The bigger, the better.\nexception - NotExistingObjectError If the comparison algorithm doesn't exist.")
@@ -716,6 +773,8 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("sget_value_at", (float (EMAN::EMData::*)(size_t) const)&EMAN::EMData::sget_value_at, args("i"), "A safer, slower way to get the pixel density value\ngiven an index 'i' assuming\nthe pixles are stored in a 1D array. The validity of i\nis checked. If i is out of range, return 0.\n \ni - 1D data array index.\n \nreturn The pixel density value")
 	.def("sget_value_at_interp", (float (EMAN::EMData::*)(float, float) const)&EMAN::EMData::sget_value_at_interp,args("x", "y"), "Get pixel density value at interpolation of (x,y).\nThe validity of x, y is checked.2D image only.\n \nx - The x cooridinate.\ny - The y cooridinate.\n \nreturn The pixel density value at coordinates (x,y).")
 	.def("sget_value_at_interp", (float (EMAN::EMData::*)(float, float, float) const)&EMAN::EMData::sget_value_at_interp, args("x", "y", "z"), "Get the pixel density value at interpolation of (x,y,z).\nThe validity of x, y, and z is checked.\n \nx - The x cooridinate.\ny - The y cooridinate.\nz - The z cooridinate.\n \nreturn The pixel density value at coordinates (x,y,z).")
+	.def("sget_values_at_interp", (std::vector<float> (EMAN::EMData::*)(const std::vector<float>&, const std::vector<float>&) const)&EMAN::EMData::sget_values_at_interp, args("x", "y"), "sget_value_at_interp(x[i], y[i]) at every point, interpolated with SIMD instructions and threads.\n \nx - The x coordinates.\ny - The y coordinates.\n \nreturn The list of interpolated values.")
+	.def("sget_values_at_interp", (std::vector<float> (EMAN::EMData::*)(const std::vector<float>&, const std::vector<float>&, const std::vector<float>&) const)&EMAN::EMData::sget_values_at_interp, args("x", "y", "z"), "sget_value_at_interp(x[i], y[i], z[i]) at every point, interpolated with SIMD instructions and threads.\n \nx - The x coordinates.\ny - The y coordinates.\nz - The z coordinates.\n \nreturn The list of interpolated values.")
 	.def("set_value_at", (void (EMAN::EMData::*)(int, int, int, float) )&EMAN::EMData::set_value_at, args("x", "y", "z", "v"), "Set the pixel density value at coordinates (x,y,z).\nThis implementation does bounds checking.\n \nx - The x cooridinate.\ny - The y cooridinate.\nz - The z cooridinate.\nv - The pixel density value at coordinates (x,y,z).\n \nexception - OutofRangeException wehn index out of image data's range.")
 	.def("set_value_at_fast", (void (EMAN::EMData::*)(int, int, int, float) )&EMAN::EMData::set_value_at_fast, args("x", "y", "z", "v"), "Set the pixel density value at coordinates (x,y,z).\nThe validity of x, y, and z is not checked.\nThis implementation has no bounds checking.\n \nx - The x cooridinate.\ny - The y cooridinate.\nz - The z cooridinate.\nv - The pixel density value at coordinates (x,y,z).")
 	.def("set_value_at", (void (EMAN::EMData::*)(int, int, float) )&EMAN::EMData::set_value_at, args("x", "y", "v"), "Set the pixel density value at coordinates (x,y).\n2D image only.\n \nx - The x cooridinate.\ny - The y cooridinate.\nv - The pixel density value at coordinates (x,y).\n \nexception - OutofRangeException wehn index out of image data's range.")
@@ -878,8 +937,12 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 	.def("getwedge", &EMAN::EMData::compute_missingwedge, EMAN_EMData_compute_missingwedge_overloads_1_3(args("wedgeangle", "start", "stop"), "get the missingt wedge mean ansd std")[ return_value_policy< manage_new_object >() ])
 	.def("__getitem__", &emdata_getitem)
 	.def("__setitem__", &emdata_setitem)
+	.def("do_fft_inplace_many", &EMAN::EMData::do_fft_inplace_many, EMAN_EMData_do_fft_inplace_many_overloads_1_2(args("images", "nthreads"), "Fourier transform a list of equal size real images in place in one call.\nSame result as do_fft_inplace() on each image, but the FFT plan is looked up once\nand the images are spread over several threads.\n \nimages - the real images, all of the same size\nnthreads - the number of threads, 0 for the process default(default=0)"))
+	.def("do_fft_many", &EMAN::EMData::do_fft_many, EMAN_EMData_do_fft_many_overloads_1_2(args("images", "nthreads"), "Fourier transform a list of equal size real images in one call.\nSame result as do_fft() on each image, but the FFT plan is looked up once\nand the images are spread over several threads. The images are not changed.\n \nimages - the real images, all of the same size\nnthreads - the number of threads, 0 for the process default(default=0)\n \nreturn The FFTs in real/imaginary format."))
 	.staticmethod("read_images_ext")
 	.staticmethod("read_images")
+	.staticmethod("do_fft_many")
+	.staticmethod("do_fft_inplace_many")
 	.def("__add__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator+, return_value_policy< manage_new_object >() )
 	.def("__sub__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator-, return_value_policy< manage_new_object >() )
 	.def("__mul__", (EMAN::EMData* (*)(const EMAN::EMData&, const EMAN::EMData&) )&EMAN::operator*, return_value_policy< manage_new_object >() )
@@ -911,6 +974,18 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 #endif	//_WIN32
 	);
 
+	enum_< EMAN::EMData::HotAttr >("HotAttr")
+	    .value("ATTR_APIX_X", EMAN::EMData::ATTR_APIX_X)
+	    .value("ATTR_APIX_Y", EMAN::EMData::ATTR_APIX_Y)
+	    .value("ATTR_APIX_Z", EMAN::EMData::ATTR_APIX_Z)
+	    .value("ATTR_XFORM_PROJECTION", EMAN::EMData::ATTR_XFORM_PROJECTION)
+	    .value("ATTR_XFORM_ALIGN2D", EMAN::EMData::ATTR_XFORM_ALIGN2D)
+	    .value("ATTR_XFORM_ALIGN3D", EMAN::EMData::ATTR_XFORM_ALIGN3D)
+	    .value("ATTR_CTF", EMAN::EMData::ATTR_CTF)
+	    .value("ATTR_CLASS_PTCL_IDXS", EMAN::EMData::ATTR_CLASS_PTCL_IDXS)
+	;
+
+
 	enum_< EMAN::EMData::FFTPLACE >("FFTPLACE")
 	    .value("FFT_IN_PLACE", EMAN::EMData::FFT_IN_PLACE)
 	    .value("FFT_OUT_OF_PLACE", EMAN::EMData::FFT_OUT_OF_PLACE)
@@ -924,5 +999,33 @@ BOOST_PYTHON_MODULE(libpyEMData2)
 
 	delete EMAN_EMData_scope;
 
+#ifdef USE_FFTW3
+	scope* EMAN_EMfft_scope = new scope(
+	class_< EMAN::EMfft >("EMfft", "Process-wide configuration of the FFTW planner used by all Fourier transforms.", no_init)
+	.def("set_plan_mode", &EMAN::EMfft::set_plan_mode, args("mode"), "Set the planner rigor for FFT plans created from now on.\n \nmode - EMfft.PlanMode.PLAN_ESTIMATE, PLAN_MEASURE or PLAN_PATIENT")
+	.def("get_plan_mode", &EMAN::EMfft::get_plan_mode, "Return the current planner rigor.")
+	.def("set_num_threads", &EMAN::EMfft::set_num_threads, args("nthreads"), "Set the number of threads used for large transforms, small transforms always use one.\n \nnthreads - number of threads, at least 1")
+	.def("get_num_threads", &EMAN::EMfft::get_num_threads, "Return the number of threads used for large transforms.")
+	.def("load_wisdom", &EMAN::EMfft::load_wisdom, EMAN_EMfft_load_wisdom_overloads_0_1(args("filename"), "Import FFTW wisdom from a file.\n \nfilename - wisdom file, the default wisdom file if empty\n \nreturn True if the wisdom was read"))
+	.def("save_wisdom", &EMAN::EMfft::save_wisdom, EMAN_EMfft_save_wisdom_overloads_0_1(args("filename"), "Export the accumulated FFTW wisdom to a file.\n \nfilename - wisdom file, the default wisdom file if empty\n \nreturn True if the wisdom was written"))
+	.def("get_wisdom_file", &EMAN::EMfft::get_wisdom_file, "Return the default wisdom file, $EMAN2_FFTW_WISDOM or ~/.eman2/fftwf_wisdom.")
+	.staticmethod("set_plan_mode")
+	.staticmethod("get_plan_mode")
+	.staticmethod("set_num_threads")
+	.staticmethod("get_num_threads")
+	.staticmethod("load_wisdom")
+	.staticmethod("save_wisdom")
+	.staticmethod("get_wisdom_file")
+	);
+
+	enum_< EMAN::EMfft::PlanMode >("PlanMode")
+	    .value("PLAN_ESTIMATE", EMAN::EMfft::PLAN_ESTIMATE)
+	    .value("PLAN_MEASURE", EMAN::EMfft::PLAN_MEASURE)
+	    .value("PLAN_PATIENT", EMAN::EMfft::PLAN_PATIENT)
+	;
+
+	delete EMAN_EMfft_scope;
+#endif	//USE_FFTW3
+
 }
 
@@ -110,6 +110,8 @@ struct EMAN_Processor_Wrapper: EMAN::Processor
 };
 
 
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_ProcessorPipeline_add_overloads_1_2, add, 1, 2)
+
 }// namespace
 
 
@@ -174,6 +176,14 @@ BOOST_PYTHON_MODULE(libpyProcessor2)
         .staticmethod("get")
     ;
 
+    class_< EMAN::ProcessorPipeline, boost::noncopyable >("ProcessorPipeline", "A chain of processors, created once and applied in order to any number of images.\nConsecutive real space pixel processors run in one pass, consecutive Fourier filters\nare merged into one filter applied with a single FFT pair.", init<  >())
+        .def("add", &EMAN::ProcessorPipeline::add, EMAN_ProcessorPipeline_add_overloads_1_2(args("processorname", "params"), "Append a processor to the pipeline.\n \nprocessorname - Processor name.\nparams - Processor parameters in a keyed dictionary."))
+        .def("process_inplace", &EMAN::ProcessorPipeline::process_inplace, args("image"), "Apply all the processors to image.")
+        .def("process", &EMAN::ProcessorPipeline::process, args("image"), "Apply all the processors to a copy of image, and return it.", return_value_policy< manage_new_object >())
+        .def("get_num_steps", &EMAN::ProcessorPipeline::get_num_steps, "return the number of processors in the pipeline")
+        .def("get_num_passes", &EMAN::ProcessorPipeline::get_num_passes, "return the number of passes the pipeline makes over an image, after merging")
+    ;
+
 #ifdef SPARX_USING_CUDA	
 // Class to wrap MPI CUDA kmeans code
     class_< EMAN::MPICUDA_kmeans, boost::noncopyable >("MPICUDA_kmeans", init<>())
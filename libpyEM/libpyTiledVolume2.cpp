@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ *
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * */
+
+#ifdef _WIN32
+	#pragma warning(disable:4819)
+#endif	//_WIN32
+
+// Boost Includes ==============================================================
+#include <boost/python.hpp>
+
+// Includes ====================================================================
+#include <tiledvolume.h>
+
+// Using =======================================================================
+using namespace boost::python;
+
+// Declarations ================================================================
+namespace  {
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(EMAN_TiledVolume_create_overloads_4_7, EMAN::TiledVolume::create, 4, 7)
+
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_TiledVolume_get_clip_overloads_1_2, get_clip, 1, 2)
+
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_TiledVolume_process_inplace_overloads_1_3, process_inplace, 1, 3)
+
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(EMAN_TiledVolume_process_overloads_2_4, process, 2, 4)
+
+}// namespace
+
+
+// Module ======================================================================
+BOOST_PYTHON_MODULE(libpyTiledVolume2)
+{
+    scope* EMAN_TiledVolume_scope = new scope(
+    class_< EMAN::TiledVolume, boost::noncopyable >("TiledVolume",
+    		"TiledVolume is a disk backed 3D volume for maps which do not fit in memory.\n"
+    		"Tiles are read and written through region I/O and cached within a memory budget.",
+    		init< const std::string&, optional< bool, int, size_t > >())
+    .def("create", &EMAN::TiledVolume::create, EMAN_TiledVolume_create_overloads_4_7()[ return_value_policy< manage_new_object >() ])
+    .staticmethod("create")
+    .def("get_filename", &EMAN::TiledVolume::get_filename)
+    .def("get_xsize", &EMAN::TiledVolume::get_xsize)
+    .def("get_ysize", &EMAN::TiledVolume::get_ysize)
+    .def("get_zsize", &EMAN::TiledVolume::get_zsize)
+    .def("get_tile_size", &EMAN::TiledVolume::get_tile_size)
+    .def("get_attr_dict", &EMAN::TiledVolume::get_attr_dict)
+    .def("set_memory_budget", &EMAN::TiledVolume::set_memory_budget)
+    .def("get_memory_budget", &EMAN::TiledVolume::get_memory_budget)
+    .def("get_cached_bytes", &EMAN::TiledVolume::get_cached_bytes)
+    .def("get_value_at", &EMAN::TiledVolume::get_value_at)
+    .def("set_value_at", &EMAN::TiledVolume::set_value_at)
+    .def("get_clip", &EMAN::TiledVolume::get_clip, EMAN_TiledVolume_get_clip_overloads_1_2()[ return_value_policy< manage_new_object >() ])
+    .def("insert_clip", &EMAN::TiledVolume::insert_clip)
+    .def("get_stats", &EMAN::TiledVolume::get_stats)
+    .def("process_inplace", &EMAN::TiledVolume::process_inplace, EMAN_TiledVolume_process_inplace_overloads_1_3())
+    .def("process", &EMAN::TiledVolume::process, EMAN_TiledVolume_process_overloads_2_4()[ return_value_policy< manage_new_object >() ])
+    .def("bin", &EMAN::TiledVolume::bin, return_value_policy< manage_new_object >())
+    .def("mult", &EMAN::TiledVolume::mult)
+    .def("flush", &EMAN::TiledVolume::flush)
+    );
+
+    delete EMAN_TiledVolume_scope;
+
+}
@@ -733,6 +733,9 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
 #ifndef _WIN32
 		.def("recv_broadcast", &EMAN::Util::recv_broadcast, args("port"), "")
 #endif	//_WIN32
+		.def("set_num_threads", &EMAN::Util::set_num_threads, args("nthreads"), "Set the number of threads used by multithreaded image operations.\n \nnthreads - number of threads, at least 1")
+		.def("get_num_threads", &EMAN::Util::get_num_threads, "Get the number of threads used by multithreaded image operations.\nDefaults to $EMAN2_NUM_THREADS, or 1.")
+		.def("simd_width", &EMAN::Util::simd_width, "Get the number of floats the image arithmetic processes per SIMD instruction, 1 without SIMD.")
 		.def("get_time_label", &EMAN::Util::get_time_label, "Get the current time in a string with format 'mm/dd/yyyy hh:mm'.\n \nreturn The current time string.")
 		.def("eman_copysign", &EMAN::Util::eman_copysign, args("a", "b"), "copy sign of a number. return a value whose absolute value\nmatches that of 'a', but whose sign matches that of 'b'.  If 'a'\nis a NaN, then a NaN with the sign of 'b' is returned.\nIt is exactly copysign() on non-Windows system.\n \na - The first number.\nb - The second number.\n \nreturn Copy sign of a number.")
 		.def("eman_erfc", &EMAN::Util::eman_erfc, args("x"), "complementary error function. It is exactly erfc() on\nnon-Windows system. On Windows, it tries to simulate erfc().\n \nThe erf() function returns the error function of x; defined as\nerf(x) = 2/sqrt(pi)* integral from 0 to x of exp(-t*t) dt\n \nThe erfc() function returns the complementary error function of x, that\nis 1.0 - erf(x).\n \nx - A float number.\n \nreturn The complementary error function of x.")
@@ -831,6 +834,9 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
 		.staticmethod("square_sum")
 		.staticmethod("Polar2D")
 		.staticmethod("get_time_label")
+		.staticmethod("set_num_threads")
+		.staticmethod("get_num_threads")
+		.staticmethod("simd_width")
 		.staticmethod("get_max")
 		.staticmethod("mul_img")
 		.staticmethod("mul_img_tabularized")
@@ -1163,17 +1169,29 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
         .def("is_same_size", &EMAN::EMUtil::is_same_size, args("image1", "image2"), "Check whether two EMData images are of the same size.\n \nimage1 - The first EMData image.\nimage2 - The second EMData image.return Whether two EMData images are of the same size.")
         .def("is_same_ctf", &EMAN::EMUtil::is_same_ctf,args("image1", "image2"), "Check whether two EMData images have the same CTF parameters.\n \nimage1 - The first EMData image.\nimage2 The second EMData image.\n \nreturn whether two EMData images have the same CTF.")
         .def("is_complex_type", &EMAN::EMUtil::is_complex_type, args("datatype"), "")
+        .def("get_datatype_size", &EMAN::EMUtil::get_datatype_size, args("type"), "Get the size of one sample of a data type\n \ntype - the EMDataType\n \nreturn the size in bytes, 0 for EM_UNKNOWN")
+        .def("is_compact_type", &EMAN::EMUtil::is_compact_type, args("type"), "Is type one of the reduced precision types EMData can store its pixels in, EM_CHAR, EM_UCHAR, EM_SHORT, EM_USHORT or EM_HALF")
         .def("is_valid_filename", &EMAN::EMUtil::is_valid_filename, args("filename"), "Ask whether or not the given filename is a valid EM image filename\nThis is the same thing as checking whether or not the return value of EMUtil.get_image_ext_type\nis IMAGE_UNKNOWN\n \nfilename - Image file name.\n \nreturn whether or not it is a valid filename")
         .def("jump_lines", &EMAN::EMUtil::jump_lines, args("file", "nlines"), "")
         .def("get_euler_names", &EMAN::EMUtil::get_euler_names, args("euler_type"), "")
         .def("get_all_attributes", &EMAN::EMUtil::get_all_attributes, args("file_name", "attr_name"), "Get an attribute from a stack of image, returned as a vector\n \nfile_name - the image file name\nattr_name - The header attribute name.\n \nreturn the vector of attribute value\n \nexception - NotExistingObjectException when access an non-existing attribute\nexception - InvalidCallException when call this function for a non-stack image")
 		.def("cuda_available", &EMAN::EMUtil::cuda_available)
+		.def("set_pool_limit", &EMAN::EMUtil::set_pool_limit, args("bytes"), "Limit the memory the image buffer pool keeps for reuse.\n \nbytes - the limit, 0 disables the pool")
+		.def("get_pool_limit", &EMAN::EMUtil::get_pool_limit, "Get the memory limit of the image buffer pool.")
+		.def("clear_pool", &EMAN::EMUtil::clear_pool, "Return every buffer cached by the image buffer pool to the system.")
+		.def("get_pool_stats", &EMAN::EMUtil::get_pool_stats, "Get the image buffer pool counters: hits, misses, cached_bytes, cached_buffers and limit.")
+		.def("set_huge_pages", &EMAN::EMUtil::set_huge_pages, args("enable"), "Back image buffers of 4 MB and more with transparent huge pages (Linux only).\n \nenable - True to enable")
 #ifdef USE_HDF5
 		.def("read_hdf_attribute", &EMAN::EMUtil::read_hdf_attribute, EMAN_EMUtil_read_hdf_attribute_2_3(args("filename", "key", "image_index"), "Retrive a single attribute value from a HDF5 image file.\n \nfilename - HDF5 image's file name\nkey - the attribute's key name\nimage_index - the image index, default=0\n \nreturn the attribute value for the given key"))
 		.def("write_hdf_attribute", &EMAN::EMUtil::write_hdf_attribute, EMAN_EMUtil_write_hdf_attribute_3_4(args("filename", "key", "value", "image_index"), "Write a single attribute value from a HDF5 image file.\n \nfilename - HDF5 image's file name\nkey - the attribute's key name\nvalue - the attribute's value\nimage_index - the image index, default=0\n \nreturn 0 for success"))
 		.def("delete_hdf_attribute", &EMAN::EMUtil::delete_hdf_attribute, EMAN_EMUtil_delete_hdf_attribute_2_3(args("filename", "key", "image_index"), "Delete a single attribute from a HDF5 image file.\n \nfilename - HDF5 image's file name\nkey - the attribute's key name\nimage_index - the image index, default=0\n \nreturn 0 for success, -1 for failure."))
 #endif	//USE_HDF5
         .staticmethod("cuda_available")
+        .staticmethod("set_pool_limit")
+        .staticmethod("get_pool_limit")
+        .staticmethod("clear_pool")
+        .staticmethod("get_pool_stats")
+        .staticmethod("set_huge_pages")
         .staticmethod("read_raw_emdata")
         .staticmethod("vertical_acf")
         .staticmethod("get_datatype_string")
@@ -1192,6 +1210,8 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
         .staticmethod("get_image_ext_type")
         .staticmethod("process_ascii_region_io")
         .staticmethod("is_complex_type")
+        .staticmethod("get_datatype_size")
+        .staticmethod("is_compact_type")
 #ifdef USE_HDF5
         .staticmethod("read_hdf_attribute")
         .staticmethod("write_hdf_attribute")
@@ -1212,6 +1232,7 @@ hyb -- y- mesh spacing above f0\nhya -- y- mesh spacing below f0\n \nInterpolant
         .value("EM_UINT", EMAN::EMUtil::EM_UINT)
         .value("EM_DOUBLE", EMAN::EMUtil::EM_DOUBLE)
         .value("EM_FLOAT", EMAN::EMUtil::EM_FLOAT)
+        .value("EM_HALF", EMAN::EMUtil::EM_HALF)
     ;
 
 
@@ -77,7 +77,7 @@ python::numeric::array EMAN::make_numeric_complex_array(const std::complex<float
 
 python::numeric::array EMNumPy::em2numpy(const EMData *const image)
 {
-	float * data = image->get_data();
+	float * data = image->export_data();
 	int nx = image->get_xsize();
 	int ny = image->get_ysize();
 	int nz = image->get_zsize();
@@ -472,7 +472,7 @@ def main():
 						except:
 							pass
 
-				if filtername in oopprocs : data=data.process(filtername,param_dict)
+				if filtername in oopprocs : data=data.process_move(filtername,param_dict)
 				else : 
 					try: data.process_inplace(filtername, param_dict)
 					except:
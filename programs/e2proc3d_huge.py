@@ -50,9 +50,10 @@ def main():
 	usage = progname + """ [options] <inputfile>
 	This is a specialized version of e2proc3d.py targeted at performing a limited set of operations on
 very large volumes in-place (such as tomograms) which may not readily fit into system memory. Operations are 
-performed by reading portions of the image, processing, then writing the portion back to disk. Unlike e2proc3d.py
-you may pass only a single operation to the program for each invocation, or behavior will be undefined. It will 
-process a single volume in a single file in-place.
+performed tile by tile, caching only as many tiles as fit in --memory, and writing modified tiles back to disk.
+It will process a single volume in a single MRC or HDF file in-place, applying --process, --mult, --add and --multfile
+in that order. Each tile is processed with --halo voxels of its neighbors, so local filters match processing the
+whole volume if the halo covers the filter. Masks and normalization use the geometry and statistics of the whole volume.
 
 """
 	parser = OptionParser(usage)
@@ -73,28 +74,67 @@ process a single volume in a single file in-place.
 								help="Adds a constant 'f' to the densities")
 
 	parser.add_option("--trans", metavar="dx,dy,dz", type="string", default=0, help="Translate map by dx,dy,dz ")
+	parser.add_option("--halo", metavar="n", type="int", default=0, help="Voxels of context each tile sees when processing with --process. Should be at least the reach of the processor, eg - 3 sigma of a real-space Gaussian.")
+	parser.add_option("--tilesize", metavar="n", type="int", default=0, help="Edge length of the cubic tiles the volume is processed in. Default 256")
+	parser.add_option("--memory", metavar="mb", type="int", default=0, help="Maximum memory in MB used to cache tiles. Default 1024, or $EMAN2_TILE_MEMORY")
+	parser.add_option("--bin", metavar="n", type="int", default=0, help="Bin the volume by an integer factor, writing the result to a second file: e2proc3d_huge.py --bin 2 <input> <output>")
 	parser.add_option("--ppid", type=int, help="Set the PID of the parent process, used for cross platform PPID",default=-1)
 	parser.add_option("--verbose", "-v", dest="verbose", action="store", metavar="n", type="int", default=0, help="verbose level [0-9], higner number means higher level of verboseness")
 		
 	(options, args) = parser.parse_args()
 
-	print("Sorry, this program still under development. Not functional yet.")
-	sys.exit(1)
+	if len(args)<1 :
+		parser.error("Input file required")
 
-	try:
-		hdr=EMData(args[1],0,1)
-	except:
-		print("ERROR: Can't read input file header")
+	if options.streaksubtract!=None or options.trans :
+		print("ERROR: --streaksubtract and --trans are not supported yet")
 		sys.exit(1)
 
+	logid=E2init(sys.argv,options.ppid)
 
-	if options.mediansubtract!=None :
-		pass  # Added this to make python happy
-		
+	if options.bin>1 :
+		if len(args)<2 :
+			parser.error("--bin requires an output file")
+		vol=TiledVolume(args[0],False,options.tilesize,options.memory*1048576)
+		if options.verbose>0 : print("Binning {}x{}x{} by {}".format(vol.get_xsize(),vol.get_ysize(),vol.get_zsize(),options.bin))
+		out=vol.bin(args[1],options.bin)
+		del out
+		E2end(logid)
+		return
 
-def findmode(img) :
-	"""This computes something akin to the mode"""
+	try:
+		vol=TiledVolume(args[0],True,options.tilesize,options.memory*1048576)
+	except:
+		print("ERROR: Can't open {} for modification. Only MRC and HDF files storing floats can be processed in-place.".format(args[0]))
+		sys.exit(1)
 
+	if options.process!=None :
+		for p in options.process:
+			(processorname, param_dict) = parsemodopt(p)
+			if not param_dict : param_dict={}
+			if options.verbose>0 : print("Processing with {} {}".format(processorname,param_dict))
+			vol.process_inplace(processorname,param_dict,options.halo)
+
+	if options.mult!=None :
+		vol.process_inplace("math.linear",{"scale":options.mult,"shift":0.0})
+
+	if options.add!=None :
+		vol.process_inplace("math.linear",{"scale":1.0,"shift":options.add})
+
+	if options.multfile!=None :
+		# the mask is read once in tile order, so it only needs one tile, taken from vol's budget
+		budget=vol.get_memory_budget()
+		tilebytes=vol.get_tile_size()**3*4
+		vol.set_memory_budget(max(budget-tilebytes,tilebytes))
+		for f in options.multfile:
+			mask=TiledVolume(f,False,vol.get_tile_size(),tilebytes)
+			vol.mult(mask)
+			del mask
+		vol.set_memory_budget(budget)
+
+	vol.flush()
+	E2end(logid)
+		
 
 if __name__ == "__main__":
 	main()
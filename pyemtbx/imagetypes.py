@@ -84,3 +84,4 @@ EM_DOUBLE = EMUtil.EMDataType.EM_DOUBLE
 EM_SHORT_COMPLEX = EMUtil.EMDataType.EM_SHORT_COMPLEX
 EM_USHORT_COMPLEX = EMUtil.EMDataType.EM_USHORT_COMPLEX
 EM_FLOAT_COMPLEX = EMUtil.EMDataType.EM_FLOAT_COMPLEX
+EM_HALF = EMUtil.EMDataType.EM_HALF
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ *
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ *
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * */
+
+
+/* Times the elementwise image arithmetic (EMData::add, mult, div, addsquare, dot)
+ * against a plain loop over the same data, with 1 thread and with the requested number,
+ * to track the gain from SIMD and threading.
+ *
+ * usage: arith_bench [threads] [seconds per test]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include "emdata.h"
+#include "util.h"
+
+#ifdef _WIN32
+#include <ctime>
+#else
+#include <sys/time.h>
+#endif
+
+using namespace std;
+using namespace EMAN;
+
+static double now()
+{
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+enum Op { ADD, MULT, DIV, ADDSQUARE, DOT, NOPS };
+static const char *op_names[NOPS] = { "add", "mult", "div", "addsquare", "dot" };
+
+static volatile double sink = 0;	// keeps the dot products from being optimized away
+
+static void run_loop(Op op, float *a, const float *b, size_t n)
+{
+	switch (op) {
+	case ADD: for (size_t i = 0; i < n; i++) a[i] += b[i]; break;
+	case MULT: for (size_t i = 0; i < n; i++) a[i] *= b[i]; break;
+	case DIV: for (size_t i = 0; i < n; i++) if (b[i] != 0) a[i] /= b[i]; break;
+	case ADDSQUARE: for (size_t i = 0; i < n; i++) a[i] += b[i] * b[i]; break;
+	case DOT: {
+		double r = 0;
+		for (size_t i = 0; i < n; i++) r += a[i] * b[i];
+		sink += r;
+		break;
+	}
+	default: break;
+	}
+}
+
+static void run_emdata(Op op, EMData *a, EMData *b)
+{
+	switch (op) {
+	case ADD: a->add(*b); break;
+	case MULT: a->mult(*b); break;
+	case DIV: a->div(*b); break;
+	case ADDSQUARE: a->addsquare(*b); break;
+	case DOT: sink += a->dot(b); break;
+	default: break;
+	}
+}
+
+// returns ms per operation
+static double bench(Op op, EMData *a, EMData *b, bool plain, double seconds)
+{
+	size_t n = (size_t)a->get_xsize() * a->get_ysize() * a->get_zsize();
+	int count = 0;
+	double t0 = now(), t = 0;
+	do {
+		if (plain) run_loop(op, a->get_data(), b->get_const_data(), n);
+		else run_emdata(op, a, b);
+		count++;
+		t = now() - t0;
+	} while (t < seconds);
+
+	return 1000.0 * t / count;
+}
+
+int main(int argc, char *argv[])
+{
+	int nthreads = argc > 1 ? atoi(argv[1]) : 4;
+	double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+
+	const int sizes[][3] = {
+		{ 256, 256, 1 }, { 1024, 1024, 1 }, { 4096, 4096, 1 },
+		{ 128, 128, 128 }, { 256, 256, 256 }
+	};
+
+	printf("SIMD width %d, %d threads\n", Util::simd_width(), nthreads);
+	printf("%14s %10s %12s %12s %12s\n", "size", "op", "ms loop", "ms 1 thread", "ms threads");
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		const int nx = sizes[i][0], ny = sizes[i][1], nz = sizes[i][2];
+		EMData a, b;
+		a.set_size(nx, ny, nz);
+		b.set_size(nx, ny, nz);
+		a.process_inplace("testimage.noise.uniform.rand");
+		b.to_one();			// repeated mult and div then leave the values where they are
+
+		char label[32];
+		sprintf(label, "%dx%dx%d", nx, ny, nz);
+		for (int op = 0; op < NOPS; op++) {
+			double loop = bench((Op)op, &a, &b, true, seconds);
+			Util::set_num_threads(1);
+			double one = bench((Op)op, &a, &b, false, seconds);
+			Util::set_num_threads(nthreads);
+			double many = bench((Op)op, &a, &b, false, seconds);
+			printf("%14s %10s %12.3f %12.3f %12.3f\n", label, op_names[op], loop, one, many);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2000-2006 Baylor College of Medicine
+ * 
+ * This software is issued under a joint BSD/GNU license. You may use the
+ * source code in this file under either license. However, note that the
+ * complete EMAN2 and SPARX software packages have some GPL dependencies,
+ * so you are responsible for compliance with the licenses of these packages
+ * if you opt to use BSD licensing. The warranty disclaimer below holds
+ * in either instance.
+ * 
+ * This complete copyright notice must be included in any revised version of the
+ * source code. Additional authorship citations may be added, but existing
+ * author citations must be preserved.
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * 
+ * */
+
+
+/* Times forward + inverse real FFTs of typical 1D, 2D and 3D sizes through EMfft,
+ * out of place and in place, so the FFTW and native (ENABLE_NATIVE_FFT) builds
+ * can be compared on the same machine.
+ *
+ * usage: fft_bench [seconds per size]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "emfft.h"
+#ifdef NATIVE_FFT
+#include "emfft_native.h"
+#endif
+
+#ifdef _WIN32
+#include <ctime>
+#else
+#include <sys/time.h>
+#endif
+
+using namespace std;
+using namespace EMAN;
+
+static double now()
+{
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+// returns the time of one forward + inverse pair in ms
+static double bench(int nx, int ny, int nz, bool inplace, double seconds)
+{
+	const int nxc = nx / 2 + 1;
+	const size_t rows = (size_t)ny * nz;
+	vector<float> real(2 * nxc * rows), cplx(2 * nxc * rows);
+	for (size_t i = 0; i < real.size(); i++) real[i] = (float)rand() / RAND_MAX - 0.5f;
+
+	float *r = &real[0];
+	float *c = inplace ? r : &cplx[0];
+
+	// the first pair creates the plans
+	EMfft::real_to_complex_nd(r, c, nx, ny, nz);
+	EMfft::complex_to_real_nd(c, r, nx, ny, nz);
+
+	int n = 0;
+	double t0 = now(), t = 0;
+	do {
+		EMfft::real_to_complex_nd(r, c, nx, ny, nz);
+		EMfft::complex_to_real_nd(c, r, nx, ny, nz);
+		n++;
+		t = now() - t0;
+	} while (t < seconds);
+
+	return 1000.0 * t / n;
+}
+
+int main(int argc, char *argv[])
+{
+	double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+	const int sizes[][3] = {
+		{ 4096, 1, 1 }, { 65536, 1, 1 },
+		{ 128, 128, 1 }, { 256, 256, 1 }, { 360, 360, 1 }, { 512, 512, 1 }, { 1024, 1024, 1 }, { 4096, 4096, 1 },
+		{ 64, 64, 64 }, { 100, 100, 100 }, { 128, 128, 128 }, { 256, 256, 256 }
+	};
+
+#ifdef USE_FFTW3
+	printf("FFT backend: FFTW3\n");
+#elif defined NATIVE_FFT
+	printf("FFT backend: native, %d-wide SIMD\n", NativeFFT::simd_width());
+#else
+	printf("FFT backend: other\n");
+#endif
+	printf("%18s %14s %14s\n", "size", "ms/pair", "ms/pair inplace");
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		const int nx = sizes[i][0], ny = sizes[i][1], nz = sizes[i][2];
+		char label[32];
+		sprintf(label, "%dx%dx%d", nx, ny, nz);
+		double out = bench(nx, ny, nz, false, seconds);
+		double in = bench(nx, ny, nz, true, seconds);
+		printf("%18s %14.3f %14.3f\n", label, out, in);
+	}
+
+	return 0;
+}
@@ -167,7 +167,108 @@ class TestEMData(unittest.TestCase):
         self.assertEqual(e.equal(e2),True)
 
         self.assertEqual(e.get_attr_dict(), e2.get_attr_dict())
-                    
+
+    def test_copy_on_write(self):
+        """test copy() shares data until written ............"""
+        e = EMData()
+        e.set_size(16,16,16)
+        e.to_zero()
+        e.process_inplace("testimage.noise.uniform.rand")
+        v = e.get_value_at(3,4,5)
+        e2 = e.copy()
+        e3 = e2.copy()
+
+        e2.set_value_at(3,4,5, v+1.0)
+        self.assertAlmostEqual(e.get_value_at(3,4,5), v, 6)
+        self.assertAlmostEqual(e2.get_value_at(3,4,5), v+1.0, 6)
+        self.assertAlmostEqual(e3.get_value_at(3,4,5), v, 6)
+
+        e.mult(2.0)
+        self.assertAlmostEqual(e3.get_value_at(3,4,5), v, 6)
+        del e3
+        e.set_size(8,8,8)
+        self.assertAlmostEqual(e2.get_value_at(3,4,5), v+1.0, 6)
+
+        # a numpy view writes straight into the pixels, so copies made after it cannot share them
+        a = EMNumPy.em2numpy(e2)
+        e4 = e2.copy()
+        a[5,4,3] = v+2.0
+        self.assertAlmostEqual(e2.get_value_at(3,4,5), v+2.0, 6)
+        self.assertAlmostEqual(e4.get_value_at(3,4,5), v+1.0, 6)
+
+    def test_storage_type(self):
+        """test compact pixel storage ......................."""
+        e = EMData()
+        e.set_size(30,20,4)
+        e.process_inplace("testimage.noise.uniform.rand")
+        e.mult(100.0)
+        e.process_inplace("math.floor")
+        self.assertEqual(e.get_storage_type(), EM_FLOAT)
+
+        c = e.copy()
+        c.set_storage_type(EM_UCHAR)
+        self.assertEqual(c.get_storage_type(), EM_UCHAR)
+        self.assertAlmostEqual(c["mean"], e["mean"], 4)
+        self.assertAlmostEqual(c["sigma"], e["sigma"], 4)
+
+        # compact images are read as they are, without converting them
+        s = e.copy()
+        s.add(c)
+        s.mult(c)
+        s.sub(c)
+        clip = c.get_clip(Region(-1,2,0,10,10,4))
+        ec = e.get_clip(Region(-1,2,0,10,10,4))
+        fc = c.do_fft()
+        fe = e.do_fft()
+        c2 = c.copy()
+        self.assertEqual(c.get_storage_type(), EM_UCHAR)
+        self.assertEqual(c2.get_storage_type(), EM_UCHAR)
+
+        v = e.get_value_at(7,8,2)
+        self.assertAlmostEqual(s.get_value_at(7,8,2), 2*v*v - v, 3)
+        self.assertAlmostEqual(clip.get_value_at(5,3,1), ec.get_value_at(5,3,1), 6)
+        self.assertAlmostEqual(fc.get_value_at(4,5,1), fe.get_value_at(4,5,1), 3)
+
+        # integer values round trip exactly, the first float access converts
+        self.assertEqual(c.get_value_at(7,8,2), v)
+        self.assertEqual(c.get_storage_type(), EM_FLOAT)
+
+        e.set_storage_type(EM_HALF)
+        self.assertAlmostEqual(e.get_value_at(7,8,2), v, 6)
+        e.set_storage_type(EM_SHORT)
+        e.sub(200.0)
+        e.set_storage_type(EM_UCHAR)
+        self.assertEqual(e.get_value_at(7,8,2), 0)
+
+    def test_hot_attrs(self):
+        """test typed attribute accessors ..................."""
+        e = EMData()
+        e.set_size(16,16,1)
+        e.to_zero()
+        self.assertEqual(e.get_attr_apix(EMData.HotAttr.ATTR_APIX_X), 1.0)
+        self.assertEqual(list(e.get_attr_class_ptcl_idxs()), [])
+
+        t = Transform({"type":"eman","az":10.0,"alt":20.0,"phi":30.0})
+        e["xform.projection"] = t
+        e["apix_x"] = 2.5
+        e["class_ptcl_idxs"] = [3,5,8]
+        self.assertEqual(e.get_attr_transform(EMData.HotAttr.ATTR_XFORM_PROJECTION), t)
+        self.assertAlmostEqual(e.get_attr_apix(EMData.HotAttr.ATTR_APIX_X), 2.5, 6)
+        self.assertEqual(list(e.get_attr_class_ptcl_idxs()), [3,5,8])
+
+        # the cached values follow changes to the attributes
+        t2 = Transform({"type":"eman","az":40.0})
+        e["xform.projection"] = t2
+        e["apix_x"] = 5.0
+        e["class_ptcl_idxs"] = 7
+        self.assertEqual(e.get_attr_transform(EMData.HotAttr.ATTR_XFORM_PROJECTION), t2)
+        self.assertAlmostEqual(e.get_attr_apix(EMData.HotAttr.ATTR_APIX_X), 5.0, 6)
+        self.assertEqual(list(e.get_attr_class_ptcl_idxs()), [7])
+        e.del_attr("xform.projection")
+        if(IS_TEST_EXCEPTION):
+            self.assertRaises(RuntimeError, e.get_attr_transform, EMData.HotAttr.ATTR_XFORM_PROJECTION)
+        self.assertEqual(EMData.get_hot_attr_name(EMData.HotAttr.ATTR_XFORM_ALIGN2D), "xform.align2d")
+
     def test_get_clip1(self):
         """test get_clip1() function ........................"""
         e = EMData()
@@ -1175,6 +1276,46 @@ class TestEMData(unittest.TestCase):
             except RuntimeError as runtime_err:
                 self.assertEqual(exception_type(runtime_err), "ImageFormatException")
 
+    def test_do_fft_inplace_many(self):
+        """test do_fft_inplace_many() function .............."""
+        imgs = []
+        for i in range(5):
+            e = EMData()
+            e.set_size(24,25)
+            e.process_inplace("testimage.noise.uniform.rand")
+            imgs.append(e)
+        ffts = [e.do_fft() for e in imgs]
+        
+        many = EMData.do_fft_many(imgs, 2)
+        self.assertEqual(len(many), len(imgs))
+        for e,f in zip(many, ffts):
+            self.assertEqual(e.is_complex(), True)
+            for a,b in zip(e.get_data_as_vector(), f.get_data_as_vector()):
+                self.assertAlmostEqual(a, b, 3)
+        
+        # a compact image is transformed without widening it
+        c = imgs[0].copy()
+        c.mult(200.0)
+        c.set_storage_type(EM_UCHAR)
+        cfft = c.do_fft()
+        many = EMData.do_fft_many([imgs[1], c], 2)
+        self.assertEqual(c.get_storage_type(), EM_UCHAR)
+        for a,b in zip(many[1].get_data_as_vector(), cfft.get_data_as_vector()):
+            self.assertAlmostEqual(a, b, 3)
+        
+        EMData.do_fft_inplace_many(imgs, 2)
+        for e,f in zip(imgs, ffts):
+            self.assertEqual(e.is_complex(), True)
+            self.assertEqual(e.get_xsize(), f.get_xsize())
+            for a,b in zip(e.get_data_as_vector(), f.get_data_as_vector()):
+                self.assertAlmostEqual(a, b, 3)
+        
+        if(IS_TEST_EXCEPTION):
+            #all images must have the same size
+            e1 = EMData(24,24)
+            e2 = EMData(32,32)
+            self.assertRaises( RuntimeError, EMData.do_fft_inplace_many, [e1, e2] )
+
     def test_get_fft_amplitude(self):
         """test get_fft_amplitude() function ................"""
         e = EMData()
@@ -2324,6 +2465,29 @@ class TestEMData(unittest.TestCase):
         
         testlib.safe_unlink(imgfile)        
 
+    def test_lazy_statistics(self):
+        """test statistics groups updated independently ....."""
+        e = EMData()
+        e.set_size(64,64,1)
+        e.to_zero()
+        e.set_value_at(1, 1, 1.0)
+        e.set_value_at(2, 3, 3.0)
+        e.set_value_at(5, 7, -2.0)
+        e.update()
+        n = 64*64
+        self.assertAlmostEqual(e.get_attr("mean"), 2.0/n, 6)
+        self.assertAlmostEqual(e.get_attr("mean_nonzero"), 2.0/3, 6)
+        self.assertAlmostEqual(e.get_attr("maximum"), 3.0, 6)
+        self.assertAlmostEqual(e.get_attr("minimum"), -2.0, 6)
+        
+        # only the moments are read here, the extrema must still follow the change
+        e.mult(2.0)
+        self.assertAlmostEqual(e.get_attr("square_sum"), 56.0, 4)
+        self.assertAlmostEqual(e.get_attr_default("maximum", 0), 6.0, 6)
+        d = e.get_attr_dict()
+        self.assertAlmostEqual(d["minimum"], -4.0, 6)
+        self.assertAlmostEqual(d["sigma_nonzero"], math.sqrt((56.0-16.0/3)/2), 4)
+
     def test_set_attr_dict(self):
         """test set/del_attr_dict() function ................"""
         e = EMData()
@@ -2661,6 +2825,69 @@ class TestEMData(unittest.TestCase):
                 for z in range(32):
                     self.assertAlmostEqual(old_div(0.005,d[z][y][x]), d99[z][y][x], 2)
 
+    def test_threaded_arithmetic(self):
+        """test image arithmetic with several threads ......."""
+        a = EMData()
+        a.set_size(161,160,160)
+        a.process_inplace("testimage.noise.gauss")
+        b = a.process("math.absvalue")
+        b.add(0.5)
+
+        nthreads = Util.get_num_threads()
+        results = []
+        for n in (1, 4):
+            Util.set_num_threads(n)
+            r = [a.copy() for i in range(5)]
+            r[0].add(b)
+            r[1].sub(b)
+            r[2].mult(b)
+            r[3].div(b)
+            r[4].addsquare(b)
+            results.append((r, a.dot(b)))
+        Util.set_num_threads(nthreads)
+
+        # the result does not depend on the number of threads
+        for r1, r4 in zip(results[0][0], results[1][0]):
+            self.assertEqual((r1 - r4)["square_sum"], 0)
+        self.assertEqual(results[0][1], results[1][1])
+        self.assertAlmostEqual(results[0][0][2]["mean"], (a*b)["mean"], 6)
+
+        # 0/0 is left alone, anything else divided by 0 raises
+        z = EMData(16,16)
+        z.to_zero()
+        c = z.copy()
+        c.div(z)
+        self.assertEqual(c["square_sum"], 0)
+        if(IS_TEST_EXCEPTION):
+            c.to_one()
+            self.assertRaises(RuntimeError, c.div, z)
+
+    def test_batch_interpolation(self):
+        """test interpolation at many points at once ........"""
+        import random
+        e = EMData()
+        e.set_size(32,24,1)
+        e.process_inplace("testimage.noise.gauss")
+        # points inside, on the edges and outside of the image
+        x = [random.uniform(-2, 34) for i in range(1000)]
+        y = [random.uniform(-2, 26) for i in range(1000)]
+        v = e.sget_values_at_interp(x, y)
+        self.assertEqual(len(v), 1000)
+        for i in range(1000):
+            self.assertEqual(v[i], e.sget_value_at_interp(x[i], y[i]))
+
+        e3 = EMData()
+        e3.set_size(16,16,16)
+        e3.process_inplace("testimage.noise.gauss")
+        z = [random.uniform(-2, 18) for i in range(1000)]
+        x = [xi/2 for xi in x]
+        v = e3.sget_values_at_interp(x, z, z)
+        for i in range(1000):
+            self.assertEqual(v[i], e3.sget_value_at_interp(x[i], z[i], z[i]))
+
+        if(IS_TEST_EXCEPTION):
+            self.assertRaises(RuntimeError, e.sget_values_at_interp, [1.0, 2.0], [1.0])
+
     def test_stat_locations(self):
         """test locational stats ............................"""
         nx = 16
@@ -3397,6 +3624,43 @@ class TestEMData(unittest.TestCase):
             for x in range(800):
                 self.assertEqual(d1[y][x], d2[y][x])
                 
+    def test_process_move(self):
+        """test process_move() and swap() ..................."""
+        e = EMData()
+        e.set_size(32,32,32)
+        e.process_inplace('testimage.noise.uniform.rand')
+        e["author"] = "test"
+        ref = e.process('normalize')
+
+        m = e.copy().process_move('normalize')
+        self.assertEqual((m - ref)["square_sum"], 0)
+        self.assertEqual(m["author"], "test")
+
+        # the source is left empty
+        c = e.copy()
+        m = c.process_move('normalize')
+        self.assertEqual(c.get_xsize(), 0)
+        self.assertEqual(c.get_size(), 0)
+
+        # processors which only work out of place
+        d = e.process('misc.directional_sum', {'axis':'z'})
+        c = e.copy()
+        m = c.process_move('misc.directional_sum', {'axis':'z'})
+        self.assertEqual(m.get_zsize(), 1)
+        self.assertEqual((m - d)["square_sum"], 0)
+        self.assertEqual(c.get_size(), 0)
+
+        a = EMData(8,8)
+        a.to_one()
+        b = EMData(4,4,4)
+        b.to_zero()
+        b["author"] = "b"
+        a.swap(b)
+        self.assertEqual(a.get_zsize(), 4)
+        self.assertEqual(a["author"], "b")
+        self.assertEqual(b.get_ysize(), 8)
+        self.assertEqual(b["mean"], 1)
+
     def test_pickling(self):
         """test EMData's pickle ............................."""
         import pickle
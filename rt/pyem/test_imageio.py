@@ -700,6 +700,74 @@ class TestMrcIO(ImageIOTester):
 		os.unlink(imgfile2)
 		os.unlink(imgfile3)
 
+	def test_read_image_mapped(self):
+		"""test read_image_mapped() on mrc stack ............"""
+		filename = "mapped_" + str(os.getpid()) + ".mrcs"
+		for i in range(3):
+			e = EMData()
+			e.set_size(24,16)
+			e.to_value(float(i))
+			e.set_value_at(5,7,100.0+i)
+			e.write_image(filename, i)
+
+		e = EMData()
+		e.read_image_mapped(filename, 2)
+		self.assertEqual(e.get_xsize(), 24)
+		self.assertEqual(e.get_ysize(), 16)
+		self.assertAlmostEqual(e.get_value_at(0,0), 2.0, 6)
+		self.assertAlmostEqual(e.get_value_at(5,7), 102.0, 6)
+		self.assertAlmostEqual(e["maximum"], 102.0, 6)
+
+		# the first write switches to a private copy, the file is unchanged
+		e2 = e.copy()
+		e.set_value_at(5,7,-1.0)
+		self.assertAlmostEqual(e.get_value_at(5,7), -1.0, 6)
+		self.assertAlmostEqual(e2.get_value_at(5,7), 102.0, 6)
+		e3 = EMData(filename, 2)
+		self.assertAlmostEqual(e3.get_value_at(5,7), 102.0, 6)
+
+		# a detached image keeps its pixels when the file is rewritten
+		e2.detach_mapped()
+		e3.to_value(7.0)
+		e3.write_image(filename, 2)
+		self.assertAlmostEqual(e2.get_value_at(5,7), 102.0, 6)
+		self.assertAlmostEqual(e2.get_value_at(0,0), 2.0, 6)
+
+		os.unlink(filename)
+
+	def test_read_image_compact(self):
+		"""test read_image_compact() on 8 bit mrc ..........."""
+		filename = "compact_" + str(os.getpid()) + ".mrc"
+		e = EMData()
+		e.set_size(32,24)
+		e.process_inplace("testimage.noise.uniform.rand")
+		e.mult(200.0)
+		e.write_image(filename, 0, IMAGE_MRC, False, None, EM_UCHAR)
+
+		f = EMData(filename)
+		c = EMData()
+		c.read_image_compact(filename)
+		self.assertEqual(c.get_storage_type(), EM_UCHAR)
+		self.assertAlmostEqual(c["mean"], f["mean"], 4)
+		self.assertAlmostEqual(c["maximum"], f["maximum"], 6)
+		self.assertEqual(c.get_storage_type(), EM_UCHAR)
+
+		r = Region(-2,3,16,16)
+		c2 = EMData()
+		c2.read_image_compact(filename, 0, r)
+		f2 = EMData(filename, 0, False, r)
+		self.assertEqual(c2.get_xsize(), 16)
+		for y in range(16):
+			for x in range(16):
+				self.assertEqual(c2.get_value_at(x,y), f2.get_value_at(x,y))
+		self.assertEqual(c2.get_storage_type(), EM_FLOAT)
+
+		for y in range(24):
+			for x in range(32):
+				self.assertEqual(c.get_value_at(x,y), f.get_value_at(x,y))
+
+		os.unlink(filename)
+
 	def test_make_image_file(self):
 		"""test make mrc image file ........................."""
 		base = "test_make_image_file"
@@ -156,6 +156,73 @@ class TestRegion(unittest.TestCase):
         self.assertEqual(e8.get_ndim(), 3)
         
 
+class TestTiledVolume(unittest.TestCase):
+    """tests for class TiledVolume"""
+    
+    def test_tiled_volume(self):
+        """test tiled volume get/set and clip ..............."""
+        file = 'test_tiled_volume.mrc'
+        v = TiledVolume.create(file, 20, 18, 10, {}, 8, 8*8*8*4*2)
+        self.assertEqual(v.get_zsize(), 10)
+        self.assertEqual(v.get_value_at(19, 17, 9), 0)
+        
+        e = test_image_3d(0, 20, 18, 10)
+        v.insert_clip(e, IntPoint(0, 0, 0))
+        self.assert_(v.get_cached_bytes() <= v.get_memory_budget())
+        v.set_value_at(9, 9, 9, 5.0)
+        e.set_value_at(9, 9, 9, 5.0)
+        del v
+        
+        v = TiledVolume(file, True, 8)
+        self.assertAlmostEqual(v.get_value_at(9, 9, 9), 5.0, 3)
+        c = v.get_clip(Region(-2, 3, 4, 16, 8, 4), -1.0)
+        c2 = e.get_clip(Region(-2, 3, 4, 16, 8, 4), -1.0)
+        for z in range(4):
+            for y in range(8):
+                for x in range(16):
+                    self.assertAlmostEqual(c.get_value_at(x, y, z), c2.get_value_at(x, y, z), 3)
+        del v
+        testlib.safe_unlink(file)
+        
+    def test_tiled_process(self):
+        """test tiled volume process and bin ................"""
+        file = 'test_tiled_process.mrc'
+        file2 = 'test_tiled_process2.mrc'
+        file3 = 'test_tiled_process3.mrc'
+        e = test_image_3d(0, 24, 24, 24)
+        e.write_image(file)
+        
+        v = TiledVolume(file, True, 8)
+        st = v.get_stats()
+        self.assertAlmostEqual(st["mean"], e.get_attr("mean"), 3)
+        self.assertAlmostEqual(st["sigma"], e.get_attr("sigma"), 3)
+        
+        # with a halo as wide as the kernel, tile edges match the whole volume
+        p = v.process(file2, "math.laplacian", {}, 1)
+        e2 = e.process("math.laplacian")
+        for x, y, z in ((8, 8, 8), (7, 15, 16), (12, 3, 9)):
+            self.assertAlmostEqual(p.get_value_at(x, y, z), e2.get_value_at(x, y, z), 3)
+        del p
+        
+        v.process_inplace("normalize")
+        st = v.get_stats()
+        self.assertAlmostEqual(st["mean"], 0, 3)
+        self.assertAlmostEqual(st["sigma"], 1, 3)
+        
+        b = v.bin(file3, 2)
+        self.assertEqual(b.get_xsize(), 12)
+        self.assertEqual(b.get_zsize(), 12)
+        e.process_inplace("normalize")
+        e2 = e.process("math.meanshrink", {"n":2})
+        self.assertAlmostEqual(b.get_value_at(5, 6, 7), e2.get_value_at(5, 6, 7), 3)
+        
+        del b
+        del v
+        testlib.safe_unlink(file)
+        testlib.safe_unlink(file2)
+        testlib.safe_unlink(file3)
+        
+
 def test_main():
     p = OptionParser()
     p.add_option('--t', action='store_true', help='test exception', default=False )
@@ -168,10 +235,12 @@ def test_main():
     suite2 = unittest.TestLoader().loadTestsFromTestCase(TestBoost)
     suite3 = unittest.TestLoader().loadTestsFromTestCase(TestException)
     suite4 = unittest.TestLoader().loadTestsFromTestCase(TestRegion)
+    suite5 = unittest.TestLoader().loadTestsFromTestCase(TestTiledVolume)
     unittest.TextTestRunner(verbosity=2).run(suite1)
     unittest.TextTestRunner(verbosity=2).run(suite2)
     unittest.TextTestRunner(verbosity=2).run(suite3)
     unittest.TextTestRunner(verbosity=2).run(suite4)
+    unittest.TextTestRunner(verbosity=2).run(suite5)
 
 if __name__ == '__main__':
     test_main()
@@ -36,7 +36,7 @@ from __future__ import division
 from past.utils import old_div
 from builtins import range
 from EMAN2 import *
-import unittest,os,sys
+import unittest,os,sys,math
 import testlib
 from pyemtbx.exceptions import *
 import numpy
@@ -674,6 +674,80 @@ class TestProcessor(unittest.TestCase):
                 for z in range(32):
                     self.assertAlmostEqual(d2[z][y][x], d[z][y][x]*3.23 + 2.56, 3)
         
+    def test_real_pixel_threads(self):
+        """test real pixel processors with several threads .."""
+        e = EMData()
+        e.set_size(128,128,128)
+        e.process_inplace('testimage.noise.gauss')
+        e2 = e.copy()
+        e2.process_inplace('math.absvalue')
+        self.assertEqual(e2["minimum"] >= 0, True)
+        self.assertAlmostEqual(e2["mean"], (e*e).process("math.sqrt")["mean"], 4)
+
+        procs = [('math.absvalue', {}), ('math.linear', {'scale':3.23, 'shift':2.56}),
+                 ('threshold.binary', {'value':0.1}), ('threshold.belowtozero', {'minval':0.2})]
+        nthreads = Util.get_num_threads()
+        for name, params in procs:
+            results = []
+            for n in (1, 4):
+                Util.set_num_threads(n)
+                results.append(e.process(name, params))
+            Util.set_num_threads(nthreads)
+            self.assertEqual((results[0] - results[1])["square_sum"], 0)
+
+    def test_processor_pipeline(self):
+        """test ProcessorPipeline ..........................."""
+        steps = [("normalize.edgemean", {}), ("mask.soft", {"outer_radius":24}),
+                 ("filter.lowpass.gauss", {"cutoff_abs":0.2}), ("filter.highpass.gauss", {"cutoff_pixels":2}),
+                 ("math.linear", {"scale":2.0, "shift":1.0}), ("math.absvalue", {})]
+        p = ProcessorPipeline()
+        for name, params in steps:
+            p.add(name, params)
+        self.assertEqual(p.get_num_steps(), 6)
+        self.assertEqual(p.get_num_passes(), 4)
+
+        # the pipeline is reused, for images of different sizes
+        for size in (64, 64, 48):
+            e = EMData()
+            e.set_size(size,size,1)
+            e.process_inplace("testimage.noise.gauss")
+            ref = e.copy()
+            for name, params in steps:
+                ref.process_inplace(name, params)
+            e2 = p.process(e)
+            self.assertEqual(e2.get_xsize(), size)
+            diff = (e2 - ref)["square_sum"] / ref["square_sum"]
+            self.assertAlmostEqual(diff, 0, 5)
+
+        # filters of both Fourier families merged into one pass, for an odd size, in real and
+        # Fourier space; an amplitude/phase input comes back as amplitude/phase
+        steps = [("filter.lowpass.tophat", {"cutoff_abs":0.3}), ("filter.linearfourier", {}),
+                 ("filter.highpass.gauss", {"cutoff_pixels":2})]
+        p = ProcessorPipeline()
+        for name, params in steps:
+            p.add(name, params)
+        self.assertEqual(p.get_num_passes(), 1)
+
+        e = EMData()
+        e.set_size(45,45,1)
+        e.process_inplace("testimage.noise.gauss")
+        for image in (e, e.do_fft()):
+            ref = image.copy()
+            for name, params in steps:
+                ref.process_inplace(name, params)
+            ref.ap2ri()
+            if image.is_complex():
+                image = image.copy()
+                image.ri2ap()
+            e2 = p.process(image)
+            self.assertEqual(e2.get_xsize(), image.get_xsize())
+            self.assertEqual(e2.is_complex(), image.is_complex())
+            if e2.is_complex():
+                self.assertEqual(e2.is_ri(), False)
+                e2.ap2ri()
+            diff = (e2 - ref)["square_sum"] / ref["square_sum"]
+            self.assertAlmostEqual(diff, 0, 5)
+
     def test_math_exp(self):
         """test math.exp processor .........................."""
         e = EMData()
@@ -890,6 +964,38 @@ class TestProcessor(unittest.TestCase):
         self.assertEqual(e.is_complex(), False)
         
         e.process_inplace('eman1.filter.median')
+
+        # compare a few pixels with the median of their box, exact and quantized
+        e = EMData()
+        e.set_size(64,48,1)
+        e.process_inplace('testimage.noise.uniform.rand')
+        r = 3
+        exact = e.process('eman1.filter.median', {'radius':r})
+        approx = e.process('eman1.filter.median', {'radius':r, 'exact':False, 'levels':1024})
+        for x, y in ((3,3), (20,17), (60,44), (31,24)):
+            box = sorted([e[x2,y2] for x2 in range(x-r,x+r+1) for y2 in range(y-r,y+r+1)])
+            self.assertEqual(exact[x,y], box[len(box)//2])
+            self.assertAlmostEqual(approx[x,y], box[len(box)//2], 2)
+        self.assertEqual(exact[1,1], 0)
+
+        # more than 65536 distinct values, so the exact median sorts the boxes and the quantized one bins linearly
+        big = EMData()
+        big.set_size(320,256,1)
+        big.process_inplace('testimage.noise.uniform.rand')
+        exact = big.process('eman1.filter.median', {'radius':r})
+        approx = big.process('eman1.filter.median', {'radius':r, 'exact':False, 'levels':1024})
+        for x, y in ((3,3), (150,100), (316,252)):
+            box = sorted([big[x2,y2] for x2 in range(x-r,x+r+1) for y2 in range(y-r,y+r+1)])
+            self.assertEqual(exact[x,y], box[len(box)//2])
+            self.assertAlmostEqual(approx[x,y], box[len(box)//2], 2)
+
+        nthreads = Util.get_num_threads()
+        results = []
+        for n in (1, 4):
+            Util.set_num_threads(n)
+            results.append(e.process('eman1.filter.median', {'radius':2}))
+        Util.set_num_threads(nthreads)
+        self.assertEqual((results[0] - results[1])["square_sum"], 0)
         
     if platform.system() == "Darwin":
         test_eman1_filter_median.broken = True
@@ -902,6 +1008,19 @@ class TestProcessor(unittest.TestCase):
         self.assertEqual(e.is_complex(), False)
         
         e.process_inplace('math.localsigma')
+
+        # compare with the standard deviation of the box, for a radius where the box sums matter
+        e = EMData()
+        e.set_size(40,36,20)
+        e.process_inplace('testimage.noise.uniform.rand')
+        r = 4
+        s = e.process('math.localsigma', {'radius':r})
+        for x, y, z in ((4,4,4), (20,17,10), (35,31,15)):
+            box = [e[x2,y2,z2] for x2 in range(x-r,x+r+1) for y2 in range(y-r,y+r+1) for z2 in range(z-r,z+r+1)]
+            mean = sum(box) / len(box)
+            sigma = math.sqrt(sum([(v-mean)**2 for v in box]) / len(box))
+            self.assertAlmostEqual(s[x,y,z], sigma, 5)
+        self.assertEqual(s[2,10,10], 0)
         
     def test_math_localmax(self):
         """test math.localmax processor ....................."""
@@ -1164,6 +1283,22 @@ class TestProcessor(unittest.TestCase):
         e2.process_inplace('testimage.noise.uniform.rand')
         self.assertEqual(e2.is_complex(), False)
         e.process_inplace('filter.bilateral', {'distance_sigma':0.3, 'value_sigma':0.4, 'niter':2, 'half_width':5})
+        
+        # the grid mode smooths the noise on each side of a step, but keeps the step
+        for nz in (1, 16):
+            e3 = EMData()
+            e3.set_size(32,32,nz)
+            e3.process_inplace('testimage.noise.uniform.rand')
+            e3.mult(0.2)
+            for z in range(nz):
+                for y in range(32):
+                    for x in range(16, 32):
+                        e3.set_value_at(x, y, z, e3.get_value_at(x, y, z) + 3.0)
+            sigma = e3.get_attr('sigma')
+            e3.process_inplace('filter.bilateral', {'distance_sigma':4.0, 'value_sigma':0.5, 'niter':1, 'grid':True})
+            self.assertAlmostEqual(e3.get_value_at(14, 16, nz//2), 0.1, places=1)
+            self.assertAlmostEqual(e3.get_value_at(17, 16, nz//2), 3.1, places=1)
+            self.assertAlmostEqual(e3.get_attr('sigma'), sigma, places=1)
             
         
     def test_normalize_unitlen(self):
@@ -1569,6 +1704,36 @@ class TestProcessor(unittest.TestCase):
             except RuntimeError as runtime_err:
                 self.assertEqual(exception_type(runtime_err), "ImageFormatException")
     
+    def test_xform_threads(self):
+        """test xform with several threads and zerocorners .."""
+        e = EMData()
+        e.set_size(48,48,40)
+        e.process_inplace('testimage.noise.gauss')
+        t = Transform({"type":"eman","az":23.0,"alt":41.0,"phi":-17.0,"tx":1.5,"ty":-2.25,"tz":0.5})
+
+        nthreads = Util.get_num_threads()
+        results = []
+        for n in (1, 4):
+            Util.set_num_threads(n)
+            results.append(e.process("xform",{"transform":t}))
+        Util.set_num_threads(nthreads)
+        self.assertEqual((results[0] - results[1])["square_sum"], 0)
+
+        # each voxel is interpolated at the inverse transformed coordinates
+        full = results[0]
+        inv = t.inverse()
+        for x, y, z in ((24,24,20), (10,30,15), (33,17,26), (5,40,8)):
+            v = inv.transform(x-24, y-24, z-20)
+            self.assertAlmostEqual(full.get_value_at(x,y,z), e.sget_value_at_interp(v[0]+24, v[1]+24, v[2]+20), 4)
+
+        # zerocorners only resamples the sphere inside the smallest dimension
+        zc = e.process("xform",{"transform":t,"zerocorners":1})
+        for x, y, z in ((24,24,20), (10,30,15), (33,17,26), (2,2,2), (46,45,38)):
+            if (x-24)**2 + (y-24)**2 + (z-20)**2 <= 20*20:
+                self.assertEqual(zc.get_value_at(x,y,z), full.get_value_at(x,y,z))
+            else:
+                self.assertEqual(zc.get_value_at(x,y,z), 0)
+
     def test_xform_fourierorigin(self):
         """test xform.fourierorigin processor ..............."""
         e = EMData()
@@ -1690,6 +1855,140 @@ class TestProcessor(unittest.TestCase):
         
         testlib.safe_unlink('mask.mrc')
         
+        # the flood follows a connected path of any shape, but not a separate blob
+        e.to_zero()
+        for i in range(4, 28):
+            e.set_value_at(i, 16, 16, 1.0)
+            e.set_value_at(27, i, 16, 1.0)
+        e.set_value_at(8, 8, 8, 1.0)
+        m = e.process('mask.auto3d', {'radius':1, 'threshold':0.5, 'nshells':0, 'nshellsgauss':0, 'return_mask':True})
+        self.assertEqual(m.get_value_at(4, 16, 16), 1.0)
+        self.assertEqual(m.get_value_at(27, 4, 16), 1.0)
+        self.assertEqual(m.get_value_at(8, 8, 8), 0.0)
+        self.assertEqual(int(m.get_attr('mean')*32*32*32 + 0.5), 47)
+        
+    def test_mask_dust3d(self):
+        """test mask.dust3d processor ......................."""
+        e = EMData()
+        e.set_size(32,32,32)
+        e.to_zero()
+        for z in range(4):
+            for y in range(4):
+                for x in range(4):
+                    e.set_value_at(18+x, 18+y, 18+z, 2.0)
+                    if x<2 and y<2 and z<2: e.set_value_at(5+x, 5+y, 5+z, 2.0)
+        
+        e.process_inplace('mask.dust3d', {'voxels':27, 'threshold':1.5})
+        self.assertTrue(e.get_value_at(5,5,5) < 0.5)
+        self.assertAlmostEqual(e.get_value_at(19,19,19), 2.0, places=2)
+        
+    def test_morph_binary(self):
+        """test binary morphology processors ................"""
+        def count(img):
+            return int(img.get_attr('mean')*img.get_xsize()*img.get_ysize()*img.get_zsize() + 0.5)
+        
+        e = EMData()
+        e.set_size(100,16,1)
+        e.to_zero()
+        for y in range(4, 9):
+            for x in range(60, 70):
+                e.set_value_at(x, y, 1.0)
+        e.set_value_at(10, 10, 1.0)
+        
+        d = e.process('morph.dilate.binary', {'radius':2})
+        self.assertEqual(count(d), 14*9 - 4*3 + 13)      # a city-block ball of radius 2 around each
+        self.assertEqual(d.get_value_at(10, 12), 1.0)
+        self.assertEqual(d.get_value_at(11, 12), 0.0)
+        
+        r = e.process('morph.erode.binary', {'radius':1, 'iters':2})
+        self.assertEqual(count(r), 6*1)
+        o = e.process('morph.open.binary', {'radius':1})
+        self.assertEqual(o.get_value_at(10, 10), 0.0)
+        self.assertEqual(count(o), 50 - 4)             # the diamond cannot reach the corners
+        self.assertEqual(count(e.process('morph.gradient.internal', {'radius':1})), 50 - 8*3 + 1)
+        
+        # a horizontal line element only grows along x, across the word boundaries
+        selem = EMData()
+        selem.set_size(131,1,1)
+        selem.to_one()
+        d = e.process('morph.dilate.binary', {'selem':selem})
+        self.assertEqual(count(d), 100*5 + 76)
+        
+        # 3D, with threads
+        e = EMData()
+        e.set_size(40,40,40)
+        e.process_inplace('testimage.noise.uniform.rand')
+        nthreads = Util.get_num_threads()
+        results = []
+        for n in (1, 4):
+            Util.set_num_threads(n)
+            results.append(e.process('morph.close.binary', {'radius':2}))
+        Util.set_num_threads(nthreads)
+        self.assertEqual(results[0].cmp('sqeuclidean', results[1]), 0)
+        
+    def test_segment_watershed(self):
+        """test segment.watershed processor .................."""
+        import math
+        e = EMData()
+        e.set_size(24,24,24)
+        for z in range(24):
+            for y in range(24):
+                for x in range(24):
+                    a = (x-7)**2 + (y-12)**2 + (z-12)**2
+                    b = (x-17)**2 + (y-12)**2 + (z-12)**2
+                    e.set_value_at(x, y, z, math.exp(-a/8.0) + 0.8*math.exp(-b/8.0))
+        
+        for sparse in (False, True):
+            s = e.process('segment.watershed', {'nseg':2, 'thr':0.1, 'sparselabels':sparse})
+            self.assertEqual(s.get_value_at(7, 12, 12), 1.0)      # the highest peak is seeded first
+            self.assertEqual(s.get_value_at(17, 12, 12), 2.0)
+            self.assertEqual(s.get_value_at(10, 12, 12), 1.0)
+            self.assertEqual(s.get_value_at(14, 12, 12), 2.0)
+            self.assertEqual(s.get_value_at(12, 2, 12), 0.0)      # below threshold
+            if sparse:
+                self.assertEqual(s.cmp('sqeuclidean', dense), 0)
+            else:
+                dense = s
+        
+        # an outlier squeezes the rest of the density into a few levels of the queue
+        f = e.copy()
+        f.mult(0.001)
+        f.set_value_at(3, 3, 3, 100.0)
+        s = f.process('segment.watershed', {'nseg':12, 'thr':0.0001})
+        self.assertEqual(s.get_value_at(3, 3, 3), 1.0)
+        self.assertEqual(s.get_value_at(7, 12, 12), 2.0)
+        self.assertEqual(s.get_value_at(10, 12, 12), 2.0)
+        self.assertEqual(s.get_value_at(14, 12, 12), 3.0)
+        self.assertEqual(s.get_attr('maximum'), 3.0)
+        
+        # a single stepped peak, with plateaus at every level, is one segment
+        for z in range(24):
+            for y in range(24):
+                for x in range(24):
+                    r = (x-12)**2 + (y-12)**2 + (z-12)**2
+                    f.set_value_at(x, y, z, math.floor(5*math.exp(-r/50.0))/5.0)
+        s = f.process('segment.watershed', {'nseg':12, 'thr':0.1})
+        self.assertEqual(s.get_attr('maximum'), 1.0)
+        self.assertEqual(s.get_value_at(12, 12, 12), 1.0)
+        self.assertEqual(s.get_value_at(12, 12, 20), 1.0)
+        
+    def test_morph_object_label(self):
+        """test morph.object.label processor ................"""
+        e = EMData()
+        e.set_size(16,16,1)
+        e.to_zero()
+        for x in range(2, 6):
+            e.set_value_at(x, 3, 1.0)
+        e.set_value_at(10, 1, 1.0)
+        e.set_value_at(11, 2, 1.0)      # only touches the last one diagonally
+        
+        e.process_inplace('morph.object.label', {'write_centers':True})
+        self.assertEqual(e.get_value_at(10, 1), 1.0)
+        self.assertEqual(e.get_value_at(11, 2), 2.0)
+        self.assertEqual(e.get_value_at(5, 3), 3.0)
+        self.assertEqual(e.get_value_at(0, 0), 0.0)
+        self.assertEqual(list(e.get_attr('obj_centers')), [0, 0, 10, 1, 11, 2, 3.5, 3])
+        
     def test_mask_addshells(self):
         """test mask.addshells processor ...................."""
         e = EMData()
@@ -1780,6 +2079,20 @@ class TestProcessor(unittest.TestCase):
         
         e.process_inplace('normalize.local', {'threshold':0.4, 'radius':16, 'apix':0.8})
         f = e.process('normalize.local', {'threshold':0.4, 'radius':16, 'apix':0.8})
+
+        # with boxes, each pixel is scaled by the fraction of its box above the threshold
+        # over the mean of the box with the pixels below the threshold set to 0
+        e = EMData()
+        e.set_size(24,24,24)
+        e.process_inplace('testimage.noise.uniform.rand')
+        r = 3
+        f = e.process('normalize.local', {'threshold':0.4, 'boxradius':r})
+        for x, y, z in ((12,12,12), (0,5,23), (20,3,8)):
+            box = [e[x2,y2,z2] for x2 in range(max(x-r,0),min(x+r+1,24)) for y2 in range(max(y-r,0),min(y+r+1,24))
+                   for z2 in range(max(z-r,0),min(z+r+1,24))]
+            above = [v for v in box if v >= 0.4]
+            scale = len(above) / sum(above)
+            self.assertAlmostEqual(f[x,y,z] / e[x,y,z], scale, 4)
         
         testlib.safe_unlink('norm.mrc')
         
@@ -1855,6 +2168,22 @@ class TestProcessor(unittest.TestCase):
         
         e.process_inplace('mask.addshells.gauss')
         
+        # one voxel grows into an octahedron by steps, or a ball by euclidean distance
+        for euclidean, count in ((False, 63), (True, 123)):
+            e.to_zero()
+            e.set_value_at(16,16,16, 1.0)
+            e.process_inplace('mask.addshells.gauss', {'val1':3, 'val2':0, 'euclidean':euclidean})
+            self.assertEqual(int(e.get_attr('mean')*32*32*32 + 0.5), count)
+            self.assertEqual(e.get_value_at(19,16,16), 1.0)
+            self.assertEqual(e.get_value_at(20,16,16), 0.0)
+        
+        # the outermost layer is never filled
+        e.to_zero()
+        e.set_value_at(1,16,16, 1.0)
+        e.process_inplace('mask.addshells.gauss', {'val1':2, 'val2':0})
+        self.assertEqual(e.get_value_at(2,16,16), 1.0)
+        self.assertEqual(e.get_value_at(0,16,16), 0.0)
+        
     def test_testimage_puregaussian(self):
         """test testimage.puregaussian processor ............"""
         e = EMData()
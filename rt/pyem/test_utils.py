@@ -374,6 +374,30 @@ class TestEMUtils(unittest.TestCase):
         self.assertEqual(EMUtil.is_complex_type(EMUtil.EMDataType.EM_UNKNOWN), False)
         self.assertEqual(EMUtil.is_complex_type(EMUtil.EMDataType.EM_USHORT), False)
         
+    def test_buffer_pool(self):
+        """test image buffer pool ..........................."""
+        limit = EMUtil.get_pool_limit()
+        EMUtil.set_pool_limit(64*1024*1024)
+        EMUtil.clear_pool()
+        
+        e = EMData()
+        e.set_size(100,100,10)
+        del e
+        stats = EMUtil.get_pool_stats()
+        self.assertEqual(stats["cached_buffers"], 1)
+        
+        # a same size image reuses the buffer, and is zeroed by to_zero()
+        hits = stats["hits"]
+        e = EMData(100,100,10)
+        e.to_zero()
+        self.assertEqual(EMUtil.get_pool_stats()["hits"], hits + 1)
+        self.assertEqual(e.get_attr("maximum"), 0)
+        
+        EMUtil.set_pool_limit(0)
+        del e
+        self.assertEqual(EMUtil.get_pool_stats()["cached_bytes"], 0)
+        EMUtil.set_pool_limit(limit)
+        
     def test_get_euler_names(self):
         """test get_euler_names ............................."""
         l1 = EMUtil.get_euler_names('EMAN')